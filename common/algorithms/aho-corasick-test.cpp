@@ -0,0 +1,91 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/algorithms/aho-corasick.h"
+
+namespace {
+
+using matches_t = std::vector<std::pair<size_t, size_t>>;
+
+matches_t find_all(const std::vector<vk::string_view> &patterns, const std::string &text) {
+  const vk::AhoCorasick automaton{patterns};
+  matches_t result;
+  automaton.find_leftmost_longest(text.data(), text.size(), [&result](size_t pos, size_t pattern) {
+    result.emplace_back(pos, pattern);
+  });
+  return result;
+}
+
+// the reference implementation, the same as php strtr() does
+matches_t find_all_naive(const std::vector<vk::string_view> &patterns, const std::string &text) {
+  matches_t result;
+  for (size_t pos = 0; pos < text.size();) {
+    size_t best = patterns.size();
+    for (size_t i = 0; i < patterns.size(); ++i) {
+      if (vk::string_view{text}.substr(pos).starts_with(patterns[i]) && (best == patterns.size() || patterns[best].size() < patterns[i].size())) {
+        best = i;
+      }
+    }
+    if (best == patterns.size()) {
+      ++pos;
+    } else {
+      result.emplace_back(pos, best);
+      pos += patterns[best].size();
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+TEST(aho_corasick_test, empty) {
+  ASSERT_TRUE(find_all({}, "abc").empty());
+  ASSERT_TRUE(find_all({"abc"}, "").empty());
+  ASSERT_TRUE(find_all({"abc"}, "ab").empty());
+}
+
+TEST(aho_corasick_test, leftmost_longest) {
+  ASSERT_EQ(find_all({"a", "ab", "abc"}, "xabcabx"), (matches_t{{1, 2}, {4, 1}}));
+  ASSERT_EQ(find_all({"bc", "ab"}, "abc"), (matches_t{{0, 1}}));
+  ASSERT_EQ(find_all({"abcd", "bc"}, "abce"), (matches_t{{1, 1}}));
+  ASSERT_EQ(find_all({"aa"}, "aaaaa"), (matches_t{{0, 0}, {2, 0}}));
+  ASSERT_EQ(find_all({"he", "she", "his", "hers"}, "ushers"), (matches_t{{1, 1}}));
+  ASSERT_EQ(find_all({"he", "she", "his", "hers"}, "hishers"), (matches_t{{0, 2}, {3, 3}}));
+}
+
+TEST(aho_corasick_test, duplicated_patterns) {
+  ASSERT_EQ(find_all({"ab", "b", "ab"}, "abab"), (matches_t{{0, 0}, {2, 0}}));
+}
+
+TEST(aho_corasick_test, binary) {
+  const std::string text("\0\xff\x80\0\xff", 5);
+  ASSERT_EQ(find_all({vk::string_view{"\0\xff", 2}, "\x80"}, text), (matches_t{{0, 0}, {2, 1}, {3, 0}}));
+}
+
+TEST(aho_corasick_test, random) {
+  std::mt19937 gen{11};
+  std::uniform_int_distribution<int> byte{'a', 'c'};
+  for (int iteration = 0; iteration < 2000; ++iteration) {
+    std::vector<std::string> patterns_storage(1 + gen() % 8);
+    for (auto &pattern : patterns_storage) {
+      pattern.resize(1 + gen() % 5);
+      for (auto &c : pattern) {
+        c = static_cast<char>(byte(gen));
+      }
+    }
+    std::string text(gen() % 100, '\0');
+    for (auto &c : text) {
+      c = static_cast<char>(byte(gen));
+    }
+    const std::vector<vk::string_view> patterns{patterns_storage.begin(), patterns_storage.end()};
+    ASSERT_EQ(find_all(patterns, text), find_all_naive(patterns, text)) << text;
+  }
+}
@@ -0,0 +1,183 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+#include "common/wrappers/string_view.h"
+
+namespace vk {
+
+// Aho-Corasick automaton over a set of non empty byte patterns, the text is scanned once regardless of the patterns count.
+// The trie edges are kept in sibling lists, except the root, which has the full transitions table:
+// the root is visited on almost every text byte, while the deeper states usually have a couple of children.
+class AhoCorasick {
+public:
+  explicit AhoCorasick(const std::vector<vk::string_view> &patterns) {
+    states_.emplace_back();
+    root_next_.fill(ROOT);
+    lengths_.reserve(patterns.size());
+    for (const auto &pattern : patterns) {
+      add_pattern(pattern);
+    }
+    build_links();
+  }
+
+  size_t patterns_count() const noexcept {
+    return lengths_.size();
+  }
+
+  // Reports non overlapping matches as on_match(position, pattern_index) with the semantics of php strtr():
+  // the text is traversed from left to right, the longest pattern is taken at each position, and the search
+  // continues right after it. If several patterns are equal, the first one is reported.
+  template<class OnMatch>
+  void find_leftmost_longest(const char *text, size_t text_len, const OnMatch &on_match) const {
+    if (max_length_ == 0) {
+      return;
+    }
+    // the longest pattern starting at position p is kept in longest[p & ring_mask] until all of them are found
+    size_t ring_mask = 1;
+    while (ring_mask < max_length_) {
+      ring_mask <<= 1;
+    }
+    std::vector<int32_t> longest(ring_mask--, NONE);
+    size_t next_allowed = 0;
+    auto settle = [&](size_t start) {
+      int32_t &slot = longest[start & ring_mask];
+      if (slot != NONE) {
+        if (start >= next_allowed) {
+          on_match(start, static_cast<size_t>(slot));
+          next_allowed = start + lengths_[slot];
+        }
+        slot = NONE;
+      }
+    };
+
+    int32_t state = ROOT;
+    for (size_t i = 0; i != text_len; ++i) {
+      state = next_state(state, static_cast<uint8_t>(text[i]));
+      for (int32_t s = states_[state].output; s != NONE; s = states_[s].dict) {
+        const int32_t pattern = states_[s].pattern;
+        const size_t start = i + 1 - lengths_[pattern];
+        if (start >= next_allowed) {
+          int32_t &slot = longest[start & ring_mask];
+          if (slot == NONE || lengths_[slot] < lengths_[pattern]) {
+            slot = pattern;
+          }
+        }
+      }
+      // no more patterns can start at this position
+      if (i + 1 >= max_length_) {
+        settle(i + 1 - max_length_);
+      }
+    }
+    for (size_t start = text_len >= max_length_ ? text_len - max_length_ + 1 : 0; start < text_len; ++start) {
+      settle(start);
+    }
+  }
+
+private:
+  enum : int32_t {
+    ROOT = 0,
+    NONE = -1
+  };
+
+  struct State {
+    int32_t first_child{NONE};
+    int32_t next_sibling{NONE};
+    int32_t fail{ROOT};
+    // the nearest state by the fail links, which ends a pattern
+    int32_t dict{NONE};
+    // the state itself, if it ends a pattern, or the dict one
+    int32_t output{NONE};
+    // the index of a pattern, which ends in this state
+    int32_t pattern{NONE};
+    uint8_t byte{0};
+  };
+
+  int32_t find_child(int32_t state, uint8_t byte) const noexcept {
+    if (state == ROOT) {
+      return root_next_[byte] == ROOT ? NONE : root_next_[byte];
+    }
+    for (int32_t child = states_[state].first_child; child != NONE; child = states_[child].next_sibling) {
+      if (states_[child].byte == byte) {
+        return child;
+      }
+    }
+    return NONE;
+  }
+
+  int32_t next_state(int32_t state, uint8_t byte) const noexcept {
+    while (state != ROOT) {
+      const int32_t child = find_child(state, byte);
+      if (child != NONE) {
+        return child;
+      }
+      state = states_[state].fail;
+    }
+    return root_next_[byte];
+  }
+
+  void add_pattern(vk::string_view pattern) {
+    assert(!pattern.empty());
+    int32_t state = ROOT;
+    for (char c : pattern) {
+      const auto byte = static_cast<uint8_t>(c);
+      int32_t child = find_child(state, byte);
+      if (child == NONE) {
+        child = static_cast<int32_t>(states_.size());
+        states_.emplace_back();
+        states_[child].byte = byte;
+        if (state == ROOT) {
+          root_next_[byte] = child;
+        } else {
+          states_[child].next_sibling = states_[state].first_child;
+          states_[state].first_child = child;
+        }
+      }
+      state = child;
+    }
+    if (states_[state].pattern == NONE) {
+      states_[state].pattern = static_cast<int32_t>(lengths_.size());
+      states_[state].output = state;
+    }
+    lengths_.emplace_back(pattern.size());
+    max_length_ = std::max(max_length_, pattern.size());
+  }
+
+  void build_links() {
+    std::queue<int32_t> bfs;
+    for (int32_t child : root_next_) {
+      if (child != ROOT) {
+        bfs.push(child);
+      }
+    }
+    while (!bfs.empty()) {
+      const int32_t state = bfs.front();
+      bfs.pop();
+      for (int32_t child = states_[state].first_child; child != NONE; child = states_[child].next_sibling) {
+        const int32_t fail = next_state(states_[state].fail, states_[child].byte);
+        states_[child].fail = fail;
+        states_[child].dict = states_[fail].output;
+        if (states_[child].pattern == NONE) {
+          states_[child].output = states_[child].dict;
+        }
+        bfs.push(child);
+      }
+    }
+  }
+
+  std::vector<State> states_;
+  std::array<int32_t, 256> root_next_;
+  std::vector<size_t> lengths_;
+  size_t max_length_{0};
+};
+
+} // namespace vk
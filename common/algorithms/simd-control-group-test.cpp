@@ -0,0 +1,62 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <array>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/algorithms/simd-control-group.h"
+
+using namespace simd_control_group;
+
+namespace {
+std::vector<uint32_t> to_vector(Group::Mask mask) {
+  std::vector<uint32_t> result;
+  for (; mask; ++mask) {
+    result.emplace_back(mask.lowest());
+  }
+  return result;
+}
+} // namespace
+
+TEST(simd_control_group_test, make_full) {
+  ASSERT_EQ(make_full(0), 0x80);
+  ASSERT_EQ(make_full(-1), 0xff);
+  ASSERT_EQ(make_full(int64_t{1} << 57), 0x81);
+}
+
+TEST(simd_control_group_test, match) {
+  std::array<uint8_t, Group::WIDTH> ctrl{};
+  ctrl[1] = 0x85;
+  ctrl[3] = 0x86;
+  ctrl[Group::WIDTH - 1] = 0x85;
+
+  const Group group{ctrl.data()};
+  ASSERT_EQ(to_vector(group.match(0x85)), (std::vector<uint32_t>{1, Group::WIDTH - 1}));
+  ASSERT_EQ(to_vector(group.match(0x86)), (std::vector<uint32_t>{3}));
+  ASSERT_TRUE(to_vector(group.match(0x87)).empty());
+
+  const auto empty = to_vector(group.match_empty());
+  ASSERT_EQ(empty.size(), Group::WIDTH - 3);
+  ASSERT_EQ(empty.front(), 0);
+  ASSERT_EQ(empty[1], 2);
+}
+
+TEST(simd_control_group_test, set_ctrl_mirrors_beginning) {
+  constexpr uint32_t slots = 3;
+  std::array<uint8_t, slots + cloned_bytes()> ctrl{};
+  set_ctrl(ctrl.data(), 1, slots, 0x90);
+  for (uint32_t i = 0; i < ctrl.size(); ++i) {
+    ASSERT_EQ(ctrl[i], i % slots == 1 ? 0x90 : EMPTY);
+  }
+
+  std::vector<uint8_t> large(100 + cloned_bytes(), EMPTY);
+  set_ctrl(large.data(), 0, 100, 0x91);
+  set_ctrl(large.data(), 99, 100, 0x92);
+  ASSERT_EQ(large[0], 0x91);
+  ASSERT_EQ(large[100], 0x91);
+  ASSERT_EQ(large[99], 0x92);
+  ASSERT_EQ(large[101], EMPTY);
+}
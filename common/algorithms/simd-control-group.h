@@ -0,0 +1,121 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+// Swiss table like control bytes, which are used for probing open addressing hash tables,
+// see https://abseil.io/about/design/swisstables
+// Each slot of a hash table has one control byte:
+//   0x00 - the slot is empty,
+//   0x80 | h2 - the slot is full, h2 is 7 high bits of the element hash.
+// A group of control bytes is loaded and matched at once, so there is no need to touch the slots themselves
+// until the high bits of the hash are matched.
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+namespace simd_control_group {
+
+constexpr uint8_t EMPTY = 0;
+
+inline uint8_t make_full(int64_t hash) noexcept {
+  return static_cast<uint8_t>(0x80 | (static_cast<uint64_t>(hash) >> 57));
+}
+
+// iterates over the matched slots within a group, the slot offsets are returned in increasing order
+template<uint32_t Shift>
+class BitMask {
+public:
+  explicit BitMask(uint64_t mask) noexcept:
+    mask_(mask) {}
+
+  explicit operator bool() const noexcept {
+    return mask_ != 0;
+  }
+
+  uint32_t lowest() const noexcept {
+    return static_cast<uint32_t>(__builtin_ctzll(mask_)) >> Shift;
+  }
+
+  BitMask &operator++() noexcept {
+    mask_ &= mask_ - 1;
+    return *this;
+  }
+
+private:
+  uint64_t mask_{0};
+};
+
+#if defined(__x86_64__)
+
+class Group {
+public:
+  static constexpr uint32_t WIDTH = 16;
+  using Mask = BitMask<0>;
+
+  explicit Group(const uint8_t *ctrl) noexcept:
+    ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl))) {}
+
+  Mask match(uint8_t h) const noexcept {
+    return Mask{static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(h)), ctrl_)))};
+  }
+
+  Mask match_empty() const noexcept {
+    return Mask{static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_setzero_si128(), ctrl_)))};
+  }
+
+private:
+  __m128i ctrl_;
+};
+
+#else
+
+// portable SWAR implementation, 8 control bytes are matched at once
+class Group {
+public:
+  static constexpr uint32_t WIDTH = 8;
+  using Mask = BitMask<3>;
+
+  explicit Group(const uint8_t *ctrl) noexcept {
+    std::memcpy(&ctrl_, ctrl, sizeof(ctrl_));
+  }
+
+  // may have false positives, the slot should be checked anyway
+  Mask match(uint8_t h) const noexcept {
+    const uint64_t x = ctrl_ ^ (LSBS * h);
+    return Mask{(x - LSBS) & ~x & MSBS};
+  }
+
+  // exact, because full control bytes have the highest bit set
+  Mask match_empty() const noexcept {
+    return Mask{(ctrl_ - LSBS) & ~ctrl_ & MSBS};
+  }
+
+private:
+  static constexpr uint64_t LSBS = 0x0101010101010101ULL;
+  static constexpr uint64_t MSBS = 0x8080808080808080ULL;
+
+  uint64_t ctrl_{0};
+};
+
+#endif
+
+// the control bytes array has WIDTH - 1 extra bytes in the end, they mirror the beginning of the array
+// (cyclically, if the array is smaller than a group) and allow to load a group from any position without wrapping
+constexpr uint32_t cloned_bytes() noexcept {
+  return Group::WIDTH - 1;
+}
+
+inline void set_ctrl(uint8_t *ctrl, uint32_t slot, uint32_t slots_count, uint8_t value) noexcept {
+  ctrl[slot] = value;
+  for (uint32_t i = slot + slots_count; i < slots_count + cloned_bytes(); i += slots_count) {
+    ctrl[i] = value;
+  }
+}
+
+} // namespace simd_control_group
@@ -0,0 +1,80 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/algorithms/aho-corasick.h"
+#include "common/algorithms/string-search.h"
+
+namespace {
+
+// a text-like haystack: the needle bytes are frequent, but the needle itself occurs only in the end
+std::string make_haystack(size_t len, const std::string &needle) {
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> byte{'a', 'z'};
+  std::string haystack(len, ' ');
+  for (auto &c : haystack) {
+    c = static_cast<char>(byte(gen));
+  }
+  haystack.replace(haystack.size() - needle.size(), needle.size(), needle);
+  return haystack;
+}
+
+template<const char *(*find)(const char *, size_t, const char *, size_t) noexcept>
+void BM_find_substring(benchmark::State &state) {
+  const std::string needle = "kphp_needle";
+  const std::string haystack = make_haystack(state.range(0), needle);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(find(haystack.data(), haystack.size(), needle.data(), needle.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * haystack.size());
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_find_substring, vk::find_substring_generic)->RangeMultiplier(16)->Range(16, 1 << 20);
+#if defined(__x86_64__)
+BENCHMARK_TEMPLATE(BM_find_substring, vk::find_substring_sse2)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_find_substring, vk::find_substring_avx2)->RangeMultiplier(16)->Range(16, 1 << 20);
+#endif
+
+// strtr() with many pairs: one pass of the automaton vs a search of each pattern
+static void BM_aho_corasick_many_patterns(benchmark::State &state) {
+  std::vector<std::string> patterns_storage;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    patterns_storage.emplace_back("pattern_" + std::to_string(i));
+  }
+  const std::vector<vk::string_view> patterns{patterns_storage.begin(), patterns_storage.end()};
+  const std::string text = make_haystack(64 * 1024, patterns_storage.back());
+  for (auto _ : state) {
+    const vk::AhoCorasick automaton{patterns};
+    size_t found = 0;
+    automaton.find_leftmost_longest(text.data(), text.size(), [&found](size_t, size_t) { ++found; });
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_aho_corasick_many_patterns)->RangeMultiplier(4)->Range(4, 1024);
+
+static void BM_find_substring_many_patterns(benchmark::State &state) {
+  std::vector<std::string> patterns;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    patterns.emplace_back("pattern_" + std::to_string(i));
+  }
+  const std::string text = make_haystack(64 * 1024, patterns.back());
+  for (auto _ : state) {
+    size_t found = 0;
+    for (const auto &pattern : patterns) {
+      found += vk::find_substring(text.data(), text.size(), pattern.data(), pattern.size()) != nullptr;
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_find_substring_many_patterns)->RangeMultiplier(4)->Range(4, 1024);
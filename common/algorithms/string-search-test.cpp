@@ -0,0 +1,84 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/algorithms/string-search.h"
+
+namespace {
+
+using find_substring_t = const char *(*)(const char *, size_t, const char *, size_t) noexcept;
+
+std::vector<find_substring_t> get_implementations() {
+  std::vector<find_substring_t> result{vk::find_substring, vk::find_substring_generic};
+#if defined(__x86_64__)
+  result.emplace_back(vk::find_substring_sse2);
+  if (vk::string_search_has_avx2_extension()) {
+    result.emplace_back(vk::find_substring_avx2);
+  }
+#endif
+  return result;
+}
+
+void check_find(const std::string &haystack, const std::string &needle) {
+  const char *expected = static_cast<const char *>(memmem(haystack.data(), haystack.size(), needle.data(), needle.size()));
+  for (auto find : get_implementations()) {
+    ASSERT_EQ(find(haystack.data(), haystack.size(), needle.data(), needle.size()), expected) << "haystack: '" << haystack << "', needle: '" << needle << "'";
+  }
+}
+
+} // namespace
+
+TEST(string_search_test, trivial) {
+  check_find("", "");
+  check_find("abc", "");
+  check_find("", "a");
+  check_find("abc", "abcd");
+  check_find("abc", "c");
+  check_find("abc", "d");
+}
+
+TEST(string_search_test, needle_positions) {
+  const std::string needle = "needle";
+  for (size_t len = needle.size(); len < 100; ++len) {
+    for (size_t pos = 0; pos + needle.size() <= len; ++pos) {
+      std::string haystack(len, 'n');
+      haystack.replace(pos, needle.size(), needle);
+      check_find(haystack, needle);
+      check_find(haystack, "nn");
+      check_find(haystack, "ne");
+      check_find(haystack, "needlf");
+    }
+  }
+}
+
+TEST(string_search_test, zero_bytes) {
+  const std::string haystack("abc\0\0def\0gh\0ij" "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz\0x", 69);
+  check_find(haystack, std::string("\0x", 2));
+  check_find(haystack, std::string("\0g", 2));
+  check_find(haystack, std::string("\0\0d", 3));
+  check_find(haystack, "yz");
+}
+
+TEST(string_search_test, random) {
+  std::mt19937 gen{7};
+  std::uniform_int_distribution<int> byte{'a', 'c'};
+  std::uniform_int_distribution<size_t> len{0, 200};
+  for (int iteration = 0; iteration < 10000; ++iteration) {
+    std::string haystack(len(gen), '\0');
+    for (auto &c : haystack) {
+      c = static_cast<char>(byte(gen));
+    }
+    std::string needle(len(gen) % 8, '\0');
+    for (auto &c : needle) {
+      c = static_cast<char>(byte(gen));
+    }
+    check_find(haystack, needle);
+  }
+}
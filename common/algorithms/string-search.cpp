@@ -0,0 +1,132 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/algorithms/string-search.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+#include "common/cpuid.h"
+#endif
+
+namespace vk {
+
+namespace {
+
+using find_substring_t = const char *(*)(const char *, size_t, const char *, size_t) noexcept;
+
+// handles the cases, when there is nothing to filter: returns true if the result is already known
+inline bool find_substring_trivial(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len, const char *&result) noexcept {
+  if (needle_len == 0) {
+    result = haystack;
+    return true;
+  }
+  if (needle_len > haystack_len) {
+    result = nullptr;
+    return true;
+  }
+  if (needle_len == 1) {
+    result = static_cast<const char *>(memchr(haystack, *needle, haystack_len));
+    return true;
+  }
+  return false;
+}
+
+} // namespace
+
+const char *find_substring_generic(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) noexcept {
+  return static_cast<const char *>(memmem(haystack, haystack_len, needle, needle_len));
+}
+
+#if defined(__x86_64__)
+
+bool string_search_has_avx2_extension() noexcept {
+  const kdb_cpuid_t *cpuid = kdb_cpuid();
+  assert(cpuid->type == KDB_CPUID_X86_64);
+
+  // avx and osxsave
+  if ((cpuid->x86_64.ecx & 0x18000000) != 0x18000000) {
+    return false;
+  }
+  // the os saves xmm and ymm registers on context switches
+  uint32_t xcr0_lo = 0, xcr0_hi = 0;
+  asm volatile("xgetbv\n\t" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  if ((xcr0_lo & 0x6) != 0x6) {
+    return false;
+  }
+  return cpuid->x86_64.leaf7_ebx & (1 << 5);
+}
+
+const char *find_substring_sse2(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) noexcept {
+  const char *result = nullptr;
+  if (find_substring_trivial(haystack, haystack_len, needle, needle_len, result)) {
+    return result;
+  }
+
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+  size_t i = 0;
+  for (; i + needle_len + 15 <= haystack_len; i += 16) {
+    const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+    const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + needle_len - 1));
+    uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last)));
+    for (; mask; mask &= mask - 1) {
+      const size_t pos = i + __builtin_ctz(mask);
+      if (memcmp(haystack + pos + 1, needle + 1, needle_len - 2) == 0) {
+        return haystack + pos;
+      }
+    }
+  }
+  return find_substring_generic(haystack + i, haystack_len - i, needle, needle_len);
+}
+
+__attribute__((target("avx2")))
+const char *find_substring_avx2(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) noexcept {
+  const char *result = nullptr;
+  if (find_substring_trivial(haystack, haystack_len, needle, needle_len, result)) {
+    return result;
+  }
+
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+  size_t i = 0;
+  for (; i + needle_len + 31 <= haystack_len; i += 32) {
+    const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+    const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i + needle_len - 1));
+    uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last)));
+    for (; mask; mask &= mask - 1) {
+      const size_t pos = i + __builtin_ctz(mask);
+      if (memcmp(haystack + pos + 1, needle + 1, needle_len - 2) == 0) {
+        return haystack + pos;
+      }
+    }
+  }
+  // the tail is shorter than two blocks, so the sse2 version will process most of it
+  return find_substring_sse2(haystack + i, haystack_len - i, needle, needle_len);
+}
+
+static find_substring_t find_substring_impl = find_substring_sse2;
+
+static void string_search_init() __attribute__((constructor(101)));
+static void string_search_init() {
+  if (string_search_has_avx2_extension()) {
+    find_substring_impl = find_substring_avx2;
+  }
+}
+
+#else
+
+static find_substring_t find_substring_impl = find_substring_generic;
+
+#endif
+
+const char *find_substring(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) noexcept {
+  return find_substring_impl(haystack, haystack_len, needle, needle_len);
+}
+
+} // namespace vk
@@ -0,0 +1,27 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cstddef>
+
+namespace vk {
+
+// The same as memmem(): returns a pointer to the first occurrence of the needle in the haystack or nullptr.
+// Candidate positions are filtered by the first and the last bytes of the needle with SIMD compares,
+// the middle part is checked only for the positions where both of them match.
+// The widest implementation supported by the cpu (AVX2 or SSE2 on x86_64) is chosen once on startup.
+const char *find_substring(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) noexcept;
+
+// the concrete implementations are exposed for tests and benchmarks
+const char *find_substring_generic(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) noexcept;
+
+#if defined(__x86_64__)
+bool string_search_has_avx2_extension() noexcept;
+
+const char *find_substring_sse2(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) noexcept;
+const char *find_substring_avx2(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) noexcept;
+#endif
+
+} // namespace vk
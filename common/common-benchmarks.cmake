@@ -0,0 +1,2 @@
+set(COMMON_BENCHMARKS_LIBS vk::common_src vk::net_src vk::binlog_src vk::unicode -l:libzstd.a rt crypto z)
+vk_add_benchmark(fiber-context "${COMMON_BENCHMARKS_LIBS}" ${COMMON_DIR}/fiber-context-benchmark.cpp)
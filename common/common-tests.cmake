@@ -1,19 +1,26 @@
 prepend(COMMON_TESTS_SOURCES ${COMMON_DIR}/
+        algorithms/aho-corasick-test.cpp
         algorithms/compare-test.cpp
         algorithms/contains-test.cpp
         algorithms/hashes-test.cpp
         algorithms/projections-test.cpp
+        algorithms/simd-control-group-test.cpp
         algorithms/simd-int-to-string-test.cpp
         algorithms/string-algorithms-test.cpp
+        algorithms/string-search-test.cpp
         allocators/freelist-test.cpp
         allocators/lockfree-slab-test.cpp
         crc32c-test.cpp
         crypto/aes256-test.cpp
+        fiber-context-test.cpp
         parallel/counter-test.cpp
         parallel/limit-counter-test.cpp
         parallel/maximum-test.cpp
+        parallel/seqlock-test.cpp
         smart_iterators/smart-iterators-test.cpp
         smart_ptrs/tagged-ptr-test.cpp
+        stats/hdr-histogram-test.cpp
+        tl/methods/zstd-dictionaries-test.cpp
         type_traits/list_of_types_test.cpp
         wrappers/span-test.cpp
         wrappers/string_view-test.cpp)
@@ -2,6 +2,7 @@ prepend(COMMON_MAIN_SOURCES ${COMMON_DIR}/
         pipe-utils.cpp
         pid.cpp
         dl-utils-lite.cpp
+        algorithms/string-search.cpp
         server/stats.cpp
         server/statsd-client.cpp
         server/init-binlog.cpp
@@ -17,6 +18,7 @@ prepend(COMMON_MAIN_SOURCES ${COMMON_DIR}/
         crypto/aes256-${HOST}.cpp
 
         fast-backtrace.cpp
+        fiber-context-${HOST}.cpp
         string-processing.cpp
         kphp-tasks-lease/lease-worker-mode.cpp)
 
@@ -33,7 +35,8 @@ prepend(COMMON_TL_SOURCES ${COMMON_DIR}/tl/
 
 prepend(COMMON_TL_METHODS_SOURCES ${COMMON_DIR}/tl/methods/
         rwm.cpp
-        string.cpp)
+        string.cpp
+        zstd-dictionaries.cpp)
 
 set(COMMON_ALL_SOURCES
     ${COMMON_MAIN_SOURCES}
@@ -13,6 +13,8 @@ typedef struct {
   union {
     struct {
       int ebx, ecx, edx;
+      // ebx of the structured extended feature flags leaf (eax = 7, ecx = 0), zero if the leaf isn't supported
+      int leaf7_ebx;
     } x86_64;
   };
 } kdb_cpuid_t;
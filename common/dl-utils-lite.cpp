@@ -246,6 +246,58 @@ int get_mem_stats (pid_t pid, mem_info_t *info) {
 #undef TMEM_SIZE
 }
 
+int get_mem_sharing_stats (pid_t pid, mem_info_t *info) {
+#define TMEM_SIZE 10000
+  static char mem[TMEM_SIZE];
+  info->rss_shared = 0;
+  info->rss_private = 0;
+
+  snprintf (mem, TMEM_SIZE, "/proc/%lu/smaps_rollup", (unsigned long)pid);
+  int fd = open (mem, O_RDONLY);
+
+  if (fd == -1) {
+    return 0;
+  }
+
+  int size = (int)read (fd, mem, TMEM_SIZE - 1);
+  close (fd);
+  if (size <= 0) {
+    return 0;
+  }
+  mem[size] = 0;
+
+  char *s = mem;
+  while (*s) {
+    char *st = s;
+    while (*s != 0 && *s != '\n') {
+      s++;
+    }
+    unsigned long long *x = NULL;
+    if (strncmp (st, "Shared_Clean:", 13) == 0 || strncmp (st, "Shared_Dirty:", 13) == 0) {
+      x = &info->rss_shared;
+    }
+    if (strncmp (st, "Private_Clean:", 14) == 0 || strncmp (st, "Private_Dirty:", 14) == 0) {
+      x = &info->rss_private;
+    }
+    if (x != NULL) {
+      while (st < s && *st != ' ' && *st != '\t') {
+        st++;
+      }
+      unsigned long long value = 0;
+      if (st < s && sscanf (st, "%llu", &value) == 1) {
+        *x += value;
+      }
+    }
+    if (*s == 0) {
+      break;
+    }
+    s++;
+  }
+
+  return 1;
+#undef TMEM_SIZE
+}
+
 int get_pid_info (pid_t pid, pid_info_t *info) {
 #define TMEM_SIZE 10000
   static char mem[TMEM_SIZE];
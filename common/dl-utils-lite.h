@@ -57,9 +57,13 @@ typedef struct {
   unsigned long long rss;
   unsigned long long rss_file;
   unsigned long long rss_shmem;
+  unsigned long long rss_shared;
+  unsigned long long rss_private;
 } mem_info_t;
 
 int get_mem_stats (pid_t pid, mem_info_t *info);
+// fills rss_shared and rss_private: resident pages shared with other processes (e.g. copy-on-write with the parent) and owned only by this one
+int get_mem_sharing_stats (pid_t pid, mem_info_t *info);
 int get_pid_info (pid_t pid, pid_info_t *info);
 unsigned long long get_pid_start_time (pid_t pid);
 int get_cpu_total (unsigned long long *cpu_total);
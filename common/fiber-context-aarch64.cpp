@@ -0,0 +1,91 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/fiber-context.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "common/sanitizer.h"
+
+// The stack of a left context (from its sp up):
+//   d8 - d15, x19 - x28, x29 (frame pointer), x30 (link register)
+asm(R"(
+  .text
+  .globl fiber_context_switch
+  .type fiber_context_switch, %function
+  .p2align 4
+fiber_context_switch:
+  .cfi_startproc
+  sub sp, sp, #0xa0
+  stp d8, d9, [sp, #0x00]
+  stp d10, d11, [sp, #0x10]
+  stp d12, d13, [sp, #0x20]
+  stp d14, d15, [sp, #0x30]
+  stp x19, x20, [sp, #0x40]
+  stp x21, x22, [sp, #0x50]
+  stp x23, x24, [sp, #0x60]
+  stp x25, x26, [sp, #0x70]
+  stp x27, x28, [sp, #0x80]
+  stp x29, x30, [sp, #0x90]
+
+  mov x9, sp
+  str x9, [x0]
+  ldr x9, [x1]
+  mov sp, x9
+
+  ldp d8, d9, [sp, #0x00]
+  ldp d10, d11, [sp, #0x10]
+  ldp d12, d13, [sp, #0x20]
+  ldp d14, d15, [sp, #0x30]
+  ldp x19, x20, [sp, #0x40]
+  ldp x21, x22, [sp, #0x50]
+  ldp x23, x24, [sp, #0x60]
+  ldp x25, x26, [sp, #0x70]
+  ldp x27, x28, [sp, #0x80]
+  ldp x29, x30, [sp, #0x90]
+  add sp, sp, #0xa0
+  ret
+  .cfi_endproc
+  .size fiber_context_switch, .-fiber_context_switch
+
+  .globl fiber_context_trampoline
+  .type fiber_context_trampoline, %function
+  .p2align 4
+fiber_context_trampoline:
+  .cfi_startproc
+  .cfi_undefined x30
+  blr x19
+  brk #0
+  .cfi_endproc
+  .size fiber_context_trampoline, .-fiber_context_trampoline
+)");
+
+extern "C" void fiber_context_trampoline();
+
+namespace {
+
+struct initial_frame {
+  uint64_t d[8];
+  uint64_t x19_x28[10];
+  uint64_t x29, x30;
+};
+
+static_assert(sizeof(initial_frame) == 0xa0, "must be the same as in fiber_context_switch");
+
+} // namespace
+
+void fiber_context_make(fiber_context_t *ctx, void *stack, size_t stack_size, void (*entry)()) noexcept {
+#if ASAN_ENABLED
+  // the stack may be left poisoned by the frames of the previous fiber, which have never returned
+  ASAN_UNPOISON_MEMORY_REGION(stack, stack_size);
+#endif
+  auto stack_top = (reinterpret_cast<uintptr_t>(stack) + stack_size) & ~uintptr_t{15};
+  auto *frame = reinterpret_cast<initial_frame *>(stack_top - sizeof(initial_frame));
+  std::memset(frame, 0, sizeof(initial_frame));
+  frame->x19_x28[0] = reinterpret_cast<uint64_t>(entry);
+  // ret of fiber_context_switch jumps to the trampoline, the zero frame pointer terminates backtraces
+  frame->x30 = reinterpret_cast<uint64_t>(&fiber_context_trampoline);
+  ctx->sp = frame;
+}
@@ -0,0 +1,63 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <benchmark/benchmark.h>
+
+#include <ucontext.h>
+#include <vector>
+
+#include "common/fiber-context.h"
+
+// Every iteration is a round trip: a switch to the fiber and back,
+// as a script does for every net query it waits for.
+
+namespace {
+
+ucontext_t main_ucontext;
+ucontext_t fiber_ucontext;
+
+void ucontext_fiber_entry() {
+  while (true) {
+    swapcontext(&fiber_ucontext, &main_ucontext);
+  }
+}
+
+fiber_context_t main_context;
+fiber_context_t fiber_context;
+
+void fiber_entry() {
+  while (true) {
+    fiber_context_switch(&fiber_context, &main_context);
+  }
+}
+
+} // namespace
+
+static void BM_fiber_switch_swapcontext(benchmark::State &state) {
+  std::vector<char> stack(64 * 1024);
+  getcontext(&fiber_ucontext);
+  fiber_ucontext.uc_stack.ss_sp = stack.data();
+  fiber_ucontext.uc_stack.ss_size = stack.size();
+  fiber_ucontext.uc_link = nullptr;
+  makecontext(&fiber_ucontext, &ucontext_fiber_entry, 0);
+
+  for (auto _ : state) {
+    swapcontext(&main_ucontext, &fiber_ucontext);
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_fiber_switch_swapcontext);
+
+static void BM_fiber_switch_fiber_context(benchmark::State &state) {
+  std::vector<char> stack(64 * 1024);
+  fiber_context_make(&fiber_context, stack.data(), stack.size(), &fiber_entry);
+
+  for (auto _ : state) {
+    fiber_context_switch(&main_context, &fiber_context);
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_fiber_switch_fiber_context);
+
+BENCHMARK_MAIN();
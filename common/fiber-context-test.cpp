@@ -0,0 +1,66 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/fiber-context.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+fiber_context_t main_context;
+fiber_context_t fiber_context;
+
+std::vector<int> events;
+double fiber_value = 0;
+uintptr_t fiber_frame_address = 0;
+
+void fiber_entry() {
+  fiber_frame_address = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+  for (int i = 0;; ++i) {
+    events.push_back(i);
+    // the floating point computations are done on the both sides between the switches
+    fiber_value = std::sqrt(fiber_value + i);
+    fiber_context_switch(&fiber_context, &main_context);
+  }
+}
+
+} // namespace
+
+TEST(fiber_context, ping_pong) {
+  std::vector<char> stack(64 * 1024);
+  fiber_context_make(&fiber_context, stack.data(), stack.size(), fiber_entry);
+
+  events.clear();
+  double main_value = 1;
+  volatile int64_t callee_saved_check = 42;
+  for (int i = 0; i < 1000; ++i) {
+    fiber_context_switch(&main_context, &fiber_context);
+    main_value = main_value * 1.5 + i;
+    ASSERT_EQ(events.size(), i + 1);
+    ASSERT_EQ(events.back(), i);
+  }
+  ASSERT_EQ(callee_saved_check, 42);
+  ASSERT_GT(main_value, 1.0);
+  ASSERT_GT(fiber_value, 0.0);
+
+  ASSERT_GE(fiber_frame_address, reinterpret_cast<uintptr_t>(stack.data()));
+  ASSERT_LT(fiber_frame_address, reinterpret_cast<uintptr_t>(stack.data() + stack.size()));
+  // the frame of the entry function is aligned as the ABI requires
+  ASSERT_EQ(fiber_frame_address % 16, 0);
+}
+
+TEST(fiber_context, restart) {
+  std::vector<char> stack(64 * 1024);
+  for (int attempt = 0; attempt < 3; ++attempt) {
+    events.clear();
+    fiber_context_make(&fiber_context, stack.data(), stack.size(), fiber_entry);
+    fiber_context_switch(&main_context, &fiber_context);
+    fiber_context_switch(&main_context, &fiber_context);
+    ASSERT_EQ(events, (std::vector<int>{0, 1}));
+  }
+}
@@ -0,0 +1,93 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/fiber-context.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "common/sanitizer.h"
+
+// The stack of a left context (from its sp up):
+//   mxcsr (4 bytes), x87 control word (2 bytes), padding (10 bytes),
+//   r15, r14, r13, r12, rbx, rbp,
+//   return address
+asm(R"(
+  .text
+  .globl fiber_context_switch
+  .type fiber_context_switch, @function
+  .p2align 4
+fiber_context_switch:
+  .cfi_startproc
+  pushq %rbp
+  pushq %rbx
+  pushq %r12
+  pushq %r13
+  pushq %r14
+  pushq %r15
+  subq $16, %rsp
+  stmxcsr (%rsp)
+  fnstcw 4(%rsp)
+
+  movq %rsp, (%rdi)
+  movq (%rsi), %rsp
+
+  ldmxcsr (%rsp)
+  fldcw 4(%rsp)
+  addq $16, %rsp
+  popq %r15
+  popq %r14
+  popq %r13
+  popq %r12
+  popq %rbx
+  popq %rbp
+  ret
+  .cfi_endproc
+  .size fiber_context_switch, .-fiber_context_switch
+
+  .globl fiber_context_trampoline
+  .type fiber_context_trampoline, @function
+  .p2align 4
+fiber_context_trampoline:
+  .cfi_startproc
+  .cfi_undefined rip
+  callq *%r12
+  ud2
+  .cfi_endproc
+  .size fiber_context_trampoline, .-fiber_context_trampoline
+)");
+
+extern "C" void fiber_context_trampoline();
+
+namespace {
+
+struct initial_frame {
+  uint32_t mxcsr;
+  uint16_t x87_control_word;
+  uint8_t padding[10];
+  uint64_t r15, r14, r13, r12, rbx, rbp;
+  uint64_t return_address;
+  // the trampoline gets control with rsp aligned by 16, as a function before the call instruction
+  uint64_t trampoline_frame[2];
+};
+
+static_assert(sizeof(initial_frame) % 16 == 8, "rsp must be aligned by 16 after the return to the trampoline");
+
+} // namespace
+
+void fiber_context_make(fiber_context_t *ctx, void *stack, size_t stack_size, void (*entry)()) noexcept {
+#if ASAN_ENABLED
+  // the stack may be left poisoned by the frames of the previous fiber, which have never returned
+  ASAN_UNPOISON_MEMORY_REGION(stack, stack_size);
+#endif
+  auto stack_top = (reinterpret_cast<uintptr_t>(stack) + stack_size) & ~uintptr_t{15};
+  auto *frame = reinterpret_cast<initial_frame *>(stack_top - sizeof(initial_frame));
+  std::memset(frame, 0, sizeof(initial_frame));
+  // rbp is zero to terminate backtraces; the default values of the control registers, see the System V x86-64 ABI
+  frame->mxcsr = 0x1F80;
+  frame->x87_control_word = 0x037F;
+  frame->r12 = reinterpret_cast<uint64_t>(entry);
+  frame->return_address = reinterpret_cast<uint64_t>(&fiber_context_trampoline);
+  ctx->sp = frame;
+}
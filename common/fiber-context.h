@@ -0,0 +1,23 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cstddef>
+
+// A replacement of makecontext(3)/swapcontext(3) for switching between the stacks within one thread.
+// Only the callee-saved registers are saved on the stack of the context being left (the caller-saved ones are
+// already spilled by the compiler around the call), the signal mask is not saved or restored,
+// so a switch doesn't make any syscalls, unlike swapcontext(3) which calls rt_sigprocmask every time.
+struct fiber_context_t {
+  void *sp{nullptr};
+};
+
+// prepares the context to call entry() on the stack [stack, stack + stack_size) when it is switched to first time;
+// entry() must never return, the context should be left by fiber_context_switch() or longjmp-like means only
+void fiber_context_make(fiber_context_t *ctx, void *stack, size_t stack_size, void (*entry)()) noexcept;
+
+// saves the current context to 'from' and continues the execution of 'to';
+// returns when some other context switches back to 'from'
+extern "C" void fiber_context_switch(fiber_context_t *from, const fiber_context_t *to) noexcept;
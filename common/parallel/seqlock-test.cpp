@@ -0,0 +1,93 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/parallel/seqlock.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct consistent_data {
+  uint64_t version;
+  std::array<uint64_t, 15> copies;
+};
+
+consistent_data make_data(uint64_t version) {
+  consistent_data data;
+  data.version = version;
+  data.copies.fill(version * 3 + 1);
+  return data;
+}
+
+} // namespace
+
+TEST(seqlock, store_load) {
+  vk::seqlock<consistent_data> lock;
+  consistent_data data;
+  ASSERT_TRUE(lock.try_load(data));
+  ASSERT_EQ(data.version, 0);
+
+  lock.store(make_data(42));
+  ASSERT_TRUE(lock.try_load(data));
+  ASSERT_EQ(data.version, 42);
+  ASSERT_EQ(data.copies.back(), 42 * 3 + 1);
+
+  lock.reset();
+  ASSERT_TRUE(lock.try_load(data));
+  ASSERT_EQ(data.version, 0);
+}
+
+TEST(seqlock, concurrent_readers_see_consistent_data) {
+  vk::seqlock<consistent_data> lock;
+  lock.store(make_data(1));
+
+  constexpr uint64_t updates = 200000;
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (uint64_t version = 2; version <= updates; ++version) {
+      lock.store(make_data(version));
+    }
+    done = true;
+  });
+
+  std::vector<std::thread> readers;
+  std::atomic<int> inconsistent{0};
+  for (int i = 0; i < 3; ++i) {
+    readers.emplace_back([&] {
+      uint64_t last_version = 0;
+      while (!done) {
+        consistent_data data;
+        if (!lock.try_load(data)) {
+          continue;
+        }
+        for (uint64_t copy : data.copies) {
+          if (copy != data.version * 3 + 1) {
+            inconsistent++;
+          }
+        }
+        // the versions seen by a reader never go back
+        if (data.version < last_version) {
+          inconsistent++;
+        }
+        last_version = data.version;
+      }
+    });
+  }
+
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  ASSERT_EQ(inconsistent, 0);
+
+  consistent_data data;
+  ASSERT_TRUE(lock.try_load(data));
+  ASSERT_EQ(data.version, updates);
+}
@@ -0,0 +1,60 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "common/cacheline.h"
+
+namespace vk {
+
+// Sequence lock for a single writer and any number of readers, which may live in different processes
+// when the seqlock is placed in a shared memory. Neither of them makes syscalls or waits for the other:
+// the writer just updates the data, the readers retry if they have read it in the middle of an update.
+template<class T>
+class KDB_CACHELINE_ALIGNED seqlock {
+  static_assert(std::is_trivially_copyable<T>{}, "seqlock data is copied with memcpy");
+
+public:
+  void store(const T &value) noexcept {
+    // the sequence is left odd if the previous store was interrupted, e.g. by a signal handler that doesn't return
+    const uint32_t seq = seq_.load(std::memory_order_relaxed) & ~1u;
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&data_, &value, sizeof(T));
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  // returns false if every attempt has hit an update, e.g. the writer was killed in the middle of it
+  bool try_load(T &value, int attempts = 1000) const noexcept {
+    for (int i = 0; i < attempts; ++i) {
+      const uint32_t seq_before = seq_.load(std::memory_order_acquire);
+      if (seq_before & 1) {
+        continue;
+      }
+      std::memcpy(&value, &data_, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == seq_before) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // must not be called concurrently with the writer
+  void reset(const T &value = T()) noexcept {
+    std::memcpy(&data_, &value, sizeof(T));
+    seq_.store(0, std::memory_order_release);
+  }
+
+private:
+  std::atomic<uint32_t> seq_{0};
+  T data_{};
+};
+
+} // namespace vk
@@ -188,12 +188,15 @@ bool php_try_to_int(const char *s, size_t l, int64_t *val) {
 }
 
 //returns len of raw string representation or -1 on error
+// size of the runtime string header: size, capacity, reference counter and cached hash
+constexpr int STRING_RAW_HEADER_SIZE = 3 * sizeof(int) + sizeof(int64_t);
+
 inline int string_raw_len(int src_len) {
-  if (src_len < 0 || src_len >= (1 << 30) - 13) {
+  if (src_len < 0 || src_len >= (1 << 30) - STRING_RAW_HEADER_SIZE - 1) {
     return -1;
   }
 
-  return src_len + 13;
+  return src_len + STRING_RAW_HEADER_SIZE + 1;
 }
 
 //returns len of raw string representation and writes it to dest or returns -1 on error
@@ -206,8 +209,11 @@ inline int string_raw(char *dest, int dest_len, const char *src, int src_len) {
   dest_int[0] = src_len;
   dest_int[1] = src_len;
   dest_int[2] = ExtraRefCnt::for_global_const;
-  memcpy(dest + 3 * sizeof(int), src, src_len);
-  dest[3 * sizeof(int) + src_len] = '\0';
+  // raw strings are constant, so their hashes can be computed only here
+  const int64_t hash = string_hash(src, src_len);
+  memcpy(dest + 3 * sizeof(int), &hash, sizeof(hash));
+  memcpy(dest + STRING_RAW_HEADER_SIZE, src, src_len);
+  dest[STRING_RAW_HEADER_SIZE + src_len] = '\0';
 
   return raw_len;
 }
@@ -150,6 +150,11 @@ using thread_safe_refcnt = refcountable<T, std::atomic<size_t>>;
 template <class T>
 using thread_unsafe_refcnt = refcountable<T, size_t>;
 
+template<class Derived, class Base>
+vk::intrusive_ptr<Derived> static_pointer_cast(const vk::intrusive_ptr<Base> &base) {
+  return vk::intrusive_ptr<Derived>{static_cast<Derived *>(base.get())};
+}
+
 template<class Derived, class Base>
 vk::intrusive_ptr<Derived> dynamic_pointer_cast(const vk::intrusive_ptr<Base> &base) {
   return base.template try_as<Derived>();
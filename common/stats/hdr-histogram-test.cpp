@@ -0,0 +1,86 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/stats/hdr-histogram.h"
+
+#include <cstdint>
+#include <random>
+
+#include <gtest/gtest.h>
+
+TEST(hdr_histogram, buckets) {
+  const size_t buckets = vk::hdr_histogram::BUCKETS;
+  for (uint64_t value = 0; value < 100000; ++value) {
+    const size_t bucket = vk::hdr_histogram::bucket_of(value);
+    ASSERT_LT(bucket, buckets);
+    ASSERT_LE(value, vk::hdr_histogram::bucket_upper_bound(bucket));
+    if (bucket > 0) {
+      ASSERT_GT(value, vk::hdr_histogram::bucket_upper_bound(bucket - 1));
+    }
+  }
+
+  for (uint64_t value = 0; value < 32; ++value) {
+    ASSERT_EQ(vk::hdr_histogram::bucket_upper_bound(vk::hdr_histogram::bucket_of(value)), value);
+  }
+
+  const uint64_t max_value = (uint64_t{1} << vk::hdr_histogram::MAX_VALUE_BITS) - 1;
+  ASSERT_EQ(vk::hdr_histogram::bucket_of(max_value), buckets - 1);
+  ASSERT_EQ(vk::hdr_histogram::bucket_upper_bound(buckets - 1), max_value);
+  ASSERT_EQ(vk::hdr_histogram::bucket_of(max_value + 1), buckets - 1);
+  ASSERT_EQ(vk::hdr_histogram::bucket_of(UINT64_MAX), buckets - 1);
+}
+
+TEST(hdr_histogram, relative_error) {
+  std::mt19937_64 gen{42};
+  for (int i = 0; i < 100000; ++i) {
+    const uint64_t value = gen() >> (64 - vk::hdr_histogram::MAX_VALUE_BITS + gen() % 30);
+    const uint64_t upper_bound = vk::hdr_histogram::bucket_upper_bound(vk::hdr_histogram::bucket_of(value));
+    ASSERT_LE(value, upper_bound);
+    ASSERT_LE(upper_bound - value, value >> vk::hdr_histogram::SUB_BUCKET_BITS);
+  }
+}
+
+TEST(hdr_histogram, percentiles) {
+  vk::hdr_histogram histogram;
+  ASSERT_EQ(histogram.count(), 0);
+  ASSERT_EQ(histogram.value_at_percentile(0.99), 0);
+
+  for (uint64_t value = 1; value <= 10000; ++value) {
+    histogram.record(value);
+  }
+  ASSERT_EQ(histogram.count(), 10000);
+
+  const double percentiles[] = {0.5, 0.95, 0.99, 0.999};
+  for (double percentile : percentiles) {
+    const auto exact = static_cast<uint64_t>(percentile * 10000);
+    const uint64_t value = histogram.value_at_percentile(percentile);
+    ASSERT_GE(value, exact);
+    ASSERT_LE(value - exact, exact >> vk::hdr_histogram::SUB_BUCKET_BITS);
+  }
+  ASSERT_EQ(histogram.value_at_percentile(0), 1);
+}
+
+TEST(hdr_histogram, merge_is_exact) {
+  // the tail of one of the workers is seen in the merged histogram, unlike the averaged percentiles
+  vk::hdr_histogram fast_worker;
+  vk::hdr_histogram slow_worker;
+  for (int i = 0; i < 990; ++i) {
+    fast_worker.record(10);
+  }
+  for (int i = 0; i < 10; ++i) {
+    slow_worker.record(1000);
+  }
+
+  vk::hdr_histogram merged;
+  merged.add(fast_worker);
+  merged.add(slow_worker);
+  ASSERT_EQ(merged.count(), 1000);
+  ASSERT_EQ(merged.value_at_percentile(0.99), 10);
+  ASSERT_GE(merged.value_at_percentile(0.999), 1000);
+
+  vk::hdr_histogram interval = merged;
+  interval.subtract(fast_worker);
+  ASSERT_EQ(interval.count(), 10);
+  ASSERT_GE(interval.value_at_percentile(0.5), 1000);
+}
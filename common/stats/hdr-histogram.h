@@ -0,0 +1,99 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace vk {
+
+// Log-linear histogram of non-negative integer values, as HdrHistogram does: the values below 2^SUB_BUCKET_BITS are counted exactly,
+// the larger ones fall into 2^SUB_BUCKET_BITS buckets per every power of two, so a value is known with the relative error of 2^-SUB_BUCKET_BITS.
+// Unlike percentiles, the histograms are merged exactly by adding the counts, and a histogram of an interval is a difference of two snapshots.
+class hdr_histogram {
+public:
+  static constexpr int SUB_BUCKET_BITS = 5;
+  // the larger values are counted in the last bucket
+  static constexpr int MAX_VALUE_BITS = 37;
+  static constexpr size_t BUCKETS = static_cast<size_t>(MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+  static size_t bucket_of(uint64_t value) noexcept {
+    if (value < (uint64_t{1} << SUB_BUCKET_BITS)) {
+      return static_cast<size_t>(value);
+    }
+    const int exponent = 63 - __builtin_clzll(value);
+    if (exponent >= MAX_VALUE_BITS) {
+      return BUCKETS - 1;
+    }
+    const int shift = exponent - SUB_BUCKET_BITS;
+    const auto sub_bucket = static_cast<size_t>(value >> shift) - (size_t{1} << SUB_BUCKET_BITS);
+    return (static_cast<size_t>(shift + 1) << SUB_BUCKET_BITS) + sub_bucket;
+  }
+
+  // the highest value which is counted in the bucket
+  static uint64_t bucket_upper_bound(size_t bucket) noexcept {
+    const size_t group = bucket >> SUB_BUCKET_BITS;
+    if (group == 0) {
+      return bucket;
+    }
+    const int shift = static_cast<int>(group) - 1;
+    const uint64_t sub_bucket = (uint64_t{1} << SUB_BUCKET_BITS) + (bucket & ((size_t{1} << SUB_BUCKET_BITS) - 1));
+    return ((sub_bucket + 1) << shift) - 1;
+  }
+
+  void record(uint64_t value) noexcept {
+    ++counts_[bucket_of(value)];
+  }
+
+  void add(const hdr_histogram &other) noexcept {
+    for (size_t i = 0; i != BUCKETS; ++i) {
+      counts_[i] += other.counts_[i];
+    }
+  }
+
+  // other must be an earlier snapshot of this histogram
+  void subtract(const hdr_histogram &other) noexcept {
+    for (size_t i = 0; i != BUCKETS; ++i) {
+      counts_[i] -= std::min(counts_[i], other.counts_[i]);
+    }
+  }
+
+  void reset() noexcept {
+    counts_.fill(0);
+  }
+
+  uint64_t count() const noexcept {
+    uint64_t total = 0;
+    for (uint64_t bucket_count : counts_) {
+      total += bucket_count;
+    }
+    return total;
+  }
+
+  // returns the upper bound of the value at the percentile, percentile is in range [0, 1]
+  uint64_t value_at_percentile(double percentile) const noexcept {
+    const uint64_t total = count();
+    if (!total) {
+      return 0;
+    }
+    const auto rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(percentile * static_cast<double>(total))), 1);
+    uint64_t accumulated = 0;
+    for (size_t i = 0; i != BUCKETS; ++i) {
+      accumulated += counts_[i];
+      if (accumulated >= rank) {
+        return bucket_upper_bound(i);
+      }
+    }
+    return bucket_upper_bound(BUCKETS - 1);
+  }
+
+private:
+  std::array<uint64_t, BUCKETS> counts_{};
+};
+
+} // namespace vk
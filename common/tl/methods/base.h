@@ -19,6 +19,8 @@ struct tl_in_methods : vk::not_copyable {
   virtual void fetch_mark_restore() noexcept = 0;
   virtual void fetch_mark_delete() noexcept = 0;
   virtual int decompress(int version) noexcept = 0;
+  virtual int decompressed_size(int version) noexcept = 0;
+  virtual bool decompress_to(int version, void *dst, int size) noexcept = 0;
   virtual ~tl_in_methods() = default;
 };
 
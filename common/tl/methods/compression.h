@@ -7,5 +7,7 @@
 #define COMPRESSION_VERSION_NONE     0
 #define COMPRESSION_VERSION_TEST_XOR 1
 #define COMPRESSION_VERSION_ZSTD     2
+// zstd with the pre-trained dictionaries, see zstd-dictionaries.h
+#define COMPRESSION_VERSION_ZSTD_DICT 3
 
-#define COMPRESSION_VERSION_MAX      2
+#define COMPRESSION_VERSION_MAX      3
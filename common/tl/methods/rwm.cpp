@@ -4,11 +4,14 @@
 
 #include "common/tl/methods/rwm.h"
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <zstd.h>
 
 #include "common/algorithms/arithmetic.h"
 #include "common/tl/methods/compression.h"
+#include "common/tl/methods/zstd-dictionaries.h"
 #include "common/tl/parse.h"
 
 static inline int rwm_do_xor_compress(void *extra __attribute__((unused)), void *data_, int len) {
@@ -38,7 +41,7 @@ static inline int tl_raw_msg_zstd_compress(void *_extra, const void *data, int l
   return 0;
 }
 
-static void raw_zstd_compress(raw_message_t &rwm) {
+static void raw_zstd_compress(raw_message_t &rwm, int version) {
   raw_message_t out;
   rwm_init(&out, 0);
   static ZSTD_CStream *zstd_stream = nullptr;
@@ -51,7 +54,11 @@ static void raw_zstd_compress(raw_message_t &rwm) {
     buf_len = ZSTD_CStreamOutSize();
     out_buf = static_cast<char *>(malloc(buf_len));
   }
-  ZSTD_initCStream(zstd_stream, 1); // TODO: maybe change compression level?
+  uint32_t tl_magic = 0;
+  if (rwm.total_bytes >= static_cast<int>(sizeof(tl_magic))) {
+    rwm_fetch_lookup(&rwm, &tl_magic, sizeof(tl_magic));
+  }
+  ZstdDictionaries::get().init_cstream(zstd_stream, version, tl_magic, rwm.total_bytes);
   zstd_compression_extra_t extra = {.raw_out = &out, .zstd_stream = zstd_stream, .buffer = out_buf, .buf_len = buf_len};
   rwm_process(&rwm, rwm.total_bytes, tl_raw_msg_zstd_compress, &extra);
   ZSTD_outBuffer output = {.dst = extra.buffer, .size = extra.buf_len, .pos = 0};
@@ -99,29 +106,99 @@ static inline int tl_raw_msg_zstd_decompress(void *_extra, const void *data, int
   return 0;
 }
 
-static void rwm_zstd_decompress(raw_message_t &in) {
-  raw_message_t out;
-  rwm_init(&out, 0);
+static ZSTD_DStream *get_zstd_dstream() {
   static ZSTD_DStream *zstd_stream = nullptr;
   if (zstd_stream == nullptr) {
     zstd_stream = ZSTD_createDStream();
   }
+  return zstd_stream;
+}
+
+// fetches the frame size and prepares the stream to decompress the frame, the frame itself isn't fetched
+static int rwm_zstd_init_decompression(raw_message_t &in, ZSTD_DStream *zstd_stream, int version) {
+  char header[sizeof(int) + ZstdDictionaries::FRAME_HEADER_MAX_SIZE];
+  const int header_size = rwm_fetch_lookup(&in, header, std::min(in.total_bytes, static_cast<int>(sizeof(header))));
+  int len = 0;
+  rwm_fetch_data(&in, &len, sizeof(int));
+  if (header_size < static_cast<int>(sizeof(int)) || len < 0 || len > in.total_bytes) {
+    return -1;
+  }
+  const size_t frame_header_size = std::min(static_cast<size_t>(len), header_size - sizeof(int));
+  if (!ZstdDictionaries::get().init_dstream(zstd_stream, version, header + sizeof(int), frame_header_size)) {
+    return -1;
+  }
+  return len;
+}
+
+static void rwm_zstd_decompress(raw_message_t &in, int version) {
+  raw_message_t out;
+  rwm_init(&out, 0);
+  ZSTD_DStream *zstd_stream = get_zstd_dstream();
   static char *out_buf = nullptr;
   static size_t buf_len = 0;
   if (out_buf == nullptr) {
     buf_len = ZSTD_DStreamOutSize();
     out_buf = static_cast<char *>(malloc(buf_len));
   }
-  ZSTD_initDStream(zstd_stream);
   zstd_decompression_extra_t extra = {.raw_out = &out, .zstd_stream = zstd_stream, .buffer = out_buf, .buf_len = buf_len};
-  int len = 0;
-  rwm_fetch_data(&in, &len, sizeof(int));
-  rwm_process(&in, len, tl_raw_msg_zstd_decompress, &extra);
+  const int len = rwm_zstd_init_decompression(in, zstd_stream, version);
+  // the frame referring to an unknown dictionary is dropped, so the fetching fails later
+  if (len >= 0) {
+    rwm_process(&in, len, tl_raw_msg_zstd_decompress, &extra);
+  }
 
   rwm_free(&in);
   rwm_steal(&in, &out);
 }
 
+static int rwm_zstd_decompressed_size(raw_message_t &in) {
+  char header[sizeof(int) + ZstdDictionaries::FRAME_HEADER_MAX_SIZE];
+  const int header_size = rwm_fetch_lookup(&in, header, std::min(in.total_bytes, static_cast<int>(sizeof(header))));
+  if (header_size <= static_cast<int>(sizeof(int))) {
+    return -1;
+  }
+  const unsigned long long size = ZSTD_getFrameContentSize(header + sizeof(int), header_size - sizeof(int));
+  if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR || size > std::numeric_limits<int>::max()) {
+    return -1;
+  }
+  return static_cast<int>(size);
+}
+
+struct zstd_buffer_decompression_extra_t {
+  ZSTD_DStream *zstd_stream;
+  ZSTD_outBuffer output;
+  bool finished;
+  bool failed;
+};
+
+static inline int tl_raw_msg_zstd_decompress_to_buffer(void *_extra, const void *data, int len) {
+  auto extra = static_cast<zstd_buffer_decompression_extra_t *>(_extra);
+  ZSTD_inBuffer input = {.src = data, .size = (size_t)len, .pos = 0};
+  while (input.pos < input.size && !extra->finished && !extra->failed) {
+    const size_t input_pos = input.pos;
+    const size_t output_pos = extra->output.pos;
+    const size_t r = ZSTD_decompressStream(extra->zstd_stream, &extra->output, &input);
+    if (r == 0) {
+      extra->finished = true;
+    } else if (ZSTD_isError(r) || (input.pos == input_pos && extra->output.pos == output_pos)) {
+      // the output buffer is smaller than the frame content
+      extra->failed = true;
+    }
+  }
+  return 0;
+}
+
+static bool rwm_zstd_decompress_to(raw_message_t &in, int version, void *dst, int size) {
+  ZSTD_DStream *zstd_stream = get_zstd_dstream();
+  const int len = rwm_zstd_init_decompression(in, zstd_stream, version);
+  zstd_buffer_decompression_extra_t extra = {.zstd_stream = zstd_stream, .output = {.dst = dst, .size = (size_t)size, .pos = 0}, .finished = false, .failed = len < 0};
+  if (!extra.failed) {
+    rwm_process(&in, len, tl_raw_msg_zstd_decompress_to_buffer, &extra);
+  }
+  rwm_fetch_data(&in, nullptr, in.total_bytes);
+  return extra.finished && extra.output.pos == static_cast<size_t>(size);
+}
+
 void compress_rwm(raw_message_t &rwm, int version) noexcept {
   assert(version <= COMPRESSION_VERSION_MAX);
   switch (version) {
@@ -130,8 +207,9 @@ void compress_rwm(raw_message_t &rwm, int version) noexcept {
       rwm_transform_from_offset(&rwm, rwm.total_bytes, 0, rwm_do_xor_compress, nullptr);
       break;
     }
-    case COMPRESSION_VERSION_ZSTD: {
-      raw_zstd_compress(rwm);
+    case COMPRESSION_VERSION_ZSTD:
+    case COMPRESSION_VERSION_ZSTD_DICT: {
+      raw_zstd_compress(rwm, version);
       break;
     }
     default:
@@ -148,8 +226,9 @@ void decompress_rwm(raw_message_t &in, int version) noexcept {
       rwm_transform_from_offset(&in, in.total_bytes, 0, rwm_do_xor_compress, nullptr);
       break;
     }
-    case COMPRESSION_VERSION_ZSTD: {
-      rwm_zstd_decompress(in);
+    case COMPRESSION_VERSION_ZSTD:
+    case COMPRESSION_VERSION_ZSTD_DICT: {
+      rwm_zstd_decompress(in, version);
       break;
     }
     default:
@@ -157,6 +236,37 @@ void decompress_rwm(raw_message_t &in, int version) noexcept {
   }
 }
 
+int decompressed_rwm_size(raw_message_t &in, int version) noexcept {
+  switch (version) {
+    case COMPRESSION_VERSION_TEST_XOR:
+      return in.total_bytes;
+    case COMPRESSION_VERSION_ZSTD:
+    case COMPRESSION_VERSION_ZSTD_DICT:
+      return rwm_zstd_decompressed_size(in);
+    default:
+      return -1;
+  }
+}
+
+bool decompress_rwm_to(raw_message_t &in, int version, void *dst, int size) noexcept {
+  assert(in.magic == RM_INIT_MAGIC);
+  switch (version) {
+    case COMPRESSION_VERSION_TEST_XOR: {
+      if (in.total_bytes != size) {
+        return false;
+      }
+      rwm_fetch_data(&in, dst, size);
+      rwm_do_xor_compress(nullptr, dst, size);
+      return true;
+    }
+    case COMPRESSION_VERSION_ZSTD:
+    case COMPRESSION_VERSION_ZSTD_DICT:
+      return rwm_zstd_decompress_to(in, version, dst, size);
+    default:
+      return false;
+  }
+}
+
 void tl_fetch_init_raw_message(raw_message_t *msg) {
   const auto total_bytes = msg->total_bytes;
   return tl_fetch_init(std::make_unique<tl_in_methods_raw_msg>(msg), total_bytes);
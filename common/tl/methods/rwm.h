@@ -13,6 +13,10 @@
 
 void compress_rwm(raw_message_t &rwm, int version) noexcept;
 void decompress_rwm(raw_message_t &rwm, int version) noexcept;
+// the size of the decompressed data, -1 if it isn't known beforehand
+int decompressed_rwm_size(raw_message_t &rwm, int version) noexcept;
+// decompresses all the message straight into the buffer, returns false if it doesn't fit the size exactly
+bool decompress_rwm_to(raw_message_t &rwm, int version, void *dst, int size) noexcept;
 
 struct tl_in_methods_raw_msg final : tl_in_methods {
   raw_message in{};
@@ -62,6 +66,12 @@ struct tl_in_methods_raw_msg final : tl_in_methods {
     decompress_rwm(in, version);
     return in.total_bytes;
   }
+  int decompressed_size(int version) noexcept override {
+    return decompressed_rwm_size(in, version);
+  }
+  bool decompress_to(int version, void *dst, int size) noexcept override {
+    return decompress_rwm_to(in, version, dst, size);
+  }
 
   ~tl_in_methods_raw_msg() noexcept override {
     if (in.magic == RM_INIT_MAGIC) {
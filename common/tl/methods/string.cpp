@@ -50,6 +50,12 @@ struct tl_in_methods_str final : tl_in_methods {
   int decompress(int) noexcept override {
     assert(0 && "decompress not implemented for str");
   }
+  int decompressed_size(int) noexcept override {
+    assert(0 && "decompress not implemented for str");
+  }
+  bool decompress_to(int, void *, int) noexcept override {
+    assert(0 && "decompress not implemented for str");
+  }
 };
 
 struct tl_out_methods_str final : tl_out_methods {
@@ -0,0 +1,185 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/tl/methods/zstd-dictionaries.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <zdict.h>
+
+#include <gtest/gtest.h>
+
+#include "common/tl/methods/compression.h"
+#include "common/tl/methods/rwm.h"
+
+namespace {
+
+constexpr uint32_t USER_MAGIC = 0x1cb5c415;
+constexpr uint32_t GROUP_MAGIC = 0x2f8c9b41;
+
+// a vector of TL objects looking alike, the way the common answers do
+std::string make_sample(std::mt19937 &gen, uint32_t tl_magic, const char *name) {
+  std::string sample;
+  auto store_int = [&sample](uint32_t x) {
+    sample.append(reinterpret_cast<const char *>(&x), sizeof(x));
+  };
+  store_int(tl_magic);
+  const uint32_t count = 5 + gen() % 20;
+  store_int(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    store_int(gen() % 1000);
+    const std::string field = std::string{name} + "_" + std::to_string(gen() % 100);
+    store_int(static_cast<uint32_t>(field.size()));
+    sample.append(field);
+    sample.append((4 - field.size() % 4) % 4, '\0');
+    store_int(gen() % 2);
+  }
+  return sample;
+}
+
+std::vector<std::string> make_samples(uint32_t tl_magic, const char *name, uint32_t seed) {
+  std::mt19937 gen{seed};
+  std::vector<std::string> samples;
+  for (int i = 0; i < 2000; ++i) {
+    samples.emplace_back(make_sample(gen, tl_magic, name));
+  }
+  return samples;
+}
+
+std::string train_dictionary(const std::vector<std::string> &samples) {
+  std::string samples_buffer;
+  std::vector<size_t> sample_sizes;
+  for (const auto &sample : samples) {
+    samples_buffer.append(sample);
+    sample_sizes.push_back(sample.size());
+  }
+  std::string dict(4096, '\0');
+  const size_t dict_size = ZDICT_trainFromBuffer(&dict[0], dict.size(), samples_buffer.data(), sample_sizes.data(),
+                                                 static_cast<unsigned>(sample_sizes.size()));
+  EXPECT_FALSE(ZDICT_isError(dict_size));
+  dict.resize(ZDICT_isError(dict_size) ? 0 : dict_size);
+  return dict;
+}
+
+int pack(const ZstdDictionaries &dictionaries, const std::string &data, std::string &packed, int version) {
+  packed.resize(ZstdDictionaries::pack_bound(static_cast<int>(data.size())));
+  const int packed_size = dictionaries.pack(data.data(), static_cast<int>(data.size()), &packed[0], static_cast<int>(packed.size()), version);
+  packed.resize(packed_size < 0 ? 0 : packed_size);
+  return packed_size;
+}
+
+bool unpack(const std::string &packed, int version, std::string &data) {
+  raw_message_t rwm;
+  rwm_init(&rwm, 0);
+  rwm_push_data(&rwm, packed.data(), static_cast<int>(packed.size()));
+  const int size = decompressed_rwm_size(rwm, version);
+  data.assign(size < 0 ? 0 : size, '\0');
+  const bool unpacked = size >= 0 && decompress_rwm_to(rwm, version, &data[0], size);
+  EXPECT_EQ(rwm.total_bytes, unpacked ? 0 : rwm.total_bytes);
+  rwm_free(&rwm);
+  return unpacked;
+}
+
+} // namespace
+
+TEST(zstd_dictionaries, test_raw_content_dictionary_is_rejected) {
+  ZstdDictionaries dictionaries;
+  const std::string raw_content(1024, 'x');
+  ASSERT_FALSE(dictionaries.add(raw_content.data(), raw_content.size(), 0));
+  ASSERT_EQ(dictionaries.find_cdict(0), nullptr);
+  ASSERT_FALSE(dictionaries.load("/nonexistent/zstd.dict", 0));
+}
+
+TEST(zstd_dictionaries, test_dictionary_choice) {
+  const std::string user_dict = train_dictionary(make_samples(USER_MAGIC, "user", 1));
+  const std::string group_dict = train_dictionary(make_samples(GROUP_MAGIC, "group", 2));
+
+  ZstdDictionaries dictionaries;
+  ASSERT_TRUE(dictionaries.add(user_dict.data(), user_dict.size(), USER_MAGIC));
+  ASSERT_EQ(dictionaries.find_cdict(GROUP_MAGIC), nullptr);
+  ASSERT_TRUE(dictionaries.add(group_dict.data(), group_dict.size(), 0));
+
+  ASSERT_NE(dictionaries.find_cdict(USER_MAGIC), nullptr);
+  ASSERT_NE(dictionaries.find_cdict(USER_MAGIC), dictionaries.find_cdict(GROUP_MAGIC));
+  // the default one
+  ASSERT_EQ(dictionaries.find_cdict(GROUP_MAGIC), dictionaries.find_cdict(0x12345678));
+
+  ASSERT_NE(dictionaries.find_ddict(ZDICT_getDictID(user_dict.data(), user_dict.size())), nullptr);
+  ASSERT_NE(dictionaries.find_ddict(ZDICT_getDictID(group_dict.data(), group_dict.size())), nullptr);
+  ASSERT_EQ(dictionaries.find_ddict(1), nullptr);
+}
+
+TEST(zstd_dictionaries, test_pack_and_decompress) {
+  const std::string user_dict = train_dictionary(make_samples(USER_MAGIC, "user", 3));
+  ASSERT_TRUE(ZstdDictionaries::get().add(user_dict.data(), user_dict.size(), USER_MAGIC));
+
+  std::mt19937 gen{4};
+  for (int i = 0; i < 100; ++i) {
+    const std::string data = make_sample(gen, USER_MAGIC, "user");
+    std::string packed_with_dict;
+    std::string packed;
+    ASSERT_GT(pack(ZstdDictionaries::get(), data, packed_with_dict, COMPRESSION_VERSION_ZSTD_DICT), 0);
+    ASSERT_GT(pack(ZstdDictionaries::get(), data, packed, COMPRESSION_VERSION_ZSTD), 0);
+    ASSERT_EQ(packed_with_dict.size() % 4, 0);
+    ASSERT_LT(packed_with_dict.size(), packed.size());
+
+    std::string unpacked;
+    ASSERT_TRUE(unpack(packed_with_dict, COMPRESSION_VERSION_ZSTD_DICT, unpacked));
+    ASSERT_EQ(unpacked, data);
+    ASSERT_TRUE(unpack(packed, COMPRESSION_VERSION_ZSTD, unpacked));
+    ASSERT_EQ(unpacked, data);
+  }
+}
+
+TEST(zstd_dictionaries, test_unknown_dictionary) {
+  const std::string group_dict = train_dictionary(make_samples(GROUP_MAGIC, "group", 5));
+  ZstdDictionaries dictionaries;
+  ASSERT_TRUE(dictionaries.add(group_dict.data(), group_dict.size(), 0));
+
+  std::mt19937 gen{6};
+  const std::string data = make_sample(gen, GROUP_MAGIC, "group");
+  std::string packed;
+  ASSERT_GT(pack(dictionaries, data, packed, COMPRESSION_VERSION_ZSTD_DICT), 0);
+  std::string unpacked;
+  ASSERT_FALSE(unpack(packed, COMPRESSION_VERSION_ZSTD_DICT, unpacked));
+}
+
+TEST(zstd_dictionaries, test_compress_rwm) {
+  const std::string user_dict = train_dictionary(make_samples(USER_MAGIC, "user", 7));
+  ASSERT_TRUE(ZstdDictionaries::get().add(user_dict.data(), user_dict.size(), USER_MAGIC));
+
+  std::mt19937 gen{8};
+  const std::string data = make_sample(gen, USER_MAGIC, "user");
+  for (int version : {COMPRESSION_VERSION_ZSTD, COMPRESSION_VERSION_ZSTD_DICT}) {
+    raw_message_t rwm;
+    rwm_init(&rwm, 0);
+    rwm_push_data(&rwm, data.data(), static_cast<int>(data.size()));
+    compress_rwm(rwm, version);
+    ASSERT_EQ(rwm.total_bytes % 4, 0);
+    // the frame content size is set for the streaming compression as well
+    ASSERT_EQ(decompressed_rwm_size(rwm, version), static_cast<int>(data.size()));
+
+    raw_message_t copy;
+    rwm_clone(&copy, &rwm);
+    std::string unpacked(data.size(), '\0');
+    ASSERT_TRUE(decompress_rwm_to(rwm, version, &unpacked[0], static_cast<int>(unpacked.size())));
+    ASSERT_EQ(unpacked, data);
+    // the buffer is too small
+    ASSERT_FALSE(decompress_rwm_to(copy, version, &unpacked[0], static_cast<int>(unpacked.size()) - 4));
+    rwm_free(&rwm);
+    rwm_free(&copy);
+
+    rwm_init(&rwm, 0);
+    rwm_push_data(&rwm, data.data(), static_cast<int>(data.size()));
+    compress_rwm(rwm, version);
+    decompress_rwm(rwm, version);
+    ASSERT_EQ(rwm.total_bytes, static_cast<int>(data.size()));
+    std::string fetched(data.size(), '\0');
+    rwm_fetch_data(&rwm, &fetched[0], rwm.total_bytes);
+    ASSERT_EQ(fetched, data);
+    rwm_free(&rwm);
+  }
+}
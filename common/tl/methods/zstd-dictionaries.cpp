@@ -0,0 +1,125 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/tl/methods/zstd-dictionaries.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "common/algorithms/arithmetic.h"
+#include "common/tl/methods/compression.h"
+
+constexpr int ZstdDictionaries::COMPRESSION_LEVEL;
+constexpr size_t ZstdDictionaries::FRAME_HEADER_MAX_SIZE;
+
+ZstdDictionaries::~ZstdDictionaries() {
+  for (Dictionary &dictionary : dictionaries_) {
+    ZSTD_freeCDict(dictionary.cdict);
+    ZSTD_freeDDict(dictionary.ddict);
+  }
+}
+
+bool ZstdDictionaries::add(const void *dict, size_t dict_size, uint32_t tl_magic) noexcept {
+  const uint32_t id = ZSTD_getDictID_fromDict(dict, dict_size);
+  if (id == 0) {
+    return false;
+  }
+  Dictionary dictionary;
+  dictionary.tl_magic = tl_magic;
+  dictionary.id = id;
+  dictionary.cdict = ZSTD_createCDict(dict, dict_size, COMPRESSION_LEVEL);
+  dictionary.ddict = ZSTD_createDDict(dict, dict_size);
+  if (!dictionary.cdict || !dictionary.ddict) {
+    ZSTD_freeCDict(dictionary.cdict);
+    ZSTD_freeDDict(dictionary.ddict);
+    return false;
+  }
+  dictionaries_.push_back(dictionary);
+  return true;
+}
+
+bool ZstdDictionaries::load(const char *file_name, uint32_t tl_magic) noexcept {
+  std::ifstream file{file_name, std::ios::binary};
+  if (!file) {
+    return false;
+  }
+  const std::string dict{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  return !file.bad() && add(dict.data(), dict.size(), tl_magic);
+}
+
+const ZSTD_CDict *ZstdDictionaries::find_cdict(uint32_t tl_magic) const noexcept {
+  // the later loaded dictionaries override the former ones
+  const ZSTD_CDict *default_cdict = nullptr;
+  for (auto it = dictionaries_.rbegin(); it != dictionaries_.rend(); ++it) {
+    if (it->tl_magic == tl_magic && tl_magic != 0) {
+      return it->cdict;
+    }
+    if (it->tl_magic == 0 && !default_cdict) {
+      default_cdict = it->cdict;
+    }
+  }
+  return default_cdict;
+}
+
+const ZSTD_DDict *ZstdDictionaries::find_ddict(uint32_t dict_id) const noexcept {
+  for (const Dictionary &dictionary : dictionaries_) {
+    if (dictionary.id == dict_id) {
+      return dictionary.ddict;
+    }
+  }
+  return nullptr;
+}
+
+void ZstdDictionaries::init_cstream(ZSTD_CStream *stream, int version, uint32_t tl_magic, size_t size) const noexcept {
+  ZSTD_CCtx_reset(stream, ZSTD_reset_session_only);
+  const ZSTD_CDict *cdict = version == COMPRESSION_VERSION_ZSTD_DICT ? find_cdict(tl_magic) : nullptr;
+  ZSTD_CCtx_refCDict(stream, cdict);
+  if (!cdict) {
+    ZSTD_CCtx_setParameter(stream, ZSTD_c_compressionLevel, COMPRESSION_LEVEL);
+  }
+  ZSTD_CCtx_setPledgedSrcSize(stream, size);
+}
+
+bool ZstdDictionaries::init_dstream(ZSTD_DStream *stream, int version, const void *frame, size_t frame_size) const noexcept {
+  ZSTD_DCtx_reset(stream, ZSTD_reset_session_only);
+  const uint32_t dict_id = version == COMPRESSION_VERSION_ZSTD_DICT ? ZSTD_getDictID_fromFrame(frame, frame_size) : 0;
+  const ZSTD_DDict *ddict = dict_id ? find_ddict(dict_id) : nullptr;
+  ZSTD_DCtx_refDDict(stream, ddict);
+  return dict_id == 0 || ddict != nullptr;
+}
+
+int ZstdDictionaries::pack(const void *src, int size, void *dst, int capacity, int version) const noexcept {
+  static ZSTD_CCtx *ctx = ZSTD_createCCtx();
+  if (size < 0 || capacity < static_cast<int>(sizeof(int))) {
+    return -1;
+  }
+  uint32_t tl_magic = 0;
+  if (version == COMPRESSION_VERSION_ZSTD_DICT && size >= static_cast<int>(sizeof(tl_magic))) {
+    memcpy(&tl_magic, src, sizeof(tl_magic));
+  }
+
+  char *frame = static_cast<char *>(dst) + sizeof(int);
+  const size_t frame_capacity = capacity - sizeof(int);
+  const ZSTD_CDict *cdict = version == COMPRESSION_VERSION_ZSTD_DICT ? find_cdict(tl_magic) : nullptr;
+  const size_t frame_size = cdict ? ZSTD_compress_usingCDict(ctx, frame, frame_capacity, src, size, cdict)
+                                  : ZSTD_compressCCtx(ctx, frame, frame_capacity, src, size, COMPRESSION_LEVEL);
+  if (ZSTD_isError(frame_size)) {
+    return -1;
+  }
+
+  const int len = static_cast<int>(frame_size);
+  memcpy(dst, &len, sizeof(len));
+  const int packed_size = align4(static_cast<int>(sizeof(int)) + len);
+  if (packed_size > capacity) {
+    return -1;
+  }
+  memset(frame + len, 0, packed_size - sizeof(int) - len);
+  return packed_size;
+}
+
+int ZstdDictionaries::pack_bound(int size) noexcept {
+  return align4(static_cast<int>(sizeof(int) + ZSTD_compressBound(size)));
+}
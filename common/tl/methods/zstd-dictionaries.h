@@ -0,0 +1,58 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zstd.h>
+
+#include "common/mixin/not_copyable.h"
+
+// The pre-trained zstd dictionaries for the common TL types, they are loaded at startup.
+// A dictionary is chosen by the magic of the compressed TL object, the default one is used for the rest of the types.
+// The frame refers to its dictionary by the id, so the peers have to load the same dictionaries to use COMPRESSION_VERSION_ZSTD_DICT.
+class ZstdDictionaries : vk::not_copyable {
+public:
+  static constexpr int COMPRESSION_LEVEL = 1;
+  static constexpr size_t FRAME_HEADER_MAX_SIZE = 18;
+
+  static ZstdDictionaries &get() noexcept {
+    static ZstdDictionaries dictionaries;
+    return dictionaries;
+  }
+
+  ZstdDictionaries() = default;
+  ~ZstdDictionaries();
+
+  // tl_magic == 0 makes the dictionary the default one;
+  // returns false if it isn't a trained dictionary, the raw content ones have no id to be referred to by
+  bool add(const void *dict, size_t dict_size, uint32_t tl_magic) noexcept;
+  bool load(const char *file_name, uint32_t tl_magic) noexcept;
+
+  // nullptr if there is neither a dictionary for the type nor the default one
+  const ZSTD_CDict *find_cdict(uint32_t tl_magic) const noexcept;
+  const ZSTD_DDict *find_ddict(uint32_t dict_id) const noexcept;
+
+  // the frame content size is always set for the peer to decompress it straight into its buffer
+  void init_cstream(ZSTD_CStream *stream, int version, uint32_t tl_magic, size_t size) const noexcept;
+  // returns false if the dictionary the frame refers to isn't loaded
+  bool init_dstream(ZSTD_DStream *stream, int version, const void *frame, size_t frame_size) const noexcept;
+
+  // packs the buffer the same way compress_rwm() does: the frame size, the frame itself and the padding;
+  // returns the packed size or -1 if the capacity isn't enough
+  int pack(const void *src, int size, void *dst, int capacity, int version) const noexcept;
+  static int pack_bound(int size) noexcept;
+
+private:
+  struct Dictionary {
+    uint32_t tl_magic{0};
+    uint32_t id{0};
+    ZSTD_CDict *cdict{nullptr};
+    ZSTD_DDict *ddict{nullptr};
+  };
+
+  std::vector<Dictionary> dictionaries_;
+};
@@ -213,6 +213,17 @@ void tl_decompress_remaining(int version) {
   tlio->in_remaining = new_size;
 }
 
+int tl_fetch_decompressed_size(int version) {
+  return tlio->in_methods->decompressed_size(version);
+}
+
+bool tl_decompress_remaining_to(int version, void *dst, int size) {
+  const bool decompressed = tlio->in_methods->decompress_to(version, dst, size);
+  tlio->in_pos += tlio->in_remaining;
+  tlio->in_remaining = 0;
+  return decompressed;
+}
+
 void tl_fetch_raw_data(void *buf, int size) {
   tlio->in_methods->fetch_raw_data(buf, size);
   tlio->in_pos += size;
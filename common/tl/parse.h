@@ -38,6 +38,10 @@ void tl_setup_result_header(const struct tl_query_header_t *header);
 
 void tl_compress_written(int version);
 void tl_decompress_remaining(int version);
+// -1 if the size isn't known before the decompression
+int tl_fetch_decompressed_size(int version);
+// decompresses the remaining data straight into the buffer, the data is fetched even if it fails
+bool tl_decompress_remaining_to(int version, void *dst, int size);
 
 int tl_fetch_check(int nbytes);
 
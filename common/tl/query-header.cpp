@@ -222,7 +222,7 @@ static int tl_fetch_query_answer_flags(tl_query_answer_header_t *header) {
   return 0;
 }
 
-bool tl_fetch_query_answer_header(tl_query_answer_header_t *header) {
+bool tl_fetch_query_answer_header(tl_query_answer_header_t *header, bool decompress) {
   assert (header);
   int op = tl_fetch_int();
   if (op == TL_RPC_REQ_RESULT) {
@@ -247,6 +247,10 @@ bool tl_fetch_query_answer_header(tl_query_answer_header_t *header) {
       assert (tl_fetch_int() == (int)TL_REQ_RESULT_HEADER);
       tl_fetch_query_answer_flags(header);
       if (header->flags & vk::tl::common::rpc_req_result_extra_flags::compression_version) {
+        if (!decompress) {
+          // the caller decompresses the rest of the answer itself
+          break;
+        }
         if (!tl_fetch_error()) {
           tl_decompress_remaining(header->compression_version);
           header->flags &= ~vk::tl::common::rpc_req_result_extra_flags::compression_version;
@@ -55,7 +55,7 @@ struct tl_query_answer_header_t {
 };
 
 bool tl_fetch_query_header(tl_query_header_t *header);
-bool tl_fetch_query_answer_header(tl_query_answer_header_t *header);
+bool tl_fetch_query_answer_header(tl_query_answer_header_t *header, bool decompress = true);
 void tl_store_header(const tl_query_header_t *header);
 void tl_store_answer_header(const tl_query_answer_header_t *header);
 
@@ -625,6 +625,17 @@ vk::intrusive_ptr<Assumption> calc_assumption_for_var(FunctionPtr f, vk::string_
   return not_instance;
 }
 
+// instance<^N> of an extern function is the class, which name is passed as the N-th argument
+static ClassPtr get_class_of_type_rule_instance(VertexAdaptor<op_type_expr_instance> type_rule, VertexAdaptor<op_func_call> call) {
+  auto arg_ref = type_rule->expr().as<op_type_expr_arg_ref>();
+  if (auto arg = GenTree::get_call_arg_ref(arg_ref, call)) {
+    if (auto class_name = GenTree::get_constexpr_string(arg)) {
+      return G->get_class(*class_name);
+    }
+  }
+  return {};
+}
+
 /*
  * A high-level function which deduces the result type of f.
  * The results are cached; init on f is called during the first invocation.
@@ -637,11 +648,15 @@ vk::intrusive_ptr<Assumption> calc_assumption_for_return(FunctionPtr f, VertexAd
       if (auto class_type_rule = rule_meta.try_as<op_type_expr_class>()) {
         return AssumInstance::create(class_type_rule->class_ptr);
       } else if (auto func_type_rule = rule_meta.try_as<op_type_expr_instance>()) {
-        auto arg_ref = func_type_rule->expr().as<op_type_expr_arg_ref>();
-        if (auto arg = GenTree::get_call_arg_ref(arg_ref, call)) {
-          if (auto class_name = GenTree::get_constexpr_string(arg)) {
-            if (auto klass = G->get_class(*class_name)) {
-              return AssumInstance::create(klass);
+        if (auto klass = get_class_of_type_rule_instance(func_type_rule, call)) {
+          return AssumInstance::create(klass);
+        }
+      } else if (auto array_type_rule = rule_meta.try_as<op_type_expr_type>()) {
+        // instance<^N>[]
+        if (array_type_rule->type_help == tp_array && !array_type_rule->empty()) {
+          if (auto element_type_rule = array_type_rule->args()[0].try_as<op_type_expr_instance>()) {
+            if (auto klass = get_class_of_type_rule_instance(element_type_rule, call)) {
+              return AssumArray::create(klass);
             }
           }
         }
@@ -518,6 +518,7 @@ void ClassDeclaration::compile_class_method(FunctionSignatureGenerator &&W, Clas
 void ClassDeclaration::compile_inner_methods(CodeGenerator &W, ClassPtr klass) {
   compile_get_class(W, klass);
   compile_get_hash(W, klass);
+  compile_get_class_id(W, klass);
   compile_accept_visitor_methods(W, klass);
   compile_serialization_methods(W, klass);
 }
@@ -531,6 +532,35 @@ void ClassDeclaration::compile_get_hash(CodeGenerator &W, ClassPtr klass) {
   compile_class_method(FunctionSignatureGenerator(W).set_const_this(), klass, "int get_hash()", klass->get_hash());
 }
 
+void ClassDeclaration::compile_get_class_id(CodeGenerator &W, ClassPtr klass) {
+  if (!klass->is_polymorphic_class()) {
+    return;
+  }
+
+  compile_class_method(FunctionSignatureGenerator(W).set_const_this(), klass, "uint32_t get_class_id()", klass->class_id);
+
+  // an instance is instanceof klass if its class id is one of klass inheritors ids,
+  // for classes they are always a contiguous range, for interfaces they may be scattered, so a bit mask is used
+  FunctionSignatureGenerator(W) << "static bool is_base_of_class_id(uint32_t class_id) " << BEGIN;
+  const auto &ids = klass->class_ids_of_inheritors;
+  if (ids.empty()) {
+    W << "return false;" << NL;
+  } else if (ids.back() - ids.front() + 1 == ids.size()) {
+    W << "return class_id - " << ids.front() << "u < " << static_cast<uint32_t>(ids.size()) << "u;" << NL;
+  } else {
+    const uint32_t span = ids.back() - ids.front() + 1;
+    std::vector<uint64_t> mask((span + 63) / 64);
+    for (uint32_t id : ids) {
+      mask[(id - ids.front()) / 64] |= uint64_t{1} << ((id - ids.front()) % 64);
+    }
+    auto transform_to_hex = [](CodeGenerator &W, uint64_t bits) { W << fmt_format("{:#x}ULL", bits); };
+    W << "static const uint64_t ids_mask[] = {" << JoinValues(mask, ", ", join_mode::one_line, transform_to_hex) << "};" << NL;
+    W << "class_id -= " << ids.front() << "u;" << NL;
+    W << "return class_id < " << span << "u && (ids_mask[class_id / 64] >> (class_id % 64) & 1);" << NL;
+  }
+  W << END << NL << NL;
+}
+
 void ClassDeclaration::compile_accept_visitor(CodeGenerator &W, ClassPtr klass, const char *visitor_type) {
   compile_class_method(FunctionSignatureGenerator(W), klass, fmt_format("void accept({} &visitor)", visitor_type), "generic_accept(visitor)");
 }
@@ -111,6 +111,7 @@ struct ClassDeclaration {
 private:
   static void compile_get_class(CodeGenerator &W, ClassPtr klass);
   static void compile_get_hash(CodeGenerator &W, ClassPtr klass);
+  static void compile_get_class_id(CodeGenerator &W, ClassPtr klass);
   static void compile_accept_visitor_methods(CodeGenerator &W, ClassPtr klass);
   static void compile_serialization_methods(CodeGenerator &W, ClassPtr klass);
   static void compile_serialize(CodeGenerator &W, ClassPtr klass);
@@ -13,6 +13,42 @@
 #include "compiler/data/class-data.h"
 #include "compiler/data/lib-data.h"
 #include "compiler/data/src-file.h"
+#include "compiler/data/var-data.h"
+
+// the superglobals which aren't mentioned in the code are not filled by the runtime for every request
+struct SuperGlobalsUsage {
+  void compile(CodeGenerator &W) const {
+    // the code of the linked static libs isn't seen by this build, everything is filled for it
+    for (LibPtr lib: G->get_libs()) {
+      if (lib && !lib->is_raw_php()) {
+        return;
+      }
+    }
+
+    static const std::pair<const char *, const char *> superglobals[] = {
+      {"_SERVER",  "server"},
+      {"_GET",     "get"},
+      {"_POST",    "post"},
+      {"_FILES",   "files"},
+      {"_COOKIE",  "cookie"},
+      {"_REQUEST", "request"},
+      {"_ENV",     "env"},
+    };
+
+    std::unordered_set<std::string> used_globals;
+    for (VarPtr var : G->get_global_vars()) {
+      if (var->is_builtin_global()) {
+        used_globals.emplace(var->name);
+      }
+    }
+
+    W << "superglobals_usage used_superglobals;" << NL;
+    for (const auto &superglobal : superglobals) {
+      W << "used_superglobals." << superglobal.second << " = " << (used_globals.count(superglobal.first) ? "true" : "false") << ";" << NL;
+    }
+    W << "set_superglobals_usage(used_superglobals);" << NL;
+  }
+};
 
 struct StaticInit {
   const std::vector<FunctionPtr> &all_functions;
@@ -69,6 +105,7 @@ void StaticInit::compile(CodeGenerator &W) const {
     W << END << NL << NL;
 
     FunctionSignatureGenerator(W) << ("void global_init_php_scripts() ") << BEGIN;
+    W << SuperGlobalsUsage{};
     for (LibPtr lib: G->get_libs()) {
       if (lib && !lib->is_raw_php()) {
         W << lib->lib_namespace() << "::global_init_lib_scripts();" << NL;
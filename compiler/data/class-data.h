@@ -47,6 +47,13 @@ public:
   std::vector<InterfacePtr> implements;
   std::vector<ClassPtr> derived_classes;
 
+  // polymorphic classes get dense ids (starting from 1) in the preorder of the inheritance tree,
+  // class_ids_of_inheritors are the sorted ids of all the classes which are instanceof this class or interface
+  uint32_t class_id{0};
+  std::vector<uint32_t> class_ids_of_inheritors;
+  // case values of the virtual methods dispatching, they are set to class_id when it is assigned
+  std::vector<VertexAdaptor<op_int_const>> class_id_consts;
+
   FunctionPtr construct_function;
   vk::string_view phpdoc_str;
 
@@ -121,12 +121,17 @@ void check_constructor(FunctionPtr interface_constructor, std::vector<ClassPtr>
   }
 }
 
-VertexAdaptor<op_case> gen_case_on_hash(ClassPtr derived, VertexAdaptor<op_seq> cmd) {
-  auto hash_of_derived = GenTree::create_int_const(derived->get_hash());
-  return VertexAdaptor<op_case>::create(hash_of_derived, cmd);
+VertexAdaptor<op_case> gen_case_on_class_id(ClassPtr derived, VertexAdaptor<op_seq> cmd) {
+  // class ids are assigned after all the classes are known, see CodeGenF::assign_class_ids()
+  auto class_id_of_derived = GenTree::create_int_const(0);
+  {
+    AutoLocker<Lockable *> locker(&(*derived));
+    derived->class_id_consts.emplace_back(class_id_of_derived);
+  }
+  return VertexAdaptor<op_case>::create(class_id_of_derived, cmd);
 }
 
-VertexAdaptor<op_case> gen_case_calling_methods_on_derived_class(ClassPtr derived, FunctionPtr virtual_function) {
+VertexAdaptor<op_seq> gen_call_of_method_on_derived_class(ClassPtr derived, FunctionPtr virtual_function) {
   FunctionPtr concrete_method_of_derived;
   if (auto method_of_derived = derived->members.get_instance_method(virtual_function->local_name())) {
     concrete_method_of_derived = method_of_derived->function;
@@ -160,9 +165,31 @@ VertexAdaptor<op_case> gen_case_calling_methods_on_derived_class(ClassPtr derive
   VertexPtr this_var = create_instance_cast_to(ClassData::gen_vertex_this({}), derived);
   // generate concrete_method call, with arguments from virtual_functions, because of Derived can have extra default params:
   auto call_self_method_of_derived = GenTree::generate_call_on_instance_var(this_var, virtual_function, concrete_method_of_derived->local_name());
-  auto call_derived_method = VertexAdaptor<op_seq>::create(VertexAdaptor<op_return>::create(call_self_method_of_derived));
+  return VertexAdaptor<op_seq>::create(VertexAdaptor<op_return>::create(call_self_method_of_derived));
+}
+
+VertexAdaptor<op_seq> gen_dispatch_by_class_id(FunctionPtr virtual_function, std::vector<std::pair<ClassPtr, VertexAdaptor<op_seq>>> &&calls) {
+  auto warn_on_default = GenTree::generate_critical_error(fmt_format("call method({}) on null object", virtual_function->get_human_readable_name()));
+
+  // the only implementation: a null check and a direct call, such a function is simple enough to be inlined to the call sites
+  if (calls.size() == 1) {
+    auto is_null_this = VertexAdaptor<op_func_call>::create(ClassData::gen_vertex_this({}));
+    is_null_this->set_string("is_null");
+    auto check_this = VertexAdaptor<op_if>::create(is_null_this, VertexAdaptor<op_seq>::create(warn_on_default));
+    return VertexAdaptor<op_seq>::create(check_this, calls.front().second->args());
+  }
+
+  std::vector<VertexPtr> cases;
+  for (auto &derived_and_call : calls) {
+    cases.emplace_back(gen_case_on_class_id(derived_and_call.first, derived_and_call.second));
+  }
+  cases.emplace_back(VertexAdaptor<op_default>::create(VertexAdaptor<op_seq>::create(warn_on_default)));
+
+  // class ids are dense, so the switch is compiled to a jump table
+  auto class_id_of_this = VertexAdaptor<op_func_call>::create(ClassData::gen_vertex_this({}));
+  class_id_of_this->set_string("get_class_id_of_instance");
 
-  return gen_case_on_hash(derived, call_derived_method);
+  return VertexAdaptor<op_seq>::create(GenTree::create_switch_vertex(virtual_function, class_id_of_this, std::move(cases)));
 }
 
 } // namespace
@@ -172,13 +199,13 @@ VertexAdaptor<op_case> gen_case_calling_methods_on_derived_class(ClassPtr derive
  * generated AST for virtual methods will be like this:
  *
  * function virtual_function($param1, ...) {
- *   switch ($this->get_virt_hash()) {
- *   case 0xDEADBEAF: { // hash of Derived1
+ *   switch (get_class_id_of_instance($this)) {
+ *   case 1: { // class id of Derived1
  *     $tmp = instance_cast<Derived1>($this);
  *     $tmp->virtual_function($param1, ...);
  *     break;
  *   }
- *   case 0x02280228: { // hash of Derived 2
+ *   case 2: { // class id of Derived 2
  *     $tmp = instance_cast<Derived2>($this);
  *     $tmp->virtual_function($param1, ...);
  *     break;
@@ -187,6 +214,8 @@ VertexAdaptor<op_case> gen_case_calling_methods_on_derived_class(ClassPtr derive
  *     php_warning("call method(Interface::virtual_function) on empty class
  *     exit(0);
  *   }
+ *
+ * if there is only one implementation, the switch is replaced by the null check of $this
  */
 void generate_body_of_virtual_method(FunctionPtr virtual_function) {
   auto klass = virtual_function->class_id;
@@ -228,11 +257,11 @@ void generate_body_of_virtual_method(FunctionPtr virtual_function) {
     kphp_assert(virtual_function->root->cmd()->empty());
   }
 
-  std::vector<VertexPtr> cases;
+  std::vector<std::pair<ClassPtr, VertexAdaptor<op_seq>>> calls;
   std::unordered_set<ClassPtr> unique_inheritors;
   for (auto inheritor : klass->get_all_inheritors()) {
-    if (auto case_for_cur_class = gen_case_calling_methods_on_derived_class(inheritor, virtual_function)) {
-      cases.emplace_back(case_for_cur_class);
+    if (auto call_for_cur_class = gen_call_of_method_on_derived_class(inheritor, virtual_function)) {
+      calls.emplace_back(inheritor, call_for_cur_class);
 
       if (!unique_inheritors.insert(inheritor).second && !stage::has_global_error()) {
         kphp_error(false, fmt_format("duplicated class: {} in hierarchy from class: {}", klass->name, inheritor->name));
@@ -240,20 +269,12 @@ void generate_body_of_virtual_method(FunctionPtr virtual_function) {
     }
   }
 
-  if (!cases.empty()) {
-    auto warn_on_default = GenTree::generate_critical_error(fmt_format("call method({}) on null object", virtual_function->get_human_readable_name()));
-
-    auto call_of_exit = VertexAdaptor<op_seq>::create(warn_on_default);
-    cases.emplace_back(VertexAdaptor<op_default>::create(call_of_exit));
-  } else {
+  if (calls.empty()) {
     // just keep empty body, when there is no inheritors for interface method
     return;
   }
 
-  auto get_hash_of_this = VertexAdaptor<op_func_call>::create(ClassData::gen_vertex_this({}));
-  get_hash_of_this->set_string("get_hash_of_class");
-
-  auto body_of_virtual_method = VertexAdaptor<op_seq>::create(GenTree::create_switch_vertex(virtual_function, get_hash_of_this, std::move(cases)));
+  auto body_of_virtual_method = gen_dispatch_by_class_id(virtual_function, std::move(calls));
 
   auto &root = virtual_function->root;
   auto declaration_location = root->get_location();
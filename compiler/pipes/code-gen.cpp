@@ -107,6 +107,7 @@ void CodeGenF::on_finish(DataStream<WriterData> &os) {
       prepare_generate_function(fun);
     }
   }
+  assign_class_ids(all_classes);
   for (const auto &c : all_classes) {
     if (ClassData::does_need_codegen(c)) {
       prepare_generate_class(c);
@@ -234,3 +235,52 @@ void CodeGenF::write_main(CodeGenerator &W) {
 
 void CodeGenF::prepare_generate_class(ClassPtr) {
 }
+
+static bool is_class_with_id(ClassPtr klass) {
+  return ClassData::does_need_codegen(klass) && klass->is_class() && klass->is_polymorphic_class();
+}
+
+static void assign_class_ids_dfs(ClassPtr klass, uint32_t &next_class_id) {
+  klass->class_id = next_class_id++;
+
+  std::vector<ClassPtr> derived_classes;
+  std::copy_if(klass->derived_classes.begin(), klass->derived_classes.end(), std::back_inserter(derived_classes), is_class_with_id);
+  std::sort(derived_classes.begin(), derived_classes.end());
+  for (ClassPtr derived : derived_classes) {
+    assign_class_ids_dfs(derived, next_class_id);
+  }
+}
+
+// the ids are assigned in the preorder of the inheritance tree, so a class and all its descendants have a contiguous range of ids
+// and instanceof / instance_cast are compiled to an integer comparison instead of dynamic_cast,
+// the virtual methods are dispatched by switch over the dense ids, which is compiled to a jump table;
+// the classes are sorted by name to keep the ids stable between compilations
+void CodeGenF::assign_class_ids(const std::vector<ClassPtr> &all_classes) {
+  std::vector<ClassPtr> roots;
+  std::copy_if(all_classes.begin(), all_classes.end(), std::back_inserter(roots), [](ClassPtr c) {
+    return is_class_with_id(c) && !is_class_with_id(c->parent_class);
+  });
+  std::sort(roots.begin(), roots.end());
+
+  uint32_t next_class_id = 1;
+  for (ClassPtr root : roots) {
+    assign_class_ids_dfs(root, next_class_id);
+  }
+
+  for (const auto &c : all_classes) {
+    for (auto class_id_const : c->class_id_consts) {
+      class_id_const->str_val = std::to_string(c->class_id);
+    }
+    if (!c->class_id) {
+      continue;
+    }
+    for (ClassPtr ancestor : c->get_all_ancestors()) {
+      ancestor->class_ids_of_inheritors.emplace_back(c->class_id);
+    }
+  }
+  for (const auto &c : all_classes) {
+    auto &ids = c->class_ids_of_inheritors;
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  }
+}
@@ -19,6 +19,7 @@ class CodeGenF final : public SyncPipeF<FunctionPtr, WriterData> {
   std::once_flag dest_dir_synced;
 
   void prepare_generate_class(ClassPtr klass);
+  void assign_class_ids(const std::vector<ClassPtr> &all_classes);
   void prepare_generate_function(FunctionPtr func);
   std::string get_subdir(const std::string &base);
   void write_lib_version(CodeGenerator &W);
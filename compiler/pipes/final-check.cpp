@@ -37,24 +37,23 @@ void check_class_immutableness(ClassPtr klass) {
                         TermStringFormat::paint(klass->parent_class->name, TermStringFormat::red)));
 }
 
-void check_instance_cache_fetch_call(VertexAdaptor<op_func_call> call) {
-  auto klass = tinf::get_type(call)->class_type();
+void check_instance_cache_fetch_call(VertexAdaptor<op_func_call> call, const TypeData *instance_type) {
+  auto klass = instance_type->class_type();
   kphp_assert(klass);
   klass->deeply_require_instance_cache_visitor();
   kphp_error(klass->is_immutable,
-             fmt_format("Can not fetch instance of mutable class {} with instance_cache_fetch call", klass->name));
+             fmt_format("Can not fetch instance of mutable class {} with {} call", klass->name, call->get_string()));
 }
 
-void check_instance_cache_store_call(VertexAdaptor<op_func_call> call) {
-  auto type = tinf::get_type(call->args()[1]);
-  kphp_error_return(type->ptype() == tp_Class,
-                    "Can not store non-instance var with instance_cache_store call");
-  auto klass = type->class_type();
+void check_instance_cache_store_call(VertexAdaptor<op_func_call> call, const TypeData *instance_type) {
+  kphp_error_return(instance_type->ptype() == tp_Class,
+                    fmt_format("Can not store non-instance var with {} call", call->get_string()));
+  auto klass = instance_type->class_type();
   klass->deeply_require_instance_cache_visitor();
   kphp_error(!klass->is_polymorphic_or_has_polymorphic_member(),
-             "Can not store instance with interface inside with instance_cache_store call");
+             fmt_format("Can not store instance with interface inside with {} call", call->get_string()));
   kphp_error(klass->is_immutable,
-             fmt_format("Can not store instance of mutable class {} with instance_cache_store call", klass->name));
+             fmt_format("Can not store instance of mutable class {} with {} call", klass->name, call->get_string()));
 }
 
 void check_instance_to_array_call(VertexAdaptor<op_func_call> call) {
@@ -393,9 +392,16 @@ void FinalCheckPass::check_op_func_call(VertexAdaptor<op_func_call> call) {
   if (call->func_id->is_extern()) {
     auto &function_name = call->get_string();
     if (function_name == "instance_cache_fetch") {
-      check_instance_cache_fetch_call(call);
+      check_instance_cache_fetch_call(call, tinf::get_type(call));
+    } else if (function_name == "instance_cache_fetch_many") {
+      check_instance_cache_fetch_call(call, tinf::get_type(call)->const_read_at(Key::any_key()));
     } else if (function_name == "instance_cache_store") {
-      check_instance_cache_store_call(call);
+      check_instance_cache_store_call(call, tinf::get_type(call->args()[1]));
+    } else if (function_name == "instance_cache_store_many") {
+      const TypeData *values_type = tinf::get_type(call->args()[0]);
+      kphp_error_return(values_type->ptype() == tp_array,
+                        "Can not store non-array var with instance_cache_store_many call");
+      check_instance_cache_store_call(call, values_type->const_read_at(Key::any_key()));
     } else if (function_name == "instance_to_array") {
       check_instance_to_array_call(call);
     } else if (function_name == "estimate_memory_usage") {
@@ -0,0 +1,2 @@
+set(NET_BENCHMARKS_LIBS vk::common_src vk::net_src vk::binlog_src vk::unicode -l:libzstd.a rt crypto z)
+vk_add_benchmark(net-reactor-timers "${NET_BENCHMARKS_LIBS}" ${BASE_DIR}/net/net-reactor-timers-benchmark.cpp)
@@ -10,7 +10,7 @@ net_reactor_ctx_t main_thread_reactor = {.epoll_fd = -1,
                                          .max_events = 0,
                                          .max_timers = 0,
                                          .event_heap_size = 0,
-                                         .timer_heap_size = 0,
+                                         .timer_wheel_size = 0,
                                          .now = 0,
                                          .prev_now = 0,
                                          .timestamp = 0,
@@ -18,7 +18,9 @@ net_reactor_ctx_t main_thread_reactor = {.epoll_fd = -1,
                                          .events = NULL,
                                          .timers = NULL,
                                          .event_heap = NULL,
-                                         .timer_heap = NULL,
+                                         .timer_wheel_tick = 0,
+                                         .timer_wheel = NULL,
+                                         .timer_wheel_bitmap = {},
                                          .pre_runqueue = NULL,
                                          .post_runqueue = NULL,
                                          .pre_event = NULL,
@@ -0,0 +1,105 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <gtest/gtest.h>
+#include <string>
+
+#include "net/net-buffers.h"
+#include "net/net-http-server.h"
+
+namespace {
+
+struct chunked_body_result {
+  int res{0};
+  int need_bytes{0};
+  std::string decoded;
+};
+
+chunked_body_result decode_chunked_body(const std::string &encoded, int max_len = 1024) {
+  // a small builtin buffer makes the data be spread over several net buffers
+  char builtin[16];
+  netbuffer_t H;
+  init_builtin_buffer(&H, builtin, sizeof(builtin));
+  write_out(&H, encoded.data(), static_cast<int>(encoded.size()));
+
+  nb_iterator_t it;
+  nbit_set(&it, &H);
+  chunked_body_result result;
+  std::string buf(max_len, '\0');
+  hts_chunked_body B;
+  hts_chunked_body_init(&B);
+  result.res = hts_decode_chunked_body(&B, &it, &buf[0], max_len, &result.need_bytes);
+  result.decoded = buf.substr(0, B.decoded);
+  nbit_clear(&it);
+  free_all_buffers(&H);
+  return result;
+}
+
+} // namespace
+
+TEST(http_chunked_body, complete) {
+  const std::string body = "4\r\nWiki\r\n5\r\npedia\r\nE\r\n in\r\n\r\nchunks.\r\n0\r\n\r\n";
+  auto result = decode_chunked_body(body + "GET / HTTP/1.1\r\n\r\n");
+  ASSERT_EQ(result.res, static_cast<int>(body.size()));
+  ASSERT_EQ(result.decoded, "Wikipedia in\r\n\r\nchunks.");
+}
+
+TEST(http_chunked_body, extensions_and_trailers) {
+  const std::string body = "3;name=value\r\nabc\r\n0\r\nExpires: never\r\nX-Trailer: 1\r\n\r\n";
+  auto result = decode_chunked_body(body);
+  ASSERT_EQ(result.res, static_cast<int>(body.size()));
+  ASSERT_EQ(result.decoded, "abc");
+}
+
+TEST(http_chunked_body, incomplete) {
+  auto result = decode_chunked_body("a\r\n0123");
+  ASSERT_EQ(result.res, 0);
+  ASSERT_EQ(result.need_bytes, 6 + 7);
+
+  result = decode_chunked_body("3\r\nabc\r\n0\r\n");
+  ASSERT_EQ(result.res, 0);
+  ASSERT_EQ(result.need_bytes, 1);
+
+  result = decode_chunked_body("");
+  ASSERT_EQ(result.res, 0);
+  ASSERT_EQ(result.need_bytes, 1);
+}
+
+TEST(http_chunked_body, malformed) {
+  ASSERT_EQ(decode_chunked_body("x\r\n").res, -1);
+  ASSERT_EQ(decode_chunked_body("3\r\nabcd\r\n").res, -1);
+  ASSERT_EQ(decode_chunked_body("3\rabc\r\n").res, -1);
+}
+
+TEST(http_chunked_body, too_long) {
+  ASSERT_EQ(decode_chunked_body("11\r\n", 16).res, -2);
+  ASSERT_EQ(decode_chunked_body("8\r\n01234567\r\n9\r\n", 16).res, -2);
+  ASSERT_EQ(decode_chunked_body("8\r\n01234567\r\n8\r\n01234567\r\n0\r\n\r\n", 16).decoded, "0123456701234567");
+}
+
+TEST(http_chunked_body, resumed) {
+  const std::string body = "4\r\nWiki\r\n5;ext\r\npedia\r\n0\r\nX-Trailer: 1\r\n\r\n";
+  char builtin[16];
+  netbuffer_t H;
+  init_builtin_buffer(&H, builtin, sizeof(builtin));
+  std::string buf(64, '\0');
+  hts_chunked_body B;
+  hts_chunked_body_init(&B);
+
+  // the body is received byte by byte, every call decodes only the new bytes
+  int res = 0;
+  for (char c : body) {
+    ASSERT_EQ(res, 0);
+    write_out(&H, &c, 1);
+    nb_iterator_t it;
+    nbit_set(&it, &H);
+    ASSERT_EQ(nbit_advance(&it, B.encoded), B.encoded);
+    int need_bytes = 0;
+    res = hts_decode_chunked_body(&B, &it, &buf[0], static_cast<int>(buf.size()), &need_bytes);
+    nbit_clear(&it);
+  }
+  ASSERT_EQ(res, static_cast<int>(body.size()));
+  ASSERT_EQ(buf.substr(0, B.decoded), "Wikipedia");
+  free_all_buffers(&H);
+}
@@ -297,16 +297,25 @@ int hts_parse_execute (struct connection *c) {
               D->http_ver = HTTP_V09;
             }
           } else {
-            assert (D->query_flags & (QF_HOST | QF_CONNECTION));
+            assert (D->query_flags & (QF_HOST | QF_CONNECTION | QF_TRANSFER_ENCODING));
             if (D->wlen) {
               if (D->query_flags & QF_HOST) {
                 D->host_offset = D->header_size;
                 D->host_size = D->wlen;
+              } else if (D->query_flags & QF_TRANSFER_ENCODING) {
+                if (D->wlen == 7 && !strncasecmp (D->word, "chunked", 7)) {
+                  D->query_flags |= QF_CHUNKED;
+                } else {
+                  D->extra_int = 501;
+                  D->query_flags |= QF_ERROR;
+                }
               } else if (D->wlen == 10 && !strncasecmp (D->word, "keep-alive", 10)) {
                 D->query_flags |= QF_KEEPALIVE;
+              } else if (D->wlen == 5 && !strncasecmp (D->word, "close", 5)) {
+                D->query_flags &= ~QF_KEEPALIVE;
               }
             }
-            D->query_flags &= ~(QF_HOST | QF_CONNECTION);
+            D->query_flags &= ~(QF_HOST | QF_CONNECTION | QF_TRANSFER_ENCODING);
             c->parse_state = htqp_skipspctoeoln;
           }
           D->header_size += D->wlen;
@@ -343,7 +352,7 @@ int hts_parse_execute (struct connection *c) {
                 c->parse_state = htqp_readint;
                 D->data_size = 0;
               }
-            } else if (D->query_flags & (QF_HOST | QF_CONNECTION)) {
+            } else if (D->query_flags & (QF_HOST | QF_CONNECTION | QF_TRANSFER_ENCODING)) {
               D->wlen = 0;
               c->parse_state = htqp_readtospace;
             } else {
@@ -384,8 +393,11 @@ int hts_parse_execute (struct connection *c) {
             D->query_flags |= QF_CONNECTION;
           } else if (D->wlen == 14 && !strncasecmp (D->word, "content-length", 14)) {
             D->query_flags |= QF_DATASIZE;
+          } else if (D->wlen == 17 && !strncasecmp (D->word, "transfer-encoding", 15)) {
+            /* only 15 first chars of the header name are saved */
+            D->query_flags |= QF_TRANSFER_ENCODING;
           } else {
-            D->query_flags &= ~(QF_HOST | QF_DATASIZE | QF_CONNECTION);
+            D->query_flags &= ~(QF_HOST | QF_DATASIZE | QF_CONNECTION | QF_TRANSFER_ENCODING);
           }
 
           D->header_size += D->wlen + 1;
@@ -553,16 +565,20 @@ int hts_parse_execute (struct connection *c) {
         }
         D->query_flags |= QF_ERROR;
       }
+      if ((D->query_flags & QF_CHUNKED) && D->data_size >= 0) {
+        /* both Content-Length and Transfer-Encoding are given */
+        D->query_flags |= QF_ERROR;
+      }
       if (!(D->query_flags & QF_ERROR)) {
         c->status = conn_running;
         if (!HTS_FUNC(c)->execute) {
           HTS_FUNC(c)->execute = hts_default_execute;
         }
         int res;
-        if (D->query_type == htqt_post && D->data_size < 0) {
+        if (D->query_type == htqt_post && D->data_size < 0 && !(D->query_flags & QF_CHUNKED)) {
           assert (advance_skip_read_ptr (&c->In, D->header_size) == D->header_size);
           res = -411;
-        } else if (D->query_type != htqt_post && D->data_size > 0) {
+        } else if (D->query_type != htqt_post && (D->data_size > 0 || (D->query_flags & QF_CHUNKED))) {
           res = -413;
         } else {
           res = HTS_FUNC(c)->execute (c, D->query_type);
@@ -586,7 +602,8 @@ int hts_parse_execute (struct connection *c) {
               }
             }
           } else {
-            if (res == -413) {
+            if (res == -413 || (D->query_flags & QF_CHUNKED)) {
+              /* the body is not skipped, so the connection can't be reused */
               D->query_flags &= ~QF_KEEPALIVE;
             }
             write_http_error (c, -res);
@@ -823,6 +840,183 @@ int get_http_header (const char *qHeaders, const int qHeadersLen, char *buffer,
   return -1;
 }
 
+enum http_chunked_parse_state {
+  htcp_size,
+  htcp_extension,
+  htcp_size_lf,
+  htcp_data,
+  htcp_data_cr,
+  htcp_data_lf,
+  htcp_trailer_start,
+  htcp_trailer_line,
+  htcp_trailer_lf,
+  htcp_done
+};
+
+static inline int hex_digit_value (char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+void hts_chunked_body_init (struct hts_chunked_body *B) {
+  memset (B, 0, sizeof (*B));
+  B->state = htcp_size;
+}
+
+int hts_decode_chunked_body (struct hts_chunked_body *B, nb_iterator_t *it, char *buf, int max_len, int *need_bytes) {
+  /* the decoding goes on from where the previous call has stopped */
+  int state = B->state;
+  int size_digits = B->size_digits;
+  long long chunk_left = B->chunk_left;
+  int encoded = B->encoded, decoded = B->decoded;
+
+  *need_bytes = 0;
+
+  while (state != htcp_done) {
+    int len = nbit_ready_bytes (it);
+    if (len <= 0) {
+      break;
+    }
+    char *ptr_s = static_cast<char *>(nbit_get_ptr (it));
+    char *ptr = ptr_s, *ptr_e = ptr_s + len;
+
+    while (ptr < ptr_e && state != htcp_done) {
+      switch (state) {
+        case htcp_size: {
+          int digit = hex_digit_value (*ptr);
+          if (digit >= 0) {
+            chunk_left = chunk_left * 16 + digit;
+            if (decoded + chunk_left > max_len) {
+              return -2;
+            }
+            size_digits++;
+            ptr++;
+            break;
+          }
+          if (!size_digits) {
+            return -1;
+          }
+          if (*ptr == ';' || *ptr == ' ' || *ptr == '\t') {
+            state = htcp_extension;
+          } else if (*ptr == '\r') {
+            ptr++;
+            state = htcp_size_lf;
+          } else if (*ptr == '\n') {
+            state = htcp_size_lf;
+          } else {
+            return -1;
+          }
+          break;
+        }
+
+        case htcp_extension:
+          while (ptr < ptr_e && *ptr != '\n') {
+            ptr++;
+          }
+          if (ptr < ptr_e) {
+            state = htcp_size_lf;
+          }
+          break;
+
+        case htcp_size_lf:
+          if (*ptr != '\n') {
+            return -1;
+          }
+          ptr++;
+          state = chunk_left ? htcp_data : htcp_trailer_start;
+          break;
+
+        case htcp_data: {
+          int n = ptr_e - ptr < chunk_left ? static_cast<int>(ptr_e - ptr) : static_cast<int>(chunk_left);
+          if (buf) {
+            memcpy (buf + decoded, ptr, n);
+          }
+          decoded += n;
+          chunk_left -= n;
+          ptr += n;
+          if (!chunk_left) {
+            state = htcp_data_cr;
+          }
+          break;
+        }
+
+        case htcp_data_cr:
+          if (*ptr == '\r') {
+            ptr++;
+          }
+          state = htcp_data_lf;
+          break;
+
+        case htcp_data_lf:
+          if (*ptr != '\n') {
+            return -1;
+          }
+          ptr++;
+          size_digits = 0;
+          state = htcp_size;
+          break;
+
+        case htcp_trailer_start:
+          if (*ptr == '\r') {
+            ptr++;
+            state = htcp_trailer_lf;
+          } else if (*ptr == '\n') {
+            state = htcp_trailer_lf;
+          } else {
+            state = htcp_trailer_line;
+          }
+          break;
+
+        case htcp_trailer_line:
+          while (ptr < ptr_e && *ptr != '\n') {
+            ptr++;
+          }
+          if (ptr < ptr_e) {
+            ptr++;
+            state = htcp_trailer_start;
+          }
+          break;
+
+        case htcp_trailer_lf:
+          if (*ptr != '\n') {
+            return -1;
+          }
+          ptr++;
+          state = htcp_done;
+          break;
+
+        default:
+          assert (0);
+      }
+    }
+
+    encoded += ptr - ptr_s;
+    nbit_advance (it, ptr - ptr_s);
+    /* chunk sizes, extensions and trailers can't be longer than the data itself plus a header */
+    if (encoded - decoded > max_len + MAX_HTTP_HEADER_SIZE) {
+      return -1;
+    }
+  }
+
+  B->state = state;
+  B->size_digits = size_digits;
+  B->chunk_left = chunk_left;
+  B->encoded = encoded;
+  B->decoded = decoded;
+  if (state != htcp_done) {
+    /* the rest of the chunk, its CRLF and at least "0\r\n\r\n" */
+    *need_bytes = state == htcp_data ? static_cast<int>(chunk_left) + 7 : 1;
+    return 0;
+  }
+  return encoded;
+}
+
 static char header_pattern[] = 
 "HTTP/1.1 %d %s\r\n"
 "Server: " SERVER_VERSION "\r\n"
@@ -7,6 +7,7 @@
 
 #include <sys/cdefs.h>
 
+#include "net/net-buffers.h"
 #include "net/net-connections.h"
 
 #define	MAX_HTTP_HEADER_SIZE	16384
@@ -61,8 +62,10 @@ enum hts_query_type {
 #define QF_HOST		2
 #define QF_DATASIZE	4
 #define	QF_CONNECTION	8
+#define	QF_TRANSFER_ENCODING	0x10
 #define	QF_KEEPALIVE	0x100
 #define	QF_EXTRA_HEADERS	0x200
+#define	QF_CHUNKED	0x400
 
 #define	HTS_DATA(c)	((struct hts_data *) ((c)->custom_data))
 #define	HTS_FUNC(c)	((struct http_server_functions *) ((c)->extra))
@@ -83,6 +86,23 @@ extern long long http_queries, http_bad_headers, http_queries_size;
 /* useful functions */
 int get_http_header (const char *qHeaders, const int qHeadersLen, char *buffer, int b_len, const char *arg_name, const int arg_len);
 
+/* state of "Transfer-Encoding: chunked" body decoding, kept between the calls while the body is being received */
+struct hts_chunked_body {
+  int state;
+  int size_digits;
+  long long chunk_left;
+  int encoded;  /* body bytes processed so far */
+  int decoded;  /* data bytes copied to buf so far */
+};
+
+void hts_chunked_body_init (struct hts_chunked_body *B);
+
+/* decodes "Transfer-Encoding: chunked" body from the iterator position, which has to be B->encoded bytes after the body start,
+   appends decoded data to buf at B->decoded (if buf is not NULL);
+   returns the encoded body size when the body is received completely,
+   0 if more bytes are needed (at least *need_bytes), -1 if the body is malformed, -2 if it is longer than max_len */
+int hts_decode_chunked_body (struct hts_chunked_body *B, nb_iterator_t *it, char *buf, int max_len, int *need_bytes);
+
 void gen_http_date (char date_buffer[29], int time);
 int gen_http_time (char *date_buffer, int *time);
 char *cur_http_date ();
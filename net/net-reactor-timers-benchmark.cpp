@@ -0,0 +1,160 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "common/precise-time.h"
+#include "net/net-reactor.h"
+
+// The reactor holds 100k query timeouts of 0.1..10 seconds, the way a proxy-like worker does.
+// Most of the queries are answered in time: their timers are removed and the new queries take their place.
+// The rest of them expire while the time goes by 1ms per 100 queries.
+// The binary heap the reactor used before is measured as well for the reference.
+
+namespace {
+
+constexpr int CONCURRENT_TIMEOUTS = 100000;
+constexpr int QUERIES_PER_TICK = 100;
+
+class TimerHeap {
+public:
+  explicit TimerHeap(int max_timers) :
+    heap_(max_timers + 1) {}
+
+  void insert(event_timer_t *et) {
+    adjust(et, et->h_idx ? et->h_idx : ++size_);
+  }
+
+  void remove(event_timer_t *et) {
+    const int i = et->h_idx;
+    if (!i) {
+      return;
+    }
+    et->h_idx = 0;
+    event_timer_t *last = heap_[size_--];
+    if (i <= size_) {
+      adjust(last, i);
+    }
+  }
+
+  void run(double now) {
+    while (size_ && heap_[1]->wakeup_time <= now) {
+      event_timer_t *et = heap_[1];
+      remove(et);
+      et->wakeup(et);
+    }
+  }
+
+private:
+  void adjust(event_timer_t *et, int i) {
+    while (i > 1 && heap_[i >> 1]->wakeup_time > et->wakeup_time) {
+      heap_[i] = heap_[i >> 1];
+      heap_[i]->h_idx = i;
+      i >>= 1;
+    }
+    for (int j = 2 * i; j <= size_; i = j, j <<= 1) {
+      if (j < size_ && heap_[j]->wakeup_time > heap_[j + 1]->wakeup_time) {
+        j++;
+      }
+      if (et->wakeup_time <= heap_[j]->wakeup_time) {
+        break;
+      }
+      heap_[i] = heap_[j];
+      heap_[i]->h_idx = i;
+    }
+    heap_[i] = et;
+    et->h_idx = i;
+  }
+
+  std::vector<event_timer_t *> heap_;
+  int size_{0};
+};
+
+class TimerWheel {
+public:
+  explicit TimerWheel(int max_timers) {
+    net_reactor_alloc(&ctx_, 1, max_timers);
+  }
+
+  ~TimerWheel() {
+    net_reactor_free(&ctx_);
+  }
+
+  void insert(event_timer_t *et) {
+    net_reactor_insert_event_timer(&ctx_, et);
+  }
+
+  void remove(event_timer_t *et) {
+    net_reactor_remove_event_timer(&ctx_, et);
+  }
+
+  void run(double) {
+    while (!net_reactor_run_timers(&ctx_)) {
+    }
+  }
+
+private:
+  net_reactor_ctx_t ctx_{};
+};
+
+std::mt19937 gen{1};
+std::uniform_real_distribution<double> timeout{0.1, 10};
+int expired_timers = 0;
+
+// an expired query is replaced by a new one
+template<class Timers>
+Timers *timers_of_expired;
+
+template<class Timers>
+int restart_expired_timer(event_timer_t *et) {
+  expired_timers++;
+  et->wakeup_time = precise_now + timeout(gen);
+  timers_of_expired<Timers>->insert(et);
+  return 0;
+}
+
+template<class Timers>
+void BM_query_timeouts(benchmark::State &state) {
+  const double answered_share = static_cast<double>(state.range(0)) / 100;
+  Timers timers{CONCURRENT_TIMEOUTS * 2};
+  timers_of_expired<Timers> = &timers;
+  precise_now = 1000000.0;
+  expired_timers = 0;
+
+  std::vector<event_timer_t> queries(CONCURRENT_TIMEOUTS);
+  for (auto &query : queries) {
+    query = event_timer_t{};
+    query.wakeup = restart_expired_timer<Timers>;
+    query.wakeup_time = precise_now + timeout(gen);
+    timers.insert(&query);
+  }
+
+  std::uniform_int_distribution<int> any_query{0, CONCURRENT_TIMEOUTS - 1};
+  std::uniform_real_distribution<double> share{0, 1};
+  int64_t queries_sent = 0;
+  for (auto _ : state) {
+    event_timer_t &query = queries[any_query(gen)];
+    if (share(gen) < answered_share) {
+      timers.remove(&query);
+      query.wakeup_time = precise_now + timeout(gen);
+      timers.insert(&query);
+    }
+    if (++queries_sent % QUERIES_PER_TICK == 0) {
+      precise_now += 0.001;
+      timers.run(precise_now);
+    }
+  }
+  state.SetItemsProcessed(queries_sent);
+  state.counters["expired"] = expired_timers;
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_query_timeouts, TimerHeap)->Arg(90)->Arg(99);
+BENCHMARK_TEMPLATE(BM_query_timeouts, TimerWheel)->Arg(90)->Arg(99);
+
+BENCHMARK_MAIN();
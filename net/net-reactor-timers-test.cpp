@@ -0,0 +1,130 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/precise-time.h"
+#include "net/net-reactor.h"
+
+namespace {
+
+struct test_timer {
+  event_timer_t et{};
+  int fired{0};
+  double fired_at{0};
+};
+
+int test_timer_wakeup(event_timer_t *et) {
+  auto *timer = reinterpret_cast<test_timer *>(et);
+  timer->fired++;
+  timer->fired_at = precise_now;
+  return 0;
+}
+
+class net_reactor_timers_test : public ::testing::Test {
+protected:
+  void SetUp() override {
+    net_reactor_alloc(&ctx_, 1, 1 << 20);
+    precise_now = 1000000.0;
+  }
+
+  void TearDown() override {
+    net_reactor_free(&ctx_);
+  }
+
+  void insert(test_timer &timer, double wakeup_time) {
+    timer.et.wakeup = test_timer_wakeup;
+    timer.et.wakeup_time = wakeup_time;
+    net_reactor_insert_event_timer(&ctx_, &timer.et);
+  }
+
+  int run_timers() {
+    int wait_ms = 0;
+    while (!(wait_ms = net_reactor_run_timers(&ctx_))) {
+    }
+    return wait_ms;
+  }
+
+  net_reactor_ctx_t ctx_{};
+};
+
+} // namespace
+
+TEST_F(net_reactor_timers_test, test_wakeup_is_never_early) {
+  std::mt19937 gen{1};
+  std::vector<test_timer> timers(3000);
+  const double start = precise_now;
+  for (auto &timer : timers) {
+    // from the overdue ones up to several hours, the wheel levels are all used
+    const double delay = std::uniform_real_distribution<double>{-1, 1}(gen) * std::pow(10.0, gen() % 5);
+    insert(timer, start + delay);
+  }
+  ASSERT_EQ(net_reactor_timers(&ctx_), timers.size());
+
+  while (net_reactor_timers(&ctx_)) {
+    const int wait_ms = run_timers();
+    ASSERT_GT(wait_ms, 0);
+    for (const auto &timer : timers) {
+      if (!timer.fired) {
+        // the reactor is not supposed to sleep past a wakeup, the overdue timers wake up with the next tick
+        ASSERT_GE(std::max(timer.et.wakeup_time, start) + 0.001, precise_now + (wait_ms - 1) / 1000.0);
+      }
+    }
+    precise_now += std::min(wait_ms, 1 + static_cast<int>(gen() % 100000)) / 1000.0;
+  }
+
+  for (const auto &timer : timers) {
+    ASSERT_EQ(timer.fired, 1);
+    ASSERT_EQ(timer.et.h_idx, 0);
+    ASSERT_GE(timer.fired_at, timer.et.wakeup_time);
+    ASSERT_LE(timer.fired_at, std::max(timer.et.wakeup_time, start) + 0.002);
+  }
+}
+
+TEST_F(net_reactor_timers_test, test_remove_and_reschedule) {
+  test_timer removed, rescheduled, kept;
+  insert(removed, precise_now + 0.5);
+  insert(rescheduled, precise_now + 3600);
+  insert(kept, precise_now + 100);
+  ASSERT_EQ(net_reactor_timers(&ctx_), 3);
+
+  ASSERT_EQ(net_reactor_remove_event_timer(&ctx_, &removed.et), 1);
+  ASSERT_EQ(net_reactor_remove_event_timer(&ctx_, &removed.et), 0);
+  insert(rescheduled, precise_now + 0.25);
+  ASSERT_EQ(net_reactor_timers(&ctx_), 2);
+
+  ASSERT_LE(run_timers(), 252);
+  precise_now += 0.251;
+  run_timers();
+  ASSERT_EQ(rescheduled.fired, 1);
+  ASSERT_EQ(kept.fired, 0);
+
+  precise_now += 100;
+  run_timers();
+  ASSERT_EQ(kept.fired, 1);
+  ASSERT_EQ(removed.fired, 0);
+  ASSERT_EQ(net_reactor_timers(&ctx_), 0);
+  ASSERT_EQ(run_timers(), 100000);
+}
+
+TEST_F(net_reactor_timers_test, test_far_timers) {
+  test_timer far, farther;
+  // beyond the wheel range of 2^32 ticks
+  insert(far, precise_now + 50 * 86400.0);
+  insert(farther, precise_now + 1e12);
+  for (int day = 1; day <= 50; ++day) {
+    precise_now += 86400;
+    run_timers();
+    ASSERT_EQ(far.fired, 0);
+  }
+  precise_now += 0.001;
+  run_timers();
+  ASSERT_EQ(far.fired, 1);
+  ASSERT_EQ(farther.fired, 0);
+  ASSERT_EQ(net_reactor_timers(&ctx_), 1);
+}
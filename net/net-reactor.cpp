@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <vector>
 
 #include "common/kernel-version.h"
 #include "common/kprintf.h"
@@ -37,12 +38,14 @@ void net_reactor_alloc(net_reactor_ctx_t *ctx, int max_events, int max_timers) {
   ctx->max_timers = max_timers;
   ctx->timestamp = 0;
   ctx->event_heap_size = 0;
-  ctx->timer_heap_size = 0;
+  ctx->timer_wheel_size = 0;
+  ctx->timer_wheel_tick = 0;
+  memset(ctx->timer_wheel_bitmap, 0, sizeof(ctx->timer_wheel_bitmap));
   ctx->now = 0;
   ctx->prev_now = 0;
   ctx->events = static_cast<event_t*>(calloc(max_events, sizeof(ctx->events[0])));
   ctx->event_heap = static_cast<event_t**>(calloc(max_events + 1, sizeof(ctx->event_heap[0])));
-  ctx->timer_heap = static_cast<event_timer_t**>(calloc(max_timers + 1, sizeof(ctx->timer_heap[0])));
+  ctx->timer_wheel = static_cast<event_timer_t**>(calloc(TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS, sizeof(ctx->timer_wheel[0])));
   ctx->epoll_events = static_cast<epoll_event*>(calloc(max_events, sizeof(ctx->epoll_events[0])));
   ctx->pre_runqueue = ctx->post_runqueue = ctx->pre_event = NULL;
   ctx->wait_start = 0;
@@ -55,7 +58,7 @@ void net_reactor_alloc(net_reactor_ctx_t *ctx, int max_events, int max_timers) {
 void net_reactor_free(net_reactor_ctx_t *ctx) {
   free(ctx->events);
   free(ctx->event_heap);
-  free(ctx->timer_heap);
+  free(ctx->timer_wheel);
   free(ctx->epoll_events);
 }
 
@@ -382,33 +385,101 @@ int net_reactor_close(net_reactor_ctx_t *ctx, int fd) {
   return 0;
 }
 
-static inline int basic_et_adjust(net_reactor_ctx_t *ctx, event_timer_t *et, int i) {
-  int j;
-  while (i > 1) {
-    j = (i >> 1);
-    if (ctx->timer_heap[j]->wakeup_time <= et->wakeup_time) {
-      break;
+static constexpr int64_t timer_wheel_slot_mask = TIMER_WHEEL_SLOTS - 1;
+static constexpr int64_t timer_wheel_max_delta = (int64_t{1} << (TIMER_WHEEL_LEVEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+static inline int64_t timer_wheel_now_tick() {
+  return static_cast<int64_t>(precise_now * TIMER_WHEEL_TICKS_PER_SECOND);
+}
+
+static inline void timer_wheel_link(net_reactor_ctx_t *ctx, event_timer_t *et, int slot) {
+  event_timer_t *&head = ctx->timer_wheel[slot];
+  if (head) {
+    et->next = head;
+    et->prev = head->prev;
+    head->prev->next = et;
+    head->prev = et;
+  } else {
+    head = et->next = et->prev = et;
+  }
+  if (slot < TIMER_WHEEL_SLOTS) {
+    ctx->timer_wheel_bitmap[slot >> 6] |= uint64_t{1} << (slot & 63);
+  }
+  et->h_idx = slot + 1;
+}
+
+static inline void timer_wheel_unlink(net_reactor_ctx_t *ctx, event_timer_t *et) {
+  const int slot = et->h_idx - 1;
+  event_timer_t *&head = ctx->timer_wheel[slot];
+  if (et->next == et) {
+    head = nullptr;
+    if (slot < TIMER_WHEEL_SLOTS) {
+      ctx->timer_wheel_bitmap[slot >> 6] &= ~(uint64_t{1} << (slot & 63));
+    }
+  } else {
+    et->prev->next = et->next;
+    et->next->prev = et->prev;
+    if (head == et) {
+      head = et->next;
     }
-    ctx->timer_heap[i] = ctx->timer_heap[j];
-    ctx->timer_heap[i]->h_idx = i;
-    i = j;
   }
-  j = 2 * i;
-  while (j <= ctx->timer_heap_size) {
-    if (j < ctx->timer_heap_size && ctx->timer_heap[j]->wakeup_time > ctx->timer_heap[j + 1]->wakeup_time) {
-      j++;
+  et->prev = et->next = nullptr;
+  et->h_idx = 0;
+}
+
+// puts the timer into the level which covers its distance from the current tick,
+// the overdue timers go into the current slot and the too distant ones are cascaded from the farthest slot again
+static void timer_wheel_place(net_reactor_ctx_t *ctx, event_timer_t *et) {
+  const double ticks = et->wakeup_time * TIMER_WHEEL_TICKS_PER_SECOND - static_cast<double>(ctx->timer_wheel_tick);
+  const int64_t delta = ticks <= 0 ? 0 : ticks >= timer_wheel_max_delta ? timer_wheel_max_delta : static_cast<int64_t>(ticks);
+  const int64_t tick = ctx->timer_wheel_tick + delta;
+  int level = 0;
+  while (delta >> (TIMER_WHEEL_LEVEL_BITS * (level + 1))) {
+    level++;
+  }
+  timer_wheel_link(ctx, et, level * TIMER_WHEEL_SLOTS + static_cast<int>((tick >> (TIMER_WHEEL_LEVEL_BITS * level)) & timer_wheel_slot_mask));
+}
+
+// called when the current tick wraps the lowest level
+static void timer_wheel_cascade(net_reactor_ctx_t *ctx) {
+  for (int level = 1; level < TIMER_WHEEL_LEVELS; ++level) {
+    const int index = static_cast<int>((ctx->timer_wheel_tick >> (TIMER_WHEEL_LEVEL_BITS * level)) & timer_wheel_slot_mask);
+    event_timer_t *et;
+    while ((et = ctx->timer_wheel[level * TIMER_WHEEL_SLOTS + index])) {
+      timer_wheel_unlink(ctx, et);
+      timer_wheel_place(ctx, et);
     }
-    if (et->wakeup_time <= ctx->timer_heap[j]->wakeup_time) {
+    if (index) {
       break;
     }
-    ctx->timer_heap[i] = ctx->timer_heap[j];
-    ctx->timer_heap[i]->h_idx = i;
-    i = j;
-    j <<= 1;
   }
-  ctx->timer_heap[i] = et;
-  et->h_idx = i;
-  return i;
+}
+
+// the first non-empty slot of the lowest level in [from, TIMER_WHEEL_SLOTS), or TIMER_WHEEL_SLOTS
+static int timer_wheel_next_slot(const net_reactor_ctx_t *ctx, int from) {
+  for (int i = from >> 6; i < TIMER_WHEEL_SLOTS / 64; ++i) {
+    uint64_t bits = ctx->timer_wheel_bitmap[i];
+    if (i == from >> 6) {
+      bits &= ~uint64_t{0} << (from & 63);
+    }
+    if (bits) {
+      return (i << 6) + __builtin_ctzll(bits);
+    }
+  }
+  return TIMER_WHEEL_SLOTS;
+}
+
+template<class F>
+static void for_each_event_timer(net_reactor_ctx_t *ctx, const F &f) {
+  for (int slot = 0; slot < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS; ++slot) {
+    if (event_timer_t *head = ctx->timer_wheel[slot]) {
+      event_timer_t *et = head;
+      do {
+        f(et);
+        et = et->next;
+      } while (et != head);
+    }
+  }
 }
 
 static int event_timer_cmp(const void *l, const void *r) {
@@ -424,73 +495,83 @@ static int event_timer_cmp(const void *l, const void *r) {
 }
 
 static void dump_too_many_event_timers(net_reactor_ctx_t *ctx) {
-  tvkprintf(net_events, 0, "Too many event timers: %d\n", ctx->timer_heap_size);
-  qsort(&ctx->timer_heap[1], (size_t) ctx->timer_heap_size, sizeof(ctx->timer_heap[0]), event_timer_cmp);
-  for (int i = 1; i <= ctx->timer_heap_size;) {
-    int j = i;
-    while (j != ctx->timer_heap_size + 1 && event_timer_cmp(&ctx->timer_heap[i], &ctx->timer_heap[j]) == 0) {
+  tvkprintf(net_events, 0, "Too many event timers: %d\n", ctx->timer_wheel_size);
+  std::vector<event_timer_t *> timers;
+  timers.reserve(ctx->timer_wheel_size);
+  for_each_event_timer(ctx, [&timers](event_timer_t *et) { timers.push_back(et); });
+  qsort(timers.data(), timers.size(), sizeof(timers[0]), event_timer_cmp);
+  for (size_t i = 0; i < timers.size();) {
+    size_t j = i;
+    while (j != timers.size() && event_timer_cmp(&timers[i], &timers[j]) == 0) {
       j++;
     }
-    tvkprintf(net_events, 0, "%d * %s\n", j - i, ctx->timer_heap[i]->operation);
+    tvkprintf(net_events, 0, "%zu * %s\n", j - i, timers[i]->operation);
     i = j;
   }
 }
 
 bool net_reactor_has_too_many_timers(net_reactor_ctx_t *ctx) {
-  return ctx->timer_heap_size * 2 >= ctx->max_timers;
+  return ctx->timer_wheel_size * 2 >= ctx->max_timers;
 }
 
 int net_reactor_insert_event_timer(net_reactor_ctx_t *ctx, event_timer_t *et) {
-  int i;
   if (et->h_idx) {
-    i = et->h_idx;
-    assert(i > 0 && i <= ctx->timer_heap_size && ctx->timer_heap[i] == et);
+    assert(et->h_idx > 0 && et->h_idx <= TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS);
+    timer_wheel_unlink(ctx, et);
   } else {
-    if (ctx->timer_heap_size >= ctx->max_timers) {
+    if (ctx->timer_wheel_size >= ctx->max_timers) {
       dump_too_many_event_timers(ctx);
     }
-    assert(ctx->timer_heap_size < ctx->max_timers);
-    i = ++ctx->timer_heap_size;
+    assert(ctx->timer_wheel_size < ctx->max_timers);
+    if (!ctx->timer_wheel_size) {
+      // nothing is to be cascaded, so the empty wheel just skips the passed ticks
+      ctx->timer_wheel_tick = std::max(ctx->timer_wheel_tick, timer_wheel_now_tick());
+    }
+    ++ctx->timer_wheel_size;
   }
 
-  return basic_et_adjust(ctx, et, i);
+  timer_wheel_place(ctx, et);
+  return et->h_idx;
 }
 
 int net_reactor_remove_event_timer(net_reactor_ctx_t *ctx, event_timer_t *et) {
-  int i = et->h_idx;
-  if (!i) {
+  if (!et->h_idx) {
     return 0;
   }
-  assert(i > 0 && i <= ctx->timer_heap_size && ctx->timer_heap[i] == et);
-  et->h_idx = 0;
-
-  et = ctx->timer_heap[ctx->timer_heap_size--];
-  if (i > ctx->timer_heap_size) {
-    return 1;
-  }
-  basic_et_adjust(ctx, et, i);
+  assert(et->h_idx > 0 && et->h_idx <= TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS && ctx->timer_wheel_size > 0);
+  timer_wheel_unlink(ctx, et);
+  --ctx->timer_wheel_size;
   return 1;
 }
 
 int net_reactor_run_timers(net_reactor_ctx_t *ctx) {
-  double wait_time;
-  event_timer_t *et;
-  if (!ctx->timer_heap_size) {
+  if (!ctx->timer_wheel_size) {
     return 100000;
   }
-  wait_time = ctx->timer_heap[1]->wakeup_time - precise_now;
-  if (wait_time > 0) {
+  const int64_t now_tick = timer_wheel_now_tick();
+  if (ctx->timer_wheel_tick >= now_tick) {
+    // the next non-empty slot or the next cascade, whichever comes first
+    const int index = static_cast<int>(ctx->timer_wheel_tick & timer_wheel_slot_mask);
+    const int64_t next_tick = ctx->timer_wheel_tick - index + timer_wheel_next_slot(ctx, index);
+    const double wait_time = std::max(static_cast<double>(next_tick + 1) / TIMER_WHEEL_TICKS_PER_SECOND - precise_now, 0.0);
     // do not remove this useful debug!
-    tvkprintf(net_events, 3, "%d event timers, next in %.3f seconds\n", ctx->timer_heap_size, wait_time);
+    tvkprintf(net_events, 3, "%d event timers, next in %.3f seconds\n", ctx->timer_wheel_size, wait_time);
     return (int)(std::min(100.0, wait_time) * 1000) + 1; // min to prevent integer overflow
   }
 
   const vk::net::TimeSlice time_slice(max_time_slice);
-  while (ctx->timer_heap_size > 0 && ctx->timer_heap[1]->wakeup_time <= precise_now && !pending_signals && !time_slice.expired()) {
-    et = ctx->timer_heap[1];
-    assert(et->h_idx == 1);
-    net_reactor_remove_event_timer(ctx, et);
-    et->wakeup(et);
+  while (ctx->timer_wheel_tick < now_tick && !pending_signals && !time_slice.expired()) {
+    const int index = static_cast<int>(ctx->timer_wheel_tick & timer_wheel_slot_mask);
+    if (event_timer_t *et = ctx->timer_wheel[index]) {
+      net_reactor_remove_event_timer(ctx, et);
+      et->wakeup(et);
+      continue;
+    }
+    // skip the empty slots up to the next cascade
+    ctx->timer_wheel_tick = std::min(now_tick, ctx->timer_wheel_tick - index + timer_wheel_next_slot(ctx, index + 1));
+    if (!(ctx->timer_wheel_tick & timer_wheel_slot_mask)) {
+      timer_wheel_cascade(ctx);
+    }
   }
   return 0;
 }
@@ -551,7 +632,7 @@ int net_reactor_runqueue(net_reactor_ctx_t *ctx) {
 }
 
 int net_reactor_work_timers(net_reactor_ctx_t *ctx, int timeout) {
-  if (ctx->event_heap_size || ctx->timer_heap_size) {
+  if (ctx->event_heap_size || ctx->timer_wheel_size) {
     ctx->now = time(0);
     get_utime_monotonic();
     const vk::net::TimeSlice time_slice(max_time_slice);
@@ -9,6 +9,7 @@
 #include <sys/epoll.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define EVT_READ        4
 #define EVT_WRITE       2
@@ -54,18 +55,27 @@ typedef struct event_timer event_timer_t;
 
 typedef int (*event_timer_wakeup_t)(event_timer_t *et);
 struct event_timer {
-  int h_idx;
+  int h_idx;       // timer wheel slot + 1 (0=not active)
   event_timer_wakeup_t wakeup;
   double wakeup_time;
   const char *operation;
+  event_timer_t *prev, *next; // the slot list
 };
 
+// The timers are kept in a hierarchical timing wheel with 1ms ticks: insertion and removal are O(1),
+// the timers are cascaded to the lower levels as the time goes and wake up by whole slots.
+// A timer wakes up within a tick after its wakeup_time, never before it.
+#define TIMER_WHEEL_TICKS_PER_SECOND 1000
+#define TIMER_WHEEL_LEVEL_BITS 8
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
 struct net_reactor_ctx {
   int epoll_fd;
   int max_events;
   int max_timers;
   int event_heap_size;
-  int timer_heap_size;
+  int timer_wheel_size;
   int now;
   int prev_now;
   int64_t timestamp;
@@ -73,7 +83,9 @@ struct net_reactor_ctx {
   event_t *events;
   event_t *timers;
   event_t **event_heap;
-  event_timer_t **timer_heap;
+  int64_t timer_wheel_tick; // the next tick to expire
+  event_timer_t **timer_wheel;
+  uint64_t timer_wheel_bitmap[TIMER_WHEEL_SLOTS / 64]; // non-empty slots of the lowest level
   epoll_func_vector_t pre_runqueue;
   epoll_func_vector_t post_runqueue;
   epoll_func_vector_t pre_event;
@@ -90,7 +102,7 @@ static inline int net_reactor_events(const net_reactor_ctx_t *reactor_ctx) {
 }
 
 static inline int net_reactor_timers(const net_reactor_ctx_t *reactor_ctx) {
-  return reactor_ctx->timer_heap_size;
+  return reactor_ctx->timer_wheel_size;
 }
 
 void net_reactor_alloc(net_reactor_ctx_t *ctx, int max_events, int max_timers);
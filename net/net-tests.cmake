@@ -1,6 +1,8 @@
 prepend(NET_TESTS_SOURCES ${BASE_DIR}/net/
         net-aes-keys-test.cpp
+        net-http-server-test.cpp
         net-msg-test.cpp
+        net-reactor-timers-test.cpp
         net-test.cpp
         time-slice-test.cpp)
 
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "common/algorithms/fastmod.h"
+#include "common/algorithms/simd-control-group.h"
+
+#include "runtime/sorting.h"
 
 #ifndef INCLUDED_FROM_KPHP_CORE
   #error "this file must be included only from kphp_core.h"
@@ -38,63 +41,6 @@ array_size &array_size::min(const array_size &other) {
   return *this;
 }
 
-namespace dl {
-
-template<class T, class T1>
-void sort(T *begin_init, T *end_init, const T1 &compare) {
-  T *begin_stack[32];
-  T *end_stack[32];
-
-  begin_stack[0] = begin_init;
-  end_stack[0] = end_init - 1;
-
-  for (int depth = 0; depth >= 0; --depth) {
-    T *begin = begin_stack[depth];
-    T *end = end_stack[depth];
-
-    while (begin < end) {
-      const auto offset = (end - begin) >> 1;
-      swap(*begin, begin[offset]);
-
-      T *i = begin + 1, *j = end;
-
-      while (1) {
-        while (i < j && compare(*begin, *i) > 0) {
-          i++;
-        }
-
-        while (i <= j && compare(*j, *begin) > 0) {
-          j--;
-        }
-
-        if (i >= j) {
-          break;
-        }
-
-        swap(*i++, *j--);
-      }
-
-      swap(*begin, *j);
-
-      if (j - begin <= end - j) {
-        if (j + 1 < end) {
-          begin_stack[depth] = j + 1;
-          end_stack[depth++] = end;
-        }
-        end = j - 1;
-      } else {
-        if (begin < j - 1) {
-          begin_stack[depth] = begin;
-          end_stack[depth++] = j - 1;
-        }
-        begin = j + 1;
-      }
-    }
-  }
-}
-
-} // namespace dl
-
 template<class T>
 typename array<T>::key_type array<T>::int_hash_entry::get_key() const {
   return key_type(int_key);
@@ -215,6 +161,21 @@ typename array<T>::string_hash_entry *array<T>::array_inner::get_string_entries(
   return (string_hash_entry * )(int_entries + int_buf_size);
 }
 
+template<class T>
+const uint8_t *array<T>::array_inner::get_string_ctrl() const {
+  return reinterpret_cast<const uint8_t *>(get_string_entries() + string_buf_size);
+}
+
+template<class T>
+uint8_t *array<T>::array_inner::get_string_ctrl() {
+  return reinterpret_cast<uint8_t *>(get_string_entries() + string_buf_size);
+}
+
+template<class T>
+void array<T>::array_inner::set_string_ctrl(uint32_t bucket, uint8_t value) {
+  simd_control_group::set_ctrl(get_string_ctrl(), bucket, string_buf_size, value);
+}
+
 template<class T>
 typename array<T>::array_inner_fields_for_map &array<T>::array_inner::fields_for_map() {
   return *reinterpret_cast<array_inner_fields_for_map *>(reinterpret_cast<char *>(this) - sizeof(array_inner_fields_for_map));
@@ -230,9 +191,22 @@ size_t array<T>::array_inner::sizeof_vector(uint32_t int_size) {
   return sizeof(array_inner) + int_size * sizeof(T);
 }
 
+template<class T>
+size_t array<T>::array_inner::sizeof_string_ctrl(uint32_t string_size) {
+  return (string_size + simd_control_group::cloned_bytes() + 7) & ~size_t{7};
+}
+
 template<class T>
 size_t array<T>::array_inner::sizeof_map(uint32_t int_size, uint32_t string_size) {
-  return sizeof(array_inner_fields_for_map) + sizeof(array_inner) + int_size * sizeof(int_hash_entry) + string_size * sizeof(string_hash_entry);
+  return sizeof(array_inner_fields_for_map) + sizeof(array_inner) + int_size * sizeof(int_hash_entry) + string_size * sizeof(string_hash_entry) +
+         sizeof_string_ctrl(string_size);
+}
+
+template<class T>
+bool array<T>::array_inner::is_string_part_overloaded(uint32_t string_size, uint32_t string_buf_size) {
+  // thanks to the control bytes long probe sequences are cheap, so the string part is allowed to be filled denser than the int one,
+  // but at least one bucket has to stay empty: lookups and insertions stop probing only there
+  return string_size * 5 > 4 * string_buf_size || string_size + 1 >= string_buf_size;
 }
 
 template<class T>
@@ -485,18 +459,37 @@ auto &array<T>::array_inner::find_map_entry(S &self, int64_t int_key) noexcept {
 }
 
 template<class T>
-template<class S>
-auto &array<T>::array_inner::find_map_entry(S &self, const string &string_key, int64_t precomuted_hash) noexcept {
-  auto *string_entries = self.get_string_entries();
-  uint32_t bucket = self.choose_bucket_string(precomuted_hash);
-  while (string_entries[bucket].next != EMPTY_POINTER &&
-         (string_entries[bucket].int_key != precomuted_hash || string_entries[bucket].string_key != string_key)) {
-    if (unlikely (++bucket == self.string_buf_size)) {
-      bucket = 0;
+uint32_t array<T>::array_inner::find_string_bucket(const string &string_key, int64_t precomuted_hash) const noexcept {
+  using simd_control_group::Group;
+
+  const string_hash_entry *string_entries = get_string_entries();
+  const uint8_t *ctrl = get_string_ctrl();
+  const uint8_t h2 = simd_control_group::make_full(precomuted_hash);
+  uint32_t group_start = choose_bucket_string(precomuted_hash);
+  auto wrap_bucket = [this](uint32_t bucket) {
+    return likely(bucket < string_buf_size) ? bucket : bucket % string_buf_size;
+  };
+
+  // linear probing by groups: the key can't be placed after an empty bucket
+  while (true) {
+    const Group group{ctrl + group_start};
+    for (auto match = group.match(h2); match; ++match) {
+      const uint32_t bucket = wrap_bucket(group_start + match.lowest());
+      if (string_entries[bucket].int_key == precomuted_hash && string_entries[bucket].string_key == string_key) {
+        return bucket;
+      }
     }
+    if (const auto empty = group.match_empty()) {
+      return wrap_bucket(group_start + empty.lowest());
+    }
+    group_start = wrap_bucket(group_start + Group::WIDTH);
   }
+}
 
-  return string_entries[bucket];
+template<class T>
+template<class S>
+auto &array<T>::array_inner::find_map_entry(S &self, const string &string_key, int64_t precomuted_hash) noexcept {
+  return self.get_string_entries()[self.find_string_bucket(string_key, precomuted_hash)];
 }
 
 template<class T>
@@ -522,14 +515,10 @@ T &array<T>::array_inner::emplace_string_key_map_value(overwrite_element policy,
   static_assert(std::is_same<std::decay_t<STRING>, string>::value, "string_key should be string");
 
   string_hash_entry *string_entries = get_string_entries();
-  uint32_t bucket = choose_bucket_string(int_key);
-  while (string_entries[bucket].next != EMPTY_POINTER && (string_entries[bucket].int_key != int_key || string_entries[bucket].string_key != string_key)) {
-    if (unlikely (++bucket == string_buf_size)) {
-      bucket = 0;
-    }
-  }
+  const uint32_t bucket = find_string_bucket(string_key, int_key);
 
   if (string_entries[bucket].next == EMPTY_POINTER) {
+    set_string_ctrl(bucket, simd_control_group::make_full(int_key));
     string_entries[bucket].int_key = int_key;
     new(&string_entries[bucket].string_key) string{std::forward<STRING>(string_key)};
 
@@ -557,14 +546,10 @@ T &array<T>::array_inner::set_map_value(overwrite_element policy, int64_t int_ke
 template<class T>
 void array<T>::array_inner::unset_map_value(const string &string_key, int64_t precomuted_hash) {
   string_hash_entry *string_entries = get_string_entries();
-  uint32_t bucket = choose_bucket_string(precomuted_hash);
-  while (string_entries[bucket].next != EMPTY_POINTER && (string_entries[bucket].int_key != precomuted_hash || string_entries[bucket].string_key != string_key)) {
-    if (unlikely (++bucket == string_buf_size)) {
-      bucket = 0;
-    }
-  }
+  uint32_t bucket = find_string_bucket(string_key, precomuted_hash);
 
   if (string_entries[bucket].next != EMPTY_POINTER) {
+    set_string_ctrl(bucket, simd_control_group::EMPTY);
     string_entries[bucket].int_key = 0;
     string_entries[bucket].string_key.~string();
 
@@ -594,6 +579,8 @@ void array<T>::array_inner::unset_map_value(const string &string_key, int64_t pr
         list_hash_entry *ei = string_entries + ri, *ej = string_entries + rj;
         memcpy(ei, ej, sizeof(string_hash_entry));
         ej->next = EMPTY_POINTER;
+        set_string_ctrl(ri, simd_control_group::make_full(string_entries[ri].int_key));
+        set_string_ctrl(rj, simd_control_group::EMPTY);
 
         get_entry(ei->prev)->next = get_pointer(ei);
         get_entry(ei->next)->prev = get_pointer(ei);
@@ -726,7 +713,7 @@ void array<T>::mutate_if_map_needed_string() {
   }
 
   // not shared (ref_cnt == 0)
-  if (p->string_size * 5 > 3 * p->string_buf_size) {
+  if (array_inner::is_string_part_overloaded(p->string_size, p->string_buf_size)) {
     int64_t new_int_size = max(int64_t{p->int_size}, int64_t{p->int_buf_size >> 1} - 1);
     int64_t new_string_size = max(int64_t{p->string_size * 2 + 1}, int64_t{p->int_size});
     array_inner *new_array = array_inner::create(new_int_size, new_string_size, false);
@@ -1831,7 +1818,7 @@ array<T> &array<T>::operator+=(const array<T> &other) {
     uint32_t new_int_size = p->int_size + other.p->int_size;
     uint32_t new_string_size = p->string_size + other.p->string_size;
 
-    if (new_int_size * 5 > 3 * p->int_buf_size || new_string_size * 5 > 3 * p->string_buf_size || p->ref_cnt > 0) {
+    if (new_int_size * 5 > 3 * p->int_buf_size || array_inner::is_string_part_overloaded(new_string_size, p->string_buf_size) || p->ref_cnt > 0) {
       array_inner *new_array = array_inner::create(max(new_int_size, 2 * p->int_size) + 1, max(new_string_size, 2 * p->string_size) + 1, false);
 
       for (const string_hash_entry *it = p->begin(); it != p->end(); it = p->next(it)) {
@@ -2005,6 +1992,18 @@ int64_t array<T>::get_next_key() const {
 template<class T>
 template<class T1>
 void array<T>::sort(const T1 &compare, bool renumber) {
+  sort_values(compare, renumber, [](auto *begin, auto *end, const auto &cmp) { dl::sort(begin, end, cmp); });
+}
+
+template<class T>
+template<class T1>
+void array<T>::stable_sort(const T1 &compare, bool renumber) {
+  sort_values(compare, renumber, [](auto *begin, auto *end, const auto &cmp) { dl::stable_sort(begin, end, cmp); });
+}
+
+template<class T>
+template<class T1, class Sorter>
+void array<T>::sort_values(const T1 &compare, bool renumber, const Sorter &sorter) {
   int64_t n = count();
 
   if (renumber) {
@@ -2024,12 +2023,8 @@ void array<T>::sort(const T1 &compare, bool renumber) {
       mutate_if_vector_shared();
     }
 
-    const auto elements_cmp =
-      [&compare](const T &lhs, const T &rhs) {
-        return compare(lhs, rhs) > 0;
-      };
     T *begin = reinterpret_cast<T *>(p->int_entries);
-    dl::sort<T, decltype(elements_cmp)>(begin, begin + n, elements_cmp);
+    sorter(begin, begin + n, compare);
     return;
   }
 
@@ -2054,7 +2049,7 @@ void array<T>::sort(const T1 &compare, bool renumber) {
     [&compare](const int_hash_entry *lhs, const int_hash_entry *rhs) {
       return compare(lhs->value, rhs->value) > 0;
     };
-  dl::sort<int_hash_entry *, decltype(hash_entry_cmp)>(arTmp, arTmp + n, hash_entry_cmp);
+  sorter(arTmp, arTmp + n, hash_entry_cmp);
 
   arTmp[0]->prev = p->get_pointer(p->end());
   p->end()->next = p->get_pointer(arTmp[0]);
@@ -2093,7 +2088,7 @@ void array<T>::ksort(const T1 &compare) {
   }
 
   key_type *keysp = (key_type *)keys.p->int_entries;
-  dl::sort<key_type, T1>(keysp, keysp + n, compare);
+  dl::sort(keysp, keysp + n, compare);
 
   list_hash_entry *prev = (list_hash_entry *)p->end();
   for (uint32_t j = 0; j < n; j++) {
@@ -2111,13 +2106,7 @@ void array<T>::ksort(const T1 &compare) {
       string string_key = keysp[j].to_string();
       int64_t int_key = string_key.hash();
       string_hash_entry *string_entries = p->get_string_entries();
-      uint32_t bucket = p->choose_bucket_string(int_key);
-      while ((string_entries[bucket].int_key != int_key || string_entries[bucket].string_key != string_key)) {
-        if (unlikely (++bucket == p->string_buf_size)) {
-          bucket = 0;
-        }
-      }
-      cur = (list_hash_entry * ) & string_entries[bucket];
+      cur = (list_hash_entry * ) & string_entries[p->find_string_bucket(string_key, int_key)];
     }
 
     cur->prev = p->get_pointer(prev);
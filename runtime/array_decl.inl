@@ -31,11 +31,6 @@ struct array_size {
   #define KPHP_ARRAY_TAIL_SIZE
 #endif
 
-namespace dl {
-template<class T, class TT, class T1>
-void sort(TT *begin_init, TT *end_init, const T1 &compare);
-}
-
 enum class overwrite_element {
   YES,
   NO
@@ -91,6 +86,8 @@ private:
     //if key is string, int_key contains hash of this string, string_key contains this string.
     //empty hash_entry identified by (next == EMPTY_POINTER)
     //vector is_identified by string_buf_size == -1
+    //string entries are followed by control bytes (see simd-control-group.h), which are used for the SIMD probing;
+    //they are kept in sync with the string entries: a full control byte for each non-empty string hash_entry
 
     static constexpr uint32_t MAX_HASHTABLE_SIZE = (1 << 26);
 
@@ -127,6 +124,11 @@ private:
     inline const string_hash_entry *get_string_entries() const __attribute__ ((always_inline));
     inline string_hash_entry *get_string_entries() __attribute__ ((always_inline));
 
+    // control bytes of the string entries, they are placed right after them
+    inline const uint8_t *get_string_ctrl() const __attribute__ ((always_inline));
+    inline uint8_t *get_string_ctrl() __attribute__ ((always_inline));
+    inline void set_string_ctrl(uint32_t bucket, uint8_t value) __attribute__ ((always_inline));
+
     inline array_inner_fields_for_map &fields_for_map() __attribute__((always_inline));
     inline const array_inner_fields_for_map &fields_for_map() const __attribute__((always_inline));
 
@@ -135,7 +137,9 @@ private:
     inline static uint32_t choose_bucket(int64_t key, uint32_t buf_size, uint64_t modulo_helper) __attribute__ ((always_inline));
 
     inline static size_t sizeof_vector(uint32_t int_size) __attribute__((always_inline));
+    inline static size_t sizeof_string_ctrl(uint32_t string_size) __attribute__((always_inline));
     inline static size_t sizeof_map(uint32_t int_size, uint32_t string_size) __attribute__((always_inline));
+    inline static bool is_string_part_overloaded(uint32_t string_size, uint32_t string_buf_size) __attribute__((always_inline));
     inline static size_t estimate_size(int64_t &new_int_size, int64_t &new_string_size, bool is_vector);
     inline static array_inner *create(int64_t new_int_size, int64_t new_string_size, bool is_vector);
 
@@ -170,6 +174,8 @@ private:
     static inline auto &find_map_entry(S &self, int64_t int_key) noexcept;
     template<class S>
     static inline auto &find_map_entry(S &self, const string &string_key, int64_t precomuted_hash) noexcept;
+    // returns the bucket of the string key or the first empty bucket, where it can be inserted
+    inline uint32_t find_string_bucket(const string &string_key, int64_t precomuted_hash) const noexcept;
 
     template<class ...Key>
     inline const T *find_map_value(Key &&... key) const noexcept;
@@ -378,6 +384,9 @@ public:
   template<class T1>
   void sort(const T1 &compare, bool renumber);
 
+  template<class T1>
+  void stable_sort(const T1 &compare, bool renumber);
+
   template<class T1>
   void ksort(const T1 &compare);
 
@@ -421,6 +430,9 @@ private:
   template<class ...Key>
   iterator find_iterator_in_map_no_mutate(const Key &... key) noexcept;
 
+  template<class T1, class Sorter>
+  void sort_values(const T1 &compare, bool renumber, const Sorter &sorter);
+
   void push_back_values() {}
 
   template<class Arg, class...Args>
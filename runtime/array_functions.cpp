@@ -4,29 +4,26 @@
 
 #include "runtime/array_functions.h"
 
+#include "common/algorithms/string-search.h"
+
 array<string> explode(char delimiter, const string &str, int64_t limit) {
   array<string> res(array_size(limit < 10 ? limit : 1, 0, true));
 
-  const string::size_type s_len = str.size();
   const char *s = str.c_str();
-  string::size_type prev = 0;
+  const char *s_end = s + str.size();
+  const char *prev = s;
 
   if (limit > 1) {
-    for (string::size_type i = 0; i < s_len;) {
-      if (delimiter == s[i]) {
-        res.push_back(string(s + prev, i - prev));
-        i++;
-        prev = i;
-        limit--;
-        if (limit == 1) {
-          break;
-        }
-      } else {
-        i++;
+    while (const char *pos = static_cast<const char *>(memchr(prev, delimiter, s_end - prev))) {
+      res.push_back(string(prev, static_cast<string::size_type>(pos - prev)));
+      prev = pos + 1;
+      limit--;
+      if (limit == 1) {
+        break;
       }
     }
   }
-  res.push_back(string(s + prev, s_len - prev));
+  res.push_back(string(prev, static_cast<string::size_type>(s_end - prev)));
 
   return res;
 }
@@ -49,28 +46,20 @@ array<string> f$explode(const string &delimiter, const string &str, int64_t limi
 
   const char *d = delimiter.c_str();
   const char *s = str.c_str();
-  int64_t s_len = str.size();
-  int64_t prev = 0;
+  const char *s_end = s + str.size();
+  const char *prev = s;
 
   if (limit > 1) {
-    for (int64_t i = 0; i < s_len;) {
-      int64_t j = 0;
-      for (j = 0; j < d_len && d[j] == s[i + j]; j++) {
-      }
-      if (j == d_len) {
-        res.push_back(string(s + prev, static_cast<string::size_type>(i - prev)));
-        i += d_len;
-        prev = i;
-        limit--;
-        if (limit == 1) {
-          break;
-        }
-      } else {
-        i++;
+    while (const char *pos = vk::find_substring(prev, s_end - prev, d, d_len)) {
+      res.push_back(string(prev, static_cast<string::size_type>(pos - prev)));
+      prev = pos + d_len;
+      limit--;
+      if (limit == 1) {
+        break;
       }
     }
   }
-  res.push_back(string(s + prev, static_cast<string::size_type>(s_len - prev)));
+  res.push_back(string(prev, static_cast<string::size_type>(s_end - prev)));
 
   return res;
 }
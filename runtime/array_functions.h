@@ -217,6 +217,9 @@ void f$rsort(array<T> &a, int64_t flag = SORT_REGULAR);
 template<class T, class T1>
 void f$usort(array<T> &a, const T1 &compare);
 
+template<class T, class T1>
+void f$usort_stable(array<T> &a, const T1 &compare);
+
 template<class T>
 void f$asort(array<T> &a, int64_t flag = SORT_REGULAR);
 
@@ -226,6 +229,9 @@ void f$arsort(array<T> &a, int64_t flag = SORT_REGULAR);
 template<class T, class T1>
 void f$uasort(array<T> &a, const T1 &compare);
 
+template<class T, class T1>
+void f$uasort_stable(array<T> &a, const T1 &compare);
+
 template<class T>
 void f$ksort(array<T> &a, int64_t flag = SORT_REGULAR);
 
@@ -1222,6 +1228,24 @@ struct sort_compare_string {
   }
 };
 
+namespace dl {
+template<class T>
+struct scalar_order_of<sort_compare<T>> : scalar_order_of<std::greater<T>> {
+};
+
+template<class T>
+struct scalar_order_of<sort_compare_numeric<T>> : scalar_order_of<std::greater<T>> {
+};
+
+template<>
+struct scalar_order_of<std::greater<int64_t>> : std::integral_constant<scalar_order, scalar_order::ascending> {
+};
+
+template<>
+struct scalar_order_of<std::greater<double>> : std::integral_constant<scalar_order, scalar_order::ascending> {
+};
+} // namespace dl
+
 template<class T>
 struct sort_compare_natural {
   bool operator()(const T &h1, const T &h2) const {
@@ -1271,6 +1295,24 @@ struct rsort_compare_string {
   }
 };
 
+namespace dl {
+template<class T>
+struct scalar_order_of<rsort_compare<T>> : scalar_order_of<std::less<T>> {
+};
+
+template<class T>
+struct scalar_order_of<rsort_compare_numeric<T>> : scalar_order_of<std::less<T>> {
+};
+
+template<>
+struct scalar_order_of<std::less<int64_t>> : std::integral_constant<scalar_order, scalar_order::descending> {
+};
+
+template<>
+struct scalar_order_of<std::less<double>> : std::integral_constant<scalar_order, scalar_order::descending> {
+};
+} // namespace dl
+
 template<class T>
 void f$rsort(array<T> &a, int64_t flag) {
   switch (flag) {
@@ -1291,6 +1333,11 @@ void f$usort(array<T> &a, const T1 &compare) {
   return a.sort(compare, true);
 }
 
+template<class T, class T1>
+void f$usort_stable(array<T> &a, const T1 &compare) {
+  return a.stable_sort(compare, true);
+}
+
 
 template<class T>
 void f$asort(array<T> &a, int64_t flag) {
@@ -1325,6 +1372,11 @@ void f$uasort(array<T> &a, const T1 &compare) {
   return a.sort(compare, false);
 }
 
+template<class T, class T1>
+void f$uasort_stable(array<T> &a, const T1 &compare) {
+  return a.stable_sort(compare, false);
+}
+
 
 template<class T>
 void f$ksort(array<T> &a, int64_t flag) {
@@ -18,6 +18,29 @@
 //};
 //
 // Their instances are wrapped into the class_instance<T>.
+//
+// Polymorphic classes also have
+//  uint32_t get_class_id() const noexcept;
+//  static bool is_base_of_class_id(uint32_t class_id) noexcept;
+// where class ids are dense and assigned by the compiler, so is_a() and cast_to() do not need dynamic_cast.
+// The runtime interfaces (e.g. C$VK$TL$RpcFunction) don't have them, and dynamic_cast is used for them.
+
+namespace impl_ {
+
+template<class T, class Derived, class = void>
+struct has_class_id_check : std::false_type {};
+
+template<class T, class Derived>
+struct has_class_id_check<T, Derived, decltype(void(std::declval<const T &>().get_class_id()), void(Derived::is_base_of_class_id(0)))> : std::true_type {};
+
+// static_cast is ill-formed for the downcast from a virtual base
+template<class T, class Derived, class = void>
+struct has_class_id_downcast : std::false_type {};
+
+template<class T, class Derived>
+struct has_class_id_downcast<T, Derived, decltype(void(static_cast<Derived *>(std::declval<T *>())))> : has_class_id_check<T, Derived> {};
+
+} // namespace impl_
 
 template<class T>
 class class_instance {
@@ -95,6 +118,7 @@ public:
   bool is_null() const { return !static_cast<bool>(o); }
   const char *get_class() const { return o ? o->get_class() : "null"; }
   int64_t get_hash() const { return o ? o->get_hash() : 0; }
+  int64_t get_class_id() const { return o ? o->get_class_id() : 0; }
 
   template<class D>
   bool is_a() const {
@@ -103,6 +127,16 @@ public:
 
   template<class D, class CurType, class Derived = std::enable_if_t<std::is_polymorphic<CurType>{}, D>, class dummy = void>
   bool is_a_helper() const {
+    return is_a_polymorphic<Derived>(impl_::has_class_id_check<T, Derived>{});
+  }
+
+  template<class Derived>
+  bool is_a_polymorphic(std::true_type /*has class id*/) const {
+    return o && Derived::is_base_of_class_id(o->get_class_id());
+  }
+
+  template<class Derived>
+  bool is_a_polymorphic(std::false_type /*has class id*/) const {
     return dynamic_cast<Derived *>(o.get());
   }
 
@@ -114,10 +148,20 @@ public:
   template<class Derived>
   class_instance<Derived> cast_to() const {
     class_instance<Derived> res;
-    res.o = vk::dynamic_pointer_cast<Derived>(o);
+    res.o = cast_to_helper<Derived>(impl_::has_class_id_downcast<T, Derived>{});
     return res;
   }
 
+  template<class Derived>
+  vk::intrusive_ptr<Derived> cast_to_helper(std::true_type /*has class id*/) const {
+    return is_a_polymorphic<Derived>(std::true_type{}) ? vk::static_pointer_cast<Derived>(o) : vk::intrusive_ptr<Derived>{};
+  }
+
+  template<class Derived>
+  vk::intrusive_ptr<Derived> cast_to_helper(std::false_type /*has class id*/) const {
+    return vk::dynamic_pointer_cast<Derived>(o);
+  }
+
   inline bool operator==(const class_instance<T> &rhs) const {
     return o == rhs.o;
   }
@@ -463,6 +463,39 @@ static Optional<string> full_realpath(const string &path) { // realpath resolvin
   return false;
 }
 
+Optional<string> get_tmp_dir() {
+  string dir;
+  dl::enter_critical_section();//OK
+  const char *s = getenv("TMPDIR");
+  dl::leave_critical_section();
+  if (s != nullptr && s[0] != 0) {
+    int len = (int)strlen(s);
+
+    if (s[len - 1] == '/') {
+      len--;
+    }
+
+    dir.assign(s, len);
+  } else if (P_tmpdir != nullptr) {
+    dir.assign(P_tmpdir);
+  } else {
+    php_critical_error ("can't compute name of temporary directory");
+    return false;
+  }
+
+  if (dir.empty()) {
+    php_critical_error ("can't find directory for temporary files");
+    return false;
+  }
+
+  Optional<string> dir_real = f$realpath(dir);
+  if (!f$boolval(dir_real)) {
+    php_critical_error ("wrong directory \"%s\" found for temporary files", dir.c_str());
+    return false;
+  }
+  return dir_real;
+}
+
 Optional<string> f$tempnam(const string &dir, const string &prefix) {
   string prefix_new = f$basename(prefix);
   prefix_new.shrink(5);
@@ -470,40 +503,15 @@ Optional<string> f$tempnam(const string &dir, const string &prefix) {
     prefix_new.assign("tmp.", 4);
   }
 
-  string dir_new;
   Optional<string> dir_real;
   if (dir.empty() || !f$boolval(dir_real = f$realpath(dir))) {
-    dl::enter_critical_section();//OK
-    const char *s = getenv("TMPDIR");
-    dl::leave_critical_section();
-    if (s != nullptr && s[0] != 0) {
-      int len = (int)strlen(s);
-
-      if (s[len - 1] == '/') {
-        len--;
-      }
-
-      dir_new.assign(s, len);
-    } else if (P_tmpdir != nullptr) {
-      dir_new.assign(P_tmpdir);
-    } else {
-      php_critical_error ("can't compute name of temporary directory in function tempnam");
-      return false;
-    }
-
-    if (dir_new.empty()) {
-      php_critical_error ("can't find directory for temporary file in function tempnam");
-      return false;
-    }
-
-    dir_real = f$realpath(dir_new);
+    dir_real = get_tmp_dir();
     if (!f$boolval(dir_real)) {
-      php_critical_error ("wrong directory \"%s\" found in function tempnam", dir_new.c_str());
       return false;
     }
   }
 
-  dir_new = dir_real.val();
+  string dir_new = dir_real.val();
   php_assert (!dir_new.empty());
 
   if (dir_new[dir_new.size() - 1] != '/' && prefix_new[0] != '/') {
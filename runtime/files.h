@@ -23,6 +23,9 @@ ssize_t read_safe(int32_t fd, void *buf, size_t len);
 
 ssize_t write_safe(int32_t fd, const void *buf, size_t len);
 
+// the real path of the directory for temporary files: $TMPDIR or P_tmpdir
+Optional<string> get_tmp_dir();
+
 
 string f$basename(const string &name, const string &suffix = string());
 
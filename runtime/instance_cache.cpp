@@ -5,10 +5,9 @@
 #include "runtime/instance_cache.h"
 
 #include <chrono>
-#include <forward_list>
-#include <map>
+#include <cmath>
+#include <limits>
 #include <mutex>
-#include <unordered_set>
 
 #include "common/kprintf.h"
 
@@ -43,22 +42,72 @@ static constexpr double EARLY_EXPIRATION_ELEMENT_RATIO{0.8};
 static constexpr std::chrono::seconds DELETED_ELEMENT_LIFETIME_LIMIT{1};
 // After the lifetime expiration, the element will be removed after this interval
 static constexpr std::chrono::minutes PHYSICAL_REMOVING_DELAY{1};
-// Number of buckets that are used for the elements sharding
-static constexpr size_t DATA_SHARDS_COUNT{997u};
-// The buckets check step during the cache cleanup
-static constexpr size_t SHARDS_PURGE_PERIOD{5u};
+// Every INDEX_SLOT_MEMORY_RATIO bytes of the memory limit give one slot of the elements index
+static constexpr size_t INDEX_SLOT_MEMORY_RATIO{256u};
+// The minimal number of the elements index slots
+static constexpr uint32_t INDEX_MIN_CAPACITY{1u << 10u};
+// The elements index load factor (including deleted slots), after which new keys are refused and the buffer swap is required
+static constexpr double INDEX_MAX_LOAD_FACTOR{0.75};
+// The attempts to read an index slot consistently, after which the slot is considered stuck and its key missed
+static constexpr int INDEX_READ_SLOT_ATTEMPTS{1000};
+// The elements index is checked by blocks of slots during the cache cleanup
+static constexpr uint32_t INDEX_PURGE_BLOCK_SIZE{1u << 10u};
+// The blocks check step during the cache cleanup
+static constexpr uint32_t INDEX_PURGE_PERIOD{5u};
+// The master process pins its epoch in the last slot, while workers use their logname_id
+static constexpr size_t MASTER_EPOCH_SLOT{MAX_WORKERS};
 
 class ElementHolder;
 
+// Elements are reclaimed with epochs:
+//  1) a worker pins the current global epoch at the request start and unpins it at the request end,
+//    so any element that was found during the request stays alive till the end of the request;
+//  2) an element that is removed from the index is retired with the global epoch, which is incremented at the same time;
+//  3) a retired element is destroyed under the allocator lock, when all pinned epochs are newer than its retire epoch.
 struct CacheContext : private vk::not_copyable {
   inter_process_mutex allocator_mutex;
   memory_resource::unsynchronized_pool_resource memory_resource;
   InstanceCacheStats stats;
   std::atomic<bool> memory_swap_required{false};
 
-  void move_to_garbage(ElementHolder *element) noexcept;
-  bool has_garbage() const noexcept { return cache_garbage_ != nullptr; }
-  void clear_garbage() noexcept;
+  std::unique_lock<inter_process_mutex> lock_allocator() noexcept {
+    std::unique_lock<inter_process_mutex> allocator_lock{allocator_mutex, std::try_to_lock};
+    if (!allocator_lock) {
+      stats.allocator_lock_contended.fetch_add(1, std::memory_order_relaxed);
+      const auto wait_started_at = std::chrono::steady_clock::now();
+      allocator_lock.lock();
+      const auto waited = std::chrono::steady_clock::now() - wait_started_at;
+      stats.allocator_lock_wait_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count(),
+                                             std::memory_order_relaxed);
+    }
+    return allocator_lock;
+  }
+
+  std::unique_lock<inter_process_mutex> try_lock_allocator() noexcept {
+    std::unique_lock<inter_process_mutex> allocator_lock{allocator_mutex, std::try_to_lock};
+    if (!allocator_lock) {
+      stats.allocator_lock_contended.fetch_add(1, std::memory_order_relaxed);
+    }
+    return allocator_lock;
+  }
+
+  void pin_epoch(size_t epoch_slot) noexcept {
+    php_assert(epoch_slot < pinned_epochs_.size());
+    pinned_epochs_[epoch_slot].store(global_epoch_.load());
+    // the pinned epoch must be visible before any index read, pairs with the fence in reclaim_retired()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  void unpin_epoch(size_t epoch_slot) noexcept {
+    php_assert(epoch_slot < pinned_epochs_.size());
+    pinned_epochs_[epoch_slot].store(0, std::memory_order_release);
+  }
+
+  // should be called under the allocator lock, after the element is removed from the index
+  void retire(ElementHolder *element) noexcept;
+  bool has_retired() const noexcept { return has_retired_.load(std::memory_order_relaxed); }
+  // should be called under the allocator lock and with the memory replacement guard
+  void reclaim_retired() noexcept;
 
   auto memory_replacement_guard(bool force_enable_disable = false) noexcept {
     dl::enter_critical_section();
@@ -70,31 +119,30 @@ struct CacheContext : private vk::not_copyable {
   }
 
 private:
-  std::atomic<ElementHolder *> cache_garbage_{nullptr};
+  std::atomic<uint64_t> global_epoch_{1};
+  // 0 means that the process doesn't use the cache right now
+  std::array<std::atomic<uint64_t>, MAX_WORKERS + 1> pinned_epochs_{};
+
+  // Retired elements in the order of their retire epochs, guarded by the allocator_mutex
+  ElementHolder *retired_head_{nullptr};
+  ElementHolder *retired_tail_{nullptr};
+  std::atomic<bool> has_retired_{false};
 };
 
-class ElementHolder : private vk::thread_safe_refcnt<ElementHolder> {
+class ElementHolder : vk::not_copyable {
 public:
-  using vk::thread_safe_refcnt<ElementHolder>::add_ref;
-  using vk::thread_safe_refcnt<ElementHolder>::get_refcnt;
-
-  void release() noexcept {
-    if (--refcnt == 0) {
-      cache_context.move_to_garbage(this);
-    }
-  }
-
   void destroy() noexcept {
-    php_assert(refcnt == 0);
     cache_context.stats.elements_destroyed.fetch_add(1, std::memory_order_relaxed);
     auto &mem_resource = cache_context.memory_resource;
+    DeepDestroyFromCacheVisitor{}.process(key);
     this->~ElementHolder();
     mem_resource.deallocate(this, sizeof(ElementHolder));
   }
 
-  ElementHolder(std::chrono::nanoseconds now, int64_t ttl,
+  ElementHolder(string &&key_in_shared_memory, std::chrono::nanoseconds now, int64_t ttl,
                 std::unique_ptr<InstanceWrapperBase> &&instance,
                 CacheContext &context) noexcept:
+    key(std::move(key_in_shared_memory)),
     inserted_by_process(getpid()),
     instance_wrapper(std::move(instance)),
     cache_context(context) {
@@ -104,75 +152,243 @@ public:
 
   // returns how long the element is lived in relation to the expected lifetime
   double freshness_ratio(std::chrono::nanoseconds now, double immortal_ratio = 0.5) const noexcept {
+    const auto element_stored_at = stored_at.load(std::memory_order_relaxed);
+    const auto element_expiring_at = expiring_at.load(std::memory_order_relaxed);
     // an immortal element
-    if (expiring_at == std::chrono::nanoseconds::max()) {
+    if (element_expiring_at == std::chrono::nanoseconds::max()) {
       return immortal_ratio;
     }
-    if (expiring_at <= stored_at) {
+    if (element_expiring_at <= element_stored_at) {
       return 1.0;
     }
-    const auto real_age = std::chrono::duration<double>{std::max(now, stored_at) - stored_at};
-    const auto max_age = std::chrono::duration<double>{expiring_at - stored_at};
+    const auto real_age = std::chrono::duration<double>{std::max(now, element_stored_at) - element_stored_at};
+    const auto max_age = std::chrono::duration<double>{element_expiring_at - element_stored_at};
     return real_age.count() / max_age.count();
   }
 
+  // time points may be updated concurrently by several processes, the last update wins;
+  // readers may observe a mix of two updates for a moment, it only affects the freshness heuristics
   void update_time_points(std::chrono::nanoseconds now, int64_t ttl) noexcept {
-    stored_at = std::max(now, stored_at);
-    expiring_at = ttl > 0 ? stored_at + std::chrono::seconds{ttl} : std::chrono::nanoseconds::max();
-    early_fetch_performed = false;
+    const auto new_stored_at = std::max(now, stored_at.load(std::memory_order_relaxed));
+    stored_at.store(new_stored_at, std::memory_order_relaxed);
+    expiring_at.store(ttl > 0 ? new_stored_at + std::chrono::seconds{ttl} : std::chrono::nanoseconds::max(),
+                      std::memory_order_relaxed);
+    early_fetch_performed.store(false, std::memory_order_relaxed);
   }
 
-  std::chrono::nanoseconds stored_at{std::chrono::nanoseconds::min()};
-  std::chrono::nanoseconds expiring_at{std::chrono::nanoseconds::max()};
-  bool early_fetch_performed{false};
+  // the key is immutable, it can be read by the lock free lookups
+  string key;
+  std::atomic<std::chrono::nanoseconds> stored_at{std::chrono::nanoseconds::min()};
+  std::atomic<std::chrono::nanoseconds> expiring_at{std::chrono::nanoseconds::max()};
+  std::atomic<bool> early_fetch_performed{false};
   const pid_t inserted_by_process{0};
 
   std::unique_ptr<InstanceWrapperBase> instance_wrapper;
   CacheContext &cache_context;
 
-  // Removed elements list
-  std::atomic<ElementHolder *> next_in_garbage_list{nullptr};
+  // Retired elements list, guarded by the allocator_mutex
+  uint64_t retired_at_epoch{0};
+  ElementHolder *next_retired{nullptr};
 };
 
-using ElementStorage_ = memory_resource::stl::map<string, vk::intrusive_ptr<ElementHolder>, memory_resource::unsynchronized_pool_resource, stl_string_less>;
+void CacheContext::retire(ElementHolder *element) noexcept {
+  php_assert(element->next_retired == nullptr);
+  // the element is already unreachable from the index, readers that pin the incremented epoch can't find it
+  element->retired_at_epoch = global_epoch_.fetch_add(1);
+  if (retired_tail_) {
+    retired_tail_->next_retired = element;
+  } else {
+    retired_head_ = element;
+  }
+  retired_tail_ = element;
+  has_retired_.store(true, std::memory_order_relaxed);
+  stats.elements_retired.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CacheContext::reclaim_retired() noexcept {
+  if (!retired_head_) {
+    return;
+  }
+  // pairs with the fence in pin_epoch(): either the reader sees the index without the retired element,
+  // or we see its pinned epoch
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t min_pinned_epoch = std::numeric_limits<uint64_t>::max();
+  auto account_pinned_epoch = [&min_pinned_epoch](const std::atomic<uint64_t> &pinned_epoch) {
+    const uint64_t epoch = pinned_epoch.load();
+    if (epoch) {
+      min_pinned_epoch = std::min(min_pinned_epoch, epoch);
+    }
+  };
+  const size_t total_server_workers = std::max(1, workers_n);
+  std::for_each(pinned_epochs_.begin(), pinned_epochs_.begin() + total_server_workers, account_pinned_epoch);
+  account_pinned_epoch(pinned_epochs_[MASTER_EPOCH_SLOT]);
 
-struct SharedDataStorages : private vk::not_copyable {
-  explicit SharedDataStorages(memory_resource::unsynchronized_pool_resource &resource) :
-    storage(ElementStorage_::allocator_type{resource}) {
+  while (retired_head_ && retired_head_->retired_at_epoch < min_pinned_epoch) {
+    ElementHolder *element = retired_head_;
+    retired_head_ = element->next_retired;
+    element->destroy();
+  }
+  if (!retired_head_) {
+    retired_tail_ = nullptr;
+    has_retired_.store(false, std::memory_order_relaxed);
   }
+}
 
-  inter_process_mutex storage_mutex;
-  ElementStorage_ storage;
-  std::atomic<bool> is_storage_empty{true};
+struct IndexSlot {
+  // odd version means that the slot is being modified right now
+  std::atomic<uint32_t> version{0};
+  std::atomic<uint32_t> hash_tag{0};
+  std::atomic<ElementHolder *> element{nullptr};
 };
 
-void CacheContext::move_to_garbage(ElementHolder *element) noexcept {
-  php_assert(element->next_in_garbage_list == nullptr);
-  // Put all garbage into the cache_context.cache_garbage; the cleanup happens later, under the lock
-  auto *next = cache_garbage_.load();
-  do {
-    element->next_in_garbage_list.store(next);
-  } while (!cache_garbage_.compare_exchange_strong(next, element));
-}
+// An open addressing (linear probing) index of the cached elements, it lives in the shared memory.
+// Lookups don't take any lock: every slot is a tiny seqlock, a reader retries until it sees the same even version
+// before and after reading the slot. A slot which is never seen consistent (its writer was killed in the middle) is a miss.
+// Elements found by a reader are kept alive by its pinned epoch.
+// All modifications are serialized by the CacheContext::allocator_mutex.
+class ElementIndex : vk::not_copyable {
+public:
+  ElementIndex(IndexSlot *slots, uint32_t capacity) noexcept:
+    slots_(slots),
+    capacity_mask_(capacity - 1) {
+    php_assert(capacity && (capacity & capacity_mask_) == 0);
+    for (uint32_t i = 0; i != capacity; ++i) {
+      new(&slots_[i]) IndexSlot{};
+    }
+  }
 
-void CacheContext::clear_garbage() noexcept {
-  auto element = cache_garbage_.exchange(nullptr);
+  uint32_t capacity() const noexcept {
+    return capacity_mask_ + 1;
+  }
 
-  while (element) {
-    auto next = element->next_in_garbage_list.load();
-    element->destroy();
-    element = next;
+  ElementHolder *find(const string &key) const noexcept {
+    const auto hash = static_cast<uint64_t>(key.hash());
+    const auto tag = static_cast<uint32_t>(hash >> 32u);
+    for (uint32_t slot_id = hash & capacity_mask_, probes = 0; probes <= capacity_mask_; slot_id = next(slot_id), ++probes) {
+      uint32_t slot_tag = 0;
+      ElementHolder *element = read_slot(slot_id, slot_tag);
+      if (!element) {
+        return nullptr;
+      }
+      if (element != deleted() && slot_tag == tag && element->key == key) {
+        return element;
+      }
+    }
+    return nullptr;
+  }
+
+  void prefetch(const string &key) const noexcept {
+    __builtin_prefetch(&slots_[static_cast<uint64_t>(key.hash()) & capacity_mask_]);
+  }
+
+  // returns the element of the slot or nullptr if the slot is empty or deleted
+  ElementHolder *get(uint32_t slot_id) const noexcept {
+    uint32_t slot_tag = 0;
+    ElementHolder *element = read_slot(slot_id, slot_tag);
+    return element == deleted() ? nullptr : element;
+  }
+
+  // should be called under the allocator lock; inserts the element or replaces another one with the same key,
+  // the replaced element is returned via the replaced_element param, returns false if there is no room for a new key
+  bool insert(ElementHolder *element, ElementHolder *&replaced_element) noexcept {
+    const auto hash = static_cast<uint64_t>(element->key.hash());
+    const auto tag = static_cast<uint32_t>(hash >> 32u);
+    uint32_t insert_slot_id = capacity();
+    for (uint32_t slot_id = hash & capacity_mask_, probes = 0; probes <= capacity_mask_; slot_id = next(slot_id), ++probes) {
+      const IndexSlot &slot = slots_[slot_id];
+      ElementHolder *stored_element = slot.element.load(std::memory_order_relaxed);
+      if (stored_element == deleted()) {
+        insert_slot_id = std::min(insert_slot_id, slot_id);
+        continue;
+      }
+      if (!stored_element) {
+        if (insert_slot_id == capacity()) {
+          if (static_cast<double>(used_slots_ + 1) > INDEX_MAX_LOAD_FACTOR * capacity()) {
+            return false;
+          }
+          ++used_slots_;
+          insert_slot_id = slot_id;
+        }
+        break;
+      }
+      if (slot.hash_tag.load(std::memory_order_relaxed) == tag && stored_element->key == element->key) {
+        replaced_element = stored_element;
+        write_slot(slot_id, tag, element);
+        return true;
+      }
+    }
+    if (insert_slot_id == capacity()) {
+      return false;
+    }
+    replaced_element = nullptr;
+    write_slot(insert_slot_id, tag, element);
+    return true;
+  }
+
+  // should be called under the allocator lock
+  void remove(uint32_t slot_id) noexcept {
+    php_assert(get(slot_id));
+    write_slot(slot_id, 0, deleted());
+    // a deleted slot followed by an empty one is not needed for the probing anymore
+    while (!slots_[next(slot_id)].element.load(std::memory_order_relaxed) &&
+           slots_[slot_id].element.load(std::memory_order_relaxed) == deleted()) {
+      write_slot(slot_id, 0, nullptr);
+      --used_slots_;
+      slot_id = (slot_id - 1) & capacity_mask_;
+    }
+  }
+
+private:
+  static ElementHolder *deleted() noexcept {
+    return reinterpret_cast<ElementHolder *>(uintptr_t{1});
+  }
+
+  uint32_t next(uint32_t slot_id) const noexcept {
+    return (slot_id + 1) & capacity_mask_;
+  }
+
+  ElementHolder *read_slot(uint32_t slot_id, uint32_t &tag) const noexcept {
+    const IndexSlot &slot = slots_[slot_id];
+    for (int attempt = 0; attempt < INDEX_READ_SLOT_ATTEMPTS; ++attempt) {
+      const uint32_t version_before = slot.version.load(std::memory_order_acquire);
+      tag = slot.hash_tag.load(std::memory_order_relaxed);
+      ElementHolder *element = slot.element.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      const uint32_t version_after = slot.version.load(std::memory_order_relaxed);
+      if (likely(!(version_before & 1u) && version_before == version_after)) {
+        return element;
+      }
+    }
+    tag = 0;
+    return nullptr;
+  }
+
+  void write_slot(uint32_t slot_id, uint32_t tag, ElementHolder *element) noexcept {
+    IndexSlot &slot = slots_[slot_id];
+    // the version may be left odd by a killed writer
+    const uint32_t version = slot.version.load(std::memory_order_relaxed) & ~1u;
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.hash_tag.store(tag, std::memory_order_relaxed);
+    slot.element.store(element, std::memory_order_release);
+    slot.version.store(version + 2, std::memory_order_release);
   }
-}
+
+  IndexSlot *const slots_{nullptr};
+  const uint32_t capacity_mask_{0};
+  // non empty slots including the deleted ones, guarded by the allocator_mutex
+  uint32_t used_slots_{0};
+};
 
 class SharedMemoryData : vk::not_copyable {
 public:
   void init(size_t pool_size) noexcept {
-    php_assert(!data_shards_);
+    php_assert(!index_);
     php_assert(!cache_context_);
     php_assert(!shared_memory_);
     shared_memory_pool_size_ = pool_size;
-    share_memory_full_size_ = get_context_size() + get_data_size() + shared_memory_pool_size_;
+    index_capacity_ = get_index_capacity(pool_size);
+    share_memory_full_size_ = get_context_size() + get_index_size() + shared_memory_pool_size_;
     shared_memory_ = mmap(nullptr, share_memory_full_size_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
     php_assert(shared_memory_);
     construct_data_inplace();
@@ -185,21 +401,13 @@ public:
 
   void destroy() noexcept {
     destroy_data();
-    data_shards_ = nullptr;
+    index_ = nullptr;
     cache_context_ = nullptr;
   }
 
-  SharedDataStorages &get_data(const string &key) noexcept {
-    php_assert(data_shards_);
-    return data_shards_[static_cast<uint32_t>(key.hash()) % DATA_SHARDS_COUNT];
-  }
-
-  SharedDataStorages *get_data_shards() noexcept {
-    return data_shards_;
-  }
-
-  static constexpr size_t get_data_shards_count() noexcept {
-    return DATA_SHARDS_COUNT;
+  ElementIndex &get_index() noexcept {
+    php_assert(index_);
+    return *index_;
   }
 
   CacheContext &get_context() noexcept {
@@ -209,11 +417,8 @@ public:
 
 private:
   void destroy_data() noexcept {
-    php_assert(data_shards_);
-    for (size_t i = 0; i != DATA_SHARDS_COUNT; ++i) {
-      // to avoid of calling all destructors, just free storage_mutex
-      data_shards_[i].storage_mutex.~inter_process_mutex();
-    }
+    php_assert(index_);
+    index_->~ElementIndex();
 
     php_assert(cache_context_);
     cache_context_->~CacheContext();
@@ -221,27 +426,38 @@ private:
 
   void construct_data_inplace() noexcept {
     cache_context_ = new(shared_memory_) CacheContext();
-    uint8_t *data_storage_mem = static_cast<uint8_t *>(shared_memory_) + get_context_size();
-    cache_context_->memory_resource.init(data_storage_mem + get_data_size(), shared_memory_pool_size_);
-    data_shards_ = reinterpret_cast<SharedDataStorages *>(data_storage_mem);
-    for (size_t i = 0; i != DATA_SHARDS_COUNT; ++i) {
-      new(&data_shards_[i]) SharedDataStorages{cache_context_->memory_resource};
+    uint8_t *index_mem = static_cast<uint8_t *>(shared_memory_) + get_context_size();
+    cache_context_->memory_resource.init(index_mem + get_index_size(), shared_memory_pool_size_);
+    auto *index_slots = reinterpret_cast<IndexSlot *>(index_mem + get_index_header_size());
+    index_ = new(index_mem) ElementIndex{index_slots, index_capacity_};
+  }
+
+  static uint32_t get_index_capacity(size_t pool_size) noexcept {
+    uint32_t capacity = INDEX_MIN_CAPACITY;
+    while (capacity < pool_size / INDEX_SLOT_MEMORY_RATIO && capacity < (1u << 31u)) {
+      capacity <<= 1u;
     }
+    return capacity;
   }
 
   static constexpr size_t get_context_size() noexcept {
-    return (sizeof(CacheContext) + 7) & -8;
+    return (sizeof(CacheContext) + 63) & -64;
+  }
+
+  static constexpr size_t get_index_header_size() noexcept {
+    return (sizeof(ElementIndex) + 63) & -64;
   }
 
-  static constexpr size_t get_data_size() noexcept {
-    return (sizeof(SharedDataStorages) * DATA_SHARDS_COUNT + 7) & -8;
+  size_t get_index_size() const noexcept {
+    return (get_index_header_size() + sizeof(IndexSlot) * index_capacity_ + 7) & -8;
   }
 
   void *shared_memory_{nullptr};
   size_t share_memory_full_size_{0};
   size_t shared_memory_pool_size_{0};
+  uint32_t index_capacity_{0};
   CacheContext *cache_context_{nullptr};
-  SharedDataStorages *data_shards_{nullptr};
+  ElementIndex *index_{nullptr};
 };
 
 struct {
@@ -270,6 +486,8 @@ public:
     update_now();
     current_ = data_manager_.acquire_current_resource();
     context_ = &current_->get_context();
+    // elements that are found during the request are alive till its end
+    context_->pin_epoch(get_epoch_slot());
   }
 
   void update_now() {
@@ -283,14 +501,13 @@ public:
     // request_cache_ and storing_delayed_ use a script memory
     storing_delayed_.clear();
     request_cache_.clear();
-    // used_elements use a heap memory
-    used_elements_.clear();
 
-    if (context_->has_garbage()) {
-      std::unique_lock<inter_process_mutex> allocator_lock{context_->allocator_mutex, std::try_to_lock};
+    context_->unpin_epoch(get_epoch_slot());
+    if (context_->has_retired()) {
+      auto allocator_lock = context_->try_lock_allocator();
       if (allocator_lock) {
         auto shared_memory_guard = context_->memory_replacement_guard();
-        context_->clear_garbage();
+        context_->reclaim_retired();
       }
     }
     data_manager_.release_resource(current_);
@@ -307,15 +524,13 @@ public:
 
     sync_delayed();
     // various service things that we can do without synchronization
-    auto &data = current_->get_data(key);
     update_now();
-    if (is_element_insertion_can_be_skipped(data, key)) {
+    if (is_element_insertion_can_be_skipped(key)) {
       return false;
     }
 
     DeepMoveFromScriptToCacheVisitor detach_processor{context_->memory_resource};
-    const ElementHolder *inserted_element = try_insert_element_into_cache(
-      data, key, ttl, instance_wrapper, detach_processor);
+    const ElementHolder *inserted_element = try_insert_element_into_cache(key, ttl, instance_wrapper, detach_processor);
 
     if (!inserted_element) {
       // failed to insert the element due to some problems (e.g. memory, depth limit)
@@ -323,6 +538,10 @@ public:
         fire_warning(detach_processor, instance_wrapper.get_class());
         return false;
       }
+      // there is no room in the index, the buffer will be swapped
+      if (unlikely(context_->memory_swap_required)) {
+        return false;
+      }
       // failed to acquire a lock, save the instance into the script memory container, we'll try again later
       class_instance<DelayedInstance> delayed_instance;
       delayed_instance.alloc().get()->ttl = ttl;
@@ -341,6 +560,82 @@ public:
   const InstanceWrapperBase *fetch(const string &key, bool even_if_expired) {
     php_assert(current_ && context_);
     sync_delayed();
+    return fetch_synced(key, even_if_expired);
+  }
+
+  array<const InstanceWrapperBase *> fetch_many(const array<string> &keys, bool even_if_expired) {
+    php_assert(current_ && context_);
+    sync_delayed();
+    // load the index slots of all keys in advance, so the cache misses of the lookups overlap
+    const auto &index = current_->get_index();
+    for (const auto &it : keys) {
+      index.prefetch(it.get_value());
+    }
+    array<const InstanceWrapperBase *> result{array_size{0, keys.count(), false}};
+    for (const auto &it : keys) {
+      const string &key = it.get_value();
+      if (const auto *instance_wrapper = fetch_synced(key, even_if_expired)) {
+        result.set_value(key, instance_wrapper);
+      }
+    }
+    return result;
+  }
+
+  // the allocator lock is taken once for all stores within the batch and held only while they are moved into the shared memory:
+  // the script memory may end on any allocation, and the lock of a terminated script in an alive process would never be recovered
+  array<bool> store_many(const array<const InstanceWrapperBase *> &instance_wrappers, int64_t ttl) noexcept {
+    php_assert(current_ && context_);
+    sync_delayed();
+    update_now();
+
+    // the script memory is prepared in advance
+    array<bool> result{instance_wrappers.size()};
+    array<string> keys{array_size{instance_wrappers.count(), 0, true}};
+    array<const ElementHolder *> inserted_elements{array_size{instance_wrappers.count(), 0, true}};
+    for (const auto &it : instance_wrappers) {
+      result.set_value(it.get_key(), false);
+      keys.push_back(it.get_key().to_string());
+      inserted_elements.push_back(nullptr);
+    }
+
+    if (!context_->memory_swap_required) {
+      dl::CriticalSectionGuard critical_section;
+      auto allocator_lock = context_->try_lock_allocator();
+      if (allocator_lock) {
+        int64_t i = 0;
+        for (const auto &it : instance_wrappers) {
+          const string &key = keys.get_value(i);
+          if (it.get_value() && !context_->memory_swap_required && !is_element_insertion_can_be_skipped(key)) {
+            DeepMoveFromScriptToCacheVisitor detach_processor{context_->memory_resource};
+            inserted_elements.set_value(i, try_insert_element_into_cache(key, ttl, *it.get_value(), detach_processor, true));
+          }
+          ++i;
+        }
+        auto shared_memory_guard = context_->memory_replacement_guard();
+        context_->reclaim_retired();
+      }
+    }
+
+    // the elements which are not inserted go the usual way: they are delayed or warned about
+    int64_t i = 0;
+    for (const auto &it : instance_wrappers) {
+      const string &key = keys.get_value(i);
+      if (const ElementHolder *inserted_element = inserted_elements.get_value(i)) {
+        ic_debug("element '%s' was successfully inserted\n", key.c_str());
+        context_->stats.elements_stored.fetch_add(1, std::memory_order_relaxed);
+        // request_cache_ uses a script memory
+        request_cache_.set_value(key, inserted_element);
+        result.set_value(it.get_key(), true);
+      } else if (it.get_value()) {
+        result.set_value(it.get_key(), store(key, *it.get_value(), ttl));
+      }
+      ++i;
+    }
+    return result;
+  }
+
+private:
+  const InstanceWrapperBase *fetch_synced(const string &key, bool even_if_expired) {
     // storing_delayed_ uses a script memory
     if (const auto *delayed_instance = storing_delayed_.find_value(key)) {
       ic_debug("fetch '%s' from delayed cache\n", key.c_str());
@@ -352,59 +647,51 @@ public:
       return (*cached_element_ptr)->instance_wrapper.get();
     }
 
-    vk::intrusive_ptr<ElementHolder> element;
-    bool element_logically_expired = false;
-    {
-      auto &data = current_->get_data(key);
-      std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-      auto it = data.storage.find(key);
-      if (it == data.storage.end()) {
-        ic_debug("can't fetch '%s' because it is absent\n", key.c_str());
-        context_->stats.elements_missed.fetch_add(1, std::memory_order_relaxed);
-        return nullptr;
-      }
-
-      update_now();
-      // if more than EARLY_EXPIRATION_ELEMENT_RATIO time is passed out of the expected element lifetime,
-      // return null to the next worker process so it knows that the value needs to be updated in advance
-      if (!it->second->early_fetch_performed &&
-          it->second->freshness_ratio(now_) >= EARLY_EXPIRATION_ELEMENT_RATIO) {
-        it->second->early_fetch_performed = true;
-        context_->stats.elements_missed_earlier.fetch_add(1, std::memory_order_relaxed);
-        ic_debug("can't fetch '%s' because less than %f of total time is left\n",
-                 key.c_str(), EARLY_EXPIRATION_ELEMENT_RATIO);
-        return nullptr;
-      }
-      element_logically_expired = it->second->expiring_at <= now_;
-      if (element_logically_expired) {
-        if (even_if_expired) {
-          context_->stats.elements_logically_expired_but_fetched.fetch_add(1, std::memory_order_relaxed);
-          ic_debug("fetch logically expired element '%s'\n", key.c_str());
-        } else {
-          context_->stats.elements_logically_expired_and_ignored.fetch_add(1, std::memory_order_relaxed);
-          ic_debug("can't fetch '%s' because element was logically expired\n", key.c_str());
-          return nullptr;
-        }
-      } else {
-        context_->stats.elements_fetched.fetch_add(1, std::memory_order_relaxed);
-        ic_debug("fetch '%s' from inter process cache\n", key.c_str());
-      }
+    const auto fetch_started_at = std::chrono::steady_clock::now();
+    auto account_fetch_latency = vk::finally([this, fetch_started_at] {
+      context_->stats.add_fetch_latency(std::chrono::steady_clock::now() - fetch_started_at);
+    });
 
-      element = it->second;
+    // the element can't be destroyed till the end of the request, as the epoch is pinned
+    ElementHolder *element = current_->get_index().find(key);
+    if (!element) {
+      ic_debug("can't fetch '%s' because it is absent\n", key.c_str());
+      context_->stats.elements_missed.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
     }
 
-    // don't cache logically expired elements
-    if (!element_logically_expired) {
+    update_now();
+    // if more than EARLY_EXPIRATION_ELEMENT_RATIO time is passed out of the expected element lifetime,
+    // return null to the next worker process so it knows that the value needs to be updated in advance
+    if (!element->early_fetch_performed.load(std::memory_order_relaxed) &&
+        element->freshness_ratio(now_) >= EARLY_EXPIRATION_ELEMENT_RATIO &&
+        !element->early_fetch_performed.exchange(true)) {
+      context_->stats.elements_missed_earlier.fetch_add(1, std::memory_order_relaxed);
+      ic_debug("can't fetch '%s' because less than %f of total time is left\n",
+               key.c_str(), EARLY_EXPIRATION_ELEMENT_RATIO);
+      return nullptr;
+    }
+    const bool element_logically_expired = element->expiring_at.load(std::memory_order_relaxed) <= now_;
+    if (element_logically_expired) {
+      if (even_if_expired) {
+        context_->stats.elements_logically_expired_but_fetched.fetch_add(1, std::memory_order_relaxed);
+        ic_debug("fetch logically expired element '%s'\n", key.c_str());
+      } else {
+        context_->stats.elements_logically_expired_and_ignored.fetch_add(1, std::memory_order_relaxed);
+        ic_debug("can't fetch '%s' because element was logically expired\n", key.c_str());
+        return nullptr;
+      }
+    } else {
+      context_->stats.elements_fetched.fetch_add(1, std::memory_order_relaxed);
+      ic_debug("fetch '%s' from inter process cache\n", key.c_str());
+      // don't cache logically expired elements
       // request_cache_ uses a script memory
-      request_cache_.set_value(key, element.get());
+      request_cache_.set_value(key, element);
     }
-
-    const auto *result = element->instance_wrapper.get();
-    // used_elements uses a heap memory, it'll hold an element until the end of the request
-    used_elements_.emplace(std::move(element));
-    return result;
+    return element->instance_wrapper.get();
   }
 
+public:
   bool update_ttl(const string &key, int64_t ttl) {
     php_assert(current_ && context_);
     ic_debug("update_ttl '%s', new ttl '%ld'\n", key.c_str(), ttl);
@@ -416,15 +703,13 @@ public:
       delayed_instance->get()->ttl = ttl;
     }
 
-    auto &data = current_->get_data(key);
     update_now();
-    std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-    auto it = data.storage.find(key);
-    if (it == data.storage.end()) {
+    ElementHolder *element = current_->get_index().find(key);
+    if (!element) {
       return false;
     }
 
-    it->second->update_time_points(now_, ttl);
+    element->update_time_points(now_, ttl);
     return true;
   }
 
@@ -435,25 +720,29 @@ public:
     // request_cache_ and storing_delayed_ use a script memory
     storing_delayed_.unset(key);
     request_cache_.unset(key);
-    auto &data = current_->get_data(key);
     update_now();
-    std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-    auto it = data.storage.find(key);
-    if (it == data.storage.end()) {
+    ElementHolder *element = current_->get_index().find(key);
+    if (!element) {
       return false;
     }
 
     // calculate expiring_at in a way that the next fetch returns false
     constexpr double SCALE = 1.0 / EARLY_EXPIRATION_ELEMENT_RATIO;
-    auto new_element_ttl = std::chrono::duration_cast<std::chrono::nanoseconds>((now_ - it->second->stored_at) * SCALE);
-    auto new_expiring_at = std::chrono::duration_cast<std::chrono::nanoseconds>(it->second->stored_at + new_element_ttl);
+    const auto stored_at = element->stored_at.load(std::memory_order_relaxed);
+    auto new_element_ttl = std::chrono::duration_cast<std::chrono::nanoseconds>((now_ - stored_at) * SCALE);
+    auto new_expiring_at = std::chrono::duration_cast<std::chrono::nanoseconds>(stored_at + new_element_ttl);
     new_expiring_at = std::min(new_expiring_at, now_ + DELETED_ELEMENT_LIFETIME_LIMIT);
-    it->second->expiring_at = std::max(new_expiring_at, it->second->stored_at);
+    element->expiring_at.store(std::max(new_expiring_at, stored_at), std::memory_order_relaxed);
     return true;
   }
 
   void force_release_all_resources() {
     data_manager_.force_release_all_resources();
+    // the previous process with the same logname_id could die during the request, leaving its epoch pinned
+    const size_t epoch_slot = get_epoch_slot();
+    data_manager_.for_each_resource([epoch_slot](SharedMemoryData &data) {
+      data.get_context().unpin_epoch(epoch_slot);
+    });
   }
 
   // this function should be called only from master
@@ -463,50 +752,49 @@ public:
 
     auto &current_data = data_manager_.get_current_resource();
     auto &context = current_data.get_context();
+    auto &index = current_data.get_index();
     // replace the default script allocator
     // as this call happens from the master process
     // we need to explicitly activate and deactivate it
     auto shared_memory_guard = context.memory_replacement_guard(true);
 
-    auto *data_shards = current_data.get_data_shards();
-    const size_t shards_count = current_data.get_data_shards_count();
-    for (size_t shard_id = purge_shard_offset_; shard_id < shards_count; shard_id += SHARDS_PURGE_PERIOD) {
-      auto &data_shard = data_shards[shard_id];
-      if (data_shard.is_storage_empty.load(std::memory_order_relaxed)) {
-        continue;
+    auto is_expired = [&index, now_with_delay](uint32_t slot_id) {
+      const ElementHolder *element = index.get(slot_id);
+      return element && element->expiring_at.load(std::memory_order_relaxed) <= now_with_delay;
+    };
+
+    // the index is checked without the lock, the master pins its epoch as well as workers do
+    context.pin_epoch(MASTER_EPOCH_SLOT);
+    const uint32_t blocks_count = index.capacity() / INDEX_PURGE_BLOCK_SIZE;
+    for (uint32_t block_id = purge_block_offset_; block_id < blocks_count; block_id += INDEX_PURGE_PERIOD) {
+      const uint32_t block_begin = block_id * INDEX_PURGE_BLOCK_SIZE;
+      const uint32_t block_end = block_begin + INDEX_PURGE_BLOCK_SIZE;
+      uint32_t slot_id = block_begin;
+      while (slot_id != block_end && !is_expired(slot_id)) {
+        ++slot_id;
       }
-      {
-        std::lock_guard<inter_process_mutex> shared_data_lock{data_shard.storage_mutex};
-        if (std::none_of(data_shard.storage.begin(), data_shard.storage.end(),
-                         [now_with_delay](const auto &stored_element) {
-                           return stored_element.second->expiring_at <= now_with_delay;
-                         })) {
-          continue;
-        }
+      if (slot_id == block_end) {
+        continue;
       }
 
-      // lock in this very order and do not move allocator_lock anywhere below, otherwise it will result in a deadlock!
-      std::lock_guard<inter_process_mutex> allocator_lock{context.allocator_mutex};
-      std::lock_guard<inter_process_mutex> shared_data_lock{data_shard.storage_mutex};
-      for (auto it = data_shard.storage.begin(); it != data_shard.storage.end();) {
-        if (it->second->expiring_at <= now_with_delay) {
-          ic_debug("purge '%s'\n", it->first.c_str());
-          string removing_key = it->first;
-          it = data_shard.storage.erase(it);
-          DeepDestroyFromCacheVisitor{}.process(removing_key);
+      auto allocator_lock = context.lock_allocator();
+      for (; slot_id != block_end; ++slot_id) {
+        if (is_expired(slot_id)) {
+          ElementHolder *element = index.get(slot_id);
+          ic_debug("purge '%s'\n", element->key.c_str());
+          index.remove(slot_id);
+          context.retire(element);
           context.stats.elements_expired.fetch_add(1, std::memory_order_relaxed);
           context.stats.elements_cached.fetch_sub(1, std::memory_order_relaxed);
-        } else {
-          ++it;
         }
       }
-      data_shard.is_storage_empty.store(data_shard.storage.empty(), std::memory_order_relaxed);
     }
+    context.unpin_epoch(MASTER_EPOCH_SLOT);
 
-    purge_shard_offset_ = (purge_shard_offset_ + 1) % SHARDS_PURGE_PERIOD;
+    purge_block_offset_ = (purge_block_offset_ + 1) % INDEX_PURGE_PERIOD;
 
-    std::lock_guard<inter_process_mutex> allocator_lock{context.allocator_mutex};
-    context.clear_garbage();
+    auto allocator_lock = context.lock_allocator();
+    context.reclaim_retired();
     last_memory_stats_ = context.memory_resource.get_memory_stats();
   }
 
@@ -534,13 +822,17 @@ public:
   }
 
 private:
-  bool is_element_insertion_can_be_skipped(SharedDataStorages &data, const string &key) const {
-    std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-    auto it = data.storage.find(key);
+  static size_t get_epoch_slot() noexcept {
+    php_assert(logname_id >= 0 && logname_id < MAX_WORKERS);
+    return static_cast<size_t>(logname_id);
+  }
+
+  bool is_element_insertion_can_be_skipped(const string &key) const {
+    const ElementHolder *element = current_->get_index().find(key);
     // allow to skip the insertion of the element if it was inserted by another process recently enough
-    if (it != data.storage.end() &&
-        it->second->freshness_ratio(now_) < FRESHNESS_ELEMENT_RATIO &&
-        it->second->inserted_by_process != getpid()) {
+    if (element &&
+        element->freshness_ratio(now_) < FRESHNESS_ELEMENT_RATIO &&
+        element->inserted_by_process != getpid()) {
       ic_debug("skip '%s' because it was recently updated\n", key.c_str());
       context_->stats.elements_storing_skipped_due_recent_update.fetch_add(1, std::memory_order_relaxed);
       return true;
@@ -559,18 +851,16 @@ private:
       php_assert(it.is_string_key());
       const auto &key = it.get_string_key();
       const auto &delayed_instance = *it.get_value().get();
-      auto &data = current_->get_data(key);
       update_now();
-      if (is_element_insertion_can_be_skipped(data, key)) {
+      if (is_element_insertion_can_be_skipped(key)) {
         storing_delayed_.unset(key);
         continue;
       }
       const ElementHolder *inserted_element = try_insert_element_into_cache(
-        data, key, delayed_instance.ttl,
-        *delayed_instance.instance_wrapper, detach_processor);
+        key, delayed_instance.ttl, *delayed_instance.instance_wrapper, detach_processor);
       if (!inserted_element) {
         if (likely(detach_processor.is_ok())) {
-          // failed to acquire an allocator lock; try later
+          // failed to acquire an allocator lock or there is no room in the index; try later
           return;
         }
         fire_warning(detach_processor, delayed_instance.instance_wrapper->get_class());
@@ -587,55 +877,58 @@ private:
     }
   }
 
-  ElementHolder *try_insert_element_into_cache(SharedDataStorages &data,
-                                               const string &key_in_script_memory, int64_t ttl,
+  ElementHolder *try_insert_element_into_cache(const string &key_in_script_memory, int64_t ttl,
                                                const InstanceWrapperBase &instance_wrapper,
-                                               DeepMoveFromScriptToCacheVisitor &detach_processor) noexcept {
+                                               DeepMoveFromScriptToCacheVisitor &detach_processor,
+                                               bool allocator_locked = false) noexcept {
     // swap the allocator
     auto shared_memory_guard = context_->memory_replacement_guard();
 
-    std::unique_lock<inter_process_mutex> allocator_lock{context_->allocator_mutex, std::try_to_lock};
-    // locking strictly before the storage_mutex to avoid a deadlock
-    if (!allocator_lock) {
-      return nullptr;
+    std::unique_lock<inter_process_mutex> allocator_lock;
+    if (!allocator_locked) {
+      allocator_lock = context_->try_lock_allocator();
+      if (!allocator_lock) {
+        return nullptr;
+      }
     }
 
-    // acquired an allocator lock, now we can safely collect the garbage
-    auto clear_garbage = vk::finally([this] { context_->clear_garbage(); });
+    // acquired an allocator lock, now we can safely reclaim the retired elements (the batch does it once in the end)
+    auto reclaim_retired = vk::finally([this, allocator_locked] {
+      if (!allocator_locked) {
+        context_->reclaim_retired();
+      }
+    });
 
     // moving an instance into a shared memory
-    if (auto cached_instance_wrapper = instance_wrapper.clone_and_detach_shared_ref(detach_processor)) {
-      if (void *mem = detach_processor.prepare_raw_memory(sizeof(ElementHolder))) {
-        vk::intrusive_ptr<ElementHolder> element{new(mem) ElementHolder{now_, ttl, std::move(cached_instance_wrapper), *context_}};
-        std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-        auto it = data.storage.find(key_in_script_memory);
-        if (it == data.storage.end()) {
-          string key_in_shared_memory = key_in_script_memory;
-          if (unlikely(!detach_processor.process(key_in_shared_memory))) {
-            return nullptr;
-          }
-          constexpr auto node_max_size = ElementStorage_::allocator_type::max_value_type_size();
-          if (unlikely(!detach_processor.is_enough_memory_for(node_max_size))) {
-            DeepDestroyFromCacheVisitor{}.process(key_in_shared_memory);
-            return nullptr;
-          }
+    auto cached_instance_wrapper = instance_wrapper.clone_and_detach_shared_ref(detach_processor);
+    if (!cached_instance_wrapper) {
+      return nullptr;
+    }
+    string key_in_shared_memory = key_in_script_memory;
+    if (unlikely(!detach_processor.process(key_in_shared_memory))) {
+      return nullptr;
+    }
+    void *mem = detach_processor.prepare_raw_memory(sizeof(ElementHolder));
+    if (unlikely(!mem)) {
+      DeepDestroyFromCacheVisitor{}.process(key_in_shared_memory);
+      return nullptr;
+    }
 
-          it = data.storage.emplace(std::move(key_in_shared_memory), vk::intrusive_ptr<ElementHolder>{}).first;
-          data.is_storage_empty.store(false, std::memory_order_relaxed);
-          context_->stats.elements_cached.fetch_add(1, std::memory_order_relaxed);
-        }
-        // replace element and save previous element into used_elements_;
-        // it'll make it possible to free it without taking a storage_mutex lock
-        it->second.swap(element);
-        if (element) {
-          // used_elements_ uses heap memory for its internal allocations
-          used_elements_.emplace(std::move(element));
-        }
-        used_elements_.emplace(it->second);
-        return it->second.get();
-      }
+    auto *element = new(mem) ElementHolder{std::move(key_in_shared_memory), now_, ttl, std::move(cached_instance_wrapper), *context_};
+    ElementHolder *replaced_element = nullptr;
+    if (unlikely(!current_->get_index().insert(element, replaced_element))) {
+      element->destroy();
+      php_warning("Instance cache index is full (%u slots), the memory buffer will be swapped", current_->get_index().capacity());
+      context_->memory_swap_required = true;
+      return nullptr;
     }
-    return nullptr;
+    if (replaced_element) {
+      // the replaced element may be still used by other processes, it'll be destroyed later
+      context_->retire(replaced_element);
+    } else {
+      context_->stats.elements_cached.fetch_add(1, std::memory_order_relaxed);
+    }
+    return element;
   }
 
   void fire_warning(const DeepMoveFromScriptToCacheVisitor &detach_processor, const char *class_name) noexcept {
@@ -652,21 +945,8 @@ private:
   CacheContext *context_{nullptr};
   InterProcessResourceManager<SharedMemoryData, 2> data_manager_;
 
-
-  struct IntrusivePtrHash {
-    size_t operator()(const vk::intrusive_ptr<ElementHolder> &el) const {
-      return reinterpret_cast<size_t>(el.get());
-    }
-  };
-
-  // A storage of elements that were used inside a script (during the request)
-  // Elements are inserted here to ensure that they don't go away unexpectedly
-  // std::unordered_set uses heap memory
-  // vk::intrusive_ptr<ElementHolder> uses shared memory
-  std::unordered_set<vk::intrusive_ptr<ElementHolder>, IntrusivePtrHash> used_elements_;
-
-  // A local cache that can be used to get elements without taking a storage_mutex lock
-  // Uses a script memory
+  // A local cache that can be used to get elements without looking into the shared index
+  // Uses a script memory, elements are kept alive by the pinned epoch
   array<const ElementHolder *> request_cache_;
 
   // A container for instances which we failed to save from the first try due to the allocator lock
@@ -679,7 +959,7 @@ private:
 
   std::chrono::nanoseconds now_{std::chrono::nanoseconds::zero()};
   memory_resource::MemoryStats last_memory_stats_;
-  size_t purge_shard_offset_{0};
+  uint32_t purge_block_offset_{0};
 };
 
 DeepMoveFromScriptToCacheVisitor::DeepMoveFromScriptToCacheVisitor(memory_resource::unsynchronized_pool_resource &memory_pool) noexcept:
@@ -729,8 +1009,43 @@ const InstanceWrapperBase *instance_cache_fetch_wrapper(const string &key, bool
   return InstanceCache::get().fetch(key, even_if_expired);
 }
 
+array<const InstanceWrapperBase *> instance_cache_fetch_wrappers(const array<string> &keys, bool even_if_expired) {
+  return InstanceCache::get().fetch_many(keys, even_if_expired);
+}
+
+array<bool> instance_cache_store_wrappers(const array<const InstanceWrapperBase *> &instance_wrappers, int64_t ttl) {
+  return InstanceCache::get().store_many(instance_wrappers, ttl);
+}
+
 } // namespace ic_impl_
 
+void InstanceCacheStats::add_fetch_latency(std::chrono::nanoseconds latency) noexcept {
+  const auto latency_ns = static_cast<uint64_t>(std::max<int64_t>(latency.count(), 1));
+  const auto bucket = std::min<size_t>(63 - __builtin_clzll(latency_ns), FETCH_LATENCY_BUCKETS - 1);
+  fetch_latency_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds InstanceCacheStats::get_fetch_latency_percentile(double percentile) const noexcept {
+  std::array<uint64_t, FETCH_LATENCY_BUCKETS> buckets{};
+  uint64_t total = 0;
+  for (size_t i = 0; i != FETCH_LATENCY_BUCKETS; ++i) {
+    buckets[i] = fetch_latency_buckets[i].load(std::memory_order_relaxed);
+    total += buckets[i];
+  }
+  if (!total) {
+    return std::chrono::nanoseconds::zero();
+  }
+  const auto rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(percentile * static_cast<double>(total))), 1);
+  uint64_t accumulated = 0;
+  for (size_t i = 0; i != FETCH_LATENCY_BUCKETS; ++i) {
+    accumulated += buckets[i];
+    if (accumulated >= rank) {
+      return std::chrono::nanoseconds{int64_t{1} << (i + 1)};
+    }
+  }
+  return std::chrono::nanoseconds{int64_t{1} << FETCH_LATENCY_BUCKETS};
+}
+
 void global_init_instance_cache_lib() {
   ic_impl_::InstanceCache::get().global_init();
 }
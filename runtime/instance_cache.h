@@ -16,6 +16,10 @@
 //  6) All instances (with all members) are destroyed strictly before or after request,
 //    and shouldn't be destroyed while request.
 
+#include <array>
+#include <atomic>
+#include <chrono>
+
 #include "common/mixin/not_copyable.h"
 
 #include "runtime/kphp_core.h"
@@ -284,6 +288,11 @@ private:
 
 bool instance_cache_store(const string &key, const InstanceWrapperBase &instance_wrapper, int64_t ttl);
 const InstanceWrapperBase *instance_cache_fetch_wrapper(const string &key, bool even_if_expired);
+// returns wrappers of the found elements by their keys
+array<const InstanceWrapperBase *> instance_cache_fetch_wrappers(const array<string> &keys, bool even_if_expired);
+
+// the null wrappers are not stored, all the others share one allocator lock acquisition
+array<bool> instance_cache_store_wrappers(const array<const InstanceWrapperBase *> &instance_wrappers, int64_t ttl);
 
 } // namespace ic_impl_
 
@@ -313,6 +322,18 @@ struct InstanceCacheStats : private vk::not_copyable {
   std::atomic<uint64_t> elements_created{0};
   std::atomic<uint64_t> elements_destroyed{0};
   std::atomic<uint64_t> elements_cached{0};
+  std::atomic<uint64_t> elements_retired{0};
+
+  std::atomic<uint64_t> allocator_lock_contended{0};
+  std::atomic<uint64_t> allocator_lock_wait_ns{0};
+
+  // fetches from the shared memory are accounted by log2 buckets: the bucket i counts fetches that took [2^i, 2^(i+1)) ns
+  static constexpr size_t FETCH_LATENCY_BUCKETS{32};
+  std::array<std::atomic<uint64_t>, FETCH_LATENCY_BUCKETS> fetch_latency_buckets{};
+
+  void add_fetch_latency(std::chrono::nanoseconds latency) noexcept;
+  // returns an upper bound of the fetch latency percentile, percentile is in range [0, 1]
+  std::chrono::nanoseconds get_fetch_latency_percentile(double percentile) const noexcept;
 };
 
 enum class InstanceCacheSwapStatus {
@@ -359,5 +380,42 @@ ClassInstanceType f$instance_cache_fetch(const string &class_name, const string
   return {};
 }
 
+template<typename ArrayOfClassInstances>
+ArrayOfClassInstances f$instance_cache_fetch_many(const string &class_name, const array<string> &keys, bool even_if_expired = false) {
+  using ClassInstanceType = typename ArrayOfClassInstances::value_type;
+  static_assert(is_class_instance<ClassInstanceType>::value, "array of class_instance<> type expected");
+  ArrayOfClassInstances result;
+  const auto base_wrappers = ic_impl_::instance_cache_fetch_wrappers(keys, even_if_expired);
+  for (const auto &it : base_wrappers) {
+    const auto *base_wrapper = it.get_value();
+    // the same as for instance_cache_fetch(), the class name is used only for the warning
+    if (auto wrapper = dynamic_cast<const ic_impl_::InstanceWrapper<ClassInstanceType> *>(base_wrapper)) {
+      auto instance = wrapper->get_instance();
+      php_assert(!instance.is_null());
+      result.set_value(it.get_key(), std::move(instance));
+    } else {
+      php_warning("Trying to fetch incompatible instance class: expect '%s', got '%s'",
+                  class_name.c_str(), base_wrapper->get_class());
+    }
+  }
+  return result;
+}
+
+template<typename ClassInstanceType>
+array<bool> f$instance_cache_store_many(const array<ClassInstanceType> &instances, int64_t ttl = 0) {
+  static_assert(is_class_instance<ClassInstanceType>::value, "class_instance<> type expected");
+  // the wrappers are created before the batch takes the allocator lock, it doesn't allocate the script memory holding it
+  array<const ic_impl_::InstanceWrapperBase *> instance_wrappers{instances.size()};
+  for (const auto &it : instances) {
+    const auto &instance = it.get_value();
+    instance_wrappers.set_value(it.get_key(), instance.is_null() ? nullptr : new ic_impl_::InstanceWrapper<ClassInstanceType>{instance});
+  }
+  auto result = ic_impl_::instance_cache_store_wrappers(instance_wrappers, ttl);
+  for (const auto &it : instance_wrappers) {
+    delete it.get_value();
+  }
+  return result;
+}
+
 bool f$instance_cache_update_ttl(const string &key, int64_t ttl = 0);
 bool f$instance_cache_delete(const string &key);
@@ -117,6 +117,13 @@ public:
     (*control_block_)->force_release_all_resources();
   }
 
+  template<typename F>
+  void for_each_resource(F &&f) noexcept {
+    for (auto &resource: switchable_resource_) {
+      f(resource);
+    }
+  }
+
   // this function should be called only from master
   T &get_current_resource() noexcept {
     php_assert(is_initial_process());
@@ -63,6 +63,13 @@ static string_buffer oub[OB_MAX_BUFFERS];
 string_buffer *coub;
 static int http_need_gzip;
 
+// after the first flush() the headers are sent and the body goes to the client by chunks
+static bool http_answer_chunked;
+// the connection can't take a chunked answer (HTTP/1.0 client), the body is sent as a whole in the end
+static bool http_answer_chunked_failed;
+static bool http_answer_chunked_compressed;
+static string_buffer http_chunk;
+
 void f$ob_clean() {
   coub->clean();
 }
@@ -119,6 +126,9 @@ void f$ob_flush() {
   ++ob_cur_buffer;
   coub = &oub[ob_cur_buffer];
   f$ob_clean();
+  if (ob_cur_buffer == 1 && http_answer_chunked) {
+    f$flush();
+  }
 }
 
 bool f$ob_end_flush() {
@@ -226,6 +236,11 @@ static void header(const char *str, int str_len, bool replace = true, int http_r
     header_last_query_num = dl::query_num;
   }
 
+  if (http_answer_chunked) {
+    php_warning("Cannot modify header information - headers already sent by flush()");
+    return;
+  }
+
   //status line
   if (str_len >= 5 && !strncasecmp(str, "HTTP/", 5)) {
     if (check_status_line(str, str_len)) {
@@ -409,11 +424,12 @@ static inline const char *http_get_error_msg_text(int *code) {
 }
 
 static const string_buffer *get_headers(int content_length) {//can't use static_SB, returns pointer to static_SB_spare
+  // negative content_length means chunked transfer encoding
   string date = f$gmdate(HTTP_DATE);
   static_SB_spare.clean() << "Date: " << date;
   header(static_SB_spare.c_str(), (int)static_SB_spare.size());
 
-  if (!is_head_query) {
+  if (!is_head_query && content_length >= 0) {
     static_SB_spare.clean() << "Content-Length: " << content_length;
     header(static_SB_spare.c_str(), (int)static_SB_spare.size());
   }
@@ -422,7 +438,12 @@ static const string_buffer *get_headers(int content_length) {//can't use static_
 
   static_SB_spare.clean();
   if (!http_status_line.empty()) {
-    static_SB_spare << http_status_line << "\r\n";
+    if (content_length < 0 && !strncmp(http_status_line.c_str(), "HTTP/1.0 ", 9)) {
+      // chunked transfer encoding appeared in HTTP/1.1
+      static_SB_spare << "HTTP/1.1" << http_status_line.c_str() + 8 << "\r\n";
+    } else {
+      static_SB_spare << http_status_line << "\r\n";
+    }
   } else {
     const char *message = http_get_error_msg_text(&http_return_code);
     static_SB_spare << "HTTP/1.1 " << http_return_code << " " << message << "\r\n";
@@ -432,11 +453,62 @@ static const string_buffer *get_headers(int content_length) {//can't use static_
   for (array<string>::const_iterator p = arr->begin(); p != arr->end(); ++p) {
     static_SB_spare << p.get_value();
   }
+  if (content_length < 0) {
+    static_SB_spare << "Transfer-Encoding: chunked\r\n";
+  }
   static_SB_spare << "\r\n";
 
   return &static_SB_spare;
 }
 
+// appends the data framed as a chunk of Transfer-Encoding: chunked body, empty data is skipped as it would end the body
+static void append_http_chunk(string_buffer &sb, const char *data, int data_len) {
+  if (data_len <= 0) {
+    return;
+  }
+  char len_buf[16];
+  int pos = sizeof(len_buf);
+  for (int len = data_len; len > 0; len >>= 4) {
+    len_buf[--pos] = lhex_digits[len & 15];
+  }
+  sb.append(len_buf + pos, sizeof(len_buf) - pos);
+  sb.append("\r\n", 2);
+  sb.append(data, data_len);
+  sb.append("\r\n", 2);
+}
+
+// the first call sends the headers, so it may fail if the connection doesn't support chunked answers
+static bool send_http_answer_chunk(const string_buffer &body) {
+  const string_buffer *headers = nullptr;
+  if (!http_answer_chunked) {
+    if ((http_need_gzip & 5) == 5 && zlib_stream_encode_init(6, ZLIB_ENCODE)) {
+      header("Content-Encoding: gzip", 22, true);
+      http_answer_chunked_compressed = true;
+    } else if ((http_need_gzip & 6) == 6 && zlib_stream_encode_init(6, ZLIB_COMPRESS)) {
+      header("Content-Encoding: deflate", 25, true);
+      http_answer_chunked_compressed = true;
+    }
+    headers = get_headers(-1);
+  }
+
+  const string_buffer *data = http_answer_chunked_compressed ? zlib_stream_encode(body.buffer(), body.size(), false) : &body;
+  http_chunk.clean();
+  append_http_chunk(http_chunk, data->buffer(), data->size());
+
+  if (headers == nullptr) {
+    http_send_chunk(nullptr, 0, http_chunk.buffer(), http_chunk.size());
+    return true;
+  }
+  if (!http_send_chunk(headers->buffer(), headers->size(), http_chunk.buffer(), http_chunk.size())) {
+    zlib_stream_encode_free();
+    http_answer_chunked_compressed = false;
+    http_answer_chunked_failed = true;
+    return false;
+  }
+  http_answer_chunked = true;
+  return true;
+}
+
 constexpr uint32_t MAX_SHUTDOWN_FUNCTIONS = 256;
 // i don't want destructors of this array to be called
 int shutdown_functions_count;
@@ -445,6 +517,37 @@ shutdown_function_type *shutdown_functions = reinterpret_cast<shutdown_function_
 static bool finished;
 static bool flushed;
 
+void f$flush() {
+  if (flushed) {
+    return;
+  }
+
+  string_buffer &out = oub[0];
+  switch (query_type) {
+    case QUERY_TYPE_CONSOLE: {
+      fflush(stderr);
+      write_safe(1, out.buffer(), out.size());
+      out.clean();
+      break;
+    }
+    case QUERY_TYPE_HTTP: {
+      if (is_head_query || http_answer_chunked_failed || (http_answer_chunked && out.size() == 0)) {
+        break;
+      }
+      if (send_http_answer_chunk(out)) {
+        out.clean();
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+bool f$headers_sent() {
+  return http_answer_chunked;
+}
+
 void f$fastcgi_finish_request(int64_t exit_code) {
   if (flushed) {
     return;
@@ -479,6 +582,17 @@ void f$fastcgi_finish_request(int64_t exit_code) {
       break;
     }
     case QUERY_TYPE_HTTP: {
+      if (http_answer_chunked) {
+        // the headers are sent by flush(), the rest of the body and the last chunk remain
+        const string_buffer &body = oub[first_not_empty_buffer];
+        const string_buffer *data = http_answer_chunked_compressed ? zlib_stream_encode(body.buffer(), body.size(), true) : &body;
+        http_chunk.clean();
+        append_http_chunk(http_chunk, data->buffer(), data->size());
+        http_chunk.append("0\r\n\r\n", 5);
+        http_set_result(nullptr, 0, http_chunk.buffer(), http_chunk.size(), static_cast<int32_t>(exit_code));
+        break;
+      }
+
       const string_buffer *compressed;
       if (is_head_query) {
         oub[first_not_empty_buffer].clean();
@@ -537,6 +651,7 @@ void finish(int64_t exit_code) {
   }
 
   f$fastcgi_finish_request(exit_code);
+  rpc_flush_postponed_queries();
 
   finish_script(static_cast<int32_t>(exit_code));
 
@@ -721,7 +836,16 @@ static long long uploaded_files_last_query_num = -1;
 
 static const int MAX_FILES = 100;
 
+static superglobals_usage used_superglobals;
+
+void set_superglobals_usage(const superglobals_usage &usage) {
+  used_superglobals = usage;
+}
+
 static string raw_post_data;
+// php://input reads raw_post_data from this position, and then the rest of the body, which is too large to be loaded in advance, from the connection
+static string::size_type input_stream_pos;
+static int input_stream_unread_len;
 
 bool f$is_uploaded_file(const string &filename) {
   return (dl::query_num == uploaded_files_last_query_num && uploaded_files->get_value(filename) == 1);
@@ -744,6 +868,13 @@ bool f$move_uploaded_file(const string &oldname, const string &newname) {
 }
 
 
+// the multipart body is parsed before the script is started, it can't go on without the body
+static int load_post_part(char *buf, int min_len, int max_len) {
+  const int loaded = http_load_long_query(buf, min_len, max_len);
+  php_assert (loaded >= min_len);
+  return loaded;
+}
+
 class post_reader {
   char *buf;
   int post_len;
@@ -792,9 +923,9 @@ public:
         buf_pos += to_erase;
         i -= to_erase;
 
-        buf_len = to_leave + http_load_long_query(buf + to_leave, min(to_leave, left), min(PHP_BUF_LEN - to_leave, left));
+        buf_len = to_leave + load_post_part(buf + to_leave, min(to_leave, left), min(PHP_BUF_LEN - to_leave, left));
       } else {
-        buf_len = http_load_long_query(buf, min(2 * chunk_size, left), min(PHP_BUF_LEN, left));
+        buf_len = load_post_part(buf, min(2 * chunk_size, left), min(PHP_BUF_LEN, left));
       }
     }
 
@@ -840,51 +971,25 @@ public:
     return true;
   }
 
-  int upload_file(const string &file_name, int &pos, int64_t max_file_size) {
+  // writes the file part starting at pos to file_fd, returns its size or -UPLOAD_ERR_*
+  int upload_file(int file_fd, int &pos, int64_t max_file_size) {
     php_assert (pos > 0 && buf_len > 0 && buf_pos <= pos && pos <= post_len);
 
     if (pos == post_len) {
       return -UPLOAD_ERR_PARTIAL;
     }
 
-    if (!f$is_writeable(file_name)) {
-      return -UPLOAD_ERR_CANT_WRITE;
-    }
-
-    dl::enter_critical_section();//OK
-    int file_fd = open_safe(file_name.c_str(), O_WRONLY | O_TRUNC, 0644);
-    if (file_fd < 0) {
-      dl::leave_critical_section();
-      return -UPLOAD_ERR_NO_FILE;
-    }
-
-    struct stat stat_buf;
-    if (fstat(file_fd, &stat_buf) < 0) {
-      close_safe(file_fd);
-      dl::leave_critical_section();
-      return -UPLOAD_ERR_CANT_WRITE;
-    }
-    dl::leave_critical_section();
-
-    php_assert (S_ISREG(stat_buf.st_mode));
-
     if (buf_len == post_len) {
       int i = pos;
       while (!is_boundary(i)) {
         i++;
       }
       if (i == post_len) {
-        dl::enter_critical_section();//OK
-        close_safe(file_fd);
-        dl::leave_critical_section();
         return -UPLOAD_ERR_PARTIAL;
       }
 
       int file_size = i - pos;
       if (file_size > max_file_size) {
-        dl::enter_critical_section();//OK
-        close_safe(file_fd);
-        dl::leave_critical_section();
         return -UPLOAD_ERR_FORM_SIZE;
       }
 
@@ -892,8 +997,6 @@ public:
       if (write_safe(file_fd, buf + pos, (size_t)file_size) < (ssize_t)file_size) {
         file_size = -UPLOAD_ERR_CANT_WRITE;
       }
-
-      close_safe(file_fd);
       dl::leave_critical_section();
       return file_size;
     } else {
@@ -937,16 +1040,10 @@ public:
 //        fprintf (stderr, "Load at pos %d. buf_len = %d, left = %d, to_leave = %d, to_erase = %d, to_write = %d.\n", buf_len + buf_pos, buf_len, left, to_leave, to_erase, to_write);
 
         if (left == 0) {
-          dl::enter_critical_section();//OK
-          close_safe(file_fd);
-          dl::leave_critical_section();
           return -UPLOAD_ERR_PARTIAL;
         }
         file_size += to_write;
         if (file_size > max_file_size) {
-          dl::enter_critical_section();//OK
-          close_safe(file_fd);
-          dl::leave_critical_section();
           return -UPLOAD_ERR_FORM_SIZE;
         }
 
@@ -954,7 +1051,6 @@ public:
 
         dl::enter_critical_section();//OK
         if (write_safe(file_fd, buf + pos - buf_pos, (size_t)to_write) < (ssize_t)to_write) {
-          close_safe(file_fd);
           dl::leave_critical_section();
           return -UPLOAD_ERR_CANT_WRITE;
         }
@@ -964,7 +1060,7 @@ public:
         buf_pos += to_erase;
         pos += to_write;
 
-        buf_len = to_leave + http_load_long_query(buf + to_leave, min(PHP_BUF_LEN - to_leave, left), min(PHP_BUF_LEN - to_leave, left));
+        buf_len = to_leave + load_post_part(buf + to_leave, min(PHP_BUF_LEN - to_leave, left), min(PHP_BUF_LEN - to_leave, left));
       }
 
       php_assert (s != nullptr);
@@ -972,19 +1068,127 @@ public:
       dl::enter_critical_section();//OK
       int to_write = (int)(s - (buf + pos - buf_pos));
       if (write_safe(file_fd, buf + pos - buf_pos, (size_t)to_write) < (ssize_t)to_write) {
-        close_safe(file_fd);
         dl::leave_critical_section();
         return -UPLOAD_ERR_CANT_WRITE;
       }
+      dl::leave_critical_section();
       pos += to_write;
 
+      return (int)(file_size + to_write);
+    }
+  }
+};
+
+static void register_uploaded_file(const string &tmp_name) {
+  if (dl::query_num != uploaded_files_last_query_num) {
+    new(&uploaded_files_storage) array<bool>();
+    uploaded_files_last_query_num = dl::query_num;
+  }
+
+  dl::enter_critical_section();//NOT OK: uploaded_files
+  uploaded_files->set_value(tmp_name, true);
+  dl::leave_critical_section();
+}
+
+static int upload_named_file(post_reader &data, int &pos, int64_t max_file_size, Optional<string> &tmp_name) {
+  tmp_name = f$tempnam(string(), string());
+  if (!f$boolval(tmp_name)) {
+    return -UPLOAD_ERR_NO_TMP_DIR;
+  }
+  register_uploaded_file(tmp_name.val());
+
+  int file_size = -UPLOAD_ERR_CANT_WRITE;
+  if (f$is_writeable(tmp_name.val())) {
+    // the file is reopened by its name, which may have been replaced since tempnam() with a link or something else:
+    // it is truncated only after the check
+    dl::enter_critical_section();//OK
+    int file_fd = open_safe(tmp_name.val().c_str(), O_WRONLY | O_NOFOLLOW, 0644);
+    struct stat stat_buf;
+    if (file_fd >= 0 && (fstat(file_fd, &stat_buf) < 0 || !S_ISREG(stat_buf.st_mode) || stat_buf.st_nlink != 1 || ftruncate(file_fd, 0) < 0)) {
+      close_safe(file_fd);
+      file_fd = -1;
+    }
+    dl::leave_critical_section();
+
+    if (file_fd >= 0) {
+      file_size = data.upload_file(file_fd, pos, max_file_size);
+
+      dl::enter_critical_section();//OK
       close_safe(file_fd);
       dl::leave_critical_section();
+    } else {
+      file_size = -UPLOAD_ERR_NO_FILE;
+    }
+  }
 
-      return (int)(file_size + to_write);
+  if (file_size < 0) {
+    dl::enter_critical_section();//NOT OK: uploaded_files
+    f$unlink(tmp_name.val());
+    uploaded_files->unset(tmp_name.val());
+    dl::leave_critical_section();
+  }
+  return file_size;
+}
+
+// gives a name in dir to the unnamed temporary file
+static Optional<string> link_tmpfile(int file_fd, const string &dir) {
+  static unsigned int links_count = 0;
+
+  char fd_path[32];
+  snprintf(fd_path, sizeof(fd_path), "/proc/self/fd/%d", file_fd);
+
+  char file_name[64];
+  for (int attempt = 0; attempt < 100; attempt++) {
+    snprintf(file_name, sizeof(file_name), "/php-upload.%d.%u", static_cast<int>(getpid()), links_count++);
+    string tmp_name = dir;
+    tmp_name.append(file_name);
+
+    dl::enter_critical_section();//OK
+    // linkat never follows the symlinks at the new path and fails if it exists
+    int res = linkat(AT_FDCWD, fd_path, AT_FDCWD, tmp_name.c_str(), AT_SYMLINK_FOLLOW);
+    dl::leave_critical_section();
+    if (res == 0) {
+      return tmp_name;
+    }
+    if (errno != EEXIST) {
+      php_warning("Can't link uploaded file to \"%s\": %m", tmp_name.c_str());
+      break;
     }
   }
-};
+  return false;
+}
+
+// An uploaded file is written to an unnamed temporary file, which gets a name only when the upload is complete.
+// So partial uploads never appear in the temporary directory, and there is nothing to remove if they fail.
+static int upload_file(post_reader &data, int &pos, int64_t max_file_size, Optional<string> &tmp_name) {
+  const Optional<string> tmp_dir = get_tmp_dir();
+  if (!f$boolval(tmp_dir)) {
+    return -UPLOAD_ERR_NO_TMP_DIR;
+  }
+
+  dl::enter_critical_section();//OK
+  int file_fd = open_safe(tmp_dir.val().c_str(), O_TMPFILE | O_WRONLY, 0600);
+  dl::leave_critical_section();
+  if (file_fd < 0) {
+    // the filesystem doesn't support O_TMPFILE
+    return upload_named_file(data, pos, max_file_size, tmp_name);
+  }
+
+  int file_size = data.upload_file(file_fd, pos, max_file_size);
+  if (file_size >= 0) {
+    tmp_name = link_tmpfile(file_fd, tmp_dir.val());
+    if (f$boolval(tmp_name)) {
+      register_uploaded_file(tmp_name.val());
+    } else {
+      file_size = -UPLOAD_ERR_CANT_WRITE;
+    }
+  }
+
+  dl::enter_critical_section();//OK
+  close_safe(file_fd);
+  dl::leave_critical_section();
+  return file_size;
+}
 
 static int parse_multipart_one(post_reader &data, int i) {
   string content_type("text/plain", 10);
@@ -1102,28 +1306,7 @@ static int parse_multipart_one(post_reader &data, int i) {
     int file_size;
     Optional<string> tmp_name;
     if (v$_FILES.count() < MAX_FILES) {
-      if (dl::query_num != uploaded_files_last_query_num) {
-        new(&uploaded_files_storage) array<bool>();
-        uploaded_files_last_query_num = dl::query_num;
-      }
-
-      dl::enter_critical_section();//NOT OK: uploaded_files
-      tmp_name = f$tempnam(string(), string());
-      uploaded_files->set_value(tmp_name.val(), true);
-      dl::leave_critical_section();
-
-      if (f$boolval(tmp_name)) {
-        file_size = data.upload_file(tmp_name.val(), i, max_file_size);
-
-        if (file_size < 0) {
-          dl::enter_critical_section();//NOT OK: uploaded_files
-          f$unlink(tmp_name.val());
-          uploaded_files->unset(tmp_name.val());
-          dl::leave_critical_section();
-        }
-      } else {
-        file_size = -UPLOAD_ERR_NO_TMP_DIR;
-      }
+      file_size = upload_file(data, i, max_file_size, tmp_name);
     } else {
       file_size = -UPLOAD_ERR_NO_FILE;
     }
@@ -1312,23 +1495,35 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
 
   reset_superglobals();
 
+  // $_REQUEST is merged from $_GET, $_POST and $_COOKIE
+  const bool need_server = used_superglobals.server;
+  const bool need_get = used_superglobals.get || used_superglobals.request;
+  const bool need_post = used_superglobals.post || used_superglobals.request;
+  const bool need_cookie = used_superglobals.cookie || used_superglobals.request;
+
   string uri_str;
   if (uri_len) {
     uri_str.assign(uri, uri_len);
-    v$_SERVER.set_value(string("PHP_SELF", 8), uri_str);
-    v$_SERVER.set_value(string("SCRIPT_URL", 10), uri_str);
-    v$_SERVER.set_value(string("SCRIPT_NAME", 11), uri_str);
+    if (need_server) {
+      v$_SERVER.set_value(string("PHP_SELF", 8), uri_str);
+      v$_SERVER.set_value(string("SCRIPT_URL", 10), uri_str);
+      v$_SERVER.set_value(string("SCRIPT_NAME", 11), uri_str);
+    }
   }
 
   string get_str;
   if (get_len) {
     get_str.assign(get, get_len);
-    f$parse_str(get_str, v$_GET);
+    if (need_get) {
+      f$parse_str(get_str, v$_GET);
+    }
 
-    v$_SERVER.set_value(string("QUERY_STRING", 12), get_str);
+    if (need_server) {
+      v$_SERVER.set_value(string("QUERY_STRING", 12), get_str);
+    }
   }
 
-  if (uri) {
+  if (uri && need_server) {
     if (get_len) {
       v$_SERVER.set_value(string("REQUEST_URI", 11), (static_SB.clean() << uri_str << '?' << get_str).str());
     } else {
@@ -1376,17 +1571,23 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
           http_need_gzip |= 2;
         }
       } else if (!strcmp(header_name.c_str(), "cookie")) {
-        array<string> cookie = explode(';', header_value);
-        for (int t = 0; t < (int)cookie.count(); t++) {
-          array<string> cur_cookie = explode('=', f$trim(cookie[t]), 2);
-          if ((int)cur_cookie.count() == 2) {
-            parse_str_set_value(v$_COOKIE, cur_cookie[0], f$urldecode(cur_cookie[1]));
+        if (need_cookie) {
+          array<string> cookie = explode(';', header_value);
+          for (int t = 0; t < (int)cookie.count(); t++) {
+            array<string> cur_cookie = explode('=', f$trim(cookie[t]), 2);
+            if ((int)cur_cookie.count() == 2) {
+              parse_str_set_value(v$_COOKIE, cur_cookie[0], f$urldecode(cur_cookie[1]));
+            }
           }
         }
       } else if (!strcmp(header_name.c_str(), "host")) {
-        v$_SERVER.set_value(string("SERVER_NAME", 11), header_value);
+        if (need_server) {
+          v$_SERVER.set_value(string("SERVER_NAME", 11), header_value);
+        }
       } else if (!strcmp(header_name.c_str(), "authorization")) {
-        parse_http_authorization_header(header_value);
+        if (need_server) {
+          parse_http_authorization_header(header_value);
+        }
       }
 
       if (!strcmp(header_name.c_str(), "content-type")) {
@@ -1394,7 +1595,7 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
         content_type_lower = f$strtolower(header_value);
       } else if (!strcmp(header_name.c_str(), "content-length")) {
         //must be equal to post_len, ignored
-      } else {
+      } else if (need_server) {
         string key(header_name.size() + 5, false);
         bool good_name = true;
         for (int i = 0; i < (int)header_name.size(); i++) {
@@ -1426,7 +1627,7 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
   string HTTP_X_REAL_SCHEME("HTTP_X_REAL_SCHEME", 18);
   string HTTP_X_REAL_HOST("HTTP_X_REAL_HOST", 16);
   string HTTP_X_REAL_REQUEST("HTTP_X_REAL_REQUEST", 19);
-  if (v$_SERVER.isset(HTTP_X_REAL_SCHEME) && v$_SERVER.isset(HTTP_X_REAL_HOST) && v$_SERVER.isset(HTTP_X_REAL_REQUEST)) {
+  if (need_server && v$_SERVER.isset(HTTP_X_REAL_SCHEME) && v$_SERVER.isset(HTTP_X_REAL_HOST) && v$_SERVER.isset(HTTP_X_REAL_REQUEST)) {
     string script_uri(v$_SERVER.get_value(HTTP_X_REAL_SCHEME).to_string());
     script_uri.append("://", 3);
     script_uri.append(v$_SERVER.get_value(HTTP_X_REAL_HOST).to_string());
@@ -1434,8 +1635,9 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
     v$_SERVER.set_value(string("SCRIPT_URI", 10), script_uri);
   }
 
+  input_stream_pos = 0;
+  input_stream_unread_len = 0;
   if (post_len > 0) {
-    bool is_parsed = (post != nullptr);
 //    fprintf (stderr, "!!!%.*s!!!\n", post_len, post);
     if (strstr(content_type_lower.c_str(), "application/x-www-form-urlencoded")) {
       if (post != nullptr) {
@@ -1443,10 +1645,15 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
         raw_post_data.assign(post, post_len);
         dl::leave_critical_section();
 
-        f$parse_str(raw_post_data, v$_POST);
+        if (need_post) {
+          f$parse_str(raw_post_data, v$_POST);
+        }
+      } else {
+        input_stream_unread_len = post_len;
       }
     } else if (strstr(content_type_lower.c_str(), "multipart/form-data")) {
-      const char *p = strstr(content_type_lower.c_str(), "boundary");
+      // when neither $_POST nor $_FILES is read, the body isn't parsed and the files aren't uploaded
+      const char *p = need_post || used_superglobals.files ? strstr(content_type_lower.c_str(), "boundary") : nullptr;
       if (p) {
         p += 8;
         p = strchr(content_type.c_str() + (p - content_type_lower.c_str()), '=');
@@ -1459,7 +1666,7 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
             end_p--;
           }
 //          fprintf (stderr, "!%s!\n", p);
-          is_parsed |= parse_multipart(post, post_len, string(p, static_cast<string::size_type>(end_p - p)));
+          parse_multipart(post, post_len, string(p, static_cast<string::size_type>(end_p - p)));
         }
       }
     } else {
@@ -1467,52 +1674,49 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
         dl::enter_critical_section();//OK
         raw_post_data.assign(post, post_len);
         dl::leave_critical_section();
+      } else {
+        input_stream_unread_len = post_len;
       }
     }
+    // a large body stays in the connection: it is read from php://input on demand,
+    // and the part which isn't read is skipped by the server after the script is finished
 
-    if (!is_parsed) {
-      int loaded = 0;
-      while (loaded < post_len) {
-        int to_load = min(PHP_BUF_LEN, post_len - loaded);
-        http_load_long_query(php_buf, to_load, to_load);
-        loaded += to_load;
-      }
+    if (need_server) {
+      v$_SERVER.set_value(string("CONTENT_TYPE", 12), content_type);
     }
-
-    v$_SERVER.set_value(string("CONTENT_TYPE", 12), content_type);
   }
 
-  double cur_time = microtime();
-  v$_SERVER.set_value(string("GATEWAY_INTERFACE", 17), string("CGI/1.1", 7));
-  if (remote_ip) {
-    v$_SERVER.set_value(string("REMOTE_ADDR", 11), f$long2ip(remote_ip));
-  }
-  if (remote_port) {
-    v$_SERVER.set_value(string("REMOTE_PORT", 11), remote_port);
-  }
-  if (rpc_request_id) {
-    v$_SERVER.set_value(string("RPC_REQUEST_ID", 14), f$strval(Long(rpc_request_id)));
-    v$_SERVER.set_value(string("RPC_REMOTE_IP", 13), rpc_remote_ip);
-    v$_SERVER.set_value(string("RPC_REMOTE_PORT", 15), rpc_remote_port);
-    v$_SERVER.set_value(string("RPC_REMOTE_PID", 14), rpc_remote_pid);
-    v$_SERVER.set_value(string("RPC_REMOTE_UTIME", 16), rpc_remote_utime);
-  }
-  is_head_query = false;
-  if (request_method_len) {
-    v$_SERVER.set_value(string("REQUEST_METHOD", 14), string(request_method, request_method_len));
-    if (request_method_len == 4 && !strncmp(request_method, "HEAD", request_method_len)) {
-      is_head_query = true;
+  is_head_query = request_method_len == 4 && !strncmp(request_method, "HEAD", request_method_len);
+
+  if (need_server) {
+    double cur_time = microtime();
+    v$_SERVER.set_value(string("GATEWAY_INTERFACE", 17), string("CGI/1.1", 7));
+    if (remote_ip) {
+      v$_SERVER.set_value(string("REMOTE_ADDR", 11), f$long2ip(remote_ip));
+    }
+    if (remote_port) {
+      v$_SERVER.set_value(string("REMOTE_PORT", 11), remote_port);
     }
+    if (rpc_request_id) {
+      v$_SERVER.set_value(string("RPC_REQUEST_ID", 14), f$strval(Long(rpc_request_id)));
+      v$_SERVER.set_value(string("RPC_REMOTE_IP", 13), rpc_remote_ip);
+      v$_SERVER.set_value(string("RPC_REMOTE_PORT", 15), rpc_remote_port);
+      v$_SERVER.set_value(string("RPC_REMOTE_PID", 14), rpc_remote_pid);
+      v$_SERVER.set_value(string("RPC_REMOTE_UTIME", 16), rpc_remote_utime);
+    }
+    if (request_method_len) {
+      v$_SERVER.set_value(string("REQUEST_METHOD", 14), string(request_method, request_method_len));
+    }
+    v$_SERVER.set_value(string("REQUEST_TIME", 12), int(cur_time));
+    v$_SERVER.set_value(string("REQUEST_TIME_FLOAT", 18), cur_time);
+    v$_SERVER.set_value(string("SERVER_PORT", 11), string("80", 2));
+    v$_SERVER.set_value(string("SERVER_PROTOCOL", 15), string("HTTP/1.1", 8));
+    v$_SERVER.set_value(string("SERVER_SIGNATURE", 16), (static_SB.clean() << "Apache/2.2.9 (Debian) PHP/5.2.6-1<<lenny10 with Suhosin-Patch Server at "
+                                                                           << v$_SERVER[string("SERVER_NAME", 11)] << " Port 80").str());
+    v$_SERVER.set_value(string("SERVER_SOFTWARE", 15), string("Apache/2.2.9 (Debian) PHP/5.2.6-1+lenny10 with Suhosin-Patch", 60));
   }
-  v$_SERVER.set_value(string("REQUEST_TIME", 12), int(cur_time));
-  v$_SERVER.set_value(string("REQUEST_TIME_FLOAT", 18), cur_time);
-  v$_SERVER.set_value(string("SERVER_PORT", 11), string("80", 2));
-  v$_SERVER.set_value(string("SERVER_PROTOCOL", 15), string("HTTP/1.1", 8));
-  v$_SERVER.set_value(string("SERVER_SIGNATURE", 16), (static_SB.clean() << "Apache/2.2.9 (Debian) PHP/5.2.6-1<<lenny10 with Suhosin-Patch Server at "
-                                                                         << v$_SERVER[string("SERVER_NAME", 11)] << " Port 80").str());
-  v$_SERVER.set_value(string("SERVER_SOFTWARE", 15), string("Apache/2.2.9 (Debian) PHP/5.2.6-1+lenny10 with Suhosin-Patch", 60));
 
-  if (environ != nullptr) {
+  if (environ != nullptr && used_superglobals.env) {
     for (int i = 0; environ[i] != nullptr; i++) {
       const char *s = strchr(environ[i], '=');
       php_assert (s != nullptr);
@@ -1520,9 +1724,11 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
     }
   }
 
-  v$_REQUEST.as_array("") += v$_GET.to_array();
-  v$_REQUEST.as_array("") += v$_POST.to_array();
-  v$_REQUEST.as_array("") += v$_COOKIE.to_array();
+  if (used_superglobals.request) {
+    v$_REQUEST.as_array("") += v$_GET.to_array();
+    v$_REQUEST.as_array("") += v$_POST.to_array();
+    v$_REQUEST.as_array("") += v$_COOKIE.to_array();
+  }
 
   if (uri != nullptr) {
     if (keep_alive) {
@@ -1548,8 +1754,10 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
     v$argv = *arg_vars;
   }
 
-  v$_SERVER.set_value(string("argv", 4), v$argv);
-  v$_SERVER.set_value(string("argc", 4), v$argc);
+  if (need_server) {
+    v$_SERVER.set_value(string("argv", 4), v$argv);
+    v$_SERVER.set_value(string("argc", 4), v$argc);
+  }
 
   v$d$PHP_SAPI = php_sapi_name();
 
@@ -1587,6 +1795,7 @@ void init_superglobals(php_query_data *data) {
                     http_data->post, http_data->post_len, http_data->request_method, http_data->request_method_len,
                     http_data->ip, http_data->port, http_data->keep_alive,
                     rpc_data->data, rpc_data->len, rpc_data->req_id, rpc_data->ip, rpc_data->port, rpc_data->pid, rpc_data->utime);
+  set_rpc_client_compression_version(rpc_data->supported_compression_version);
 }
 
 double f$get_net_time() {
@@ -1698,6 +1907,38 @@ const Stream STDIN("php://stdin", 11);
 const Stream STDOUT("php://stdout", 12);
 const Stream STDERR("php://stderr", 12);
 
+static string load_input_stream(int length) {
+  php_assert (0 < length && length <= input_stream_unread_len);
+  string res(static_cast<string::size_type>(length), false);
+  if (http_load_long_query(&res[0], length, length) != length) {
+    php_warning("Can't load %d bytes of the request body from php://input", length);
+    input_stream_unread_len = 0;
+    return {};
+  }
+  input_stream_unread_len -= length;
+  return res;
+}
+
+static string read_input_stream(int64_t length) {
+  string res;
+  if (input_stream_pos < raw_post_data.size()) {
+    const auto buffered_len = static_cast<string::size_type>(min(length, static_cast<int64_t>(raw_post_data.size() - input_stream_pos)));
+    res.assign(raw_post_data.c_str() + input_stream_pos, buffered_len);
+    input_stream_pos += buffered_len;
+    length -= buffered_len;
+  }
+  if (length > 0 && input_stream_unread_len > 0) {
+    // the loaded part isn't saved to raw_post_data: large bodies are read by parts without keeping them in memory
+    string loaded = load_input_stream(static_cast<int>(min(length, static_cast<int64_t>(input_stream_unread_len))));
+    if (res.empty()) {
+      res = loaded;
+    } else {
+      res.append(loaded);
+    }
+  }
+  return res;
+}
+
 static Stream php_fopen(const string &stream, const string &mode) {
   if (eq2(stream, STDOUT) || eq2(stream, STDERR)) {
     if (neq2(mode, string("w", 1)) && neq2(mode, string("a", 1))) {
@@ -1797,9 +2038,7 @@ static Optional<string> php_fread(const Stream &stream, int64_t length) {
   }
 
   if (eq2(stream, INPUT)) {
-    //TODO implement this
-    php_warning("Can't use fread with stream %s", stream.to_string().c_str());
-    return false;
+    return read_input_stream(length);
   }
 
   if (eq2(stream, STDIN)) {
@@ -1934,9 +2173,7 @@ static bool php_feof(const Stream &stream) {
   }
 
   if (eq2(stream, INPUT)) {
-    //TODO implement this
-    php_warning("Can't use feof with stream %s", stream.to_string().c_str());
-    return true;
+    return input_stream_pos >= raw_post_data.size() && input_stream_unread_len == 0;
   }
 
   if (eq2(stream, STDIN)) {
@@ -1957,6 +2194,14 @@ static Optional<string> php_file_get_contents(const string &url) {
   }
 
   if (eq2(url, INPUT)) {
+    if (input_stream_unread_len > 0) {
+      string rest = load_input_stream(input_stream_unread_len);
+      if (raw_post_data.empty()) {
+        raw_post_data = rest;
+      } else {
+        raw_post_data.append(rest);
+      }
+    }
     return raw_post_data;
   }
 
@@ -2062,6 +2307,9 @@ static void init_runtime_libs() {
   shutdown_functions_count = 0;
   finished = false;
   flushed = false;
+  http_answer_chunked = false;
+  http_answer_chunked_failed = false;
+  http_answer_chunked_compressed = false;
 
   php_warning_level = std::max(2, php_warning_minimum_level);
   php_disable_warnings = 0;
@@ -2110,6 +2358,7 @@ static void free_runtime_libs() {
   free_confdata_functions_lib();
   free_instance_cache_lib();
   free_kphp_backtrace();
+  zlib_stream_encode_free();
 
   dl::enter_critical_section();//OK
   if (dl::query_num == uploaded_files_last_query_num) {
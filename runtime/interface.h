@@ -31,6 +31,10 @@ bool f$ob_end_flush();
 
 Optional<string> f$ob_get_flush();
 
+void f$flush();
+
+bool f$headers_sent();
+
 Optional<int64_t> f$ob_get_length();
 
 int64_t f$ob_get_level();
@@ -115,6 +119,20 @@ extern mixed v$_COOKIE;
 extern mixed v$_REQUEST;
 extern mixed v$_ENV;
 
+// the superglobals which are read by the script, the compiler knows them;
+// the unused ones stay empty, so the requests don't spend time on filling them
+struct superglobals_usage {
+  bool server = true;
+  bool get = true;
+  bool post = true;
+  bool files = true;
+  bool cookie = true;
+  bool request = true;
+  bool env = true;
+};
+
+void set_superglobals_usage(const superglobals_usage &usage);
+
 const int32_t UPLOAD_ERR_OK = 0;
 const int32_t UPLOAD_ERR_INI_SIZE = 1;
 const int32_t UPLOAD_ERR_FORM_SIZE = 2;
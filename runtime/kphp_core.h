@@ -392,6 +392,9 @@ inline string f$get_class(const class_instance<T> &v);
 template<class T>
 inline int64_t f$get_hash_of_class(const class_instance<T> &klass);
 
+template<class T>
+inline int64_t f$get_class_id_of_instance(const class_instance<T> &klass);
+
 
 inline int64_t f$count(const mixed &v);
 
@@ -1263,6 +1266,11 @@ inline int64_t f$get_hash_of_class(const class_instance<T> &klass) {
   return klass.get_hash();
 }
 
+template<class T>
+inline int64_t f$get_class_id_of_instance(const class_instance<T> &klass) {
+  return klass.get_class_id();
+}
+
 string &append(string &dest, const string &from) {
   return dest.append(from);
 }
@@ -4,10 +4,15 @@
 
 #include "runtime/regexp.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <list>
 #include <re2/re2.h>
+#include <unordered_map>
 
 #include "common/containers/final_action.h"
+#include "common/wrappers/string_view.h"
 
 #include "runtime/critical_section.h"
 
@@ -287,58 +292,170 @@ bool regexp::is_valid_RE2_regexp(const char *regexp_string, int64_t regexp_len,
   return true;
 }
 
-void regexp::init(const string &regexp_string, const char *function, const char *file) {
-  static char regexp_cache_storage[sizeof(array<regexp *>)];
-  static array<regexp *> *regexp_cache = (array<regexp *> *)regexp_cache_storage;
-  static long long regexp_last_query_num = -1;
+namespace {
 
-  use_heap_memory = (dl::get_script_memory_stats().memory_limit == 0);
+// Worker-lifetime LRU cache of the compiled dynamic patterns.
+// Patterns are compiled on the heap, so they survive the script memory reset between requests.
+// Evicted patterns can still be used by the running script, therefore they are freed at the next request start.
+class RegexpCache : vk::not_copyable {
+public:
+  static RegexpCache &get() noexcept {
+    static RegexpCache cache;
+    return cache;
+  }
 
-  if (!use_heap_memory) {
-    if (dl::query_num != regexp_last_query_num) {
-      new(regexp_cache_storage) array<regexp *>();
-      regexp_last_query_num = dl::query_num;
+  const regexp *find(const string &pattern) noexcept {
+    release_retired();
+
+    auto it = index_.find(vk::string_view{pattern.c_str(), pattern.size()});
+    if (it == index_.end()) {
+      ++stats_.misses;
+      return nullptr;
     }
 
-    regexp *re = regexp_cache->get_value(regexp_string);
-    if (re != nullptr) {
-      php_assert (!re->use_heap_memory);
+    ++stats_.hits;
+    ++it->second->stats.hits;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->compiled;
+  }
 
-      subpatterns_count = re->subpatterns_count;
-      named_subpatterns_count = re->named_subpatterns_count;
-      is_utf8 = re->is_utf8;
-      use_heap_memory = re->use_heap_memory;
+  void insert(const string &pattern, regexp *compiled, double compile_time) noexcept {
+    stats_.compile_time += compile_time;
+    if (max_entries_ == 0) {
+      retired_.push_back(compiled);
+      return;
+    }
 
-      subpattern_names = re->subpattern_names;
+    while (lru_.size() >= max_entries_) {
+      evict_last();
+    }
 
-      pcre_regexp = re->pcre_regexp;
-      RE2_regexp = re->RE2_regexp;
+    lru_.emplace_front();
+    auto &entry = lru_.front();
+    entry.stats.pattern.assign(pattern.c_str(), pattern.size());
+    entry.stats.compile_time = compile_time;
+    entry.compiled = compiled;
+    index_.emplace(vk::string_view{entry.stats.pattern}, lru_.begin());
+    stats_.entries = static_cast<int64_t>(lru_.size());
+  }
 
-      return;
+  void set_max_entries(size_t max_entries) noexcept {
+    max_entries_ = max_entries;
+  }
+
+  const RegexpCacheStats &get_stats() const noexcept {
+    return stats_;
+  }
+
+  std::vector<RegexpCachePatternStats> get_hottest_patterns(size_t limit) const noexcept {
+    std::vector<RegexpCachePatternStats> result;
+    result.reserve(lru_.size());
+    for (const auto &entry : lru_) {
+      result.emplace_back(entry.stats);
     }
+    limit = std::min(limit, result.size());
+    std::partial_sort(result.begin(), result.begin() + limit, result.end(),
+                      [](const RegexpCachePatternStats &lhs, const RegexpCachePatternStats &rhs) {
+                        return lhs.hits > rhs.hits;
+                      });
+    result.resize(limit);
+    return result;
   }
 
-  init(regexp_string.c_str(), regexp_string.size(), function, file);
+private:
+  struct Entry {
+    RegexpCachePatternStats stats;
+    regexp *compiled{nullptr};
+  };
+
+  void evict_last() noexcept {
+    auto &entry = lru_.back();
+    index_.erase(vk::string_view{entry.stats.pattern});
+    retired_.push_back(entry.compiled);
+    lru_.pop_back();
+    ++stats_.evictions;
+    stats_.entries = static_cast<int64_t>(lru_.size());
+  }
 
-  if (!use_heap_memory) {
-    regexp *re = static_cast <regexp *> (dl::allocate(sizeof(regexp)));
-    new(re) regexp();
+  void release_retired() noexcept {
+    if (dl::query_num == last_query_num_) {
+      return;
+    }
+    last_query_num_ = dl::query_num;
+    for (regexp *re : retired_) {
+      delete re;
+    }
+    retired_.clear();
+  }
 
-    re->subpatterns_count = subpatterns_count;
-    re->named_subpatterns_count = named_subpatterns_count;
-    re->is_utf8 = is_utf8;
-    re->use_heap_memory = use_heap_memory;
+  // 4096 patterns is enough for the most of the templating and validation code
+  size_t max_entries_{4096};
+  long long last_query_num_{-1};
+  std::list<Entry> lru_;
+  std::unordered_map<vk::string_view, std::list<Entry>::iterator> index_;
+  std::vector<regexp *> retired_;
+  RegexpCacheStats stats_;
+};
+
+pcre_jit_stack *get_pcre_jit_stack() noexcept {
+  static pcre_jit_stack *jit_stack = pcre_jit_stack_alloc(PCRE_JIT_STACK_MIN_SIZE, PCRE_JIT_STACK_MAX_SIZE);
+  return jit_stack;
+}
 
-    re->subpattern_names = subpattern_names;
+} // namespace
 
-    re->pcre_regexp = pcre_regexp;
-    re->RE2_regexp = RE2_regexp;
+void regexp::init(const string &regexp_string, const char *function, const char *file) {
+  use_heap_memory = (dl::get_script_memory_stats().memory_limit == 0);
+  if (use_heap_memory) {
+    compile(regexp_string.c_str(), regexp_string.size(), function, file);
+    return;
+  }
 
-    regexp_cache->set_value(regexp_string, re);
+  dl::CriticalSectionGuard critical_section;
+  auto &cache = RegexpCache::get();
+  const regexp *re = cache.find(regexp_string);
+  if (re == nullptr) {
+    const auto compile_start = std::chrono::steady_clock::now();
+    auto *compiled = new regexp();
+    compiled->use_heap_memory = true;
+    compiled->compile(regexp_string.c_str(), regexp_string.size(), function, file);
+    if (compiled->pcre_regexp == nullptr && compiled->RE2_regexp == nullptr) {
+      // the warning is already given, the invalid patterns aren't cached and this regexp stays empty as well
+      delete compiled;
+      return;
+    }
+    const std::chrono::duration<double> compile_time = std::chrono::steady_clock::now() - compile_start;
+    cache.insert(regexp_string, compiled, compile_time.count());
+    re = compiled;
   }
+
+  copy_compiled_from(*re);
+}
+
+void regexp::copy_compiled_from(const regexp &other) noexcept {
+  php_assert (other.use_heap_memory && !other.is_cached);
+
+  subpatterns_count = other.subpatterns_count;
+  named_subpatterns_count = other.named_subpatterns_count;
+  is_utf8 = other.is_utf8;
+  use_heap_memory = true;
+  is_cached = true;
+
+  subpattern_names = other.subpattern_names;
+
+  pcre_regexp = other.pcre_regexp;
+  pcre_regexp_extra = other.pcre_regexp_extra;
+  RE2_regexp = other.RE2_regexp;
+
+  regex_compilation_warning = other.regex_compilation_warning;
 }
 
 void regexp::init(const char *regexp_string, int64_t regexp_len, const char *function, const char *file) {
+  use_heap_memory = (dl::get_script_memory_stats().memory_limit == 0);
+  compile(regexp_string, regexp_len, function, file);
+}
+
+void regexp::compile(const char *regexp_string, int64_t regexp_len, const char *function, const char *file) {
   if (regexp_len == 0) {
     pattern_compilation_warning(function, file, "Empty regular expression");
     return;
@@ -389,8 +506,6 @@ void regexp::init(const char *regexp_string, int64_t regexp_len, const char *fun
 
   static_SB.clean().append(regexp_string + 1, static_cast<size_t>(regexp_end - 1));
 
-  use_heap_memory = (dl::get_script_memory_stats().memory_limit == 0);
-
   auto malloc_replacement_guard = make_malloc_replacement_with_script_allocator(!use_heap_memory);
 
   is_utf8 = false;
@@ -493,6 +608,10 @@ void regexp::init(const char *regexp_string, int64_t regexp_len, const char *fun
       clean();
       return;
     }
+
+    if (use_heap_memory) {
+      study_pcre_regexp();
+    }
   }
 
   //compile has finished
@@ -517,18 +636,19 @@ void regexp::init(const char *regexp_string, int64_t regexp_len, const char *fun
 
         for (int64_t i = 0; i < named_subpatterns_count; i++) {
           int64_t name_id = (((unsigned char)name_table[0]) << 8) + (unsigned char)name_table[1];
-          string name(name_table + 2);
-
-          if (use_heap_memory) {
-            name.set_reference_counter_to(ExtraRefCnt::for_global_const);
-          }
+          const char *name = name_table + 2;
+          const auto name_len = static_cast<string::size_type>(strlen(name));
+          name_table += name_entry_size;
 
-          if (name.is_int()) {
+          if (php_is_int(name, name_len)) {
             pattern_compilation_warning(function, file, "Numeric named subpatterns are not allowed");
+          } else if (use_heap_memory) {
+            // the names must outlive the script memory, they are freed in regexp::clean()
+            const size_t name_memory_size = string::inner_sizeof() + name_len + 1;
+            subpattern_names[name_id] = string::make_const_string_on_memory(name, name_len, malloc(name_memory_size), name_memory_size);
           } else {
-            subpattern_names[name_id] = name;
+            subpattern_names[name_id] = string(name, name_len);
           }
-          name_table += name_entry_size;
         }
       }
     }
@@ -537,6 +657,8 @@ void regexp::init(const char *regexp_string, int64_t regexp_len, const char *fun
 
   if (subpatterns_count > MAX_SUBPATTERNS) {
     pattern_compilation_warning(function, file, "Maximum number of subpatterns %d exceeded, %d subpatterns found", MAX_SUBPATTERNS, subpatterns_count);
+    // the heap names are freed by clean(), it has to see them and their count
+    clean();
     subpatterns_count = 0;
 
     delete RE2_regexp;
@@ -544,24 +666,54 @@ void regexp::init(const char *regexp_string, int64_t regexp_len, const char *fun
 
     delete[] subpattern_names;
     subpattern_names = nullptr;
-    clean();
     return;
   }
 }
 
+void regexp::study_pcre_regexp() noexcept {
+  php_assert (use_heap_memory && pcre_regexp);
+
+  const char *error = nullptr;
+  pcre_regexp_extra = pcre_study(pcre_regexp, PCRE_STUDY_JIT_COMPILE, &error);
+  if (pcre_regexp_extra == nullptr) {
+    // nothing to study or JIT is not supported, the default extra will be used
+    return;
+  }
+
+  pcre_regexp_extra->flags |= PCRE_EXTRA_MATCH_LIMIT | PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+  pcre_regexp_extra->match_limit = PCRE_BACKTRACK_LIMIT;
+  pcre_regexp_extra->match_limit_recursion = PCRE_RECURSION_LIMIT;
+  if (pcre_jit_stack *jit_stack = get_pcre_jit_stack()) {
+    pcre_assign_jit_stack(pcre_regexp_extra, nullptr, jit_stack);
+  }
+}
+
 void regexp::clean() {
-  if (!use_heap_memory) {
-    // Regexp is stored inside a static cache, see regexp_cache_storage
+  if (!use_heap_memory || is_cached) {
+    // Regexp is owned by the worker regexp cache, see RegexpCache
     return;
   }
 
   php_assert(!dl::is_malloc_replaced());
 
+  if (subpattern_names != nullptr) {
+    for (int64_t i = 0; i < subpatterns_count; i++) {
+      if (!subpattern_names[i].empty()) {
+        free(const_cast<char *>(subpattern_names[i].c_str()) - string::inner_sizeof());
+      }
+    }
+  }
+
   subpatterns_count = 0;
   named_subpatterns_count = 0;
   is_utf8 = false;
   use_heap_memory = false;
 
+  if (pcre_regexp_extra != nullptr) {
+    pcre_free_study(pcre_regexp_extra);
+    pcre_regexp_extra = nullptr;
+  }
+
   if (pcre_regexp != nullptr) {
     pcre_free(pcre_regexp);
     pcre_regexp = nullptr;
@@ -576,7 +728,9 @@ void regexp::clean() {
 
 regexp::~regexp() {
   clean();
-  free(regex_compilation_warning);
+  if (!is_cached) {
+    free(regex_compilation_warning);
+  }
 }
 
 
@@ -615,7 +769,7 @@ int64_t regexp::exec(const string &subject, int64_t offset, bool second_try) con
 
   int32_t options = second_try ? PCRE_NO_UTF8_CHECK | PCRE_NOTEMPTY_ATSTART : PCRE_NO_UTF8_CHECK;
   dl::enter_critical_section();//OK
-  int64_t count = pcre_exec(pcre_regexp, &extra, subject.c_str(), subject.size(),
+  int64_t count = pcre_exec(pcre_regexp, pcre_regexp_extra ? pcre_regexp_extra : &extra, subject.c_str(), subject.size(),
                             static_cast<int32_t>(offset), options, submatch, 3 * subpatterns_count);
   dl::leave_critical_section();
 
@@ -1005,6 +1159,8 @@ int64_t regexp::last_error() {
       return PHP_PCRE_RECURSION_LIMIT_ERROR;
     case PCRE_ERROR_BADUTF8:
       return PHP_PCRE_BAD_UTF8_ERROR;
+    case PCRE_ERROR_JIT_STACKLIMIT:
+      return PHP_PCRE_JIT_STACKLIMIT_ERROR;
     default:
       php_assert (0);
       exit(1);
@@ -1064,9 +1220,23 @@ void regexp::global_init() {
   extra.flags = PCRE_EXTRA_MATCH_LIMIT | PCRE_EXTRA_MATCH_LIMIT_RECURSION;
   extra.match_limit = PCRE_BACKTRACK_LIMIT;
   extra.match_limit_recursion = PCRE_RECURSION_LIMIT;
+  // allocate the JIT stack before forking, so the workers don't do it during the script execution
+  get_pcre_jit_stack();
 }
 
 void global_init_regexp_lib() {
   regexp::global_init();
 }
 
+void set_regexp_cache_max_entries(size_t max_entries) noexcept {
+  RegexpCache::get().set_max_entries(max_entries);
+}
+
+const RegexpCacheStats &regexp_cache_get_stats() noexcept {
+  return RegexpCache::get().get_stats();
+}
+
+std::vector<RegexpCachePatternStats> regexp_cache_get_hottest_patterns(size_t limit) noexcept {
+  return RegexpCache::get().get_hottest_patterns(limit);
+}
+
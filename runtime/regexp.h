@@ -5,6 +5,8 @@
 #pragma once
 
 #include <pcre.h>
+#include <string>
+#include <vector>
 
 #include "common/mixin/not_copyable.h"
 
@@ -30,6 +32,9 @@ constexpr int64_t PREG_SPLIT_OFFSET_CAPTURE = 32;
 constexpr int64_t PCRE_RECURSION_LIMIT = 100000;
 constexpr int64_t PCRE_BACKTRACK_LIMIT = 1000000;
 
+constexpr int32_t PCRE_JIT_STACK_MIN_SIZE = 32 * 1024;
+constexpr int32_t PCRE_JIT_STACK_MAX_SIZE = 1024 * 1024;
+
 constexpr int32_t MAX_SUBPATTERNS = 512;
 
 enum {
@@ -38,6 +43,21 @@ enum {
   PHP_PCRE_BACKTRACK_LIMIT_ERROR,
   PHP_PCRE_RECURSION_LIMIT_ERROR,
   PHP_PCRE_BAD_UTF8_ERROR,
+  PHP_PCRE_JIT_STACKLIMIT_ERROR = 6,
+};
+
+struct RegexpCacheStats {
+  int64_t hits{0};
+  int64_t misses{0};
+  int64_t evictions{0};
+  int64_t entries{0};
+  double compile_time{0};
+};
+
+struct RegexpCachePatternStats {
+  std::string pattern;
+  int64_t hits{0};
+  double compile_time{0};
 };
 
 class regexp : vk::not_copyable {
@@ -46,16 +66,23 @@ private:
   int32_t named_subpatterns_count{0};
   bool is_utf8{false};
   bool use_heap_memory{false};
+  // compiled data is owned by the worker regexp cache and must not be freed, see regexp::init(const string &)
+  bool is_cached{false};
 
   string *subpattern_names{nullptr};
 
   pcre *pcre_regexp{nullptr};
+  pcre_extra *pcre_regexp_extra{nullptr};
   re2::RE2 *RE2_regexp{nullptr};
 
   char *regex_compilation_warning{nullptr};
 
   void clean();
 
+  void compile(const char *regexp_string, int64_t regexp_len, const char *function, const char *file);
+  void study_pcre_regexp() noexcept;
+  void copy_compiled_from(const regexp &other) noexcept;
+
   int64_t exec(const string &subject, int64_t offset, bool second_try) const;
 
   bool is_valid_RE2_regexp(const char *regexp_string, int64_t regexp_len, bool is_utf8, const char *function, const char *file) noexcept;
@@ -102,6 +129,10 @@ public:
 
 void global_init_regexp_lib();
 
+void set_regexp_cache_max_entries(size_t max_entries) noexcept;
+const RegexpCacheStats &regexp_cache_get_stats() noexcept;
+std::vector<RegexpCachePatternStats> regexp_cache_get_hottest_patterns(size_t limit) noexcept;
+
 inline void preg_add_match(array<mixed> &v, const mixed &match, const string &name);
 inline void preg_add_match(array<string> &v, const string &match, const string &name);
 
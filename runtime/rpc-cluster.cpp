@@ -0,0 +1,203 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "runtime/rpc-cluster.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr uint32_t RpcLatencyEstimator::WARMUP_SAMPLES;
+
+constexpr double RpcTargets::OUTLIER_LATENCY_FACTOR;
+constexpr double RpcTargets::OUTLIER_MIN_LATENCY_GAP;
+constexpr uint32_t RpcTargets::OUTLIER_CONSECUTIVE_ERRORS;
+constexpr double RpcTargets::EJECTION_TIME;
+constexpr double RpcTargets::MIN_HEDGE_DELAY;
+constexpr double RpcTargets::MAX_HEDGES_RATIO;
+
+void RpcLatencyEstimator::add(double latency) noexcept {
+  latency = std::max(latency, 0.0);
+  if (samples_ == 0) {
+    mean_ = latency;
+    deviation_ = latency / 2;
+  } else {
+    deviation_ = 0.75 * deviation_ + 0.25 * std::fabs(mean_ - latency);
+    mean_ = 0.875 * mean_ + 0.125 * latency;
+  }
+  ++samples_;
+}
+
+void RpcTargets::Target::eject(double now) noexcept {
+  ejected_until = now + EJECTION_TIME;
+  ++stats.ejections;
+}
+
+void RpcTargets::add_target(int32_t host_num, const std::string &name) {
+  if (host_num < 0) {
+    return;
+  }
+  if (static_cast<size_t>(host_num) >= targets_.size()) {
+    targets_.resize(static_cast<size_t>(host_num) + 1);
+  }
+  Target &target = targets_[host_num];
+  if (!target.registered) {
+    target.registered = true;
+    target.stats.name = name;
+  }
+}
+
+RpcTargets::Target *RpcTargets::find(int32_t host_num) noexcept {
+  return host_num >= 0 && static_cast<size_t>(host_num) < targets_.size() && targets_[host_num].registered ? &targets_[host_num] : nullptr;
+}
+
+const RpcTargets::Target *RpcTargets::find(int32_t host_num) const noexcept {
+  return host_num >= 0 && static_cast<size_t>(host_num) < targets_.size() && targets_[host_num].registered ? &targets_[host_num] : nullptr;
+}
+
+void RpcTargets::update_ejections(const int32_t *host_nums, size_t count, double now) noexcept {
+  size_t healthy = 0;
+  double best_latency = -1;
+  for (size_t i = 0; i < count; ++i) {
+    Target *target = find(host_nums[i]);
+    if (!target) {
+      continue;
+    }
+    if (target->ejected_until != 0 && !target->is_ejected(now)) {
+      // the replica is back on probation, the latency it had before the ejection doesn't matter
+      target->ejected_until = 0;
+      target->consecutive_errors = 0;
+      target->latency.reset();
+    }
+    if (!target->is_ejected(now)) {
+      ++healthy;
+      if (target->latency.is_warm() && (best_latency < 0 || target->latency.mean() < best_latency)) {
+        best_latency = target->latency.mean();
+      }
+    }
+  }
+  if (best_latency < 0) {
+    return;
+  }
+
+  const double outlier_latency = std::max(best_latency * OUTLIER_LATENCY_FACTOR, best_latency + OUTLIER_MIN_LATENCY_GAP);
+  for (size_t i = 0; i < count && healthy > 1; ++i) {
+    Target *target = find(host_nums[i]);
+    if (target && !target->is_ejected(now) && target->latency.is_warm() && target->latency.mean() > outlier_latency) {
+      target->eject(now);
+      --healthy;
+    }
+  }
+}
+
+int32_t RpcTargets::choose_primary(const int32_t *host_nums, size_t count, double now) noexcept {
+  update_ejections(host_nums, count, now);
+
+  int32_t candidates[RPC_CLUSTER_MAX_REPLICAS];
+  size_t candidates_count = 0;
+  for (size_t i = 0; i < count && candidates_count < RPC_CLUSTER_MAX_REPLICAS; ++i) {
+    const Target *target = find(host_nums[i]);
+    if (!target || !target->is_ejected(now)) {
+      candidates[candidates_count++] = host_nums[i];
+    }
+  }
+  if (candidates_count == 0) {
+    candidates_count = std::min(count, RPC_CLUSTER_MAX_REPLICAS);
+    std::copy(host_nums, host_nums + candidates_count, candidates);
+  }
+  if (candidates_count == 0) {
+    return -1;
+  }
+
+  // the power of two random choices: the load is spread over the replicas, but the faster ones get more of it;
+  // the replicas with unknown latency are preferred to get it known
+  const auto score = [this](int32_t host_num) {
+    const Target *target = find(host_num);
+    return target && target->latency.is_warm() ? target->latency.mean() : 0.0;
+  };
+  int32_t chosen = candidates[random_() % candidates_count];
+  if (candidates_count > 1) {
+    const int32_t other = candidates[random_() % candidates_count];
+    if (score(other) < score(chosen)) {
+      chosen = other;
+    }
+  }
+
+  ++total_queries_;
+  if (Target *target = find(chosen)) {
+    ++target->stats.queries;
+  }
+  return chosen;
+}
+
+int32_t RpcTargets::choose_hedge(const int32_t *host_nums, size_t count, int32_t primary_host_num, double now) noexcept {
+  int32_t chosen = -1;
+  double chosen_latency = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (host_nums[i] == primary_host_num) {
+      continue;
+    }
+    const Target *target = find(host_nums[i]);
+    if (target && target->is_ejected(now)) {
+      continue;
+    }
+    const double latency = target && target->latency.is_warm() ? target->latency.mean() : 0.0;
+    if (chosen == -1 || latency < chosen_latency) {
+      chosen = host_nums[i];
+      chosen_latency = latency;
+    }
+  }
+  return chosen;
+}
+
+double RpcTargets::get_hedge_delay(int32_t host_num) const noexcept {
+  const Target *target = find(host_num);
+  if (!target || !target->latency.is_warm() || total_hedges_ >= total_queries_ * MAX_HEDGES_RATIO) {
+    return -1;
+  }
+  return std::max(target->latency.p95(), MIN_HEDGE_DELAY);
+}
+
+void RpcTargets::on_answer(int32_t host_num, double latency) noexcept {
+  if (Target *target = find(host_num)) {
+    target->latency.add(latency);
+    target->consecutive_errors = 0;
+  }
+}
+
+void RpcTargets::on_error(int32_t host_num, double now) noexcept {
+  if (Target *target = find(host_num)) {
+    ++target->stats.errors;
+    if (++target->consecutive_errors >= OUTLIER_CONSECUTIVE_ERRORS && !target->is_ejected(now)) {
+      target->consecutive_errors = 0;
+      target->eject(now);
+    }
+  }
+}
+
+void RpcTargets::on_hedge(int32_t host_num) noexcept {
+  ++total_hedges_;
+  if (Target *target = find(host_num)) {
+    ++target->stats.hedges;
+  }
+}
+
+void RpcTargets::on_hedge_win(int32_t host_num) noexcept {
+  if (Target *target = find(host_num)) {
+    ++target->stats.hedge_wins;
+  }
+}
+
+std::vector<RpcTargetStats> RpcTargets::get_stats(double now) const {
+  std::vector<RpcTargetStats> result;
+  for (const Target &target : targets_) {
+    if (!target.registered) {
+      continue;
+    }
+    result.emplace_back(target.stats);
+    result.back().latency_mean = target.latency.mean();
+    result.back().latency_p95 = target.latency.p95();
+    result.back().ejected = target.is_ejected(now);
+  }
+  return result;
+}
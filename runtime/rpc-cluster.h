@@ -0,0 +1,124 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/mixin/not_copyable.h"
+
+constexpr size_t RPC_CLUSTER_MAX_REPLICAS = 8;
+
+// Smoothed reply latency of an rpc target, the same estimator TCP uses for the retransmission timeout.
+class RpcLatencyEstimator {
+public:
+  static constexpr uint32_t WARMUP_SAMPLES = 8;
+
+  void add(double latency) noexcept;
+
+  void reset() noexcept {
+    *this = RpcLatencyEstimator{};
+  }
+
+  bool is_warm() const noexcept {
+    return samples_ >= WARMUP_SAMPLES;
+  }
+
+  double mean() const noexcept {
+    return mean_;
+  }
+
+  double deviation() const noexcept {
+    return deviation_;
+  }
+
+  // the latencies are far from being normally distributed, it is a rough upper estimate
+  double p95() const noexcept {
+    return mean_ + 2 * deviation_;
+  }
+
+private:
+  double mean_{0};
+  double deviation_{0};
+  uint32_t samples_{0};
+};
+
+struct RpcTargetStats {
+  std::string name;
+  int64_t queries{0};
+  int64_t errors{0};
+  // the hedge queries sent to the target and the ones of them which were answered before the primary query
+  int64_t hedges{0};
+  int64_t hedge_wins{0};
+  int64_t ejections{0};
+  double latency_mean{0};
+  double latency_p95{0};
+  bool ejected{false};
+};
+
+// Worker-lifetime registry of the replicas of the rpc cluster connections, keyed by host_num.
+// It chooses the replicas for the queries and the hedge queries and temporarily ejects the outliers.
+class RpcTargets : vk::not_copyable {
+public:
+  // a replica is ejected if it is that many times slower than the best one
+  static constexpr double OUTLIER_LATENCY_FACTOR = 3;
+  // and the difference is noticeable
+  static constexpr double OUTLIER_MIN_LATENCY_GAP = 0.005;
+  static constexpr uint32_t OUTLIER_CONSECUTIVE_ERRORS = 5;
+  static constexpr double EJECTION_TIME = 10;
+  static constexpr double MIN_HEDGE_DELAY = 0.001;
+  // the hedge queries are limited not to double the load on the cluster which is slow as a whole
+  static constexpr double MAX_HEDGES_RATIO = 0.1;
+
+  static RpcTargets &get() noexcept {
+    static RpcTargets targets;
+    return targets;
+  }
+
+  RpcTargets() = default;
+
+  void add_target(int32_t host_num, const std::string &name);
+
+  // the ejected replicas are skipped, unless all of them are ejected
+  int32_t choose_primary(const int32_t *host_nums, size_t count, double now) noexcept;
+  // returns -1 if there is no other replica to hedge the query to
+  int32_t choose_hedge(const int32_t *host_nums, size_t count, int32_t primary_host_num, double now) noexcept;
+  // returns a negative value if the query shouldn't be hedged
+  double get_hedge_delay(int32_t host_num) const noexcept;
+
+  void on_answer(int32_t host_num, double latency) noexcept;
+  void on_error(int32_t host_num, double now) noexcept;
+  void on_hedge(int32_t host_num) noexcept;
+  void on_hedge_win(int32_t host_num) noexcept;
+
+  std::vector<RpcTargetStats> get_stats(double now) const;
+
+private:
+  struct Target {
+    bool registered{false};
+    RpcTargetStats stats;
+    RpcLatencyEstimator latency;
+    uint32_t consecutive_errors{0};
+    double ejected_until{0};
+
+    bool is_ejected(double now) const noexcept {
+      return ejected_until > now;
+    }
+
+    void eject(double now) noexcept;
+  };
+
+  Target *find(int32_t host_num) noexcept;
+  const Target *find(int32_t host_num) const noexcept;
+  void update_ejections(const int32_t *host_nums, size_t count, double now) noexcept;
+
+  std::vector<Target> targets_;
+  int64_t total_queries_{0};
+  int64_t total_hedges_{0};
+  std::minstd_rand random_;
+};
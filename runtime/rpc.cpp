@@ -8,6 +8,8 @@
 
 #include "common/rpc-error-codes.h"
 #include "common/tl/constants/common.h"
+#include "common/tl/methods/compression.h"
+#include "common/tl/methods/zstd-dictionaries.h"
 
 #include "runtime/critical_section.h"
 #include "runtime/exception.h"
@@ -45,6 +47,8 @@ static const char *last_rpc_error;
 static const int32_t *rpc_data_begin;
 static const int32_t *rpc_data;
 static int32_t rpc_data_len;
+// the string being parsed is shared, not copied: the net layer lays the answers out as strings (see dl_allocate_safe),
+// so an answer is fetched right from the buffer the network message was read to
 static string rpc_data_copy;
 static string rpc_filename;
 
@@ -370,6 +374,7 @@ static inline const char *f$fetch_string_raw(int *string_len) {
   return str;
 }
 
+// a string owns its buffer with the header right before the data, so it can't reference a part of the answer
 string f$fetch_string() {
   int result_len = 0;
   const char *str = TRY_CALL(const char*, string, f$fetch_string_raw(&result_len));
@@ -444,13 +449,59 @@ class_instance<C$RpcConnection> f$new_rpc_connection(const string &host_name, in
                                         timeout_convert_to_ms(connect_timeout), timeout_convert_to_ms(reconnect_timeout));
 }
 
+class_instance<C$RpcConnection> f$new_rpc_cluster_connection(const array<string> &host_names, int64_t port, const mixed &default_actor_id, double timeout, double connect_timeout, double reconnect_timeout) {
+  if (host_names.count() > RPC_CLUSTER_MAX_REPLICAS) {
+    php_warning("Too many replicas in the rpc cluster connection: %" PRIi64 ", only the first %zu are used", host_names.count(), RPC_CLUSTER_MAX_REPLICAS);
+  }
+
+  std::array<int32_t, RPC_CLUSTER_MAX_REPLICAS> replicas{};
+  size_t replicas_count = 0;
+  for (auto it = host_names.begin(); it != host_names.end() && replicas_count < RPC_CLUSTER_MAX_REPLICAS; ++it) {
+    const string &host_name = it.get_value();
+    int32_t host_num = rpc_connect_to(host_name.c_str(), static_cast<int32_t>(port));
+    if (host_num < 0) {
+      continue;
+    }
+    {
+      dl::CriticalSectionGuard critical_section;
+      RpcTargets::get().add_target(host_num, std::string{host_name.c_str(), host_name.size()} + ":" + std::to_string(port));
+    }
+    replicas[replicas_count++] = host_num;
+  }
+  if (replicas_count == 0) {
+    return {};
+  }
+
+  auto conn = make_instance<C$RpcConnection>(replicas[0], static_cast<int32_t>(port), timeout_convert_to_ms(timeout),
+                                             store_parse_number<long long>(default_actor_id),
+                                             timeout_convert_to_ms(connect_timeout), timeout_convert_to_ms(reconnect_timeout));
+  conn.get()->replicas = replicas;
+  conn.get()->replicas_count = static_cast<int32_t>(replicas_count);
+  return conn;
+}
+
+void f$rpc_set_compression(const class_instance<C$RpcConnection> &conn, int64_t compression_version) {
+  if (unlikely(conn.is_null())) {
+    php_warning("Wrong RpcConnection specified");
+    return;
+  }
+  if (compression_version != COMPRESSION_VERSION_NONE && compression_version != COMPRESSION_VERSION_ZSTD && compression_version != COMPRESSION_VERSION_ZSTD_DICT) {
+    php_warning("Unsupported rpc compression version %" PRIi64, compression_version);
+    return;
+  }
+  conn.get()->compression_version = static_cast<int32_t>(compression_version);
+}
+
 static string_buffer data_buf;
-static const int data_buf_header_size = 2 * sizeof(long long) + 4 * sizeof(int);
-static const int data_buf_header_reserved_size = sizeof(long long) + sizeof(int);
+static const int data_buf_header_size = 2 * sizeof(long long) + 6 * sizeof(int);
+static const int data_buf_header_reserved_size = sizeof(long long) + 3 * sizeof(int);
 
 bool rpc_stored;
 static int64_t rpc_pack_threshold;
 static int64_t rpc_pack_from;
+static int64_t rpc_zstd_pack_threshold;
+// the compression version supported by the client of the current rpc query
+static int32_t rpc_client_compression_version;
 
 void estimate_and_flush_overflow(size_t &bytes_sent) {
   // estimate
@@ -465,6 +516,14 @@ void f$store_gzip_pack_threshold(int64_t pack_threshold_bytes) {
   rpc_pack_threshold = pack_threshold_bytes;
 }
 
+void f$store_zstd_pack_threshold(int64_t pack_threshold_bytes) {
+  rpc_zstd_pack_threshold = pack_threshold_bytes;
+}
+
+void set_rpc_client_compression_version(int32_t compression_version) {
+  rpc_client_compression_version = compression_version;
+}
+
 void f$store_start_gzip_pack() {
   rpc_pack_from = data_buf.size();
 }
@@ -487,6 +546,40 @@ void f$store_finish_gzip_pack(int64_t threshold) {
   rpc_pack_from = -1;
 }
 
+// unlike gzip_packed, the whole answer is compressed and it is told in its header,
+// so it is used only when the client has declared it supports the compression
+static bool store_finish_zstd_pack(int64_t threshold) {
+  const int32_t version = std::min(rpc_client_compression_version, COMPRESSION_VERSION_ZSTD_DICT);
+  if (rpc_pack_from == -1 || threshold <= 0 || version < COMPRESSION_VERSION_ZSTD) {
+    return false;
+  }
+  const int64_t answer_size = data_buf.size() - rpc_pack_from;
+  php_assert (rpc_pack_from % sizeof(int) == 0 && 0 <= rpc_pack_from && 0 <= answer_size);
+  const char *answer_begin = data_buf.c_str() + rpc_pack_from;
+  if (answer_size < threshold || *reinterpret_cast<const uint32_t *>(answer_begin) == TL_REQ_RESULT_HEADER) {
+    return false;
+  }
+
+  const int capacity = ZstdDictionaries::pack_bound(static_cast<int>(answer_size));
+  static_SB.clean().reserve(capacity);
+  int packed_size = -1;
+  {
+    dl::CriticalSectionGuard critical_section;
+    packed_size = ZstdDictionaries::get().pack(answer_begin, static_cast<int>(answer_size), static_SB.buffer(), capacity, version);
+  }
+  if (packed_size < 0 || packed_size + 3 * sizeof(int) >= answer_size) {
+    return false;
+  }
+
+  data_buf.set_pos(rpc_pack_from);
+  store_int(TL_REQ_RESULT_HEADER);
+  store_int(vk::tl::common::rpc_req_result_extra_flags::compression_version);
+  store_int(version);
+  data_buf.append(static_SB.buffer(), packed_size);
+  rpc_pack_from = -1;
+  return true;
+}
+
 
 template<class T>
 inline bool store_raw(T v) {
@@ -674,8 +767,10 @@ bool f$store_finish() {
 
 bool f$rpc_clean(bool is_error) {
   data_buf.clean();
-  store_int(-1); //reserve for TL_RPC_DEST_ACTOR
+  store_int(-1); //reserve for TL_RPC_DEST_ACTOR_FLAGS
   store_long(-1); //reserve for actor_id
+  store_int(-1); //reserve for flags
+  store_int(-1); //reserve for supported_compression_version
   store_int(-1); //reserve for length
   store_int(-1); //reserve for num
   store_int(-is_error); //reserve for type
@@ -692,7 +787,9 @@ bool rpc_store(bool is_error) {
 
   if (!is_error) {
     rpc_pack_from = data_buf_header_size;
-    f$store_finish_gzip_pack(rpc_pack_threshold);
+    if (!store_finish_zstd_pack(rpc_zstd_pack_threshold)) {
+      f$store_finish_gzip_pack(rpc_pack_threshold);
+    }
   }
 
   store_int(-1); // reserve for crc32
@@ -755,9 +852,9 @@ protected:
 
 /*
     if (request->resumable_id == -1) {
-      int len = *reinterpret_cast <int *>(request->answer - 12);
+      int len = *reinterpret_cast <int *>(request->answer - string::inner_sizeof());
       fprintf (stderr, "Receive  string of len %d at %p\n", len, request->answer);
-      for (int i = -12; i <= len; i++) {
+      for (int i = -static_cast<int>(string::inner_sizeof()); i <= len; i++) {
         fprintf (stderr, "%d: %x(%d)\t%c\n", i, request->answer[i], request->answer[i], request->answer[i] >= 32 ? request->answer[i] : '.');
       }
     }
@@ -805,6 +902,34 @@ public:
 
 static array<double> rpc_request_need_timer;
 
+// The queries to the cluster connections are hedged: if the chosen replica doesn't answer in its usual time,
+// the same query is sent to another one. The first answer is taken, the other one is dropped when it comes.
+struct rpc_cluster_query {
+  class_instance<C$RpcConnection> conn;
+  string request;
+  // the primary query and the hedge one
+  int32_t host_nums[2]{-1, -1};
+  slot_id_t request_ids[2]{-1, -1};
+  double send_times[2]{0, 0};
+  bool pending[2]{false, false};
+  bool answered{false};
+  double hedge_delay{-1};
+  double deadline{0};
+  event_timer *hedge_timer{nullptr};
+};
+
+// keyed by the primary request id, the request ids of both queries are mapped to it
+static array<rpc_cluster_query> rpc_cluster_queries;
+static array<int64_t> rpc_cluster_request_ids;
+
+static int hedge_wakeup_id = -1;
+
+// The queries sent shortly after the previous flush are not flushed at once, but are left in the net queue.
+// They are written to the connections together with the next flush or when the script waits for the network.
+static double rpc_coalescing_window;
+static double rpc_last_flush_time;
+static bool rpc_flush_postponed;
+
 static void process_rpc_timeout(int request_id) {
   process_rpc_error(request_id, TL_ERROR_QUERY_TIMEOUT, "Timeout in KPHP runtime");
 }
@@ -813,6 +938,139 @@ static void process_rpc_timeout(event_timer *timer) {
   return process_rpc_timeout(timer->wakeup_extra);
 }
 
+static rpc_request *register_rpc_request(slot_id_t request_id) {
+  if (dl::query_num != rpc_requests_last_query_num) {
+    rpc_requests_last_query_num = dl::query_num;
+    rpc_requests_size = 170;
+    rpc_requests = static_cast<rpc_request *>(dl::allocate(sizeof(rpc_request) * rpc_requests_size));
+
+    rpc_first_request_id = request_id;
+    rpc_first_array_request_id = request_id;
+    rpc_next_request_id = request_id + 1;
+    rpc_first_unfinished_request_id = request_id;
+    gotten_rpc_request.resumable_id = -3;
+    gotten_rpc_request.answer = nullptr;
+  } else {
+    php_assert (rpc_next_request_id == request_id);
+    rpc_next_request_id++;
+  }
+
+  if (request_id - rpc_first_array_request_id >= rpc_requests_size) {
+    php_assert (request_id - rpc_first_array_request_id == rpc_requests_size);
+    if (rpc_first_unfinished_request_id > rpc_first_array_request_id + rpc_requests_size / 2) {
+      memcpy(rpc_requests,
+             rpc_requests + rpc_first_unfinished_request_id - rpc_first_array_request_id,
+             sizeof(rpc_request) * (rpc_requests_size - (rpc_first_unfinished_request_id - rpc_first_array_request_id)));
+      rpc_first_array_request_id = rpc_first_unfinished_request_id;
+    } else {
+      rpc_requests = static_cast <rpc_request *> (dl::reallocate(rpc_requests, sizeof(rpc_request) * 2 * rpc_requests_size, sizeof(rpc_request) * rpc_requests_size));
+      rpc_requests_size *= 2;
+    }
+  }
+
+  return get_rpc_request(request_id);
+}
+
+static void register_rpc_cluster_query(const class_instance<C$RpcConnection> &conn, int32_t host_num, slot_id_t request_id,
+                                       const char *request, size_t request_size, double timeout) {
+  rpc_cluster_query query;
+  query.conn = conn;
+  query.request = string(request, static_cast<string::size_type>(request_size));
+  query.host_nums[0] = host_num;
+  query.request_ids[0] = request_id;
+  query.send_times[0] = get_precise_now();
+  query.pending[0] = true;
+  query.hedge_delay = RpcTargets::get().get_hedge_delay(host_num);
+  query.deadline = get_precise_now() + timeout;
+  rpc_cluster_queries.set_value(request_id, query);
+  rpc_cluster_request_ids.set_value(request_id, request_id);
+}
+
+// the query is actually sent now, the timers are started
+static void start_rpc_cluster_query(slot_id_t request_id, double timeout) {
+  if (!rpc_cluster_queries.has_key(request_id)) {
+    return;
+  }
+  rpc_cluster_query &query = rpc_cluster_queries[request_id];
+  query.send_times[0] = get_precise_now();
+  query.deadline = get_precise_now() + timeout;
+  if (query.hedge_delay > 0 && query.hedge_delay < timeout) {
+    php_assert (query.hedge_timer == nullptr);
+    query.hedge_timer = allocate_event_timer(query.hedge_delay + get_precise_now(), hedge_wakeup_id, request_id);
+  }
+}
+
+static void process_rpc_hedge_timeout(event_timer *timer) {
+  const slot_id_t request_id = timer->wakeup_extra;
+  remove_event_timer(timer);
+
+  rpc_cluster_query &query = rpc_cluster_queries[request_id];
+  query.hedge_timer = nullptr;
+  if (query.answered) {
+    return;
+  }
+
+  const double now = get_precise_now();
+  const C$RpcConnection *conn = query.conn.get();
+  const int32_t host_num = RpcTargets::get().choose_hedge(conn->replicas.data(), static_cast<size_t>(conn->replicas_count), query.host_nums[0], now);
+  if (host_num < 0 || query.deadline <= now) {
+    return;
+  }
+
+  const auto request_size = static_cast<size_t>(query.request.size());
+  void *p = dl::allocate(request_size);
+  memcpy(p, query.request.c_str(), request_size);
+  slot_id_t hedge_request_id = rpc_send_query(host_num, static_cast<char *>(p), static_cast<int>(request_size), timeout_convert_to_ms(query.deadline - now));
+  if (hedge_request_id <= 0) {
+    return;
+  }
+
+  // the hedge query has no resumable, its answer is passed to the primary one
+  rpc_request *hedge = register_rpc_request(hedge_request_id);
+  hedge->resumable_id = -3;
+  hedge->answer = nullptr;
+
+  query.host_nums[1] = host_num;
+  query.request_ids[1] = hedge_request_id;
+  query.send_times[1] = now;
+  query.pending[1] = true;
+  rpc_cluster_request_ids.set_value(hedge_request_id, request_id);
+  RpcTargets::get().on_hedge(host_num);
+}
+
+// returns the request to be finished with the reply, or -1 if the reply is to be dropped
+static int32_t process_rpc_cluster_reply(int32_t request_id, bool is_error, bool is_timeout) {
+  const int64_t *primary_request_id = rpc_cluster_request_ids.find_value(request_id);
+  if (primary_request_id == nullptr) {
+    return request_id;
+  }
+
+  rpc_cluster_query &query = rpc_cluster_queries[*primary_request_id];
+  const size_t i = query.request_ids[0] == request_id ? 0 : 1;
+  if (query.pending[i]) {
+    query.pending[i] = false;
+    if (is_error) {
+      RpcTargets::get().on_error(query.host_nums[i], get_precise_now());
+    } else {
+      RpcTargets::get().on_answer(query.host_nums[i], get_precise_now() - query.send_times[i]);
+    }
+  }
+
+  // either the other query has already won or it still may succeed, the timeout is common for both of them
+  if (query.answered || (is_error && !is_timeout && query.pending[1 - i])) {
+    return -1;
+  }
+  query.answered = true;
+  if (query.hedge_timer) {
+    remove_event_timer(query.hedge_timer);
+    query.hedge_timer = nullptr;
+  }
+  if (i == 1) {
+    RpcTargets::get().on_hedge_win(query.host_nums[1]);
+  }
+  return static_cast<int32_t>(*primary_request_id);
+}
+
 int64_t rpc_send(const class_instance<C$RpcConnection> &conn, double timeout, bool ignore_answer) {
   if (unlikely (conn.is_null() || conn.get()->host_num < 0)) {
     php_warning("Wrong RpcConnection specified");
@@ -827,14 +1085,30 @@ int64_t rpc_send(const class_instance<C$RpcConnection> &conn, double timeout, bo
   php_assert (data_buf.size() % sizeof(int) == 0);
 
   int reserved = data_buf_header_reserved_size;
-  if (conn.get()->default_actor_id) {
+  const long long actor_id = conn.get()->default_actor_id;
+  const int32_t compression_version = conn.get()->compression_version;
+  if (actor_id || compression_version != COMPRESSION_VERSION_NONE) {
     const char *answer_begin = data_buf.c_str() + data_buf_header_size;
     int x = *(int *)answer_begin;
     if (x != TL_RPC_DEST_ACTOR && x != TL_RPC_DEST_ACTOR_FLAGS) {
-      reserved -= (int)(sizeof(int) + sizeof(long long));
+      // the destination header stored by the script is kept as is, so the compression is declared only in the added one
+      const bool declare_compression = compression_version != COMPRESSION_VERSION_NONE && x != TL_RPC_DEST_FLAGS;
+      const char *header_begin = answer_begin;
+      if (declare_compression) {
+        header_begin -= 2 * sizeof(int);
+        *(int *)header_begin = vk::tl::common::rpc_invoke_req_extra_flags::supported_compression_version;
+        *(int *)(header_begin + sizeof(int)) = compression_version;
+      }
+      if (actor_id) {
+        header_begin -= sizeof(int) + sizeof(long long);
+        *(int *)header_begin = declare_compression ? TL_RPC_DEST_ACTOR_FLAGS : TL_RPC_DEST_ACTOR;
+        *(long long *)(header_begin + sizeof(int)) = actor_id;
+      } else if (declare_compression) {
+        header_begin -= sizeof(int);
+        *(int *)header_begin = TL_RPC_DEST_FLAGS;
+      }
+      reserved -= (int)(answer_begin - header_begin);
       php_assert (reserved >= 0);
-      *(int *)(answer_begin - sizeof(int) - sizeof(long long)) = TL_RPC_DEST_ACTOR;
-      *(long long *)(answer_begin - sizeof(long long)) = conn.get()->default_actor_id;
     }
   }
 
@@ -842,41 +1116,18 @@ int64_t rpc_send(const class_instance<C$RpcConnection> &conn, double timeout, bo
   void *p = dl::allocate(request_size);
   memcpy(p, data_buf.c_str() + reserved, request_size);
 
-  slot_id_t result = rpc_send_query(conn.get()->host_num, (char *)p, (int)request_size, timeout_convert_to_ms(timeout));
-  if (result <= 0) {
-    return -1;
+  const bool is_cluster = conn.get()->replicas_count > 1;
+  int32_t host_num = conn.get()->host_num;
+  if (is_cluster) {
+    host_num = RpcTargets::get().choose_primary(conn.get()->replicas.data(), static_cast<size_t>(conn.get()->replicas_count), get_precise_now());
   }
 
-  if (dl::query_num != rpc_requests_last_query_num) {
-    rpc_requests_last_query_num = dl::query_num;
-    rpc_requests_size = 170;
-    rpc_requests = static_cast<rpc_request *>(dl::allocate(sizeof(rpc_request) * rpc_requests_size));
-
-    rpc_first_request_id = result;
-    rpc_first_array_request_id = result;
-    rpc_next_request_id = result + 1;
-    rpc_first_unfinished_request_id = result;
-    gotten_rpc_request.resumable_id = -3;
-    gotten_rpc_request.answer = nullptr;
-  } else {
-    php_assert (rpc_next_request_id == result);
-    rpc_next_request_id++;
-  }
-
-  if (result - rpc_first_array_request_id >= rpc_requests_size) {
-    php_assert (result - rpc_first_array_request_id == rpc_requests_size);
-    if (rpc_first_unfinished_request_id > rpc_first_array_request_id + rpc_requests_size / 2) {
-      memcpy(rpc_requests,
-             rpc_requests + rpc_first_unfinished_request_id - rpc_first_array_request_id,
-             sizeof(rpc_request) * (rpc_requests_size - (rpc_first_unfinished_request_id - rpc_first_array_request_id)));
-      rpc_first_array_request_id = rpc_first_unfinished_request_id;
-    } else {
-      rpc_requests = static_cast <rpc_request *> (dl::reallocate(rpc_requests, sizeof(rpc_request) * 2 * rpc_requests_size, sizeof(rpc_request) * rpc_requests_size));
-      rpc_requests_size *= 2;
-    }
+  slot_id_t result = rpc_send_query(host_num, (char *)p, (int)request_size, timeout_convert_to_ms(timeout));
+  if (result <= 0) {
+    return -1;
   }
 
-  rpc_request *cur = get_rpc_request(result);
+  rpc_request *cur = register_rpc_request(result);
 
   cur->resumable_id = register_forked_resumable(new rpc_resumable(result, conn.get()->port, conn.get()->default_actor_id));
   cur->timer = nullptr;
@@ -887,32 +1138,62 @@ int64_t rpc_send(const class_instance<C$RpcConnection> &conn, double timeout, bo
     return resumable_id;
   } else {
     rpc_request_need_timer.set_value(result, timeout);
+    if (is_cluster) {
+      register_rpc_cluster_query(conn, host_num, result, data_buf.c_str() + reserved, request_size, timeout);
+    }
     return cur->resumable_id;
   }
 }
 
-void f$rpc_flush() {
-  update_precise_now();
-  wait_net(0);
-  update_precise_now();
+static void start_rpc_timers() {
   for (array<double>::iterator iter = rpc_request_need_timer.begin(); iter != rpc_request_need_timer.end(); ++iter) {
     int32_t id = static_cast<int32_t>(iter.get_key().to_int());
     rpc_request *cur = get_rpc_request(id);
     if (cur->resumable_id > 0) {
       php_assert (cur->timer == nullptr);
       cur->timer = allocate_event_timer(iter.get_value() + get_precise_now(), timeout_wakeup_id, id);
+      start_rpc_cluster_query(id, iter.get_value());
     }
   }
   rpc_request_need_timer.clear();
 }
 
+void f$rpc_flush() {
+  update_precise_now();
+  wait_net(0);
+  update_precise_now();
+  rpc_last_flush_time = get_precise_now();
+  rpc_flush_postponed = false;
+  start_rpc_timers();
+}
+
+void rpc_flush_coalesced() {
+  update_precise_now();
+  if (get_precise_now() - rpc_last_flush_time < rpc_coalescing_window) {
+    rpc_flush_postponed = true;
+    start_rpc_timers();
+    return;
+  }
+  f$rpc_flush();
+}
+
+void rpc_flush_postponed_queries() {
+  if (rpc_flush_postponed) {
+    f$rpc_flush();
+  }
+}
+
+void set_rpc_coalescing_window(double window) noexcept {
+  rpc_coalescing_window = window;
+}
+
 int64_t f$rpc_send(const class_instance<C$RpcConnection> &conn, double timeout) {
   int64_t request_id = rpc_send(conn, timeout);
   if (request_id <= 0) {
     return 0;
   }
 
-  f$rpc_flush();
+  rpc_flush_coalesced();
   return request_id;
 }
 
@@ -927,11 +1208,17 @@ int64_t f$rpc_send_noflush(const class_instance<C$RpcConnection> &conn, double t
 
 
 void process_rpc_answer(int32_t request_id, char *result, int32_t result_len __attribute__((unused))) {
+  request_id = process_rpc_cluster_reply(request_id, false, false);
+  if (request_id < 0) {
+    php_assert (result != nullptr);
+    dl::deallocate(result - string::inner_sizeof(), result_len + string::inner_sizeof() + 1);
+    return;
+  }
   rpc_request *request = get_rpc_request(request_id);
 
   if (request->resumable_id < 0) {
     php_assert (result != nullptr);
-    dl::deallocate(result - 12, result_len + 13);
+    dl::deallocate(result - string::inner_sizeof(), result_len + string::inner_sizeof() + 1);
     php_assert (request->resumable_id != -1);
     return;
   }
@@ -950,7 +1237,11 @@ void process_rpc_answer(int32_t request_id, char *result, int32_t result_len __a
   resumable_run_ready(resumable_id);
 }
 
-void process_rpc_error(int32_t request_id, int32_t error_code __attribute__((unused)), const char *error_message) {
+void process_rpc_error(int32_t request_id, int32_t error_code, const char *error_message) {
+  request_id = process_rpc_cluster_reply(request_id, true, error_code == TL_ERROR_QUERY_TIMEOUT);
+  if (request_id < 0) {
+    return;
+  }
   rpc_request *request = get_rpc_request(request_id);
 
   if (request->resumable_id < 0) {
@@ -1008,7 +1299,7 @@ protected:
       php_assert (res.resumable_id == -1);
 
       string result;
-      result.assign_raw(res.answer - 12);
+      result.assign_raw(res.answer - string::inner_sizeof());
       RETURN(result);
     RESUMABLE_END
   }
@@ -1081,7 +1372,7 @@ protected:
       php_assert (res.resumable_id == -1);
 
       string result;
-      result.assign_raw(res.answer - 12);
+      result.assign_raw(res.answer - string::inner_sizeof());
       bool parse_result = f$rpc_parse(result);
       php_assert(parse_result);
 
@@ -1285,7 +1576,7 @@ int64_t rpc_tl_query_impl(const class_instance<C$RpcConnection> &c, const mixed
     return 0;
   }
   if (flush) {
-    f$rpc_flush();
+    rpc_flush_coalesced();
   }
   if (ignore_answer) {
     return -1;
@@ -1355,7 +1646,7 @@ array<int64_t> f$rpc_tl_query(const class_instance<C$RpcConnection> &c, const ar
     result.set_value(it.get_key(), query_id);
   }
   if (bytes_sent > 0) {
-    f$rpc_flush();
+    rpc_flush_coalesced();
   }
 
   return result;
@@ -1522,9 +1813,10 @@ array<array<mixed>> f$rpc_tl_query_result_synchronously(const array<int64_t> &qu
 }
 
 void global_init_rpc_lib() {
-  php_assert (timeout_wakeup_id == -1);
+  php_assert (timeout_wakeup_id == -1 && hedge_wakeup_id == -1);
 
   timeout_wakeup_id = register_wakeup_callback(&process_rpc_timeout);
+  hedge_wakeup_id = register_wakeup_callback(&process_rpc_hedge_timeout);
 }
 
 static void reset_rpc_global_vars() {
@@ -1532,7 +1824,11 @@ static void reset_rpc_global_vars() {
   hard_reset_var(rpc_data_copy);
   hard_reset_var(rpc_data_copy_backup);
   hard_reset_var(rpc_request_need_timer);
+  hard_reset_var(rpc_cluster_queries);
+  hard_reset_var(rpc_cluster_request_ids);
   fail_rpc_on_int32_overflow = false;
+  rpc_last_flush_time = 0;
+  rpc_flush_postponed = false;
 }
 
 void init_rpc_lib() {
@@ -1551,6 +1847,7 @@ void init_rpc_lib() {
   rpc_stored = false;
 
   rpc_pack_threshold = -1;
+  rpc_zstd_pack_threshold = -1;
   rpc_pack_from = -1;
   rpc_filename = string("rpc.cpp", 7);
 }
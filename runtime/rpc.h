@@ -4,11 +4,13 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
 
 #include "runtime/integer_types.h"
 #include "runtime/kphp_core.h"
 #include "runtime/resumable.h"
+#include "runtime/rpc-cluster.h"
 
 extern const string tl_str_;
 extern const string tl_str_underscore;
@@ -108,6 +110,11 @@ struct C$RpcConnection final : public refcountable_php_classes<C$RpcConnection>
   long long default_actor_id{-1};
   int32_t connect_timeout{-1};
   int32_t reconnect_timeout{-1};
+  // the replicas of a cluster connection, host_num is the first of them
+  std::array<int32_t, RPC_CLUSTER_MAX_REPLICAS> replicas{};
+  int32_t replicas_count{0};
+  // the max compression version the engine may compress the answers with
+  int32_t compression_version{0};
 
   C$RpcConnection(int32_t host_num, int32_t port, int32_t tmeout_ms, long long default_actor_id, int32_t connect_timeout, int32_t reconnect_timeout);
 
@@ -116,8 +123,16 @@ struct C$RpcConnection final : public refcountable_php_classes<C$RpcConnection>
 
 class_instance<C$RpcConnection> f$new_rpc_connection(const string &host_name, int64_t port, const mixed &default_actor_id = 0, double timeout = 0.3, double connect_timeout = 0.3, double reconnect_timeout = 17);
 
+class_instance<C$RpcConnection> f$new_rpc_cluster_connection(const array<string> &host_names, int64_t port, const mixed &default_actor_id = 0, double timeout = 0.3, double connect_timeout = 0.3, double reconnect_timeout = 17);
+
+void f$rpc_set_compression(const class_instance<C$RpcConnection> &conn, int64_t compression_version);
+
 void f$store_gzip_pack_threshold(int64_t pack_threshold_bytes);
 
+void f$store_zstd_pack_threshold(int64_t pack_threshold_bytes);
+
+void set_rpc_client_compression_version(int32_t compression_version);
+
 void f$store_start_gzip_pack();
 
 void f$store_finish_gzip_pack(int64_t threshold);
@@ -168,6 +183,11 @@ int64_t rpc_send(const class_instance<C$RpcConnection> &conn, double timeout, bo
 int64_t f$rpc_send_noflush(const class_instance<C$RpcConnection> &conn, double timeout = -1.0);
 
 void f$rpc_flush();
+// flushes the sent queries unless the previous flush was within the coalescing window
+void rpc_flush_coalesced();
+// called when the script finishes, not to leave the queries unsent
+void rpc_flush_postponed_queries();
+void set_rpc_coalescing_window(double window) noexcept;
 
 Optional<string> f$rpc_get(int64_t request_id, double timeout = -1.0);
 
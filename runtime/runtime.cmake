@@ -40,6 +40,7 @@ prepend(KPHP_RUNTIME_SOURCES ${BASE_DIR}/runtime/
         regexp.cpp
         resumable.cpp
         rpc.cpp
+        rpc-cluster.cpp
         storage.cpp
         streams.cpp
         string_buffer.cpp
@@ -0,0 +1,407 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "runtime/allocator.h"
+
+// Sorting algorithms of the runtime arrays.
+// All of them take the compare function in the php style: compare(lhs, rhs) > 0 means that lhs should be placed after rhs.
+// User comparators (usort and its friends) may be inconsistent, therefore no algorithm here relies on the strict weak ordering
+// for staying in bounds: a bad comparator gives a strange order, but never crashes.
+
+namespace dl {
+
+// A comparator may declare (by specializing this template) that it orders int64_t or double values
+// just as the '>' operator does (ascending order) or as the '<' operator does (descending order).
+// Vectors of such values are sorted by the radix sort.
+enum class scalar_order {
+  unknown,
+  ascending,
+  descending
+};
+
+template<class Compare>
+struct scalar_order_of : std::integral_constant<scalar_order, scalar_order::unknown> {
+};
+
+namespace sort_impl_ {
+
+constexpr int64_t INSERTION_SORT_THRESHOLD = 24;
+constexpr int64_t NINTHER_THRESHOLD = 128;
+constexpr int64_t PARTIAL_INSERTION_SORT_LIMIT = 8;
+constexpr int64_t RADIX_SORT_THRESHOLD = 256;
+
+template<class T, class Compare>
+struct less_by {
+  const Compare &compare;
+
+  bool operator()(const T &lhs, const T &rhs) const {
+    return compare(rhs, lhs) > 0;
+  }
+};
+
+template<class T>
+inline void swap_values(T &lhs, T &rhs) {
+  using std::swap;
+  swap(lhs, rhs);
+}
+
+template<class T, class Less>
+void insertion_sort(T *begin, T *end, const Less &less) {
+  for (T *cur = begin + 1; cur < end; ++cur) {
+    if (less(*cur, cur[-1])) {
+      T tmp = std::move(*cur);
+      T *hole = cur;
+      do {
+        *hole = std::move(hole[-1]);
+        --hole;
+      } while (hole > begin && less(tmp, hole[-1]));
+      *hole = std::move(tmp);
+    }
+  }
+}
+
+// the same as insertion_sort, but gives up after PARTIAL_INSERTION_SORT_LIMIT moved elements
+template<class T, class Less>
+bool partial_insertion_sort(T *begin, T *end, const Less &less) {
+  int64_t moved = 0;
+  for (T *cur = begin + 1; cur < end; ++cur) {
+    if (less(*cur, cur[-1])) {
+      T tmp = std::move(*cur);
+      T *hole = cur;
+      do {
+        *hole = std::move(hole[-1]);
+        --hole;
+      } while (hole > begin && less(tmp, hole[-1]));
+      *hole = std::move(tmp);
+      moved += cur - hole;
+      if (moved > PARTIAL_INSERTION_SORT_LIMIT) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template<class T, class Less>
+void sift_down(T *heap, int64_t size, int64_t root, const Less &less) {
+  while (true) {
+    int64_t child = 2 * root + 1;
+    if (child >= size) {
+      return;
+    }
+    if (child + 1 < size && less(heap[child], heap[child + 1])) {
+      ++child;
+    }
+    if (!less(heap[root], heap[child])) {
+      return;
+    }
+    swap_values(heap[root], heap[child]);
+    root = child;
+  }
+}
+
+template<class T, class Less>
+void heap_sort(T *begin, T *end, const Less &less) {
+  const int64_t size = end - begin;
+  for (int64_t i = size / 2 - 1; i >= 0; --i) {
+    sift_down(begin, size, i, less);
+  }
+  for (int64_t i = size - 1; i > 0; --i) {
+    swap_values(begin[0], begin[i]);
+    sift_down(begin, i, 0, less);
+  }
+}
+
+template<class T, class Less>
+void sort3(T *a, T *b, T *c, const Less &less) {
+  if (less(*b, *a)) {
+    swap_values(*a, *b);
+  }
+  if (less(*c, *b)) {
+    swap_values(*b, *c);
+    if (less(*b, *a)) {
+      swap_values(*a, *b);
+    }
+  }
+}
+
+// moves the pivot to *begin; returns a pivot position and true if the range was already partitioned
+template<class T, class Less>
+std::pair<T *, bool> partition_right(T *begin, T *end, const Less &less) {
+  const T &pivot = *begin;
+  T *i = begin + 1;
+  T *j = end - 1;
+  bool already_partitioned = true;
+  while (true) {
+    while (i <= j && less(*i, pivot)) {
+      ++i;
+    }
+    while (i <= j && less(pivot, *j)) {
+      --j;
+    }
+    if (i >= j) {
+      break;
+    }
+    already_partitioned = false;
+    swap_values(*i++, *j--);
+  }
+  swap_values(*begin, *j);
+  return {j, already_partitioned};
+}
+
+// used when the pivot is equal to the element before the range, so it's the smallest element there:
+// puts all the elements equal to the pivot to the left part and returns the end of this part
+template<class T, class Less>
+T *partition_left(T *begin, T *end, const Less &less) {
+  const T &pivot = *begin;
+  T *i = begin + 1;
+  T *j = end - 1;
+  while (true) {
+    while (i <= j && !less(pivot, *i)) {
+      ++i;
+    }
+    while (i <= j && less(pivot, *j)) {
+      --j;
+    }
+    if (i >= j) {
+      break;
+    }
+    swap_values(*i++, *j--);
+  }
+  return i;
+}
+
+inline int64_t log2_floor(int64_t n) {
+  return 63 - __builtin_clzll(static_cast<uint64_t>(n));
+}
+
+// pattern-defeating quicksort, https://github.com/orlp/pdqsort
+template<class T, class Less>
+void pdq_sort_loop(T *begin, T *end, const Less &less, int64_t bad_allowed, bool leftmost) {
+  while (true) {
+    const int64_t size = end - begin;
+    if (size < INSERTION_SORT_THRESHOLD) {
+      insertion_sort(begin, end, less);
+      return;
+    }
+
+    T *middle = begin + size / 2;
+    if (size > NINTHER_THRESHOLD) {
+      sort3(begin, middle, end - 1, less);
+      sort3(begin + 1, middle - 1, end - 2, less);
+      sort3(begin + 2, middle + 1, end - 3, less);
+      sort3(middle - 1, middle, middle + 1, less);
+    } else {
+      sort3(begin, middle, end - 1, less);
+    }
+    swap_values(*begin, *middle);
+
+    // the element before the range is not greater than any element of the range;
+    // if it is equal to the pivot, there are many equal elements, which can be skipped at once
+    if (!leftmost && !less(begin[-1], *begin)) {
+      begin = partition_left(begin, end, less);
+      continue;
+    }
+
+    auto partition = partition_right(begin, end, less);
+    T *pivot = partition.first;
+    const int64_t left_size = pivot - begin;
+    const int64_t right_size = end - (pivot + 1);
+
+    if (left_size < size / 8 || right_size < size / 8) {
+      if (--bad_allowed == 0) {
+        heap_sort(begin, end, less);
+        return;
+      }
+      // break the possible patterns, which lead to the bad partitions
+      if (left_size >= INSERTION_SORT_THRESHOLD) {
+        swap_values(begin[0], begin[left_size / 4]);
+        swap_values(pivot[-1], pivot[-left_size / 4]);
+      }
+      if (right_size >= INSERTION_SORT_THRESHOLD) {
+        swap_values(pivot[1], pivot[1 + right_size / 4]);
+        swap_values(end[-1], end[-right_size / 4]);
+      }
+    } else if (partition.second &&
+               partial_insertion_sort(begin, pivot, less) &&
+               partial_insertion_sort(pivot + 1, end, less)) {
+      return;
+    }
+
+    // recurse into the smaller part, so the stack depth is O(log n)
+    if (left_size < right_size) {
+      pdq_sort_loop(begin, pivot, less, bad_allowed, leftmost);
+      begin = pivot + 1;
+      leftmost = false;
+    } else {
+      pdq_sort_loop(pivot + 1, end, less, bad_allowed, false);
+      end = pivot;
+    }
+  }
+}
+
+template<class T, class Less>
+void pdq_sort(T *begin, T *end, const Less &less) {
+  if (end - begin > 1) {
+    pdq_sort_loop(begin, end, less, log2_floor(end - begin), true);
+  }
+}
+
+inline uint64_t radix_key(int64_t value) {
+  return static_cast<uint64_t>(value) ^ (uint64_t{1} << 63);
+}
+
+inline uint64_t radix_key(double value) {
+  // -0.0 and 0.0 are equal for the comparators, the stable radix sort keeps them in the original order
+  if (value == 0) {
+    value = 0;
+  }
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return (bits >> 63) ? ~bits : bits | (uint64_t{1} << 63);
+}
+
+inline bool has_unordered_values(const int64_t *, const int64_t *) {
+  return false;
+}
+
+// NaN is neither less nor greater than anything, there is no radix order which would agree with the comparators
+inline bool has_unordered_values(const double *begin, const double *end) {
+  return std::any_of(begin, end, [](double value) { return value != value; });
+}
+
+// LSD radix sort by bytes, the passes where all the values have the same byte are skipped
+template<class T>
+void radix_sort(T *begin, T *end, bool descending) {
+  static_assert(std::is_trivially_copyable<T>{} && sizeof(T) == sizeof(uint64_t), "unexpected type");
+  const size_t size = end - begin;
+  const uint64_t key_mask = descending ? ~uint64_t{0} : 0;
+
+  uint32_t counts[sizeof(uint64_t)][256];
+  std::memset(counts, 0, sizeof(counts));
+  for (const T *it = begin; it != end; ++it) {
+    const uint64_t key = radix_key(*it) ^ key_mask;
+    for (size_t byte = 0; byte < sizeof(uint64_t); ++byte) {
+      ++counts[byte][(key >> (8 * byte)) & 0xff];
+    }
+  }
+
+  T *buffer = static_cast<T *>(dl::allocate(size * sizeof(T)));
+  T *src = begin;
+  T *dst = buffer;
+  for (size_t byte = 0; byte < sizeof(uint64_t); ++byte) {
+    const size_t shift = 8 * byte;
+    uint32_t *byte_counts = counts[byte];
+    if (byte_counts[((radix_key(*src) ^ key_mask) >> shift) & 0xff] == size) {
+      continue;
+    }
+
+    uint32_t offset = 0;
+    for (size_t digit = 0; digit < 256; ++digit) {
+      const uint32_t count = byte_counts[digit];
+      byte_counts[digit] = offset;
+      offset += count;
+    }
+    for (const T *it = src; it != src + size; ++it) {
+      dst[byte_counts[((radix_key(*it) ^ key_mask) >> shift) & 0xff]++] = *it;
+    }
+    std::swap(src, dst);
+  }
+
+  if (src != begin) {
+    std::memcpy(begin, src, size * sizeof(T));
+  }
+  dl::deallocate(buffer, size * sizeof(T));
+}
+
+template<class T, class Compare>
+void sort(T *begin, T *end, const Compare &compare, std::false_type /*radix sortable*/) {
+  pdq_sort(begin, end, less_by<T, Compare>{compare});
+}
+
+template<class T, class Compare>
+void sort(T *begin, T *end, const Compare &compare, std::true_type /*radix sortable*/) {
+  const less_by<T, Compare> less{compare};
+  if (end - begin < RADIX_SORT_THRESHOLD || has_unordered_values(begin, end)) {
+    pdq_sort(begin, end, less);
+    return;
+  }
+
+  // the radix sort doesn't benefit from the presorted input, unlike the pdq sort
+  const T *first_unordered = std::is_sorted_until(begin, end, less);
+  if (first_unordered == end) {
+    return;
+  }
+  if (first_unordered == begin + 1 && std::is_sorted(begin, end, [&less](const T &lhs, const T &rhs) { return less(rhs, lhs); })) {
+    std::reverse(begin, end);
+    return;
+  }
+  radix_sort(begin, end, scalar_order_of<Compare>::value == scalar_order::descending);
+}
+
+template<class T, class Less>
+void merge_sort(T *begin, T *end, T *buffer, const Less &less) {
+  const int64_t size = end - begin;
+  if (size <= INSERTION_SORT_THRESHOLD) {
+    insertion_sort(begin, end, less);
+    return;
+  }
+
+  T *middle = begin + size / 2;
+  merge_sort(begin, middle, buffer, less);
+  merge_sort(middle, end, buffer, less);
+  if (!less(*middle, middle[-1])) {
+    return;
+  }
+
+  // the left part is moved to the buffer, and the parts are merged back into the range
+  T *buffer_end = buffer;
+  for (T *it = begin; it != middle; ++it) {
+    new(buffer_end++) T(std::move(*it));
+  }
+  T *left = buffer;
+  T *right = middle;
+  T *out = begin;
+  while (left != buffer_end && right != end) {
+    *out++ = less(*right, *left) ? std::move(*right++) : std::move(*left++);
+  }
+  while (left != buffer_end) {
+    *out++ = std::move(*left++);
+  }
+  for (T *it = buffer; it != buffer_end; ++it) {
+    it->~T();
+  }
+}
+
+} // namespace sort_impl_
+
+template<class T, class Compare>
+void sort(T *begin, T *end, const Compare &compare) {
+  using radix_sortable = std::integral_constant<bool, (std::is_same<T, int64_t>{} || std::is_same<T, double>{}) &&
+                                                      scalar_order_of<Compare>::value != scalar_order::unknown>;
+  sort_impl_::sort(begin, end, compare, radix_sortable{});
+}
+
+// keeps the order of the equal elements, uses an additional buffer of n / 2 elements
+template<class T, class Compare>
+void stable_sort(T *begin, T *end, const Compare &compare) {
+  const int64_t size = end - begin;
+  if (size < 2) {
+    return;
+  }
+  const size_t buffer_size = (size / 2 + 1) * sizeof(T);
+  T *buffer = static_cast<T *>(dl::allocate(buffer_size));
+  sort_impl_::merge_sort(begin, end, buffer, sort_impl_::less_by<T, Compare>{compare});
+  dl::deallocate(buffer, buffer_size);
+}
+
+} // namespace dl
@@ -3,6 +3,7 @@
 #include <cctype>
 
 #include "common/algorithms/simd-int-to-string.h"
+#include "common/algorithms/string-search.h"
 
 #include "runtime/string_cache.h"
 
@@ -18,6 +19,7 @@ void string::string_inner::set_length_and_sharable(size_type n) {
 //  fprintf (stderr, "inc ref cnt %d %s\n", 0, ref_data());
   ref_count = 0;
   size = n;
+  cached_hash = 0;
   ref_data()[n] = '\0';
 }
 
@@ -50,6 +52,7 @@ string::string_inner *string::string_inner::create(size_type requested_capacity,
   size_type new_size = (size_type)(sizeof(string_inner) + (capacity + 1));
   string_inner *p = (string_inner *)dl::allocate(new_size);
   p->capacity = capacity;
+  p->cached_hash = 0;
   return p;
 }
 
@@ -308,6 +311,9 @@ string::size_type string::capacity() const {
 void string::make_not_shared() {
   if (inner()->is_shared()) {
     force_reserve(size());
+  } else {
+    // the content is going to be changed in place
+    inner()->cached_hash = 0;
   }
 }
 
@@ -326,8 +332,12 @@ void string::force_reserve(size_type res) {
 string &string::reserve_at_least(size_type res) {
   if (inner()->is_shared()) {
     force_reserve(res);
-  } else if (res > capacity()) {
-    p = inner()->reserve(res);
+  } else {
+    if (res > capacity()) {
+      p = inner()->reserve(res);
+    }
+    // the content is going to be changed in place
+    inner()->cached_hash = 0;
   }
   return *this;
 }
@@ -627,7 +637,7 @@ string &string::assign(size_type n, bool b __attribute__((unused))) {
 
 
 void string::assign_raw(const char *s) {
-  static_assert (sizeof(string_inner) == 12u, "need 12 bytes");
+  static_assert (sizeof(string_inner) == STRING_RAW_HEADER_SIZE, "string_inner should be compatible with string_raw()");
   p = const_cast <char *> (s + sizeof(string_inner));
 }
 
@@ -639,6 +649,10 @@ void string::swap(string &s) {
 }
 
 char *string::buffer() {
+  if (!inner()->is_shared()) {
+    // the content is going to be changed in place
+    inner()->cached_hash = 0;
+  }
   return p;
 }
 
@@ -838,7 +852,17 @@ bool string::is_numeric() const {
 }
 
 int64_t string::hash() const {
-  return string_hash(p, size());
+  string_inner *in = inner();
+  if (in->cached_hash) {
+    return in->cached_hash;
+  }
+  const int64_t result = string_hash(p, size());
+  // constant strings can be placed in read only memory, the compiler precomputes their hashes;
+  // strings from instance cache and confdata live in shared memory, it's better not to touch them
+  if (in->ref_count < ExtraRefCnt::for_global_const) {
+    in->cached_hash = result;
+  }
+  return result;
 }
 
 
@@ -847,19 +871,11 @@ string string::substr(size_type pos, size_type n) const {
 }
 
 string::size_type string::find(const string &s, size_type pos) const {
-  for (size_type i = pos; i + s.size() <= size(); i++) {
-    bool equal = true;
-    for (size_type j = 0; j < s.size(); j++) {
-      if (p[i + j] != s.p[j]) {
-        equal = false;
-        break;
-      }
-    }
-    if (equal) {
-      return i;
-    }
+  if (pos > size()) {
+    return string::npos;
   }
-  return string::npos;
+  const char *found = vk::find_substring(p + pos, size() - pos, s.p, s.size());
+  return found ? static_cast<size_type>(found - p) : string::npos;
 }
 
 string::size_type string::find_first_of(const string &s, size_type pos) const {
@@ -934,6 +950,11 @@ bool string::is_reference_counter(ExtraRefCnt ref_cnt_value) const noexcept {
 void string::set_reference_counter_to(ExtraRefCnt ref_cnt_value) noexcept {
   // some const arrays are placed in read only memory and can't be modified
   if (inner()->ref_count != ref_cnt_value) {
+    if (ref_cnt_value != ExtraRefCnt::for_global_const) {
+      // instance cache and confdata strings are published into the shared memory right after that,
+      // their hashes can't be cached later
+      hash();
+    }
     inner()->ref_count = ref_cnt_value;
   }
 }
@@ -954,7 +975,7 @@ inline string::size_type string::estimate_memory_usage() const {
 
 inline string string::make_const_string_on_memory(const char *str, size_type len, void *memory, size_t memory_size) {
   php_assert(len + inner_sizeof() + 1 <= memory_size);
-  auto *inner = new (memory) string_inner {len, len, ExtraRefCnt::for_global_const};
+  auto *inner = new (memory) string_inner {len, len, ExtraRefCnt::for_global_const, string_hash(str, len)};
   memcpy(inner->ref_data(), str, len);
   inner->ref_data()[len] = '\0';
   string result;
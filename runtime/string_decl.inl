@@ -13,10 +13,13 @@ private:
   char *p;
 
 private:
-  struct string_inner {
+  struct __attribute__((packed, aligned(4))) string_inner {
     size_type size;
     size_type capacity;
     int ref_count;
+    // string_hash() of the content, it's computed lazily and 0 means that it isn't computed yet;
+    // every operation that can change the content of a not shared string resets it
+    int64_t cached_hash;
 
     inline bool is_shared() const;
     inline void set_length_and_sharable(size_type n);
@@ -7,6 +7,7 @@
 #include <clocale>
 #include <endian.h>
 
+#include "common/algorithms/string-search.h"
 #include "common/unicode/unicode-utils.h"
 
 #include "runtime/integer_types.h"
@@ -1284,7 +1285,7 @@ static bool php_tag_find(const string &tag, const string &allow) {
     }
   }
   norm.push_back('>');
-  return memmem(allow.c_str(), allow.size(), norm.c_str(), norm.size()) != nullptr;
+  return vk::find_substring(allow.c_str(), allow.size(), norm.c_str(), norm.size()) != nullptr;
 }
 
 string f$strip_tags(const string &str, const string &allow) {
@@ -1718,7 +1719,7 @@ Optional<int64_t> f$strpos(const string &haystack, const string &needle, int64_t
     return s - haystack.c_str();
   }
 
-  const char *s = static_cast <const char *> (memmem(haystack.c_str() + offset, haystack.size() - offset, needle.c_str(), needle.size()));
+  const char *s = vk::find_substring(haystack.c_str() + offset, haystack.size() - offset, needle.c_str(), needle.size());
   if (s == nullptr) {
     return false;
   }
@@ -1744,11 +1745,11 @@ Optional<int64_t> f$strrpos(const string &haystack, const string &needle, int64_
     return false;
   }
 
-  const char *s = static_cast <const char *> (memmem(haystack.c_str() + offset, haystack.size() - offset, needle.c_str(), needle.size())), *t;
+  const char *s = vk::find_substring(haystack.c_str() + offset, haystack.size() - offset, needle.c_str(), needle.size()), *t;
   if (s == nullptr || s >= end) {
     return false;
   }
-  while ((t = static_cast <const char *> (memmem(s + 1, haystack.c_str() + haystack.size() - s - 1, needle.c_str(), needle.size()))) != nullptr && t < end) {
+  while ((t = vk::find_substring(s + 1, haystack.c_str() + haystack.size() - s - 1, needle.c_str(), needle.size())) != nullptr && t < end) {
     s = t;
   }
   return s - haystack.c_str();
@@ -1800,7 +1801,7 @@ Optional<string> f$strstr(const string &haystack, const string &needle, bool bef
     return false;
   }
 
-  const char *s = static_cast <const char *> (memmem(haystack.c_str(), haystack.size(), needle.c_str(), needle.size()));
+  const char *s = vk::find_substring(haystack.c_str(), haystack.size(), needle.c_str(), needle.size());
   if (s == nullptr) {
     return false;
   }
@@ -1963,7 +1964,7 @@ void str_replace_inplace(const string &search, const string &replace, string &su
   char *output = subject.buffer();
   bool length_no_change = search.size() == replace.size();
   while (true) {
-    const char *pos = static_cast <const char *> (memmem(piece, piece_end - piece, search.c_str(), search.size()));
+    const char *pos = vk::find_substring(piece, piece_end - piece, search.c_str(), search.size());
     if (pos == nullptr) {
       if (count == 0) {
         return;
@@ -2003,7 +2004,7 @@ string str_replace(const string &search, const string &replace, const string &su
   const char *piece = subject.c_str(), *piece_end = subject.c_str() + subject.size();
   string result;
   while (true) {
-    const char *pos = static_cast <const char *> (memmem(piece, piece_end - piece, search.c_str(), search.size()));
+    const char *pos = vk::find_substring(piece, piece_end - piece, search.c_str(), search.size());
     if (pos == nullptr) {
       if (count == 0) {
         return subject;
@@ -2161,7 +2162,7 @@ int64_t f$substr_count(const string &haystack, const string &needle, int64_t off
     return end - s;
   }
   do {
-    s = static_cast <const char *> (memmem(static_cast <const void *> (s), (size_t)(end - s), static_cast <const void *> (needle.c_str()), (size_t)needle.size()));
+    s = vk::find_substring(s, end - s, needle.c_str(), needle.size());
     if (s == nullptr) {
       return ans;
     }
@@ -5,6 +5,10 @@
 #pragma once
 
 #include <type_traits>
+#include <vector>
+
+#include "common/algorithms/aho-corasick.h"
+
 #include "runtime/kphp_core.h"
 
 extern const string COLON;
@@ -347,35 +351,46 @@ Optional<string> f$strstr(const string &haystack, const mixed &needle, bool befo
 
 template<class T>
 string f$strtr(const string &subject, const array<T> &replace_pairs) {
-  const char *piece = subject.c_str(), *piece_end = subject.c_str() + subject.size();
-  string result;
-  while (1) {
-    const char *best_pos = nullptr;
-    int64_t best_len = -1;
-    string replace;
-    for (typename array<T>::const_iterator p = replace_pairs.begin(); p != replace_pairs.end(); ++p) {
-      const string search = f$strval(p.get_key());
-      int64_t search_len = search.size();
-      if (search_len == 0) {
-        return subject;
-      }
-      const char *pos = static_cast <const char *> (memmem(static_cast <const void *> (piece), (size_t)(piece_end - piece), static_cast <const void *> (search.c_str()), (size_t)search_len));
-      if (pos != nullptr && (best_pos == nullptr || best_pos > pos || (best_pos == pos && search_len > best_len))) {
-        best_pos = pos;
-        best_len = search_len;
-        replace = f$strval(p.get_value());
-      }
-    }
-    if (best_pos == nullptr) {
-      result.append(piece, static_cast<string::size_type>(piece_end - piece));
-      break;
+  if (replace_pairs.empty()) {
+    return subject;
+  }
+
+  array<string> search(array_size(replace_pairs.count(), 0, true));
+  for (const auto &it : replace_pairs) {
+    string key = f$strval(it.get_key());
+    if (key.empty()) {
+      return subject;
     }
+    search.push_back(std::move(key));
+  }
+  if (replace_pairs.count() == 1) {
+    return str_replace(search.get_value(0), f$strval(replace_pairs.begin().get_value()), subject, str_replace_count_dummy);
+  }
 
-    result.append(piece, static_cast<string::size_type>(best_pos - piece));
-    result.append(replace);
+  array<string> replace(array_size(replace_pairs.count(), 0, true));
+  for (const auto &it : replace_pairs) {
+    replace.push_back(f$strval(it.get_value()));
+  }
 
-    piece = best_pos + best_len;
+  string result;
+  const char *piece = subject.c_str();
+  // the automaton is built with std containers
+  auto malloc_replacement_guard = make_malloc_replacement_with_script_allocator();
+  std::vector<vk::string_view> patterns;
+  patterns.reserve(search.count());
+  for (const auto &it : search) {
+    patterns.emplace_back(it.get_value().c_str(), it.get_value().size());
+  }
+  const vk::AhoCorasick automaton{patterns};
+  automaton.find_leftmost_longest(subject.c_str(), subject.size(), [&](size_t pos, size_t pattern) {
+    result.append(piece, static_cast<string::size_type>(subject.c_str() + pos - piece));
+    result.append(replace.get_value(static_cast<int64_t>(pattern)));
+    piece = subject.c_str() + pos + patterns[pattern].size();
+  });
+  if (piece == subject.c_str()) {
+    return subject;
   }
+  result.append(piece, static_cast<string::size_type>(subject.c_str() + subject.size() - piece));
 
   return result;
 }
@@ -54,7 +54,7 @@ array<int64_t> f$typed_rpc_tl_query(const class_instance<C$RpcConnection> &conne
     queries.set_value(it.get_key(), rpc_query);
   }
   if (bytes_sent > 0) {
-    f$rpc_flush();
+    rpc_flush_coalesced();
   }
 
   return queries;
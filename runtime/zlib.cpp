@@ -58,6 +58,73 @@ const string_buffer *zlib_encode(const char *s, int32_t s_len, int32_t level, in
   return &static_SB;
 }
 
+static z_stream zlib_stream;
+static bool zlib_stream_active;
+
+static voidpf zlib_stream_alloc(voidpf opaque __attribute__((unused)), uInt items, uInt size) {
+  const size_t total_size = size_t{items} * size + sizeof(size_t);
+  auto *mem = static_cast<size_t *>(dl::allocate(total_size));
+  if (mem == nullptr) {
+    return Z_NULL;
+  }
+  *mem = total_size;
+  return mem + 1;
+}
+
+static void zlib_stream_free(voidpf opaque __attribute__((unused)), voidpf address) {
+  auto *mem = static_cast<size_t *>(address) - 1;
+  dl::deallocate(mem, *mem);
+}
+
+bool zlib_stream_encode_init(int32_t level, int32_t encoding) {
+  php_assert (!zlib_stream_active);
+  zlib_stream.zalloc = zlib_stream_alloc;
+  zlib_stream.zfree = zlib_stream_free;
+  zlib_stream.opaque = Z_NULL;
+
+  dl::enter_critical_section();//OK
+  zlib_stream_active = deflateInit2 (&zlib_stream, level, Z_DEFLATED, encoding, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) == Z_OK;
+  dl::leave_critical_section();
+  return zlib_stream_active;
+}
+
+const string_buffer *zlib_stream_encode(const char *s, int32_t s_len, bool finish) {
+  php_assert (zlib_stream_active);
+  static_SB.clean();
+
+  dl::enter_critical_section();//OK
+  zlib_stream.avail_in = (unsigned int)s_len;
+  zlib_stream.next_in = reinterpret_cast <Bytef *> (const_cast <char *> (s));
+  int ret = Z_OK;
+  do {
+    const auto out_len = static_cast<unsigned int>(deflateBound(&zlib_stream, zlib_stream.avail_in) + 16);
+    static_SB.reserve(out_len);
+    zlib_stream.avail_out = out_len;
+    zlib_stream.next_out = reinterpret_cast <Bytef *> (static_SB.buffer() + static_SB.size());
+    ret = deflate(&zlib_stream, finish ? Z_FINISH : Z_SYNC_FLUSH);
+    static_SB.set_pos(static_SB.size() + out_len - zlib_stream.avail_out);
+  } while (ret == Z_OK && zlib_stream.avail_out == 0);
+  dl::leave_critical_section();
+
+  if (finish) {
+    zlib_stream_encode_free();
+  }
+  if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+    php_warning("Error during pack of string with length %d", s_len);
+    static_SB.clean();
+  }
+  return &static_SB;
+}
+
+void zlib_stream_encode_free() {
+  if (zlib_stream_active) {
+    dl::enter_critical_section();//OK
+    deflateEnd(&zlib_stream);
+    dl::leave_critical_section();
+    zlib_stream_active = false;
+  }
+}
+
 string f$gzcompress(const string &s, int64_t level) {
   if (level < -1 || level > 9) {
     php_warning("Wrong parameter level = %ld in function gzcompress", level);
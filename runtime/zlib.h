@@ -14,6 +14,13 @@ constexpr int32_t ZLIB_ENCODE = 0x1f;
 
 const string_buffer *zlib_encode(const char *s, int32_t s_len, int32_t level, int32_t encoding);//returns pointer to static_SB
 
+// incremental compression, the state is kept between the calls, so the result is a single stream;
+// it is used for chunked http answers, only one stream may be active at once
+bool zlib_stream_encode_init(int32_t level, int32_t encoding);
+// every call produces the data which can be decoded right away, finish ends the stream
+const string_buffer *zlib_stream_encode(const char *s, int32_t s_len, bool finish);//returns pointer to static_SB
+void zlib_stream_encode_free();
+
 string f$gzcompress(const string &s, int64_t level = -1);
 
 const char *gzuncompress_raw(vk::string_view s, string::size_type *result_len);
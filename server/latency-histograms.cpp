@@ -0,0 +1,348 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "server/latency-histograms.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cinttypes>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <new>
+#include <sys/mman.h>
+#include <type_traits>
+#include <vector>
+
+#include "common/dl-utils-lite.h"
+#include "common/stats/hdr-histogram.h"
+
+#include "server/php-engine-vars.h"
+
+namespace {
+
+constexpr size_t ENDPOINT_NAME_LEN = 64;
+// the endpoints which don't fit are accounted together in the last one
+constexpr size_t MAX_WORKER_ENDPOINTS = 16;
+constexpr size_t MAX_MERGED_ENDPOINTS = 64;
+constexpr const char *OTHER_ENDPOINTS = "other";
+constexpr const char *ID_SEGMENT = "{id}";
+
+// the percentiles are calculated for the difference between the current totals and the snapshot taken a minute ago
+constexpr double SNAPSHOTS_PERIOD = 15;
+constexpr size_t SNAPSHOTS_PER_WINDOW = 4;
+
+struct request_histograms {
+  // in microseconds
+  vk::hdr_histogram working_time;
+  vk::hdr_histogram script_time;
+  vk::hdr_histogram net_time;
+  // in bytes
+  vk::hdr_histogram memory_used;
+  vk::hdr_histogram real_memory_used;
+
+  void add(const request_histograms &other) noexcept {
+    working_time.add(other.working_time);
+    script_time.add(other.script_time);
+    net_time.add(other.net_time);
+    memory_used.add(other.memory_used);
+    real_memory_used.add(other.real_memory_used);
+  }
+
+  void subtract(const request_histograms &other) noexcept {
+    working_time.subtract(other.working_time);
+    script_time.subtract(other.script_time);
+    net_time.subtract(other.net_time);
+    memory_used.subtract(other.memory_used);
+    real_memory_used.subtract(other.real_memory_used);
+  }
+};
+
+struct endpoint_histogram {
+  char name[ENDPOINT_NAME_LEN];
+  vk::hdr_histogram working_time;
+};
+
+// it is written only by its worker, and the master reads it at the same time:
+// a request which is being accounted may be missed in some of the histograms, it doesn't matter for the stats
+struct worker_histograms {
+  request_histograms requests;
+  // the name of an endpoint is written before it is counted here
+  std::atomic<uint32_t> named_endpoints_count;
+  endpoint_histogram endpoints[MAX_WORKER_ENDPOINTS];
+};
+
+struct merged_histograms {
+  request_histograms requests;
+  std::map<std::string, vk::hdr_histogram> endpoints;
+
+  void add_endpoint(const std::string &name, const vk::hdr_histogram &histogram) {
+    auto it = endpoints.find(name);
+    if (it == endpoints.end()) {
+      it = endpoints.size() < MAX_MERGED_ENDPOINTS ? endpoints.emplace(name, vk::hdr_histogram{}).first : endpoints.emplace(OTHER_ENDPOINTS, vk::hdr_histogram{}).first;
+    }
+    it->second.add(histogram);
+  }
+
+  void add(const worker_histograms &worker) {
+    requests.add(worker.requests);
+    const uint32_t named_endpoints_count = worker.named_endpoints_count.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < named_endpoints_count; ++i) {
+      add_endpoint(worker.endpoints[i].name, worker.endpoints[i].working_time);
+    }
+    const endpoint_histogram &other = worker.endpoints[MAX_WORKER_ENDPOINTS - 1];
+    if (other.working_time.count()) {
+      add_endpoint(OTHER_ENDPOINTS, other.working_time);
+    }
+  }
+
+  void add(const merged_histograms &other) {
+    requests.add(other.requests);
+    for (const auto &endpoint : other.endpoints) {
+      add_endpoint(endpoint.first, endpoint.second);
+    }
+  }
+
+  void subtract(const merged_histograms &snapshot) {
+    requests.subtract(snapshot.requests);
+    for (auto &endpoint : endpoints) {
+      const auto it = snapshot.endpoints.find(endpoint.first);
+      if (it != snapshot.endpoints.end()) {
+        endpoint.second.subtract(it->second);
+      }
+    }
+  }
+};
+
+worker_histograms *worker_slots;
+// the slots of the alive workers, the others aren't touched not to fault in their pages
+std::vector<bool> used_slots;
+
+merged_histograms dead_workers;
+std::deque<merged_histograms> snapshots;
+double last_snapshot_time;
+merged_histograms last_minute;
+
+uint64_t to_microseconds(double seconds) noexcept {
+  return seconds > 0 ? static_cast<uint64_t>(seconds * 1e6) : 0;
+}
+
+uint64_t to_bytes(int64_t bytes) noexcept {
+  return static_cast<uint64_t>(std::max<int64_t>(bytes, 0));
+}
+
+double to_seconds(uint64_t microseconds) noexcept {
+  return static_cast<double>(microseconds) / 1e6;
+}
+
+// an all-digit path segment or a long hex one, as hashes and uuids are
+bool is_id_segment(const char *segment, size_t len) noexcept {
+  size_t digits = 0;
+  size_t hex_digits = 0;
+  for (size_t i = 0; i < len; ++i) {
+    const auto c = static_cast<unsigned char>(segment[i]);
+    digits += isdigit(c) != 0;
+    hex_digits += isxdigit(c) != 0 || c == '-';
+  }
+  return len > 0 && (digits == len || (len >= 8 && digits > 0 && hex_digits == len));
+}
+
+// the query string is dropped and the ids are collapsed: /user/42/photos?page=2 is counted as /user/{id}/photos,
+// otherwise the first distinct URIs would take all the endpoints and the rest of the requests would go to "other"
+size_t normalize_endpoint(const char *endpoint, size_t endpoint_len, char *name) noexcept {
+  endpoint_len = std::find_if(endpoint, endpoint + endpoint_len, [](char c) { return c == '?' || c == '#'; }) - endpoint;
+  size_t name_len = 0;
+  size_t segment_begin = 0;
+  while (segment_begin <= endpoint_len && name_len < ENDPOINT_NAME_LEN - 1) {
+    const char *segment = endpoint + segment_begin;
+    size_t segment_len = std::find(segment, endpoint + endpoint_len, '/') - segment;
+    const bool last_segment = segment_begin + segment_len == endpoint_len;
+    segment_begin += segment_len + 1;
+    if (is_id_segment(segment, segment_len)) {
+      segment = ID_SEGMENT;
+      segment_len = strlen(ID_SEGMENT);
+    }
+    segment_len = std::min(segment_len, ENDPOINT_NAME_LEN - 1 - name_len);
+    memcpy(name + name_len, segment, segment_len);
+    name_len += segment_len;
+    if (!last_segment && name_len < ENDPOINT_NAME_LEN - 1) {
+      name[name_len++] = '/';
+    }
+  }
+  name[name_len] = '\0';
+  return name_len;
+}
+
+vk::hdr_histogram &get_endpoint_histogram(worker_histograms &slot, const char *endpoint, size_t endpoint_len) noexcept {
+  endpoint_len = std::min(endpoint_len, ENDPOINT_NAME_LEN - 1);
+  const uint32_t named_endpoints_count = slot.named_endpoints_count.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < named_endpoints_count; ++i) {
+    endpoint_histogram &histogram = slot.endpoints[i];
+    if (!strncmp(histogram.name, endpoint, endpoint_len) && histogram.name[endpoint_len] == '\0') {
+      return histogram.working_time;
+    }
+  }
+  if (named_endpoints_count + 1 < MAX_WORKER_ENDPOINTS) {
+    endpoint_histogram &histogram = slot.endpoints[named_endpoints_count];
+    memcpy(histogram.name, endpoint, endpoint_len);
+    histogram.name[endpoint_len] = '\0';
+    slot.named_endpoints_count.store(named_endpoints_count + 1, std::memory_order_release);
+    return histogram.working_time;
+  }
+  return slot.endpoints[MAX_WORKER_ENDPOINTS - 1].working_time;
+}
+
+const double PERCENTILES[] = {0.5, 0.95, 0.99, 0.999};
+const char *PERCENTILES_SUFFIXES[] = {"50", "95", "99", "999"};
+
+void write_time_percentiles(std::string &res, const char *name, const vk::hdr_histogram &histogram) {
+  char buf[256];
+  for (size_t i = 0; i < std::extent<decltype(PERCENTILES)>::value; ++i) {
+    snprintf(buf, sizeof(buf), "%s_percentile_%s\t%.6lf\n", name, PERCENTILES_SUFFIXES[i], to_seconds(histogram.value_at_percentile(PERCENTILES[i])));
+    res += buf;
+  }
+}
+
+void write_memory_percentiles(std::string &res, const char *name, const vk::hdr_histogram &histogram) {
+  char buf[256];
+  for (size_t i = 0; i < std::extent<decltype(PERCENTILES)>::value; ++i) {
+    snprintf(buf, sizeof(buf), "%s_percentile_%s\t%" PRIu64 "\n", name, PERCENTILES_SUFFIXES[i], histogram.value_at_percentile(PERCENTILES[i]));
+    res += buf;
+  }
+}
+
+void write_time_percentiles(stats_t *stats, const char *prefix, const vk::hdr_histogram &histogram) {
+  for (size_t i = 0; i < std::extent<decltype(PERCENTILES)>::value; ++i) {
+    add_histogram_stat_double(stats, stat_temp_format("%s.percentile_%s", prefix, PERCENTILES_SUFFIXES[i]),
+                              to_seconds(histogram.value_at_percentile(PERCENTILES[i])));
+  }
+}
+
+void write_memory_percentiles(stats_t *stats, const char *prefix, const vk::hdr_histogram &histogram) {
+  for (size_t i = 0; i < std::extent<decltype(PERCENTILES)>::value; ++i) {
+    add_histogram_stat_long(stats, stat_temp_format("%s.percentile_%s", prefix, PERCENTILES_SUFFIXES[i]),
+                            static_cast<long long>(histogram.value_at_percentile(PERCENTILES[i])));
+  }
+}
+
+// the dead workers' endpoints without requests for the whole window are forgotten not to hold the merged endpoints forever,
+// they are taken out of the snapshots as well: the counts of the alive workers under the same names stay consistent
+void forget_idle_dead_workers_endpoints(const merged_histograms &window) {
+  for (auto it = dead_workers.endpoints.begin(); it != dead_workers.endpoints.end();) {
+    const auto recent = window.endpoints.find(it->first);
+    if (it->first == OTHER_ENDPOINTS || (recent != window.endpoints.end() && recent->second.count())) {
+      ++it;
+      continue;
+    }
+    for (auto &snapshot : snapshots) {
+      const auto snapshot_it = snapshot.endpoints.find(it->first);
+      if (snapshot_it != snapshot.endpoints.end()) {
+        snapshot_it->second.subtract(it->second);
+      }
+    }
+    it = dead_workers.endpoints.erase(it);
+  }
+}
+
+} // namespace
+
+void init_latency_histograms() {
+  void *mem = mmap(nullptr, sizeof(worker_histograms) * MAX_WORKERS, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+  dl_passert(mem != MAP_FAILED, "can't allocate the shared memory for the latency histograms");
+  worker_slots = static_cast<worker_histograms *>(mem);
+  used_slots.assign(MAX_WORKERS, false);
+}
+
+void reset_latency_histograms_slot(int slot_id) {
+  if (worker_slots) {
+    worker_histograms *slot = new(&worker_slots[slot_id]) worker_histograms{};
+    strcpy(slot->endpoints[MAX_WORKER_ENDPOINTS - 1].name, OTHER_ENDPOINTS);
+    used_slots[slot_id] = true;
+  }
+}
+
+void add_dead_worker_latency_histograms(int slot_id) {
+  if (worker_slots) {
+    dead_workers.add(worker_slots[slot_id]);
+    used_slots[slot_id] = false;
+  }
+}
+
+void update_latency_histograms(double now) {
+  if (!worker_slots) {
+    return;
+  }
+
+  merged_histograms total = dead_workers;
+  for (int i = 0; i < MAX_WORKERS; ++i) {
+    if (used_slots[i]) {
+      total.add(worker_slots[i]);
+    }
+  }
+
+  if (snapshots.empty() || last_snapshot_time + SNAPSHOTS_PERIOD <= now) {
+    snapshots.push_back(total);
+    last_snapshot_time = now;
+    if (snapshots.size() > SNAPSHOTS_PER_WINDOW + 1) {
+      snapshots.pop_front();
+    }
+  }
+
+  total.subtract(snapshots.front());
+  if (snapshots.size() > SNAPSHOTS_PER_WINDOW) {
+    forget_idle_dead_workers_endpoints(total);
+  }
+  last_minute = std::move(total);
+}
+
+std::string latency_histograms_to_string() {
+  std::string res;
+  write_time_percentiles(res, "requests_working_time", last_minute.requests.working_time);
+  write_time_percentiles(res, "requests_script_time", last_minute.requests.script_time);
+  write_time_percentiles(res, "requests_net_time", last_minute.requests.net_time);
+  write_memory_percentiles(res, "memory_script_usage", last_minute.requests.memory_used);
+  write_memory_percentiles(res, "memory_script_real_usage", last_minute.requests.real_memory_used);
+
+  char buf[512];
+  for (const auto &endpoint : last_minute.endpoints) {
+    const vk::hdr_histogram &histogram = endpoint.second;
+    if (!histogram.count()) {
+      continue;
+    }
+    // the names may contain anything, but the stats are line and tab separated
+    std::string name = endpoint.first;
+    std::replace_if(name.begin(), name.end(), [](char c) { return !isprint(static_cast<unsigned char>(c)) || c == '\t'; }, '?');
+    snprintf(buf, sizeof(buf), "endpoint_working_time\t%" PRIu64 "\t%.6lf\t%.6lf\t%.6lf\t%.6lf\t%s\n", histogram.count(),
+             to_seconds(histogram.value_at_percentile(0.5)), to_seconds(histogram.value_at_percentile(0.95)),
+             to_seconds(histogram.value_at_percentile(0.99)), to_seconds(histogram.value_at_percentile(0.999)), name.c_str());
+    res += buf;
+  }
+  return res;
+}
+
+void latency_histograms_to_stats(stats_t *stats) {
+  write_time_percentiles(stats, "requests.working_time", last_minute.requests.working_time);
+  write_time_percentiles(stats, "requests.script_time", last_minute.requests.script_time);
+  write_time_percentiles(stats, "requests.net_time", last_minute.requests.net_time);
+  write_memory_percentiles(stats, "memory.script_usage", last_minute.requests.memory_used);
+  write_memory_percentiles(stats, "memory.script_real_usage", last_minute.requests.real_memory_used);
+}
+
+void record_request_latency(const char *endpoint, size_t endpoint_len, double script_time, double net_time,
+                            int64_t memory_used, int64_t real_memory_used) {
+  if (!worker_slots || logname_id < 0 || logname_id >= MAX_WORKERS) {
+    return;
+  }
+  worker_histograms &slot = worker_slots[logname_id];
+  const uint64_t working_time = to_microseconds(script_time + net_time);
+  slot.requests.working_time.record(working_time);
+  slot.requests.script_time.record(to_microseconds(script_time));
+  slot.requests.net_time.record(to_microseconds(net_time));
+  slot.requests.memory_used.record(to_bytes(memory_used));
+  slot.requests.real_memory_used.record(to_bytes(real_memory_used));
+  char name[ENDPOINT_NAME_LEN];
+  const size_t name_len = normalize_endpoint(endpoint, endpoint_len, name);
+  get_endpoint_histogram(slot, name, name_len).record(working_time);
+}
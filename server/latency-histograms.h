@@ -0,0 +1,29 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "common/stats/provider.h"
+
+// Log-linear histograms of the requests working, script and net time and memory usage.
+// Every worker counts its requests in the shared memory slot of its logname_id, the master merges the slots exactly
+// and calculates the percentiles over the requests of all the workers for the last minute.
+// The working time is also broken down by the endpoint: the script URI path of HTTP requests with the numeric and hex ids
+// collapsed to {id}, or the function magic of RPC ones. The endpoints the dead workers had no requests to for a minute are forgotten.
+
+// master
+void init_latency_histograms();
+void reset_latency_histograms_slot(int slot_id);
+void add_dead_worker_latency_histograms(int slot_id);
+void update_latency_histograms(double now);
+std::string latency_histograms_to_string();
+void latency_histograms_to_stats(stats_t *stats);
+
+// worker
+void record_request_latency(const char *endpoint, size_t endpoint_len, double script_time, double net_time,
+                            int64_t memory_used, int64_t real_memory_used);
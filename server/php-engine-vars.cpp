@@ -37,6 +37,8 @@ double load_time;
 /** http **/
 int http_port = -1;
 int http_sfd = -1;
+int http_reuseport = 0;
+int http_reuseport_sfd = -1;
 
 /** rpc **/
 long long rpc_failed, rpc_sent, rpc_received, rpc_received_news_subscr, rpc_received_news_redirect;
@@ -64,6 +66,7 @@ int master_pipe_fast_write = -1;
 int sql_target_id = -1;
 int in_ready = 0;
 int script_timeout = 0;
+int pending_queries_limit = 0;
 int disable_access_log = 0;
 int force_clear_sql_connection = 0;
 long long static_buffer_length_limit = -1;
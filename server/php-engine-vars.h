@@ -47,6 +47,9 @@ extern double load_time;
 /** http **/
 extern int http_port;
 extern int http_sfd;
+extern int http_reuseport;
+// worker's own SO_REUSEPORT listening socket, accepted along with the shared http_sfd
+extern int http_reuseport_sfd;
 
 /** rpc **/
 extern long long rpc_failed, rpc_sent, rpc_received, rpc_received_news_subscr, rpc_received_news_redirect;
@@ -90,6 +93,7 @@ struct php_immediate_stats_t {
 extern int sql_target_id;
 extern int in_ready;
 extern int script_timeout;
+extern int pending_queries_limit;
 extern int disable_access_log;
 extern int force_clear_sql_connection;
 extern long long static_buffer_length_limit;
@@ -4,8 +4,10 @@
 
 #include "server/php-engine.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
+#include <cinttypes>
 #include <cstdlib>
 #include <cstring>
 #include <netdb.h>
@@ -32,8 +34,12 @@
 #include "common/server/signals.h"
 #include "common/tl/constants/common.h"
 #include "common/tl/constants/kphp.h"
+#include "common/tl/methods/compression.h"
 #include "common/tl/methods/rwm.h"
+#include "common/tl/methods/string.h"
+#include "common/tl/methods/zstd-dictionaries.h"
 #include "common/tl/parse.h"
+#include "common/tl/query-header.h"
 #include "net/net-buffers.h"
 #include "net/net-connections.h"
 #include "net/net-crypto-aes.h"
@@ -50,6 +56,9 @@
 
 #include "runtime/interface.h"
 #include "runtime/profiler.h"
+#include "runtime/regexp.h"
+#include "runtime/rpc.h"
+#include "runtime/rpc-cluster.h"
 #include "server/confdata-binlog-replay.h"
 #include "server/lease-config-parser.h"
 #include "server/php-engine-vars.h"
@@ -196,10 +205,15 @@ double fix_timeout(double timeout) {
   HTTP INTERFACE
  ***/
 void http_return(connection *c, const char *str, int len);
+void http_return_unavailable(connection *c, const char *str);
+void server_rpc_error(connection *c, long long req_id, int code, const char *str);
+
+static int pending_queries_count;
 
 int delete_pending_query(conn_query *q) {
   vkprintf (1, "delete_pending_query(%p,%p)\n", q, q->requester);
 
+  pending_queries_count--;
   delete_conn_query(q);
   free(q);
   return 0;
@@ -284,6 +298,11 @@ command_t *create_command_net_writer(const char *data, int data_len, command_t *
 #define run_once_count 1
 int queries_to_recreate_script = 100;
 
+// the script isn't started if less time is left before the deadline
+static constexpr double MIN_SCRIPT_TIME_LEFT = 0.21;
+// the client timeout can't make the script timeout lower than that, the same as the minimal --time-limit
+static constexpr double MIN_CLIENT_SCRIPT_TIMEOUT = 1;
+
 void *php_script;
 
 php_worker *active_worker = nullptr;
@@ -300,9 +319,11 @@ php_worker *php_worker_create(php_worker_mode_t mode, connection *c, http_query_
 
   worker->init_time = precise_now;
   worker->finish_time = precise_now + timeout;
+  worker->client_deadline = 0;
 
   worker->paused = false;
   worker->terminate_flag = false;
+  worker->shed = false;
   worker->terminate_reason = script_error_t::unclassified_error;
   worker->error_message = "no error";
 
@@ -311,6 +332,8 @@ php_worker *php_worker_create(php_worker_mode_t mode, connection *c, http_query_
   worker->wakeup_time = 0;
 
   worker->req_id = req_id;
+  worker->answer_chunked = false;
+  worker->post_data_left = 0;
 
   if (worker->conn->target) {
     worker->target_fd = static_cast<int>(worker->conn->target - Targets);
@@ -334,32 +357,104 @@ void php_worker_free(php_worker *worker) {
   free(worker);
 }
 
+void php_worker_terminate(php_worker *worker, int flag, script_error_t terminate_reason, const char *error_message) {
+  worker->terminate_flag = true;
+  worker->terminate_reason = terminate_reason;
+  worker->error_message = error_message;
+  if (flag) {
+    vkprintf(0, "php_worker_terminate\n");
+    worker->conn = nullptr;
+  }
+}
+
 int has_pending_scripts() {
   return php_worker_run_flag || pending_http_queue.first_query != (conn_query *)&pending_http_queue;
 }
 
+/** wakes up the first alive pending query **/
+void php_worker_wakeup_pending() {
+  int f = 0;
+  while (pending_http_queue.first_query != (conn_query *)&pending_http_queue && !f) {
+    //TODO: is it correct to do it?
+    conn_query *q = pending_http_queue.first_query;
+    f = q->requester != nullptr && q->requester->generation == q->req_generation;
+    delete_pending_query(q);
+  }
+}
+
+/** the oldest pending query is dropped, because the newer ones are more likely to be answered before their clients give up **/
+void php_worker_shed_oldest_pending() {
+  conn_query *q = pending_http_queue.first_query;
+  if (q->requester != nullptr && q->requester->generation == q->req_generation) {
+    auto shed_worker = reinterpret_cast<php_worker *>(q->extra);
+    shed_worker->shed = true;
+    php_worker_terminate(shed_worker, 0, script_error_t::unclassified_error, "overload");
+  }
+  // the shed query is woken up to be answered with an error
+  delete_pending_query(q);
+}
+
+/** answers the query with an error instead of running the script **/
+void php_worker_drop(php_worker *worker, query_drop_reason reason) {
+  PhpWorkerStats::get_local().add_dropped_query(reason);
+  vkprintf (1, "DROP php script [query waited = %.5lf] [req_id = %016llx] due to %s\n",
+            precise_now - worker->init_time, worker->req_id, reason == query_drop_reason::overload ? "overload" : "deadline");
+  if (worker->conn == nullptr) {
+    return;
+  }
+  if (worker->mode == http_worker) {
+    http_return_unavailable(worker->conn, reason == query_drop_reason::overload ? "OVERLOADED" : "DEADLINE EXPIRED");
+  } else if (worker->mode == rpc_worker) {
+    if (reason == query_drop_reason::overload) {
+      server_rpc_error(worker->conn, worker->req_id, TL_ERROR_FLOOD_CONTROL, "Query is dropped due to overload");
+    } else {
+      server_rpc_error(worker->conn, worker->req_id, TL_ERROR_QUERY_TIMEOUT, "Query deadline expired before the script start");
+    }
+  }
+}
+
 /** trying to start query **/
 void php_worker_try_start(php_worker *worker) {
+  if (!worker->terminate_flag && (worker->finish_time - precise_now < MIN_SCRIPT_TIME_LEFT
+                                  || (worker->client_deadline > 0 && worker->client_deadline <= precise_now))) {
+    // the client gives up before the script is done anyway, or it has already given up
+    php_worker_terminate(worker, 0, script_error_t::timeout, "deadline expired");
+  }
 
   if (worker->terminate_flag) {
+    if (worker->shed) {
+      php_worker_drop(worker, query_drop_reason::overload);
+    } else if (worker->terminate_reason == script_error_t::timeout) {
+      php_worker_drop(worker, query_drop_reason::deadline);
+    }
     worker->state = phpq_finish;
+    if (!php_worker_run_flag) {
+      // the dropped query could be woken up instead of the next one
+      php_worker_wakeup_pending();
+    }
     return;
   }
 
   if (php_worker_run_flag) { // put connection into pending_http_query
     vkprintf (2, "php script [req_id = %016llx] is waiting\n", worker->req_id);
 
+    if (pending_queries_limit > 0 && pending_queries_count >= pending_queries_limit) {
+      php_worker_shed_oldest_pending();
+    }
+
     auto pending_q = reinterpret_cast<conn_query *>(malloc(sizeof(conn_query)));
 
     pending_q->custom_type = 0;
     pending_q->outbound = (connection *)&pending_http_queue;
     assert (worker->conn != nullptr);
     pending_q->requester = worker->conn;
+    pending_q->extra = worker;
 
     pending_q->cq_type = &pending_cq_func;
-    pending_q->timer.wakeup_time = worker->finish_time;
+    pending_q->timer.wakeup_time = worker->client_deadline > 0 ? std::min(worker->finish_time, worker->client_deadline) : worker->finish_time;
 
     insert_conn_query(pending_q);
+    pending_queries_count++;
 
     worker->conn->status = conn_wait_net;
 
@@ -372,11 +467,8 @@ void php_worker_try_start(php_worker *worker) {
 }
 
 void php_worker_init_script(php_worker *worker) {
+  // the deadline is checked in php_worker_try_start, right before
   double timeout = worker->finish_time - precise_now - 0.01;
-  if (worker->terminate_flag || timeout < 0.2) {
-    worker->state = phpq_finish;
-    return;
-  }
 
   if (force_clear_sql_connection && sql_target_id != -1) {
     connection *c, *tmp;
@@ -410,16 +502,6 @@ void php_worker_init_script(php_worker *worker) {
   worker->state = phpq_run;
 }
 
-void php_worker_terminate(php_worker *worker, int flag, script_error_t terminate_reason, const char *error_message) {
-  worker->terminate_flag = true;
-  worker->terminate_reason = terminate_reason;
-  worker->error_message = error_message;
-  if (flag) {
-    vkprintf(0, "php_worker_terminate\n");
-    worker->conn = nullptr;
-  }
-}
-
 
 void php_worker_run_query_x2(php_worker *worker __attribute__((unused)), php_query_x2_t *query) {
   php_script_query_readed(php_script);
@@ -575,6 +657,14 @@ int php_worker_http_load_post_impl(php_worker *worker, char *buf, int min_len, i
   assert (c->basic_type != ct_pipe);
   assert (min_len <= max_len);
 
+  // the following pipelined request mustn't be read
+  if (max_len > worker->post_data_left) {
+    max_len = worker->post_data_left;
+  }
+  if (min_len > max_len) {
+    return -1;
+  }
+
   int read = 0;
   int have_bytes = get_total_ready_bytes(&c->In);
   if (have_bytes > 0) {
@@ -637,6 +727,7 @@ int php_worker_http_load_post_impl(php_worker *worker, char *buf, int min_len, i
   }
 
 //  fprintf (stderr, "%d bytes loaded\n", read);
+  worker->post_data_left -= read;
   return read;
 }
 
@@ -655,6 +746,25 @@ void php_worker_http_load_post(php_worker *worker, php_query_http_load_post_t *q
   }
 }
 
+void php_worker_http_send_chunk(php_worker *worker, php_query_http_send_chunk_t *query) {
+  php_script_query_readed(php_script);
+
+  static php_query_http_send_chunk_answer_t res;
+  res.sent = 0;
+  connection *c = worker->conn;
+  // chunked transfer encoding can't be used for HTTP/1.0 clients, the answer is sent as a whole in that case
+  if (worker->mode == http_worker && c != nullptr && !c->error && HTS_DATA(c)->http_ver >= HTTP_V11) {
+    write_out(&c->Out, query->headers, query->headers_len);
+    write_out(&c->Out, query->data, query->data_len);
+    flush_connection_output(c);
+    worker->answer_chunked = true;
+    res.sent = 1;
+  }
+  query->base.ans = &res;
+
+  php_script_query_answered(php_script);
+}
+
 void php_worker_answer_query(php_worker *worker, void *ans) {
   assert (worker != nullptr && ans != nullptr);
   auto q_base = (php_query_base_t *)php_script_get_query(php_script);
@@ -756,6 +866,10 @@ void php_worker_run_query(php_worker *worker) {
       query_stats.desc = "HTTP_LOAD_POST";
       php_worker_http_load_post(worker, (php_query_http_load_post_t *)q_base);
       break;
+    case PHPQ_HTTP_SEND_CHUNK:
+      query_stats.desc = "HTTP_SEND_CHUNK";
+      php_worker_http_send_chunk(worker, (php_query_http_send_chunk_t *)q_base);
+      break;
     default:
       assert ("unknown php_query type" && 0);
   }
@@ -893,7 +1007,12 @@ void php_worker_run(php_worker *worker) {
 
         if (worker->conn != nullptr) {
           if (worker->mode == http_worker) {
-            http_return(worker->conn, "ERROR", 5);
+            if (worker->answer_chunked) {
+              // the headers are sent already, so the client will see the body unfinished when the connection is closed
+              HTS_DATA(worker->conn)->query_flags &= ~QF_KEEPALIVE;
+            } else {
+              http_return(worker->conn, "ERROR", 5);
+            }
           } else if (worker->mode == rpc_worker) {
             if (!rpc_stored) {
               server_rpc_error(worker->conn, worker->req_id, -504, php_script_get_error(php_script));
@@ -924,7 +1043,6 @@ void php_worker_run(php_worker *worker) {
 
 void php_worker_free_script(php_worker *worker) {
   php_worker_run_flag = 0;
-  int f = 0;
 
   get_utime_monotonic();
   double worked = precise_now - worker->start_time;
@@ -946,12 +1064,7 @@ void php_worker_free_script(php_worker *worker) {
     vkprintf (1, "ATTENTION php script [query worked = %.5lf] [query waited for start = %.5lf] [req_id = %016llx]\n", worked, waited, worker->req_id);
   }
 
-  while (pending_http_queue.first_query != (conn_query *)&pending_http_queue && !f) {
-    //TODO: is it correct to do it?
-    conn_query *q = pending_http_queue.first_query;
-    f = q->requester != nullptr && q->requester->generation == q->req_generation;
-    delete_pending_query(q);
-  }
+  php_worker_wakeup_pending();
 
   php_queries_finish();
   php_script_clear(php_script);
@@ -969,6 +1082,18 @@ void php_worker_free_script(php_worker *worker) {
 
 void php_worker_finish(php_worker *worker) {
   vkprintf (2, "free php script [req_id = %016llx]\n", worker->req_id);
+  if (worker->post_data_left > 0) {
+    // the script hasn't read the whole request body, the rest is skipped to get to the next request on the connection
+    // the connection is already gone if the worker was terminated
+    connection *c = worker->conn;
+    if (c != nullptr && !c->error) {
+      const int skipped = advance_skip_read_ptr(&c->In, worker->post_data_left);
+      if (skipped < worker->post_data_left) {
+        c->skip_bytes = skipped - worker->post_data_left;
+      }
+    }
+    worker->post_data_left = 0;
+  }
   lease_on_worker_finish(worker);
   php_worker_free(worker);
 }
@@ -1075,6 +1200,17 @@ http_server_functions http_methods = [] {
 static char *qPost, *qGet, *qUri, *qHeaders;
 static int qPostLen, qGetLen, qUriLen, qHeadersLen;
 
+// the clients may tell how long they are going to wait for the answer, there is no point to run the scripts after that
+static const char CLIENT_TIMEOUT_HEADER[] = "X-Request-Timeout-Ms";
+
+static double apply_client_timeout(double timeout, long long client_timeout_ms) {
+  return client_timeout_ms > 0 ? std::min(timeout, std::max(client_timeout_ms * 0.001, MIN_CLIENT_SCRIPT_TIMEOUT)) : timeout;
+}
+
+static double get_client_deadline(long long client_timeout_ms) {
+  return client_timeout_ms > 0 ? precise_now + client_timeout_ms * 0.001 : 0;
+}
+
 static char no_cache_headers[] =
   "Pragma: no-cache\r\n"
   "Cache-Control: no-store\r\n";
@@ -1093,6 +1229,12 @@ void http_return(connection *c, const char *str, int len) {
   write_out(&c->Out, str, len);
 }
 
+void http_return_unavailable(connection *c, const char *str) {
+  const int len = static_cast<int>(strlen(str));
+  write_basic_http_header(c, 503, 0, len, no_cache_headers, "text/plain; charset=UTF-8");
+  write_out(&c->Out, str, len);
+}
+
 #define MAX_POST_SIZE (1 << 18)
 
 int hts_stopped = 0;
@@ -1106,6 +1248,11 @@ void hts_stop() {
     close(http_sfd);
     http_sfd = -1;
   }
+  if (http_reuseport_sfd != -1) {
+    epoll_close(http_reuseport_sfd);
+    close(http_reuseport_sfd);
+    http_reuseport_sfd = -1;
+  }
   sigterm_time = get_utime_monotonic() + SIGTERM_WAIT_TIMEOUT;
   hts_stopped = 1;
 }
@@ -1169,6 +1316,38 @@ int hts_func_execute(connection *c, int op) {
     }
   }
 
+  int chunked_body_size = 0;
+  if (D->query_flags & QF_CHUNKED) {
+    // chunked body is decoded to Post, so it is limited by MAX_POST_SIZE;
+    // a worker has a single http connection, so the decoding state is kept here until the whole body is received
+    static hts_chunked_body chunked_body;
+    static connection *chunked_body_conn = nullptr;
+    static int chunked_body_generation = 0;
+    if (chunked_body_conn != c || chunked_body_generation != c->generation) {
+      hts_chunked_body_init(&chunked_body);
+      chunked_body_conn = c;
+      chunked_body_generation = c->generation;
+    }
+
+    nb_iterator_t it;
+    nbit_set(&it, &c->In);
+    const int offset = D->header_size + chunked_body.encoded;
+    assert (nbit_advance(&it, offset) == offset);
+    int need_bytes = 0;
+    chunked_body_size = hts_decode_chunked_body(&chunked_body, &it, Post, MAX_POST_SIZE - 1, &need_bytes);
+    nbit_clear(&it);
+    if (chunked_body_size == 0) {
+      vkprintf (1, "-- need at least %d more bytes of chunked body, waiting\n", need_bytes);
+      return need_bytes;
+    }
+    chunked_body_conn = nullptr;
+    if (chunked_body_size < 0) {
+      D->query_flags &= ~QF_KEEPALIVE;
+      return chunked_body_size == -2 ? -413 : -400;
+    }
+    D->data_size = chunked_body.decoded;
+  }
+
   assert (D->header_size <= MAX_HTTP_HEADER_SIZE);
   assert (read_in(&c->In, &ReqHdr, D->header_size) == D->header_size);
 
@@ -1184,7 +1363,13 @@ int hts_func_execute(connection *c, int op) {
 
 //  D->query_flags &= ~QF_KEEPALIVE;
 
-  if (0 < D->data_size && D->data_size < MAX_POST_SIZE) {
+  if (chunked_body_size > 0) {
+    assert (advance_skip_read_ptr(&c->In, chunked_body_size) == chunked_body_size);
+    Post[D->data_size] = 0;
+    vkprintf (1, "have %d POST bytes in %d chunked bytes: `%.80s`\n", D->data_size, chunked_body_size, Post);
+    qPost = Post;
+    qPostLen = D->data_size;
+  } else if (0 < D->data_size && D->data_size < MAX_POST_SIZE) {
     assert (read_in(&c->In, Post, D->data_size) == D->data_size);
     Post[D->data_size] = 0;
     vkprintf (1, "have %d POST bytes: `%.80s`\n", D->data_size, Post);
@@ -1232,11 +1417,24 @@ int hts_func_execute(connection *c, int op) {
                                                       inet_sockaddr_address(&c->remote_endpoint),
                                                       inet_sockaddr_port(&c->remote_endpoint));
 
+  double actual_script_timeout = script_timeout;
+  long long client_timeout_ms = 0;
+  char client_timeout_header[32];
+  if (get_http_header(qHeaders, qHeadersLen, client_timeout_header, sizeof(client_timeout_header),
+                      CLIENT_TIMEOUT_HEADER, static_cast<int>(sizeof(CLIENT_TIMEOUT_HEADER) - 1)) > 0) {
+    client_timeout_ms = atoll(client_timeout_header);
+    actual_script_timeout = apply_client_timeout(actual_script_timeout, client_timeout_ms);
+  }
+
   static long long http_script_req_id = 0;
-  php_worker *worker = php_worker_create(http_worker, c, http_data, nullptr, script_timeout, ++http_script_req_id);
+  php_worker *worker = php_worker_create(http_worker, c, http_data, nullptr, actual_script_timeout, ++http_script_req_id);
+  worker->client_deadline = get_client_deadline(client_timeout_ms);
+  if (qPost == nullptr) {
+    worker->post_data_left = qPostLen;
+  }
   D->extra = worker;
 
-  set_connection_timeout(c, script_timeout);
+  set_connection_timeout(c, actual_script_timeout);
   c->status = conn_wait_net;
   return do_hts_func_wakeup(c, 0);
 }
@@ -1487,6 +1685,56 @@ static double normalize_script_timeout(double timeout_sec) {
   return timeout_sec;
 }
 
+// the engines compress the answers to the queries which declare the supported compression version in their header
+static bool is_compressed_rpc_answer() {
+  int answer_begin[5];
+  if (tl_fetch_unread() < static_cast<int64_t>(sizeof(answer_begin))) {
+    return false;
+  }
+  tl_fetch_lookup_data(reinterpret_cast<char *>(answer_begin), sizeof(answer_begin));
+  return static_cast<uint32_t>(answer_begin[3]) == TL_REQ_RESULT_HEADER
+         && (answer_begin[4] & vk::tl::common::rpc_req_result_extra_flags::compression_version);
+}
+
+// the answer is decompressed straight into the script memory, its header is kept without the compression version
+static int create_decompressed_rpc_answer_event() {
+  tl_query_answer_header_t header;
+  const bool header_fetched = tl_fetch_query_answer_header(&header, false);
+  const auto id = static_cast<slot_id_t>(header.qid);
+  if (!header_fetched) {
+    return create_rpc_error_event(id, TL_ERROR_HEADER, "Can't parse the compressed answer header", nullptr);
+  }
+
+  const int version = header.compression_version;
+  header.flags &= ~vk::tl::common::rpc_req_result_extra_flags::compression_version;
+  header.compression_version = COMPRESSION_VERSION_NONE;
+  static char header_buf[1024];
+  const int header_len = vk::tl::save_to_buffer(header_buf, sizeof(header_buf), [&header] { tl_store_answer_header(&header); });
+
+  int result_len = tl_fetch_decompressed_size(version);
+  const bool is_size_known = result_len >= 0;
+  if (!is_size_known) {
+    // the frames of the older engines have no content size, such answers are decompressed into the net buffers first
+    tl_decompress_remaining(version);
+    result_len = static_cast<int>(tl_fetch_unread());
+  }
+
+  net_event_t *event = nullptr;
+  const int event_status = create_rpc_answer_event(id, header_len + result_len, &event);
+  if (event_status <= 0 || event->result == nullptr) {
+    return event_status;
+  }
+  memcpy(event->result, header_buf, header_len);
+  if (!is_size_known) {
+    auto fetched_bytes = tl_fetch_data(event->result + header_len, result_len);
+    assert(fetched_bytes == result_len);
+  } else if (!tl_decompress_remaining_to(version, event->result + header_len, result_len)) {
+    unalloc_rpc_answer_event(event);
+    return create_rpc_error_event(id, TL_ERROR_RESPONSE_SYNTAX, "Can't decompress the answer", nullptr);
+  }
+  return event_status;
+}
+
 int rpcx_execute(connection *c, int op, raw_message *raw) {
   vkprintf(1, "rpcx_execute: fd=%d, op=%d, len=%d\n", c->fd, op, raw->total_bytes);
 
@@ -1547,6 +1795,14 @@ int rpcx_execute(connection *c, int op, raw_message *raw) {
       }
       // got a new task from the tasks engine
       tl_fetch_init_raw_message(raw);
+
+      // the query header is looked up for the client's timeout, the script parses it once again
+      tl_query_header_t query_header;
+      tl_fetch_mark();
+      const bool has_query_header = tl_fetch_query_header(&query_header);
+      tl_fetch_mark_restore();
+      tl_fetch_reset_error();
+
       auto op_from_tl = tl_fetch_int();
       len -= static_cast<int>(sizeof(op_from_tl));
       assert(op_from_tl == op);
@@ -1576,6 +1832,11 @@ int rpcx_execute(connection *c, int op, raw_message *raw) {
       }
       auto custom_settings = try_fetch_lookup_custom_worker_settings();
       double actual_script_timeout = custom_settings.has_timeout() ? normalize_script_timeout(custom_settings.php_timeout_ms / 1000.0) : script_timeout;
+      long long client_timeout_ms = 0;
+      if (has_query_header && (query_header.flags & vk::tl::common::rpc_invoke_req_extra_flags::custom_timeout_ms)) {
+        client_timeout_ms = query_header.custom_timeout;
+        actual_script_timeout = apply_client_timeout(actual_script_timeout, client_timeout_ms);
+      }
       set_connection_timeout(c, actual_script_timeout);
 
       char buf[len + 1];
@@ -1586,12 +1847,15 @@ int rpcx_execute(connection *c, int op, raw_message *raw) {
       }
       assert(fetched_bytes == len);
       auto D = TCP_RPC_DATA(c);
+      const bool declares_compression = has_query_header && (query_header.flags & vk::tl::common::rpc_invoke_req_extra_flags::supported_compression_version);
       rpc_query_data *rpc_data = rpc_query_data_create(reinterpret_cast<int *>(buf), len / static_cast<int>(sizeof(int)),
                                                        req_id, D->remote_pid.ip, D->remote_pid.port,
-                                                       D->remote_pid.pid, D->remote_pid.utime);
+                                                       D->remote_pid.pid, D->remote_pid.utime,
+                                                       declares_compression ? query_header.supported_compression_version : COMPRESSION_VERSION_NONE);
 
       php_worker *worker = php_worker_create(run_once ? once_worker : rpc_worker, c, nullptr, rpc_data,
                                              actual_script_timeout, req_id);
+      worker->client_deadline = get_client_deadline(client_timeout_ms);
       D->extra = worker;
 
       c->status = conn_wait_net;
@@ -1606,6 +1870,11 @@ int rpcx_execute(connection *c, int op, raw_message *raw) {
 
       tl_fetch_init_raw_message(raw);
 
+      if (op == TL_RPC_REQ_RESULT && is_compressed_rpc_answer()) {
+        event_status = create_decompressed_rpc_answer_event();
+        break;
+      }
+
       auto op_from_tl = tl_fetch_int();
       assert(op_from_tl == op);
 
@@ -1924,7 +2193,6 @@ void prepare_full_stats() {
 
   PhpWorkerStats::get_local().update_idle_time(epoll_total_idle_time(), get_uptime(),
                                                epoll_average_idle_time(), epoll_average_idle_quotient());
-  PhpWorkerStats::get_local().recalc_worker_percentiles();
   const int stats_size = PhpWorkerStats::get_local().write_into(s, s_left);
   s += stats_size;
   s_left -= stats_size;
@@ -1942,6 +2210,24 @@ void prepare_full_stats() {
   W ("pid %d\t%d\n", pid, pid);
   W ("active_special_connections %d\t%d\n", pid, active_special_connections);
   W ("max_special_connections %d\t%d\n", pid, max_special_connections);
+
+  const auto &regexp_cache_stats = regexp_cache_get_stats();
+  W ("regexp_cache_hits %d\t%" PRIi64 "\n", pid, regexp_cache_stats.hits);
+  W ("regexp_cache_misses %d\t%" PRIi64 "\n", pid, regexp_cache_stats.misses);
+  W ("regexp_cache_evictions %d\t%" PRIi64 "\n", pid, regexp_cache_stats.evictions);
+  W ("regexp_cache_entries %d\t%" PRIi64 "\n", pid, regexp_cache_stats.entries);
+  W ("regexp_cache_compile_time %d\t%.6lf\n", pid, regexp_cache_stats.compile_time);
+  for (const auto &pattern_stats : regexp_cache_get_hottest_patterns(10)) {
+    // patterns may contain anything, but the stats are line and tab separated
+    std::string pattern = pattern_stats.pattern.substr(0, 64);
+    std::replace_if(pattern.begin(), pattern.end(), [](char c) { return !isprint(static_cast<unsigned char>(c)); }, '?');
+    W ("regexp_cache_pattern %d\t%" PRIi64 "\t%.6lf\t%s\n", pid, pattern_stats.hits, pattern_stats.compile_time, pattern.c_str());
+  }
+  for (const auto &target_stats : RpcTargets::get().get_stats(precise_now)) {
+    W ("rpc_target %d\t%" PRIi64 "\t%" PRIi64 "\t%" PRIi64 "\t%" PRIi64 "\t%" PRIi64 "\t%.6lf\t%.6lf\t%d\t%s\n", pid,
+       target_stats.queries, target_stats.errors, target_stats.hedges, target_stats.hedge_wins, target_stats.ejections,
+       target_stats.latency_mean, target_stats.latency_p95, target_stats.ejected ? 1 : 0, target_stats.name.c_str());
+  }
 //  W ("TODO: more stats\n");
 #undef W
   stats_len = (int)(s - stats);
@@ -2070,7 +2356,7 @@ void cron() {
 }
 
 int try_get_http_fd() {
-  return server_socket(http_port, settings_addr, backlog, 0);
+  return server_socket(http_port, settings_addr, backlog, http_reuseport ? SM_REUSEPORT : 0);
 }
 
 void open_json_log() {
@@ -2152,6 +2438,11 @@ void start_server() {
     init_listening_tcpv6_connection(http_sfd, &ct_php_engine_http_server, &http_methods, SM_SPECIAL);
   }
 
+  if (http_reuseport_sfd >= 0) {
+    vkprintf (1, "accept http connections from own reuseport socket, fd=%d\n", http_reuseport_sfd);
+    init_listening_tcpv6_connection(http_reuseport_sfd, &ct_php_engine_http_server, &http_methods, SM_SPECIAL);
+  }
+
   if (rpc_sfd >= 0) {
     init_listening_connection(rpc_sfd, &ct_php_engine_rpc_server, &rpc_methods);
   }
@@ -2203,6 +2494,10 @@ void start_server() {
   assert (SIGRTMIN <= SIGSTAT && SIGSTAT <= SIGRTMAX);
   dl_sigaction(SIGSTAT, nullptr, dl_get_empty_sigset(), SA_SIGINFO | SA_ONSTACK | SA_RESTART, sigstats_handler);
 
+  // let the master know that the worker is ready, it measures the worker startup latency this way;
+  // the signals are still blocked here, so sigstats_handler can't interleave with this write
+  write_immediate_stats_to_pipe();
+
   dl_allow_all_signals();
 
   vkprintf (1, "Server started\n");
@@ -2212,6 +2507,7 @@ void start_server() {
                 active_connections, maxconn, NB_used, NB_alloc, NB_max);
     }
     epoll_work(57);
+    publish_imm_stats_if_ready_for_accept_changed();
 
     if (precise_now > next_create_outbound) {
       create_all_outbound_connections();
@@ -2266,6 +2562,10 @@ void start_server() {
     epoll_close(http_sfd);
     assert (close(http_sfd) >= 0);
   }
+  if (http_reuseport_sfd >= 0) {
+    epoll_close(http_reuseport_sfd);
+    assert (close(http_reuseport_sfd) >= 0);
+  }
 }
 
 void set_instance_cache_memory_limit(size_t limit);
@@ -2586,6 +2886,56 @@ int main_args_handler(int i) {
       kprintf("couldn't set net-dc-mask '%s'\n", optarg);
       return -1;
     }
+    case 2013: {
+      const int regexp_cache_size = atoi(optarg);
+      if (regexp_cache_size < 0) {
+        kprintf("regexp-cache-size has to be non negative\n");
+        return -1;
+      }
+      set_regexp_cache_max_entries(static_cast<size_t>(regexp_cache_size));
+      return 0;
+    }
+    case 2014: {
+      http_reuseport = 1;
+      return 0;
+    }
+    case 2015: {
+      pending_queries_limit = atoi(optarg);
+      if (pending_queries_limit < 0) {
+        kprintf("pending-queries-limit has to be non negative\n");
+        return -1;
+      }
+      return 0;
+    }
+    case 2016: {
+      const int window_us = atoi(optarg);
+      if (window_us < 0) {
+        kprintf("rpc-coalescing-window has to be non negative\n");
+        return -1;
+      }
+      set_rpc_coalescing_window(window_us * 1e-6);
+      return 0;
+    }
+    case 2017: {
+      // [<tl magic>:]<file name>, the dictionary without the magic is the default one
+      uint32_t tl_magic = 0;
+      const char *file_name = optarg;
+      const char *colon = strchr(optarg, ':');
+      if (colon != nullptr && strncmp(optarg, "0x", 2) == 0) {
+        char *magic_end = nullptr;
+        tl_magic = static_cast<uint32_t>(strtoul(optarg, &magic_end, 16));
+        if (magic_end != colon) {
+          kprintf("couldn't parse the tl magic of rpc-zstd-dictionary '%s'\n", optarg);
+          return -1;
+        }
+        file_name = colon + 1;
+      }
+      if (ZstdDictionaries::get().load(file_name, tl_magic)) {
+        return 0;
+      }
+      kprintf("couldn't load the zstd dictionary '%s'\n", file_name);
+      return -1;
+    }
 
     default:
       return -1;
@@ -2651,6 +3001,11 @@ void parse_main_args(int argc, char *argv[]) {
   parse_option("profiler-log-prefix", required_argument, 2010, "set profier log path perfix");
   parse_option("mysql-db-name", required_argument, 2011, "database name of MySQL to connect");
   parse_option("net-dc-mask", required_argument, 2012, "a string formatted like '8=1.2.3.4/12' to detect a datacenter by ipv4");
+  parse_option("regexp-cache-size", required_argument, 2013, "max number of dynamic regexps compiled once and reused between requests (default: 4096, 0 disables)");
+  parse_option("http-reuseport", no_argument, 2014, "every worker accepts http connections from its own SO_REUSEPORT listening socket (in master mode)");
+  parse_option("pending-queries-limit", required_argument, 2015, "the oldest of the queries waiting for the worker is answered with an error when there are more of them (default: 0, unlimited)");
+  parse_option("rpc-coalescing-window", required_argument, 2016, "microseconds after an rpc flush during which the sent rpc queries are gathered to be written to the connections at once (default: 0, disabled)");
+  parse_option("rpc-zstd-dictionary", required_argument, 2017, "[<tl magic>:]<file>, a trained zstd dictionary for the rpc compression of the tl type with the magic or for the rest of them, can be passed several times");
   parse_engine_options_long(argc, argv, main_args_handler);
   parse_main_args_till_option(argc, argv);
 }
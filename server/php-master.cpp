@@ -11,6 +11,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <poll.h>
 #include <pthread.h>
 #include <semaphore.h>
@@ -48,10 +50,12 @@
 #include "runtime/confdata-global-manager.h"
 #include "runtime/instance_cache.h"
 #include "server/confdata-binlog-replay.h"
+#include "server/latency-histograms.h"
 #include "server/php-engine-vars.h"
 #include "server/php-engine.h"
 #include "server/php-worker-stats.h"
 #include "server/php-master-tl-handlers.h"
+#include "server/php-runner.h"
 
 extern const char *engine_tag;
 
@@ -120,7 +124,8 @@ void mem_info_add(mem_info_t *dst, const mem_info_t &other) {
   dst->vm += other.vm;
   dst->rss_peak += other.rss_peak;
   dst->rss += other.rss;
-  // do not accumulate rss_file and rss_shmem,
+  dst->rss_private += other.rss_private;
+  // do not accumulate rss_file, rss_shmem and rss_shared,
   // because they are about shared memory and accumulated value will show strange stat
 }
 
@@ -133,6 +138,10 @@ static long workers_killed{0};
 static long workers_hung{0};
 static long workers_terminated{0};
 static long workers_failed{0};
+static long workers_startup_latency_n{0};
+static double workers_startup_latency_sum{0};
+static double workers_startup_latency_max{0};
+static double workers_startup_latency_last{0};
 
 struct CpuStatTimestamp {
   double timestamp;
@@ -342,6 +351,10 @@ struct Stats {
     res += buffer;
     sprintf(buffer, "RSS_max%s\t%lluKb\n", pid_s.c_str(), mem_info.rss_peak);
     res += buffer;
+    sprintf(buffer, "RSS_shared%s\t%lluKb\n", pid_s.c_str(), mem_info.rss_shared);
+    res += buffer;
+    sprintf(buffer, "RSS_private%s\t%lluKb\n", pid_s.c_str(), mem_info.rss_private);
+    res += buffer;
 
     if (is_main) {
       std::string running_workers_max_vals;
@@ -563,6 +576,8 @@ struct worker_info_t {
 
   double last_activity_time;
   double start_time;
+  double fork_time;
+  double ready_time;
   double kill_time;
   int kill_flag;
 
@@ -591,6 +606,11 @@ static double last_failed;
 static int *http_fd;
 static int http_fd_port;
 static int (*try_get_http_fd)();
+// with --http-reuseport every worker slot (logname_id) has its own listening socket in the SO_REUSEPORT group of http_fd;
+// the socket is closed as soon as the worker of the slot is terminated or dies, so the kernel stops queueing connections to it
+static int http_reuseport_fds[MAX_WORKERS];
+
+static void close_http_reuseport_fd(int worker_logname_id);
 static master_state state;
 static bool in_sigterm;
 
@@ -644,8 +664,10 @@ void delete_worker(worker_info_t *w) {
     dead_stime += w->my_info.stime;
   }
   dead_worker_stats.add_from(w->stats->worker_stats);
-  // ignore dead workers memory and percentiles stats
-  dead_worker_stats.reset_memory_and_percentiles_stats();
+  // ignore dead workers memory stats
+  dead_worker_stats.reset_memory_stats();
+  add_dead_worker_latency_histograms(w->logname_id);
+  close_http_reuseport_fd(w->logname_id);
   worker_free(w);
   w->next_worker = free_workers;
   free_workers = w;
@@ -659,6 +681,9 @@ void start_master(int *new_http_fd, int (*new_try_get_http_fd)(), int new_http_f
   for (int i = MAX_WORKERS - 1; i >= 0; i--) {
     add_logname_id(i);
   }
+  std::fill(std::begin(http_reuseport_fds), std::end(http_reuseport_fds), -1);
+  init_imm_stats_slots();
+  init_latency_histograms();
 
   std::string s = cluster_name;
   std::replace_if(s.begin(), s.end(), [](unsigned char c) { return !isalpha(c); }, '_');
@@ -739,6 +764,8 @@ void start_master(int *new_http_fd, int (*new_try_get_http_fd)(), int new_http_f
 void terminate_worker(worker_info_t *w) {
   vkprintf(1, "kill_worker: send SIGTERM to [pid = %d]\n", (int)w->pid);
   kill(w->pid, SIGTERM);
+  // the worker closes its copy on SIGTERM, after that the connections go to the other workers
+  close_http_reuseport_fd(w->logname_id);
   w->is_dying = 1;
   w->kill_time = my_now + 35;
   w->kill_flag = 0;
@@ -840,6 +867,24 @@ void worker_set_immediate_stats(worker_info_t *w, php_immediate_stats_t *istats)
   w->stats->istats = *istats;
 }
 
+// the previous stats are kept if the worker is killed in the middle of their update
+void update_workers_immediate_stats() {
+  for (int i = 0; i < me_workers_n; i++) {
+    read_imm_stats_slot(workers[i]->logname_id, &workers[i]->stats->istats);
+  }
+}
+
+// a worker sends its immediate stats as soon as it is ready to serve requests,
+// so the first packet marks the end of the worker startup
+void worker_set_ready(worker_info_t *w) {
+  w->ready_time = dl_time();
+  const double latency = w->ready_time - w->fork_time;
+  workers_startup_latency_n++;
+  workers_startup_latency_sum += latency;
+  workers_startup_latency_max = std::max(workers_startup_latency_max, latency);
+  workers_startup_latency_last = latency;
+}
+
 
 /*** PIPE connection ***/
 struct pr_data {
@@ -878,6 +923,9 @@ int pr_execute(connection *c, int op, raw_message *raw) {
     }
 
     if (op == RPC_PHP_IMMEDIATE_STATS) {
+      if (w->ready_time == 0) {
+        worker_set_ready(w);
+      }
       worker_set_immediate_stats(w, reinterpret_cast<php_immediate_stats_t *>(buf.data()));
     }
 
@@ -921,6 +969,42 @@ void clear_pipe_info(pipe_info_t *info) {
   info->reader = nullptr;
 }
 
+static int get_http_reuseport_fd(int worker_logname_id) {
+  static bool reuseport_failed = false;
+  if (!http_reuseport || reuseport_failed || http_fd == nullptr || *http_fd == -1) {
+    return -1;
+  }
+  int &fd = http_reuseport_fds[worker_logname_id];
+  if (fd == -1) {
+    fd = try_get_http_fd();
+    if (fd == -1) {
+      // e.g. http_fd is got from the previous master started without SO_REUSEPORT
+      vkprintf(-1, "can't create reuseport http socket, workers will accept from the shared one only\n");
+      reuseport_failed = true;
+    }
+  }
+  return fd;
+}
+
+static void close_http_reuseport_fd(int worker_logname_id) {
+  int &fd = http_reuseport_fds[worker_logname_id];
+  if (fd != -1) {
+    // the connections waiting in its accept queue are reset, unless net.ipv4.tcp_migrate_req moves them to the other sockets of the group
+    close(fd);
+    fd = -1;
+  }
+}
+
+static int get_accept_queue_len(int fd) {
+  tcp_info info;
+  socklen_t info_len = sizeof(info);
+  if (fd == -1 || getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &info_len) == -1) {
+    return -1;
+  }
+  // for a listening socket it is the number of established connections waiting for accept
+  return static_cast<int>(info.tcpi_unacked);
+}
+
 int run_worker() {
   dl_block_all_signals();
 
@@ -936,10 +1020,15 @@ int run_worker() {
 
   tot_workers_started++;
 
+  int worker_logname_id = get_logname_id();
+  const int worker_http_reuseport_fd = get_http_reuseport_fd(worker_logname_id);
+  reset_imm_stats_slot(worker_logname_id);
+  reset_latency_histograms_slot(worker_logname_id);
+
+  const double fork_time = dl_time();
   pid_t new_pid = fork();
   assert (new_pid != -1 && "failed to fork");
 
-  int worker_logname_id = get_logname_id();
   if (new_pid == 0) {
     prctl(PR_SET_PDEATHSIG, SIGKILL); // TODO: or SIGTERM
     if (getppid() != me->pid) {
@@ -969,6 +1058,14 @@ int run_worker() {
 
     master_sfd = -1;
 
+    for (int &fd : http_reuseport_fds) {
+      if (fd != -1 && fd != worker_http_reuseport_fd) {
+        close(fd);
+      }
+      fd = -1;
+    }
+    http_reuseport_sfd = worker_http_reuseport_fd;
+
     for (int i = 0; i < allocated_targets; i++) {
       while (Targets[i].refcnt > 0) {
         destroy_target(&Targets[i]);
@@ -1015,6 +1112,8 @@ int run_worker() {
   worker->is_dying = 0;
   worker->generation = ++conn_generation;
   worker->start_time = my_now;
+  worker->fork_time = fork_time;
+  worker->ready_time = 0;
   worker->logname_id = worker_logname_id;
   worker->last_activity_time = my_now;
 
@@ -1340,6 +1439,7 @@ int return_one_key_val(connection *c, const char *val, int vlen) {
 int update_mem_stats();
 
 std::string php_master_prepare_stats(bool full_flag, int worker_pid) {
+  update_workers_immediate_stats();
   std::string res, header;
   header = server_stats.to_string(me == nullptr ? 0 : (int)me->pid, false, true);
   int total_workers_n = 0;
@@ -1372,6 +1472,11 @@ std::string php_master_prepare_stats(bool full_flag, int worker_pid) {
       if (worker_pid == -1 || w->pid == worker_pid) {
         sprintf(buf, "worker_uptime %d\t%.0lf\n", (int)w->pid, worker_uptime);
         res += buf;
+        const int accept_queue_len = get_accept_queue_len(http_reuseport_fds[w->logname_id]);
+        if (accept_queue_len != -1) {
+          sprintf(buf, "accept_queue %d\t%d\n", (int)w->pid, accept_queue_len);
+          res += buf;
+        }
         res += w->stats->to_string(w->pid, full_flag);
         res += "\n";
       }
@@ -1412,9 +1517,20 @@ std::string php_master_prepare_stats(bool full_flag, int worker_pid) {
   header += buf;
   sprintf(buf, "workers_failed\t%ld\n", workers_failed);
   header += buf;
+  sprintf(buf, "worker_startup_latency_avg\t%.6lf\n", workers_startup_latency_n ? workers_startup_latency_sum / workers_startup_latency_n : 0.0);
+  header += buf;
+  sprintf(buf, "worker_startup_latency_max\t%.6lf\n", workers_startup_latency_max);
+  header += buf;
+  sprintf(buf, "worker_startup_latency_last\t%.6lf\n", workers_startup_latency_last);
+  header += buf;
+  if (http_fd != nullptr && *http_fd != -1) {
+    sprintf(buf, "http_accept_queue\t%d\n", get_accept_queue_len(*http_fd));
+    header += buf;
+  }
 
   if (full_flag) {
     header += worker_stats.to_string();
+    header += latency_histograms_to_string();
   }
   if (!full_flag && worker_pid == -2) {
     header += " pid \t  state time\t  port  actor time\tcustom_server_status time\n";
@@ -1526,7 +1642,6 @@ int php_master_get(connection *c, const char *old_key, int old_key_len) {
       D->worker_pid = -2;
     }
 
-    create_stats_queries(c, SPOLL_SEND_STATS | SPOLL_SEND_IMMEDIATE_STATS, -1);
     if (D->full_flag) {
       create_stats_queries(c, SPOLL_SEND_STATS | SPOLL_SEND_FULL_STATS, D->worker_pid);
     }
@@ -1574,6 +1689,7 @@ struct WorkerStats {
   int ready_for_accept_workers_n{0};
 
   static WorkerStats collect() {
+    update_workers_immediate_stats();
     WorkerStats result;
     for (int i = 0; i < me_workers_n; i++) {
       worker_info_t *w = workers[i];
@@ -1672,6 +1788,22 @@ STATS_PROVIDER_TAGGED(kphp_stats, 100, STATS_TAG_KPHP_SERVER) {
   add_histogram_stat_long(stats, "workers.total.hung", workers_hung);
   add_histogram_stat_long(stats, "workers.total.terminated", workers_terminated);
   add_histogram_stat_long(stats, "workers.total.failed", workers_failed);
+  add_histogram_stat_double(stats, "workers.startup_latency.avg",
+                            workers_startup_latency_n ? workers_startup_latency_sum / workers_startup_latency_n : 0.0);
+  add_histogram_stat_double(stats, "workers.startup_latency.max", workers_startup_latency_max);
+  add_histogram_stat_double(stats, "workers.startup_latency.last", workers_startup_latency_last);
+
+  int max_accept_queue = 0;
+  int total_accept_queue = http_fd != nullptr ? std::max(get_accept_queue_len(*http_fd), 0) : 0;
+  for (int i = 0; i < me_workers_n; i++) {
+    if (!workers[i]->is_dying) {
+      const int accept_queue_len = std::max(get_accept_queue_len(http_reuseport_fds[workers[i]->logname_id]), 0);
+      max_accept_queue = std::max(max_accept_queue, accept_queue_len);
+      total_accept_queue += accept_queue_len;
+    }
+  }
+  add_histogram_stat_long(stats, "workers.accept_queue.max", max_accept_queue);
+  add_histogram_stat_long(stats, "workers.accept_queue.total", total_accept_queue);
 
   const auto workers_stats = server_stats.misc[1].get_stat();
   add_histogram_stat_double(stats, "workers.running.avg_1m", workers_stats.running_workers_avg);
@@ -1712,10 +1844,22 @@ STATS_PROVIDER_TAGGED(kphp_stats, 100, STATS_TAG_KPHP_SERVER) {
                           instance_cache_element_stats.elements_logically_expired_and_ignored.load(std::memory_order_relaxed));
   add_histogram_stat_long(stats, "instance_cache.elements.logically_expired_but_fetched",
                           instance_cache_element_stats.elements_logically_expired_but_fetched.load(std::memory_order_relaxed));
+  add_histogram_stat_long(stats, "instance_cache.elements.retired",
+                          instance_cache_element_stats.elements_retired.load(std::memory_order_relaxed));
+  add_histogram_stat_long(stats, "instance_cache.allocator_lock.contended",
+                          instance_cache_element_stats.allocator_lock_contended.load(std::memory_order_relaxed));
+  add_histogram_stat_long(stats, "instance_cache.allocator_lock.wait_ns",
+                          instance_cache_element_stats.allocator_lock_wait_ns.load(std::memory_order_relaxed));
+  add_histogram_stat_long(stats, "instance_cache.fetch_latency_ns.percentile_50",
+                          instance_cache_element_stats.get_fetch_latency_percentile(0.5).count());
+  add_histogram_stat_long(stats, "instance_cache.fetch_latency_ns.percentile_95",
+                          instance_cache_element_stats.get_fetch_latency_percentile(0.95).count());
+  add_histogram_stat_long(stats, "instance_cache.fetch_latency_ns.percentile_99",
+                          instance_cache_element_stats.get_fetch_latency_percentile(0.99).count());
 
   write_confdata_stats_to(stats);
-  server_stats.worker_stats.recalc_master_percentiles();
   server_stats.worker_stats.to_stats(stats);
+  latency_histograms_to_stats(stats);
 
   static QPSCalculator qps_calculator{FULL_STATS_PERIOD * 2};
   qps_calculator.update(my_now, server_stats.worker_stats);
@@ -1726,6 +1870,9 @@ STATS_PROVIDER_TAGGED(kphp_stats, 100, STATS_TAG_KPHP_SERVER) {
   unsigned long long max_vms = 0;
   unsigned long long max_rss = 0;
   unsigned long long max_shared = 0;
+  unsigned long long max_rss_shared = 0;
+  unsigned long long max_rss_private = 0;
+  unsigned long long total_rss_private = 0;
   for (int i = 0; i < me_workers_n; i++) {
     worker_info_t *w = workers[i];
     if (!w->is_dying) {
@@ -1733,12 +1880,18 @@ STATS_PROVIDER_TAGGED(kphp_stats, 100, STATS_TAG_KPHP_SERVER) {
       max_vms = std::max(max_vms, mem_stats.vm_peak);
       max_rss = std::max(max_rss, mem_stats.rss_peak);
       max_shared = std::max(max_shared, mem_stats.rss_shmem + mem_stats.rss_file);
+      max_rss_shared = std::max(max_rss_shared, mem_stats.rss_shared);
+      max_rss_private = std::max(max_rss_private, mem_stats.rss_private);
+      total_rss_private += mem_stats.rss_private;
     }
   }
 
   add_histogram_stat_long(stats, "memory.vms_max", max_vms * 1024);
   add_histogram_stat_long(stats, "memory.rss_max", max_rss * 1024);
   add_histogram_stat_long(stats, "memory.shared_max", max_shared * 1024);
+  add_histogram_stat_long(stats, "memory.rss_shared_max", max_rss_shared * 1024);
+  add_histogram_stat_long(stats, "memory.rss_private_max", max_rss_private * 1024);
+  add_histogram_stat_long(stats, "memory.rss_private_total", total_rss_private * 1024);
 }
 
 int php_master_http_execute(struct connection *c, int op) {
@@ -1929,12 +2082,14 @@ int signal_epoll_handler(int fd __attribute__((unused)), void *data __attribute_
 
 int update_mem_stats() {
   get_mem_stats(me->pid, &server_stats.mem_info);
+  get_mem_sharing_stats(me->pid, &server_stats.mem_info);
   for (int i = 0; i < me_workers_n; i++) {
     worker_info_t *w = workers[i];
 
     if (get_mem_stats(w->pid, &w->stats->mem_info) != 1) {
       continue;
     }
+    get_mem_sharing_stats(w->pid, &w->stats->mem_info);
     mem_info_add(&server_stats.mem_info, w->stats->mem_info);
   }
   return 0;
@@ -1967,7 +2122,9 @@ static void cron() {
   dl_assert (get_cpu_err, "get_cpu_total failed");
 
   server_stats.worker_stats.copy_internal_from(dead_worker_stats);
-  server_stats.worker_stats.reset_memory_and_percentiles_stats();
+  server_stats.worker_stats.reset_memory_stats();
+  update_workers_immediate_stats();
+  update_latency_histograms(my_now);
   int running_workers = 0;
   for (int i = 0; i < me_workers_n; i++) {
     worker_info_t *w = workers[i];
@@ -1992,7 +2149,6 @@ static void cron() {
   CpuStatTimestamp cpu_timestamp{my_now, utime, stime, cpu_total};
   server_stats.update(cpu_timestamp);
 
-  create_stats_queries(nullptr, SPOLL_SEND_STATS | SPOLL_SEND_IMMEDIATE_STATS, -1);
   static double last_full_stats = -1;
   if (last_full_stats + FULL_STATS_PERIOD < my_now) {
     last_full_stats = my_now;
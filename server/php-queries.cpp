@@ -9,6 +9,7 @@
 #include <cstdio>
 #include <cstring>
 
+#include "common/php-functions.h"
 #include "common/precise-time.h"
 
 #include "runtime/allocator.h"
@@ -55,10 +56,27 @@ php_query_http_load_post_answer_t *php_query_http_load(char *buf, int min_len, i
 
 int http_load_long_query(char *buf, int min_len, int max_len) {
   php_query_http_load_post_answer_t *ans = php_query_http_load(buf, min_len, max_len);
-  assert (min_len <= ans->loaded_bytes && ans->loaded_bytes <= max_len);
+  // -1 if the body can't be loaded, the worker terminates the script then
+  assert (ans->loaded_bytes == -1 || (min_len <= ans->loaded_bytes && ans->loaded_bytes <= max_len));
   return ans->loaded_bytes;
 }
 
+/** send a part of chunked http answer query **/
+bool http_send_chunk(const char *headers, int headers_len, const char *data, int data_len) {
+  assert (PHPScriptBase::is_running);
+
+  php_query_http_send_chunk_t q;
+  q.base.type = PHPQ_HTTP_SEND_CHUNK;
+  q.headers = headers;
+  q.headers_len = headers_len;
+  q.data = data;
+  q.data_len = data_len;
+
+  PHPScriptBase::current_script->ask_query((void *)&q);
+
+  return static_cast<php_query_http_send_chunk_answer_t *>(q.base.ans)->sent;
+}
+
 
 /***
  QUERY MEMORY ALLOCATOR
@@ -782,8 +800,9 @@ void *dl_allocate_safe(size_t size) {
     return nullptr;
   }
 
-  assert (size <= (1u << 30) - 13);
-  void *dest = dl::allocate(size + 13);
+  // the result is laid out as a string_raw(), so it can be used as a string without copying, see string::assign_raw()
+  assert (size <= (1u << 30) - STRING_RAW_HEADER_SIZE - 1);
+  void *dest = dl::allocate(size + STRING_RAW_HEADER_SIZE + 1);
   if (dest == nullptr) {
     return nullptr;
   }
@@ -792,14 +811,16 @@ void *dl_allocate_safe(size_t size) {
   dest_int[0] = static_cast<int>(size);
   dest_int[1] = static_cast<int>(size);
   dest_int[2] = 0;
-  (static_cast <char *> (dest))[size + 12] = '\0';
+  const int64_t hash = 0;
+  memcpy(dest_int + 3, &hash, sizeof(hash));
+  (static_cast <char *> (dest))[size + STRING_RAW_HEADER_SIZE] = '\0';
 
-//  fprintf (stderr, "Allocate string of len %d at %p\n", (int)size, (void *)(dest_int + 3));
-//  for (int i = 0; i < (int)size + 13; i++) {
-//    fprintf (stderr, "%d: %x(%d)\n", i - 12, static_cast <char *> (dest)[i], static_cast <char *> (dest)[i]);
+//  fprintf (stderr, "Allocate string of len %d at %p\n", (int)size, static_cast <char *> (dest) + STRING_RAW_HEADER_SIZE);
+//  for (int i = 0; i < (int)size + STRING_RAW_HEADER_SIZE + 1; i++) {
+//    fprintf (stderr, "%d: %x(%d)\n", i - STRING_RAW_HEADER_SIZE, static_cast <char *> (dest)[i], static_cast <char *> (dest)[i]);
 //  }
 
-  return (void *)(dest_int + 3);
+  return static_cast <char *> (dest) + STRING_RAW_HEADER_SIZE;
 }
 
 int alloc_net_event(slot_id_t slot_id, net_event_type_t type, net_event_t **res) {
@@ -858,6 +879,13 @@ int create_rpc_answer_event(slot_id_t slot_id, int len, net_event_t **res) {
   return 1;
 }
 
+void unalloc_rpc_answer_event(net_event_t *event) {
+  if (event->result != nullptr) {
+    dl::deallocate(event->result - STRING_RAW_HEADER_SIZE, event->result_len + STRING_RAW_HEADER_SIZE + 1);
+  }
+  unalloc_net_event(event);
+}
+
 int net_events_empty() {
   return net_events.empty();
 }
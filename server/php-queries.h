@@ -85,6 +85,7 @@ struct chain_t {
 #define PHPQ_NETQ 0x3d780000
 #define PHPQ_WAIT 0x728a0000
 #define PHPQ_HTTP_LOAD_POST 0x5ac20000
+#define PHPQ_HTTP_SEND_CHUNK 0x6b1e0000
 #define NETQ_PACKET 1234
 
 #define PNETF_IMMEDIATE 16
@@ -150,6 +151,20 @@ struct php_query_http_load_post_t {
   int max_len;
 };
 
+/** send a part of chunked http answer query **/
+struct php_query_http_send_chunk_answer_t {
+  int sent;
+};
+
+struct php_query_http_send_chunk_t {
+  php_query_base_t base;
+
+  const char *headers;
+  int headers_len;
+  const char *data;
+  int data_len;
+};
+
 
 /** net query **/
 struct data_reader_t {
@@ -331,6 +346,8 @@ void free_net_query(net_query_t *query);
 
 int create_rpc_error_event(slot_id_t slot_id, int error_code, const char *error_message, net_event_t **res);
 int create_rpc_answer_event(slot_id_t slot_id, int len, net_event_t **res);
+// only the event created the last can be dropped
+void unalloc_rpc_answer_event(net_event_t *event);
 int net_events_empty();
 
 void php_queries_start();
@@ -350,6 +367,8 @@ int get_net_queries_count();
 int get_engine_uptime();
 const char *get_engine_version();
 int http_load_long_query(char *buf, int min_len, int max_len);
+// sends headers (if any) and data to the client immediately, returns false if the connection doesn't support chunked answers
+bool http_send_chunk(const char *headers, int headers_len, const char *data, int data_len);
 void http_set_result(const char *headers, int headers_len, const char *body, int body_len, int exit_code);
 void rpc_answer(const char *res, int res_len);
 void rpc_set_result(const char *body, int body_len, int exit_code);
@@ -68,7 +68,7 @@ void http_query_data_free(http_query_data *d) {
   free(d);
 }
 
-rpc_query_data *rpc_query_data_create(int *data, int len, long long req_id, unsigned int ip, short port, short pid, int utime) {
+rpc_query_data *rpc_query_data_create(int *data, int len, long long req_id, unsigned int ip, short port, short pid, int utime, int supported_compression_version) {
   rpc_query_data *d = (rpc_query_data *)malloc(sizeof(rpc_query_data));
 
   d->data = (int *)memdup(data, sizeof(int) * len);
@@ -81,6 +81,8 @@ rpc_query_data *rpc_query_data_create(int *data, int len, long long req_id, unsi
   d->pid = pid;
   d->utime = utime;
 
+  d->supported_compression_version = supported_compression_version;
+
   return d;
 }
 
@@ -28,9 +28,12 @@ struct rpc_query_data {
   short port;
   short pid;
   int utime;
+
+  // from the query header, the answer may be compressed with it
+  int supported_compression_version;
 };
 
-rpc_query_data *rpc_query_data_create(int *data, int len, long long req_id, unsigned int ip, short port, short pid, int utime);
+rpc_query_data *rpc_query_data_create(int *data, int len, long long req_id, unsigned int ip, short port, short pid, int utime, int supported_compression_version);
 void rpc_query_data_free(rpc_query_data *d);
 
 /** php_query_data **/
@@ -17,6 +17,7 @@
 #include "common/fast-backtrace.h"
 #include "common/kernel-version.h"
 #include "common/kprintf.h"
+#include "common/parallel/seqlock.h"
 #include "common/server/crash-dump.h"
 #include "common/server/signals.h"
 #include "common/wrappers/madvise.h"
@@ -27,6 +28,7 @@
 #include "runtime/exception.h"
 #include "runtime/interface.h"
 #include "runtime/profiler.h"
+#include "server/latency-histograms.h"
 #include "server/php-engine-vars.h"
 #include "server/php-worker-stats.h"
 
@@ -45,12 +47,16 @@ void PHPScriptBase::error(const char *error_message, script_error_t error_type)
   current_script->state = run_state_t::error;
   current_script->error_message = error_message;
   current_script->error_type = error_type;
-  stack_end = reinterpret_cast<char *>(exit_context.uc_stack.ss_sp) + exit_context.uc_stack.ss_size;
+  stack_end = nullptr;
 #if ASAN7_ENABLED
   __sanitizer_finish_switch_fiber(nullptr, nullptr, nullptr);
-  __sanitizer_start_switch_fiber(nullptr, exit_context.uc_stack.ss_sp, exit_context.uc_stack.ss_size);
+  __sanitizer_start_switch_fiber(nullptr, nullptr, 0);
 #endif
-  setcontext(&exit_context);
+  // error may be called from a signal handler, which signal is blocked until the handler returns
+  sigprocmask(SIG_SETMASK, &exit_sigmask, nullptr);
+  // the script context is abandoned, it will be made anew by init()
+  fiber_context_switch(&current_script->run_context, &exit_context);
+  assert ("unreachable point" && 0);
 }
 
 void PHPScriptBase::check_tl() {
@@ -123,11 +129,8 @@ void PHPScriptBase::init(script_t *script, php_query_data *data_to_set) {
 
   assert (state == run_state_t::before_init);
 
-  getcontext(&run_context);
-  run_context.uc_stack.ss_sp = run_stack;
-  run_context.uc_stack.ss_size = stack_size;
-  run_context.uc_link = nullptr;
-  makecontext(&run_context, &cur_run, 0);
+  fiber_context_make(&run_context, run_stack, stack_size, &cur_run);
+  sigprocmask(SIG_SETMASK, nullptr, &exit_sigmask);
 
   run_main = script;
   data = data_to_set;
@@ -147,29 +150,30 @@ void PHPScriptBase::init(script_t *script, php_query_data *data_to_set) {
   PHPScriptBase::ml_flag = false;
 }
 
-int PHPScriptBase::swapcontext_helper(ucontext_t *oucp, const ucontext_t *ucp) {
-  stack_end = reinterpret_cast<char *>(ucp->uc_stack.ss_sp) + ucp->uc_stack.ss_size;
+void PHPScriptBase::switch_context(fiber_context_t *from, const fiber_context_t *to, char *to_stack, size_t to_stack_size) {
+  stack_end = to_stack ? to_stack + to_stack_size : nullptr;
 #if ASAN7_ENABLED
   if (fiber_is_started) {
     __sanitizer_finish_switch_fiber(nullptr, nullptr, nullptr);
   }
   fiber_is_started = true;
-  __sanitizer_start_switch_fiber(nullptr, ucp->uc_stack.ss_sp, ucp->uc_stack.ss_size);
+  __sanitizer_start_switch_fiber(nullptr, to_stack, to_stack_size);
 #endif
 
-  return swapcontext(oucp, ucp);
+  fiber_context_switch(from, to);
 }
+
 void PHPScriptBase::pause() {
   //fprintf (stderr, "pause: \n");
   is_running = false;
-  assert (swapcontext_helper(&run_context, &exit_context) == 0);
+  switch_context(&run_context, &exit_context, nullptr, 0);
   is_running = true;
   check_tl();
   //fprintf (stderr, "pause: ended\n");
 }
 
 void PHPScriptBase::resume() {
-  assert (swapcontext_helper(&exit_context, &run_context) == 0);
+  switch_context(&exit_context, &run_context, run_stack, stack_size);
 }
 
 void dump_query_stats() {
@@ -243,6 +247,20 @@ run_state_t PHPScriptBase::iterate() {
   return state;
 }
 
+static void record_request_latency(const php_query_data *data, double script_time, double net_time, int64_t memory_used, int64_t real_memory_used) {
+  // the requests are broken down by the script URI or by the RPC function magic
+  char endpoint[32] = "unknown";
+  const char *endpoint_name = endpoint;
+  size_t endpoint_len = strlen(endpoint);
+  if (data != nullptr && data->http_data != nullptr) {
+    endpoint_name = data->http_data->uri;
+    endpoint_len = static_cast<size_t>(data->http_data->uri_len);
+  } else if (data != nullptr && data->rpc_data != nullptr && data->rpc_data->len > 0) {
+    endpoint_len = static_cast<size_t>(snprintf(endpoint, sizeof(endpoint), "rpc:0x%08x", static_cast<unsigned>(data->rpc_data->data[0])));
+  }
+  record_request_latency(endpoint_name, endpoint_len, script_time, net_time, memory_used, real_memory_used);
+}
+
 void PHPScriptBase::finish() {
   assert (state == run_state_t::finished || state == run_state_t::error);
   auto save_state = state;
@@ -253,6 +271,7 @@ void PHPScriptBase::finish() {
   update_net_time();
   PhpWorkerStats::get_local().add_stats(script_time, net_time, queries_cnt,
                                         script_mem_stats.max_memory_used, script_mem_stats.max_real_memory_used, save_error_type);
+  record_request_latency(data, script_time, net_time, script_mem_stats.max_memory_used, script_mem_stats.max_real_memory_used);
   if (save_state == run_state_t::error) {
     assert (error_message != nullptr);
     kprintf("Critical error during script execution: %s\n", error_message);
@@ -396,7 +415,8 @@ int PHPScriptBase::get_net_queries_count() const {
 
 
 PHPScriptBase *volatile PHPScriptBase::current_script;
-ucontext_t PHPScriptBase::exit_context;
+fiber_context_t PHPScriptBase::exit_context;
+sigset_t PHPScriptBase::exit_sigmask;
 volatile bool PHPScriptBase::is_running = false;
 volatile bool PHPScriptBase::tl_flag = false;
 volatile bool PHPScriptBase::ml_flag = false;
@@ -662,10 +682,47 @@ static php_immediate_stats_t *get_new_imm_stats() {
   return &imm_stats[imm_stats_i ^ 1];
 }
 
+static vk::seqlock<php_immediate_stats_t> *imm_stats_slots;
+static bool published_ready_for_accept;
+
+void init_imm_stats_slots() {
+  void *mem = mmap(nullptr, sizeof(vk::seqlock<php_immediate_stats_t>) * MAX_WORKERS, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+  dl_passert(mem != MAP_FAILED, "can't allocate the shared memory for the workers stats");
+  imm_stats_slots = new(mem) vk::seqlock<php_immediate_stats_t>[MAX_WORKERS];
+}
+
+void reset_imm_stats_slot(int slot_id) {
+  if (imm_stats_slots) {
+    imm_stats_slots[slot_id].reset();
+  }
+}
+
+bool read_imm_stats_slot(int slot_id, php_immediate_stats_t *istats) {
+  return imm_stats_slots && imm_stats_slots[slot_id].try_load(*istats);
+}
+
+void publish_imm_stats() {
+  if (imm_stats_slots && 0 <= logname_id && logname_id < MAX_WORKERS) {
+    const php_immediate_stats_t *istats = get_imm_stats();
+    published_ready_for_accept = istats->is_ready_for_accept;
+    // it's called from the script as well, a timeout mustn't interrupt the store
+    dl::CriticalSectionGuard critical_section;
+    imm_stats_slots[logname_id].store(*istats);
+  }
+}
+
+// is_ready_for_accept changes with the connections, not with the server status
+void publish_imm_stats_if_ready_for_accept_changed() {
+  if (published_ready_for_accept != (active_special_connections != max_special_connections)) {
+    publish_imm_stats();
+  }
+}
+
 static void upd_imm_stats() {
   int x = imm_stats_i;
   imm_stats_i = 1 ^ x;
   memcpy(get_new_imm_stats(), get_imm_stats(), sizeof(php_immediate_stats_t));
+  publish_imm_stats();
 }
 
 enum server_status_t {
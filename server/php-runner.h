@@ -4,9 +4,10 @@
 
 #pragma once
 
-#include <ucontext.h>
+#include <csignal>
 
 #include "common/dl-utils-lite.h"
+#include "common/fiber-context.h"
 #include "common/sanitizer.h"
 
 #include "server/php-engine-vars.h"
@@ -100,6 +101,14 @@ void idle_server_status();
 void wait_net_server_status();
 void running_server_status();
 
+// every worker publishes its immediate stats to the shared memory slot of its logname_id,
+// so the master reads them without signalling the worker and waiting for an answer through the pipe
+void init_imm_stats_slots();
+void reset_imm_stats_slot(int slot_id);
+bool read_imm_stats_slot(int slot_id, php_immediate_stats_t *istats);
+void publish_imm_stats();
+void publish_imm_stats_if_ready_for_accept_changed();
+
 class PHPScriptBase;
 
 class PHPScriptBase {
@@ -110,12 +119,14 @@ private:
 #if ASAN7_ENABLED
   bool fiber_is_started = false;
 #endif
-  int swapcontext_helper(ucontext_t *oucp, const ucontext_t *ucp);
+  void switch_context(fiber_context_t *from, const fiber_context_t *to, char *to_stack, size_t to_stack_size);
 
 public:
 
   static PHPScriptBase *volatile current_script;
-  static ucontext_t exit_context;
+  static fiber_context_t exit_context;
+  // fiber_context_switch() doesn't restore the signal mask, so it is restored explicitly on leaving a signal handler by error()
+  static sigset_t exit_sigmask;
   volatile static bool is_running;
   volatile static bool tl_flag;
   volatile static bool ml_flag;
@@ -126,7 +137,7 @@ public:
   void *query;
   char *run_stack, *protected_end, *run_stack_end, *run_mem;
   size_t mem_size, stack_size;
-  ucontext_t run_context;
+  fiber_context_t run_context;
 
   script_t *run_main;
   php_query_data *data;
@@ -28,6 +28,8 @@ struct php_worker {
 
   bool paused;
   bool terminate_flag;
+  // the query is dropped from the full pending queue, it is answered with an error without running the script
+  bool shed;
   script_error_t terminate_reason;
   const char *error_message;
 
@@ -39,11 +41,19 @@ struct php_worker {
   double init_time;
   double start_time;
   double finish_time;
+  // when the client stops waiting for the answer (0 if it isn't told), the query isn't started after that
+  double client_deadline;
 
   php_worker_state_t state;
   php_worker_mode_t mode;
 
   long long req_id;
   int target_fd;
+
+  // a part of the http answer is already sent by chunks
+  bool answer_chunked;
+
+  // bytes of the http request body which are left in the connection to be loaded by the script on demand
+  int post_data_left;
 };
 
@@ -0,0 +1,97 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <random>
+
+#include "runtime/allocator.h"
+#include "runtime/kphp_core.h"
+
+namespace {
+
+void init_script_memory() noexcept {
+  static std::array<char, 256 * 1024 * 1024> memory;
+  static bool inited = false;
+  if (!inited) {
+    dl::global_init_script_allocator();
+    dl::init_script_allocator(memory.data(), memory.size());
+    inited = true;
+  }
+}
+
+array<string> make_keys(int64_t n, size_t key_len) noexcept {
+  init_script_memory();
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> dist{'a', 'z'};
+  array<string> keys{array_size{n, 0, true}};
+  for (int64_t i = 0; i < n; ++i) {
+    string key{static_cast<string::size_type>(key_len), true};
+    for (size_t j = 0; j < key_len; ++j) {
+      key[j] = static_cast<char>(dist(gen));
+    }
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+} // namespace
+
+static void BM_array_string_keys_get(benchmark::State &state) {
+  const array<string> keys = make_keys(state.range(0), state.range(1));
+  array<mixed> arr;
+  for (const auto &key : keys) {
+    arr.set_value(key.get_value(), key.get_key().to_int());
+  }
+
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (const auto &key : keys) {
+      sum += arr.get_value(key.get_value()).as_int();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * keys.count());
+}
+BENCHMARK(BM_array_string_keys_get)->RangeMultiplier(8)->Ranges({{64, 64 << 12}, {8, 64}});
+
+static void BM_array_string_keys_isset(benchmark::State &state) {
+  const array<string> keys = make_keys(state.range(0), state.range(1));
+  array<mixed> arr;
+  for (const auto &key : keys) {
+    arr.set_value(key.get_value(), 1);
+  }
+
+  for (auto _ : state) {
+    int64_t found = 0;
+    for (const auto &key : keys) {
+      found += arr.isset(key.get_value());
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations() * keys.count());
+}
+BENCHMARK(BM_array_string_keys_isset)->RangeMultiplier(8)->Ranges({{64, 64 << 12}, {8, 64}});
+
+static void BM_array_string_keys_const_keys(benchmark::State &state) {
+  // emulates the compiled code: the same key strings are used again and again
+  const array<string> keys = make_keys(16, state.range(0));
+  array<mixed> arr;
+  for (const auto &key : keys) {
+    arr.set_value(key.get_value(), 1);
+  }
+
+  for (auto _ : state) {
+    int64_t found = 0;
+    for (int i = 0; i < 64; ++i) {
+      for (const auto &key : keys) {
+        found += arr.get_value(key.get_value()).as_int();
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations() * 64 * keys.count());
+}
+BENCHMARK(BM_array_string_keys_const_keys)->RangeMultiplier(4)->Range(8, 512);
@@ -132,3 +132,54 @@ TEST(array_test, test_mutate_shared_map) {
   ASSERT_EQ(arr_copy.get_reference_counter(), 1);
   ASSERT_FALSE(arr_copy.is_equal_inner_pointer(arr));
 }
+
+TEST(array_test, test_string_keys_insert_unset_find) {
+  array<int64_t> arr;
+  const auto make_key = [](int64_t i) { return string{"key_"}.append(i); };
+
+  for (int64_t i = 0; i < 5000; ++i) {
+    arr.set_value(make_key(i), i);
+  }
+  ASSERT_EQ(arr.count(), 5000);
+
+  // unsetting moves the entries of the probe sequences, all the rest should be still reachable
+  for (int64_t i = 0; i < 5000; i += 3) {
+    arr.unset(make_key(i));
+  }
+  for (int64_t i = 0; i < 5000; ++i) {
+    const int64_t *value = arr.find_value(make_key(i));
+    if (i % 3 == 0) {
+      ASSERT_EQ(value, nullptr);
+    } else {
+      ASSERT_NE(value, nullptr);
+      ASSERT_EQ(*value, i);
+    }
+  }
+  ASSERT_EQ(arr.find_value(string{"key_unknown"}), nullptr);
+
+  // insertion order is kept
+  int64_t prev = -1;
+  for (const auto &it : arr) {
+    ASSERT_GT(it.get_value(), prev);
+    prev = it.get_value();
+  }
+
+  arr.set_value(7, 7);
+  ASSERT_EQ(arr.get_value(make_key(1)), 1);
+  ASSERT_EQ(arr.get_value(7), 7);
+}
+
+TEST(array_test, test_small_string_part_keeps_empty_bucket) {
+  // the map made for int keys has the smallest string part, the lookups must stop at an empty bucket after it's filled
+  array<int64_t> arr{array_size(2, 0, false)};
+  arr.set_value(1, 1);
+  arr.set_value(string{"a"}, 2);
+  arr.set_value(string{"b"}, 3);
+  arr.set_value(string{"c"}, 4);
+
+  ASSERT_EQ(arr.find_value(string{"missing"}), nullptr);
+  arr.set_value(string{"d"}, 5);
+  ASSERT_EQ(arr.count(), 5);
+  ASSERT_EQ(arr.get_value(string{"c"}), 4);
+  ASSERT_EQ(arr.get_value(string{"d"}), 5);
+}
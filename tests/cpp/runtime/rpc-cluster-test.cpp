@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include "runtime/rpc-cluster.h"
+
+namespace {
+
+constexpr int32_t REPLICAS[] = {0, 1, 2};
+constexpr size_t REPLICAS_COUNT = 3;
+
+void warm_up(RpcTargets &targets, int32_t host_num, double latency) {
+  for (uint32_t i = 0; i < RpcLatencyEstimator::WARMUP_SAMPLES; ++i) {
+    targets.on_answer(host_num, latency);
+  }
+}
+
+void add_targets(RpcTargets &targets) {
+  for (int32_t host_num : REPLICAS) {
+    targets.add_target(host_num, "replica" + std::to_string(host_num));
+  }
+}
+
+const RpcTargetStats &get_stats(const std::vector<RpcTargetStats> &stats, int32_t host_num) {
+  return stats.at(static_cast<size_t>(host_num));
+}
+
+} // namespace
+
+TEST(rpc_cluster_test, test_latency_estimator) {
+  RpcLatencyEstimator estimator;
+  ASSERT_FALSE(estimator.is_warm());
+
+  for (int i = 0; i < 100; ++i) {
+    estimator.add(0.010);
+  }
+  ASSERT_TRUE(estimator.is_warm());
+  ASSERT_NEAR(estimator.mean(), 0.010, 1e-6);
+  ASSERT_NEAR(estimator.p95(), 0.010, 1e-6);
+
+  for (int i = 0; i < 100; ++i) {
+    estimator.add(i % 2 ? 0.005 : 0.015);
+  }
+  ASSERT_NEAR(estimator.mean(), 0.010, 0.001);
+  ASSERT_GT(estimator.p95(), 0.015);
+
+  estimator.reset();
+  ASSERT_FALSE(estimator.is_warm());
+  ASSERT_EQ(estimator.mean(), 0);
+}
+
+TEST(rpc_cluster_test, test_faster_replicas_are_preferred) {
+  RpcTargets targets;
+  add_targets(targets);
+  warm_up(targets, 0, 0.010);
+  warm_up(targets, 1, 0.012);
+  warm_up(targets, 2, 0.020);
+
+  int chosen[REPLICAS_COUNT] = {0};
+  for (int i = 0; i < 3000; ++i) {
+    ++chosen[targets.choose_primary(REPLICAS, REPLICAS_COUNT, 0)];
+  }
+  ASSERT_GT(chosen[0], chosen[1]);
+  ASSERT_GT(chosen[1], chosen[2]);
+  // the load is still spread
+  ASSERT_GT(chosen[2], 0);
+
+  const auto stats = targets.get_stats(0);
+  ASSERT_EQ(get_stats(stats, 0).queries, chosen[0]);
+  ASSERT_EQ(get_stats(stats, 2).ejections, 0);
+}
+
+TEST(rpc_cluster_test, test_slow_replica_is_ejected) {
+  RpcTargets targets;
+  add_targets(targets);
+  warm_up(targets, 0, 0.010);
+  warm_up(targets, 1, 0.010);
+  warm_up(targets, 2, 0.100);
+
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_NE(targets.choose_primary(REPLICAS, REPLICAS_COUNT, 1), 2);
+  }
+  ASSERT_EQ(targets.choose_hedge(REPLICAS, REPLICAS_COUNT, 0, 1), 1);
+  auto stats = targets.get_stats(1);
+  ASSERT_EQ(get_stats(stats, 2).ejections, 1);
+  ASSERT_TRUE(get_stats(stats, 2).ejected);
+
+  // the replica is taken back after the ejection time expires
+  const double now = 1 + RpcTargets::EJECTION_TIME;
+  bool chosen = false;
+  for (int i = 0; i < 1000 && !chosen; ++i) {
+    chosen = targets.choose_primary(REPLICAS, REPLICAS_COUNT, now) == 2;
+  }
+  ASSERT_TRUE(chosen);
+  stats = targets.get_stats(now);
+  ASSERT_FALSE(get_stats(stats, 2).ejected);
+}
+
+TEST(rpc_cluster_test, test_last_healthy_replica_is_not_ejected) {
+  RpcTargets targets;
+  add_targets(targets);
+  warm_up(targets, 1, 0.010);
+  warm_up(targets, 2, 0.100);
+  for (uint32_t i = 0; i < RpcTargets::OUTLIER_CONSECUTIVE_ERRORS; ++i) {
+    targets.on_error(1, 0);
+  }
+
+  const int32_t pair[] = {1, 2};
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(targets.choose_primary(pair, 2, 0), 2);
+  }
+  const auto stats = targets.get_stats(0);
+  ASSERT_EQ(get_stats(stats, 1).ejections, 1);
+  ASSERT_EQ(get_stats(stats, 2).ejections, 0);
+}
+
+TEST(rpc_cluster_test, test_failing_replica_is_ejected) {
+  RpcTargets targets;
+  add_targets(targets);
+
+  for (uint32_t i = 0; i < RpcTargets::OUTLIER_CONSECUTIVE_ERRORS; ++i) {
+    targets.on_error(1, 0);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_NE(targets.choose_primary(REPLICAS, REPLICAS_COUNT, 0), 1);
+  }
+  const auto stats = targets.get_stats(0);
+  ASSERT_EQ(get_stats(stats, 1).errors, RpcTargets::OUTLIER_CONSECUTIVE_ERRORS);
+  ASSERT_EQ(get_stats(stats, 1).ejections, 1);
+
+  // all the replicas are ejected, the queries are sent anyway
+  const int32_t single[] = {1};
+  ASSERT_EQ(targets.choose_primary(single, 1, 0), 1);
+}
+
+TEST(rpc_cluster_test, test_hedging) {
+  RpcTargets targets;
+  add_targets(targets);
+  ASSERT_LT(targets.get_hedge_delay(0), 0);
+
+  warm_up(targets, 0, 0.010);
+  warm_up(targets, 1, 0.020);
+  for (int i = 0; i < 100; ++i) {
+    targets.choose_primary(REPLICAS, REPLICAS_COUNT, 0);
+  }
+  ASSERT_NEAR(targets.get_hedge_delay(0), 0.010, 0.002);
+
+  // the replica with the unknown latency is tried first
+  ASSERT_EQ(targets.choose_hedge(REPLICAS, REPLICAS_COUNT, 0, 0), 2);
+  ASSERT_EQ(targets.choose_hedge(REPLICAS, 2, 0, 0), 1);
+  ASSERT_EQ(targets.choose_hedge(REPLICAS, 1, 0, 0), -1);
+
+  for (int i = 0; i < 10; ++i) {
+    targets.on_hedge(1);
+  }
+  targets.on_hedge_win(1);
+  // the hedges are limited by the ratio to the queries
+  ASSERT_LT(targets.get_hedge_delay(0), 0);
+
+  const auto stats = targets.get_stats(0);
+  ASSERT_EQ(get_stats(stats, 1).hedges, 10);
+  ASSERT_EQ(get_stats(stats, 1).hedge_wins, 1);
+}
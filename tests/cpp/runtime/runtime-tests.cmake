@@ -12,6 +12,9 @@ prepend(RUNTIME_TESTS_SOURCES ${BASE_DIR}/tests/cpp/runtime/
         memory_resource/details/memory_chunk_tree-test.cpp
         memory_resource/details/memory_ordered_chunk_list-test.cpp
         memory_resource/unsynchronized_pool_resource-test.cpp
-        string-test.cpp)
+        rpc-cluster-test.cpp
+        sort-test.cpp
+        string-test.cpp
+        superglobals-test.cpp)
 
 vk_add_unittest(runtime "${RUNTIME_LIBS};${RUNTIME_LINK_TEST_LIBS}" ${RUNTIME_TESTS_SOURCES})
@@ -0,0 +1,103 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+#include "runtime/allocator.h"
+#include "runtime/array_functions.h"
+#include "runtime/kphp_core.h"
+
+namespace {
+
+enum Pattern {
+  random_values,
+  sorted_values,
+  reversed_values,
+  many_duplicates
+};
+
+void init_script_memory() noexcept {
+  static std::array<char, 64 * 1024 * 1024> memory;
+  static bool inited = false;
+  if (!inited) {
+    dl::global_init_script_allocator();
+    dl::init_script_allocator(memory.data(), memory.size());
+    inited = true;
+  }
+}
+
+std::vector<int64_t> make_input(int64_t size, int64_t pattern) {
+  init_script_memory();
+  std::mt19937_64 gen{42};
+  std::vector<int64_t> values(size);
+  std::generate(values.begin(), values.end(), [&gen] { return static_cast<int64_t>(gen()); });
+  switch (pattern) {
+    case sorted_values:
+      std::sort(values.begin(), values.end());
+      break;
+    case reversed_values:
+      std::sort(values.rbegin(), values.rend());
+      break;
+    case many_duplicates:
+      for (auto &value : values) {
+        value %= 16;
+      }
+      break;
+    default:
+      break;
+  }
+  return values;
+}
+
+// a comparator which is unknown for the radix sort
+struct generic_compare {
+  bool operator()(int64_t lhs, int64_t rhs) const {
+    return lhs > rhs;
+  }
+};
+
+template<class Sorter>
+void run_sort_benchmark(benchmark::State &state, const Sorter &sorter) {
+  const auto input = make_input(state.range(0), state.range(1));
+  std::vector<int64_t> values;
+  for (auto _ : state) {
+    state.PauseTiming();
+    values = input;
+    state.ResumeTiming();
+    sorter(values.data(), values.data() + values.size());
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+static void BM_sort_std(benchmark::State &state) {
+  run_sort_benchmark(state, [](int64_t *begin, int64_t *end) { std::sort(begin, end); });
+}
+
+static void BM_sort_pdq(benchmark::State &state) {
+  run_sort_benchmark(state, [](int64_t *begin, int64_t *end) { dl::sort(begin, end, generic_compare{}); });
+}
+
+static void BM_sort_radix(benchmark::State &state) {
+  run_sort_benchmark(state, [](int64_t *begin, int64_t *end) { dl::sort(begin, end, sort_compare_numeric<int64_t>{}); });
+}
+
+static void BM_sort_stable(benchmark::State &state) {
+  run_sort_benchmark(state, [](int64_t *begin, int64_t *end) { dl::stable_sort(begin, end, generic_compare{}); });
+}
+
+#define SORT_BENCHMARK_ARGS \
+  ArgsProduct({benchmark::CreateRange(64, 1 << 20, 16), {random_values, sorted_values, reversed_values, many_duplicates}})
+
+BENCHMARK(BM_sort_std)->SORT_BENCHMARK_ARGS;
+BENCHMARK(BM_sort_pdq)->SORT_BENCHMARK_ARGS;
+BENCHMARK(BM_sort_radix)->SORT_BENCHMARK_ARGS;
+BENCHMARK(BM_sort_stable)->SORT_BENCHMARK_ARGS;
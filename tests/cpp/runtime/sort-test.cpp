@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "runtime/array_functions.h"
+#include "runtime/kphp_core.h"
+
+namespace {
+
+struct ascending {
+  bool operator()(int64_t lhs, int64_t rhs) const {
+    return lhs > rhs;
+  }
+};
+
+std::vector<std::vector<int64_t>> make_inputs(size_t size) {
+  std::mt19937_64 gen{size};
+  std::vector<int64_t> random(size);
+  std::generate(random.begin(), random.end(), [&gen] { return static_cast<int64_t>(gen()); });
+
+  std::vector<int64_t> sorted = random;
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<int64_t> reversed{sorted.rbegin(), sorted.rend()};
+
+  std::vector<int64_t> duplicates(size);
+  std::generate(duplicates.begin(), duplicates.end(), [&gen] { return static_cast<int64_t>(gen() % 4) - 2; });
+
+  std::vector<int64_t> organ_pipe(size);
+  for (size_t i = 0; i < size; ++i) {
+    organ_pipe[i] = std::min(i, size - i);
+  }
+  return {random, sorted, reversed, duplicates, organ_pipe};
+}
+
+} // namespace
+
+TEST(sort_test, test_sort_patterns) {
+  for (size_t size : {0, 1, 2, 5, 23, 24, 100, 129, 255, 256, 1000, 10000}) {
+    for (auto input : make_inputs(size)) {
+      auto expected = input;
+      std::sort(expected.begin(), expected.end());
+
+      auto pdq = input;
+      dl::sort(pdq.data(), pdq.data() + pdq.size(), ascending{});
+      ASSERT_EQ(pdq, expected);
+
+      auto radix = input;
+      dl::sort(radix.data(), radix.data() + radix.size(), sort_compare_numeric<int64_t>{});
+      ASSERT_EQ(radix, expected);
+
+      auto stable = input;
+      dl::stable_sort(stable.data(), stable.data() + stable.size(), ascending{});
+      ASSERT_EQ(stable, expected);
+
+      std::reverse(expected.begin(), expected.end());
+      auto radix_desc = input;
+      dl::sort(radix_desc.data(), radix_desc.data() + radix_desc.size(), rsort_compare_numeric<int64_t>{});
+      ASSERT_EQ(radix_desc, expected);
+    }
+  }
+}
+
+TEST(sort_test, test_radix_sort_double) {
+  std::mt19937_64 gen{42};
+  std::uniform_real_distribution<double> dist{-1e6, 1e6};
+  std::vector<double> values(5000);
+  std::generate(values.begin(), values.end(), [&] { return dist(gen); });
+  values[0] = 0.0;
+  values[1] = std::numeric_limits<double>::infinity();
+  values[2] = -std::numeric_limits<double>::infinity();
+
+  auto expected = values;
+  std::sort(expected.begin(), expected.end());
+  dl::sort(values.data(), values.data() + values.size(), sort_compare_numeric<double>{});
+  ASSERT_EQ(values, expected);
+}
+
+TEST(sort_test, test_radix_sort_double_zeros_and_nan) {
+  std::mt19937_64 gen{7};
+  std::vector<double> values(1000);
+  std::generate(values.begin(), values.end(), [&gen] {
+    const double zeros[] = {-0.0, 0.0};
+    return gen() % 2 ? zeros[gen() % 2] : static_cast<double>(static_cast<int64_t>(gen() % 200) - 100);
+  });
+
+  // the equal zeros keep their order, as the stable sort by the comparator keeps it
+  auto expected = values;
+  std::stable_sort(expected.begin(), expected.end());
+  auto radix = values;
+  dl::sort(radix.data(), radix.data() + radix.size(), sort_compare_numeric<double>{});
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(radix[i], expected[i]);
+    ASSERT_EQ(std::signbit(radix[i]), std::signbit(expected[i]));
+  }
+
+  // the values with NaN are sorted by the comparator
+  values[values.size() / 2] = std::numeric_limits<double>::quiet_NaN();
+  auto pdq = values;
+  dl::sort(pdq.data(), pdq.data() + pdq.size(), [](double lhs, double rhs) { return lhs > rhs; });
+  radix = values;
+  dl::sort(radix.data(), radix.data() + radix.size(), sort_compare_numeric<double>{});
+  ASSERT_EQ(std::memcmp(radix.data(), pdq.data(), values.size() * sizeof(double)), 0);
+}
+
+TEST(sort_test, test_inconsistent_compare) {
+  std::mt19937 gen{1};
+  for (size_t size : {10, 100, 1000, 10000}) {
+    std::vector<int64_t> values(size);
+    std::iota(values.begin(), values.end(), 0);
+    const auto random_compare = [&gen](int64_t, int64_t) { return static_cast<int64_t>(gen() % 3) - 1; };
+
+    dl::sort(values.data(), values.data() + values.size(), random_compare);
+    dl::stable_sort(values.data(), values.data() + values.size(), random_compare);
+
+    // the order is random, but all the elements are still there
+    std::sort(values.begin(), values.end());
+    for (size_t i = 0; i < size; ++i) {
+      ASSERT_EQ(values[i], i);
+    }
+  }
+}
+
+TEST(sort_test, test_stable_sort) {
+  array<string> arr;
+  for (int64_t i = 0; i < 1000; ++i) {
+    arr.push_back(string{}.append(i % 10).append("_").append(i));
+  }
+  const auto by_first_char = [](const string &lhs, const string &rhs) { return int64_t{lhs[0]} - int64_t{rhs[0]}; };
+
+  auto vector = arr;
+  vector.stable_sort(by_first_char, true);
+  ASSERT_TRUE(vector.is_vector());
+  for (int64_t i = 1; i < vector.count(); ++i) {
+    const string &prev = vector.get_value(i - 1);
+    const string &cur = vector.get_value(i);
+    ASSERT_LE(prev[0], cur[0]);
+    if (prev[0] == cur[0]) {
+      ASSERT_LT(prev.substr(2, prev.size() - 2).to_int(), cur.substr(2, cur.size() - 2).to_int());
+    }
+  }
+
+  auto map = arr;
+  map.stable_sort(by_first_char, false);
+  ASSERT_FALSE(map.is_vector());
+  int64_t prev_key = -1;
+  char prev_char = 0;
+  for (const auto &it : map) {
+    const char cur_char = it.get_value()[0];
+    ASSERT_LE(prev_char, cur_char);
+    if (prev_char == cur_char) {
+      ASSERT_LT(prev_key, it.get_key().to_int());
+    }
+    prev_char = cur_char;
+    prev_key = it.get_key().to_int();
+  }
+}
@@ -98,4 +98,46 @@ TEST(string_test, test_hex_to_int) {
   ASSERT_EQ(hex_to_int('D'), 13);
   ASSERT_EQ(hex_to_int('E'), 14);
   ASSERT_EQ(hex_to_int('F'), 15);
-}
\ No newline at end of file
+}
+TEST(string_test, test_cached_hash) {
+  string str{"hello world"};
+  ASSERT_EQ(str.hash(), string_hash("hello world", 11));
+  ASSERT_EQ(str.hash(), string_hash("hello world", 11));
+
+  const string copy = str;
+  str.append("!");
+  ASSERT_EQ(copy.hash(), string_hash("hello world", 11));
+  ASSERT_EQ(str.hash(), string_hash("hello world!", 12));
+
+  str.push_back('?');
+  ASSERT_EQ(str.hash(), string_hash("hello world!?", 13));
+
+  str.make_not_shared();
+  str[0] = 'H';
+  ASSERT_EQ(str.hash(), string_hash("Hello world!?", 13));
+
+  str.buffer()[1] = 'E';
+  ASSERT_EQ(str.hash(), string_hash("HEllo world!?", 13));
+
+  str.shrink(5);
+  ASSERT_EQ(str.hash(), string_hash("HEllo", 5));
+
+  str.assign("x");
+  ASSERT_EQ(str.hash(), string_hash("x", 1));
+}
+
+TEST(string_test, test_raw_string_hash) {
+  char mem[64];
+  const int raw_len = string_raw(mem, sizeof(mem), "raw string", 10);
+  ASSERT_EQ(raw_len, string_raw_len(10));
+
+  string str;
+  str.assign_raw(mem);
+  ASSERT_EQ(str, string{"raw string"});
+  ASSERT_TRUE(str.is_reference_counter(ExtraRefCnt::for_global_const));
+  ASSERT_EQ(str.hash(), string_hash("raw string", 10));
+
+  char const_mem[64];
+  auto const_str = string::make_const_string_on_memory("hello", 5, const_mem, sizeof(const_mem));
+  ASSERT_EQ(const_str.hash(), string_hash("hello", 5));
+}
@@ -0,0 +1,56 @@
+#include <cstring>
+#include <gtest/gtest.h>
+
+#include "runtime/interface.h"
+#include "server/php-query-data.h"
+
+namespace {
+
+void init_http_superglobals(const superglobals_usage &usage) {
+  static char uri[] = "/index.php";
+  static char get[] = "a=1&b=2";
+  static char headers[] = "Host: localhost\r\nCookie: c=3\r\n";
+  static char request_method[] = "GET";
+  http_query_data http_data{uri, get, headers, nullptr, request_method,
+                            static_cast<int>(strlen(uri)), static_cast<int>(strlen(get)), static_cast<int>(strlen(headers)), 0,
+                            static_cast<int>(strlen(request_method)), 0, 0, 0};
+  php_query_data data{&http_data, nullptr};
+  set_superglobals_usage(usage);
+  init_superglobals(&data);
+  set_superglobals_usage(superglobals_usage{});
+}
+
+} // namespace
+
+TEST(superglobals_test, test_unused_superglobals_are_not_filled) {
+  superglobals_usage usage;
+  usage.cookie = false;
+  usage.request = false;
+  usage.env = false;
+  init_http_superglobals(usage);
+
+  ASSERT_EQ(v$_GET.to_array().count(), 2);
+  ASSERT_EQ(v$_GET.get_value(string("a")).to_string(), string("1"));
+  ASSERT_EQ(v$_SERVER.get_value(string("SERVER_NAME")).to_string(), string("localhost"));
+  ASSERT_EQ(v$_COOKIE.to_array().count(), 0);
+  ASSERT_EQ(v$_REQUEST.to_array().count(), 0);
+  ASSERT_EQ(v$_ENV.to_array().count(), 0);
+}
+
+TEST(superglobals_test, test_request_fills_its_sources) {
+  superglobals_usage usage;
+  usage.get = false;
+  usage.cookie = false;
+  init_http_superglobals(usage);
+
+  ASSERT_EQ(v$_REQUEST.get_value(string("b")).to_string(), string("2"));
+  ASSERT_EQ(v$_REQUEST.get_value(string("c")).to_string(), string("3"));
+}
+
+TEST(superglobals_test, test_all_superglobals_are_filled_by_default) {
+  init_http_superglobals(superglobals_usage{});
+
+  ASSERT_EQ(v$_GET.to_array().count(), 2);
+  ASSERT_EQ(v$_COOKIE.get_value(string("c")).to_string(), string("3"));
+  ASSERT_EQ(v$_REQUEST.to_array().count(), 3);
+}
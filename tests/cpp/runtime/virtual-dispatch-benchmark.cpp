@@ -0,0 +1,171 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+// Per call overhead of the virtual methods dispatching for hierarchies of 2, 10 and 100 classes:
+//  - switch over the class name hashes, as the virtual methods were generated before,
+//  - switch over the dense class ids, as they are generated now,
+//  - native C++ virtual call, for reference.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t class_hash(uint32_t i) noexcept {
+  // class name hashes are scattered over int32
+  return (i + 1) * 2654435761u ^ 0x5bd1e995u;
+}
+
+struct Base {
+  explicit Base(uint32_t i) noexcept
+    : hash(class_hash(i))
+    , class_id(i + 1)
+    , value(i) {}
+
+  virtual int64_t native_call() const noexcept = 0;
+  virtual int32_t get_hash() const noexcept { return static_cast<int32_t>(hash); }
+  virtual uint32_t get_class_id() const noexcept { return class_id; }
+  virtual ~Base() = default;
+
+  const uint32_t hash;
+  const uint32_t class_id;
+  const int64_t value;
+};
+
+template<uint32_t I>
+struct Derived final : Base {
+  Derived() noexcept
+    : Base(I) {}
+
+  int64_t native_call() const noexcept final {
+    return method(this);
+  }
+
+  static __attribute__((noinline)) int64_t method(const Derived *self) noexcept {
+    return self->value * (I + 1);
+  }
+};
+
+template<uint32_t I>
+int64_t call(const Base *b) noexcept {
+  return Derived<I>::method(static_cast<const Derived<I> *>(b));
+}
+
+#define CASES_2(CASE, base) CASE(base + 0) CASE(base + 1)
+#define CASES_10(CASE, base) CASES_2(CASE, base) CASES_2(CASE, base + 2) CASES_2(CASE, base + 4) CASES_2(CASE, base + 6) CASES_2(CASE, base + 8)
+#define CASES_100(CASE) CASES_10(CASE, 0) CASES_10(CASE, 10) CASES_10(CASE, 20) CASES_10(CASE, 30) CASES_10(CASE, 40) \
+                        CASES_10(CASE, 50) CASES_10(CASE, 60) CASES_10(CASE, 70) CASES_10(CASE, 80) CASES_10(CASE, 90)
+
+#define HASH_CASE(i) case static_cast<int32_t>(class_hash(i)): return call<i>(b);
+#define CLASS_ID_CASE(i) case (i) + 1: return call<i>(b);
+
+__attribute__((noinline)) int64_t dispatch_by_hash_2(const Base *b) noexcept {
+  switch (b->get_hash()) {
+    CASES_2(HASH_CASE, 0)
+    default: return 0;
+  }
+}
+
+__attribute__((noinline)) int64_t dispatch_by_hash_10(const Base *b) noexcept {
+  switch (b->get_hash()) {
+    CASES_10(HASH_CASE, 0)
+    default: return 0;
+  }
+}
+
+__attribute__((noinline)) int64_t dispatch_by_hash_100(const Base *b) noexcept {
+  switch (b->get_hash()) {
+    CASES_100(HASH_CASE)
+    default: return 0;
+  }
+}
+
+__attribute__((noinline)) int64_t dispatch_by_class_id_2(const Base *b) noexcept {
+  switch (b->get_class_id()) {
+    CASES_2(CLASS_ID_CASE, 0)
+    default: return 0;
+  }
+}
+
+__attribute__((noinline)) int64_t dispatch_by_class_id_10(const Base *b) noexcept {
+  switch (b->get_class_id()) {
+    CASES_10(CLASS_ID_CASE, 0)
+    default: return 0;
+  }
+}
+
+__attribute__((noinline)) int64_t dispatch_by_class_id_100(const Base *b) noexcept {
+  switch (b->get_class_id()) {
+    CASES_100(CLASS_ID_CASE)
+    default: return 0;
+  }
+}
+
+#define MAKE_CASE(i) case (i): return std::make_unique<Derived<i>>();
+
+std::unique_ptr<Base> make_instance(uint32_t i) {
+  switch (i) {
+    CASES_100(MAKE_CASE)
+    default: return {};
+  }
+}
+
+std::vector<std::unique_ptr<Base>> make_instances(uint32_t classes) {
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<uint32_t> dist{0, classes - 1};
+  std::vector<std::unique_ptr<Base>> instances;
+  for (int i = 0; i < 1024; ++i) {
+    instances.emplace_back(make_instance(dist(gen)));
+  }
+  return instances;
+}
+
+using Dispatcher = int64_t (*)(const Base *) noexcept;
+
+void run_dispatch_benchmark(benchmark::State &state, uint32_t classes, Dispatcher dispatcher) {
+  const auto instances = make_instances(classes);
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (const auto &instance : instances) {
+      sum += dispatcher(instance.get());
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * instances.size());
+}
+
+int64_t native_dispatch(const Base *b) noexcept {
+  return b->native_call();
+}
+
+} // namespace
+
+static void BM_dispatch_by_hash(benchmark::State &state) {
+  const auto classes = static_cast<uint32_t>(state.range(0));
+  run_dispatch_benchmark(state, classes, classes == 2 ? dispatch_by_hash_2 : classes == 10 ? dispatch_by_hash_10 : dispatch_by_hash_100);
+}
+BENCHMARK(BM_dispatch_by_hash)->Arg(2)->Arg(10)->Arg(100);
+
+static void BM_dispatch_by_class_id(benchmark::State &state) {
+  const auto classes = static_cast<uint32_t>(state.range(0));
+  run_dispatch_benchmark(state, classes, classes == 2 ? dispatch_by_class_id_2 : classes == 10 ? dispatch_by_class_id_10 : dispatch_by_class_id_100);
+}
+BENCHMARK(BM_dispatch_by_class_id)->Arg(2)->Arg(10)->Arg(100);
+
+static void BM_dispatch_native_virtual(benchmark::State &state) {
+  run_dispatch_benchmark(state, static_cast<uint32_t>(state.range(0)), native_dispatch);
+}
+BENCHMARK(BM_dispatch_native_virtual)->Arg(2)->Arg(10)->Arg(100);
+
+static void BM_dispatch_single_implementation(benchmark::State &state) {
+  // a virtual method with the only implementation is a null check and a direct call
+  run_dispatch_benchmark(state, 1, [](const Base *b) noexcept { return b ? call<0>(b) : 0; });
+}
+BENCHMARK(BM_dispatch_single_implementation);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,33 @@
+@ok
+<?php
+
+function test_strtr_many_pairs() {
+  $trans = ["he" => "1", "she" => "2", "his" => "3", "hers" => "4", "h" => "5", "" . 7 => "seven"];
+  var_dump(strtr("ushers and his 77 hershey shells", $trans));
+  var_dump(strtr("nothing to replace", $trans));
+  var_dump(strtr("", $trans));
+  var_dump(strtr("abc", ["a" => "b", "b" => "c", "c" => "a"]));
+  var_dump(strtr("aaaaa", ["aa" => "b", "a" => "c"]));
+  var_dump(strtr("hi all, I said hello world", ["hello" => "hi", "hi" => "hello", "h" => "-"]));
+  var_dump(strtr("abc", []));
+  var_dump(strtr("abc", ["ab" => "x"]));
+}
+
+function test_search_in_long_strings() {
+  $haystack = str_repeat("abcdefghij", 20) . "needle" . str_repeat("klmnopqrst", 20) . "needle";
+  var_dump(strpos($haystack, "needle"));
+  var_dump(strpos($haystack, "needle", 207));
+  var_dump(strpos($haystack, "needles"));
+  var_dump(strrpos($haystack, "needle"));
+  var_dump(strstr($haystack, "jklm"));
+  var_dump(substr_count($haystack, "ee"));
+  var_dump(str_replace("needle", "pin", $haystack));
+  var_dump(str_replace(["needle", "pin", "abc"], ["pin", "nail", ""], $haystack));
+  var_dump(explode("needle", $haystack));
+  var_dump(explode("ij", $haystack, 5));
+  var_dump(explode("j", $haystack, 3));
+  var_dump(explode("jk", "jk"));
+}
+
+test_strtr_many_pairs();
+test_search_in_long_strings();
@@ -0,0 +1,18 @@
+@ok
+<?php
+
+function test_flush() {
+  echo "before flush\n";
+  flush();
+  echo "after flush\n";
+  ob_start();
+  echo "buffered\n";
+  flush();
+  var_dump(ob_get_length());
+  ob_end_flush();
+  flush();
+  var_dump(headers_sent());
+  echo "the end\n";
+}
+
+test_flush();
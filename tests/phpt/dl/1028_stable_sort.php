@@ -0,0 +1,104 @@
+@ok
+<?php
+
+#ifndef KPHP
+// the keys ordered by the comparator, the equal values are ordered by their positions
+function stable_order(array $a, callable $compare) {
+  $keys = array_keys($a);
+  $positions = array_flip($keys);
+  usort($keys, function ($lhs, $rhs) use ($a, $compare, $positions) {
+    return $compare($a[$lhs], $a[$rhs]) ?: $positions[$lhs] - $positions[$rhs];
+  });
+  return $keys;
+}
+
+function usort_stable(array &$a, callable $compare) {
+  $sorted = [];
+  foreach (stable_order($a, $compare) as $key) {
+    $sorted[] = $a[$key];
+  }
+  $a = $sorted;
+}
+
+function uasort_stable(array &$a, callable $compare) {
+  $sorted = [];
+  foreach (stable_order($a, $compare) as $key) {
+    $sorted[$key] = $a[$key];
+  }
+  $a = $sorted;
+}
+#endif
+
+function test_usort_stable() {
+  $records = [];
+  for ($i = 0; $i < 100; ++$i) {
+    $records["r$i"] = [($i * 7) % 5, $i];
+  }
+  usort_stable($records, function ($lhs, $rhs) { return $lhs[0] - $rhs[0]; });
+  foreach ($records as $key => $record) {
+    echo $key, ":", $record[0], ":", $record[1], " ";
+  }
+  echo "\n";
+
+  $small = [3, 1, 2];
+  usort_stable($small, function ($lhs, $rhs) { return $lhs - $rhs; });
+  var_dump($small);
+
+  $empty = [];
+  usort_stable($empty, function ($lhs, $rhs) { return $lhs - $rhs; });
+  var_dump($empty);
+}
+
+function test_uasort_stable() {
+  $words = [];
+  for ($i = 0; $i < 60; ++$i) {
+    $words["w$i"] = str_repeat("x", ($i * 11) % 4);
+  }
+  $words[7] = "xx";
+  $words[-1] = "";
+  uasort_stable($words, function ($lhs, $rhs) { return strlen($lhs) - strlen($rhs); });
+  foreach ($words as $key => $word) {
+    echo $key, ":", strlen($word), " ";
+  }
+  echo "\n";
+}
+
+function test_stable_sort_signed_zeros() {
+  $values = [];
+  for ($i = 0; $i < 300; ++$i) {
+    $values[] = $i % 3 == 0 ? -0.0 : ($i % 3 == 1 ? 0.0 : (($i * 37) % 100) / 10.0 - 5);
+  }
+
+  $stable = $values;
+  usort_stable($stable, function ($lhs, $rhs) { return $lhs <=> $rhs; });
+  foreach ($stable as $value) {
+    echo $value, " ";
+  }
+  echo "\n";
+
+  $rstable = $values;
+  uasort_stable($rstable, function ($lhs, $rhs) { return $rhs <=> $lhs; });
+  foreach ($rstable as $key => $value) {
+    echo $key, ":", $value, " ";
+  }
+  echo "\n";
+
+  // the order of the equal zeros isn't specified for the unstable sorts
+  $sorted = $values;
+  sort($sorted);
+  foreach ($sorted as $value) {
+    echo $value == 0 ? 0 : $value, " ";
+  }
+  echo "\n";
+
+  $rsorted = $values;
+  rsort($rsorted);
+  foreach ($rsorted as $value) {
+    echo $value == 0 ? 0 : $value, " ";
+  }
+  echo "\n";
+}
+
+test_usort_stable();
+test_uasort_stable();
+test_stable_sort_signed_zeros();
@@ -0,0 +1,37 @@
+@ok
+<?php
+
+error_reporting(0);
+
+/**
+ * @param string $body
+ * @param string $modifiers
+ */
+function test_dynamic_pattern($body, $modifiers) {
+  $pattern = "/" . $body . "/" . $modifiers;
+  // the second time the pattern is looked up in the cache of the compiled ones
+  for ($i = 0; $i < 2; ++$i) {
+    $matches = [];
+    var_dump(preg_match($pattern, "abc", $matches));
+    var_dump(preg_replace($pattern, "x", "abc"));
+  }
+}
+
+function test_too_many_subpatterns() {
+  $pattern = "/";
+  for ($i = 0; $i < 1000; ++$i) {
+    $pattern .= "(a)";
+  }
+  $pattern .= "/";
+  // PHP supports more subpatterns than KPHP does, only the survival is checked
+  preg_match($pattern, "abc");
+  preg_match($pattern, "abc");
+  echo "ok\n";
+}
+
+test_dynamic_pattern("a", "k");
+test_dynamic_pattern("\xff", "u");
+test_dynamic_pattern("(a", "");
+test_too_many_subpatterns();
+// the valid patterns work after the invalid ones
+test_dynamic_pattern("b", "");
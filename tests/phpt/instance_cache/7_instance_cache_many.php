@@ -0,0 +1,93 @@
+@ok
+<?php
+
+require_once 'kphp_tester_include.php';
+
+#ifndef KPHP
+function instance_cache_fetch_many(string $type, array $keys, bool $even_if_expired = false) {
+  $result = [];
+  foreach ($keys as $key) {
+    $instance = instance_cache_fetch($type, $key, $even_if_expired);
+    if ($instance) {
+      $result[$key] = $instance;
+    }
+  }
+  return $result;
+}
+
+function instance_cache_store_many(array $values, int $ttl = 0) {
+  $result = [];
+  foreach ($values as $key => $instance) {
+    $result[$key] = instance_cache_store((string)$key, $instance, $ttl);
+  }
+  return $result;
+}
+#endif
+
+/** @kphp-immutable-class */
+class Item {
+  /** @var int */
+  public $id = 0;
+  /** @var string */
+  public $title = "";
+  /** @var int[] */
+  public $tags = [];
+
+  public function __construct(int $id) {
+    $this->id = $id;
+    $this->title = "item #$id";
+    $this->tags = [$id, $id * 2];
+  }
+
+  public function describe(): string {
+    return $this->title . ": " . implode(",", $this->tags);
+  }
+}
+
+/** @kphp-immutable-class */
+class Other {
+  /** @var int */
+  public $x = 1;
+}
+
+function test_store_many() {
+  $items = [];
+  for ($i = 0; $i < 10; ++$i) {
+    $items["item_$i"] = new Item($i);
+  }
+  var_dump(instance_cache_store_many($items));
+  var_dump(instance_cache_store_many([15 => new Item(15)]));
+}
+
+function test_fetch_many() {
+  $keys = [];
+  for ($i = 0; $i < 12; ++$i) {
+    $keys[] = "item_$i";
+  }
+  $keys[] = "15";
+  $items = instance_cache_fetch_many(Item::class, $keys);
+  var_dump(count($items));
+  foreach ($items as $key => $item) {
+    var_dump($key);
+    var_dump($item->describe());
+  }
+  var_dump(count(instance_cache_fetch_many(Item::class, [])));
+  var_dump(count(instance_cache_fetch_many(Item::class, ["unknown_1", "unknown_2"])));
+}
+
+function test_fetch_many_after_delete() {
+  var_dump(instance_cache_delete("item_3"));
+  $items = instance_cache_fetch_many(Item::class, ["item_2", "item_3", "item_4"]);
+  var_dump(array_keys($items));
+}
+
+function test_fetch_many_mismatch_classes() {
+  var_dump(instance_cache_store("other", new Other));
+  $items = @instance_cache_fetch_many(Item::class, ["other", "item_5"]);
+  var_dump(array_keys($items));
+}
+
+test_store_many();
+test_fetch_many();
+test_fetch_many_after_delete();
+test_fetch_many_mismatch_classes();
@@ -0,0 +1,9 @@
+@kphp_should_fail
+/Can not store instance of mutable class X with instance_cache_store_many call/
+<?php
+
+class X {
+  public $x = 1;
+}
+
+instance_cache_store_many(["key" => new X]);
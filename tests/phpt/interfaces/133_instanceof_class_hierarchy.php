@@ -0,0 +1,74 @@
+@ok
+<?php
+
+interface INamed {
+    public function name(): string;
+}
+
+interface ITagged extends INamed {
+}
+
+abstract class Base {
+    public $x = 1;
+}
+
+class A1 extends Base implements INamed {
+    public function name(): string { return "A1"; }
+}
+
+class A2 extends Base {
+}
+
+class A3 extends Base implements ITagged {
+    public function name(): string { return "A3"; }
+}
+
+class A31 extends A3 {
+    public function name(): string { return "A31"; }
+}
+
+class A4 extends A2 {
+}
+
+class Other implements INamed {
+    public function name(): string { return "Other"; }
+}
+
+/**
+ * @param Base[] $items
+ */
+function check_base_items(array $items) {
+    foreach ($items as $item) {
+        var_dump(get_class($item));
+        var_dump($item instanceof Base);
+        var_dump($item instanceof A1);
+        var_dump($item instanceof A2);
+        var_dump($item instanceof A3);
+        var_dump($item instanceof A31);
+        var_dump($item instanceof A4);
+        var_dump($item instanceof INamed);
+        var_dump($item instanceof ITagged);
+        $named = instance_cast($item, INamed::class);
+        var_dump($named ? $named->name() : "not named");
+        $a3 = instance_cast($item, A3::class);
+        var_dump($a3 ? $a3->name() : "not A3");
+    }
+}
+
+/**
+ * @param INamed[] $items
+ */
+function check_named_items(array $items) {
+    foreach ($items as $item) {
+        var_dump($item->name());
+        var_dump($item instanceof Base);
+        var_dump($item instanceof A3);
+        var_dump($item instanceof ITagged);
+        var_dump($item instanceof Other);
+        $base = instance_cast($item, Base::class);
+        var_dump($base ? $base->x : -1);
+    }
+}
+
+check_base_items([new A1, new A2, new A3, new A31, new A4]);
+check_named_items([new A1, new A3, new A31, new Other]);
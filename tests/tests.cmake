@@ -16,3 +16,16 @@ if(KPHP_TESTS)
     include(tests/cpp/runtime/runtime-tests.cmake)
     include(tests/cpp/server/server-tests.cmake)
 endif()
+
+if(KPHP_BENCHMARKS)
+    function(vk_add_benchmark BENCHMARK_NAME SRC_LIBS)
+        set(BENCHMARK_NAME benchmarks-${BENCHMARK_NAME})
+        add_executable(${BENCHMARK_NAME} ${ARGN})
+        target_link_libraries(${BENCHMARK_NAME} PRIVATE benchmark::benchmark ${SRC_LIBS} vk::popular_common)
+        target_link_options(${BENCHMARK_NAME} PRIVATE ${NO_PIE})
+        set_target_properties(${BENCHMARK_NAME} PROPERTIES FOLDER benchmarks)
+    endfunction()
+
+    include(common/common-benchmarks.cmake)
+    include(net/net-benchmarks.cmake)
+endif()